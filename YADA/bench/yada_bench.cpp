@@ -0,0 +1,760 @@
+// Benchmarks for yada's hot paths.
+//
+// Each benchmark is calibrated so one sample runs for at least --min-time-ms,
+// then sampled --samples times. Results are printed to stdout as one JSON
+// object per line (median/MAD/min/p90 nanoseconds per operation plus heap
+// allocations per operation) so runs can be diffed and tracked over time.
+// A human-readable summary is printed to stderr.
+
+// The counting operator new/delete below pair malloc with free correctly,
+// but GCC cannot see that through inlined std::allocator calls
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+#include "food/BasicFood.h"
+#include "food/CompositeFood.h"
+#include "food/FoodDatabase.h"
+#include "food/FoodImporter.h"
+#include "log/FoodLog.h"
+#include "log/LogExporter.h"
+#include "log/TrendEngine.h"
+#include "command/Command.h"
+#include "planner/MealSuggester.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Global allocation counters, fed by the replacement operator new below
+namespace {
+std::atomic<unsigned long long> allocationCount{0};
+std::atomic<unsigned long long> allocationBytes{0};
+}
+
+void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    size_t maxRecords = 1000000;
+    size_t samples = 15;
+    double minTimeMs = 20.0;
+    std::string filter;
+};
+
+Options options;
+
+// Keeps the optimizer from discarding benchmark results
+template <typename T>
+void doNotOptimize(const T& value) {
+#if defined(_MSC_VER)
+    static volatile const void* sink;
+    sink = &value;
+#else
+    asm volatile("" : : "g"(&value) : "memory");
+#endif
+}
+
+double percentile(std::vector<double> values, double fraction) {
+    std::sort(values.begin(), values.end());
+    double position = fraction * (values.size() - 1);
+    size_t lower = static_cast<size_t>(position);
+    size_t upper = std::min(lower + 1, values.size() - 1);
+    return values[lower] + (values[upper] - values[lower]) * (position - lower);
+}
+
+// Runs op enough times to get stable per-operation timings and reports them
+template <typename Op>
+void runBenchmark(const std::string& name, const std::string& params, Op&& op) {
+    if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+        return;
+    }
+
+    // Calibrate: double the batch until it runs for at least minTimeMs
+    size_t iterations = 1;
+    double batchMs = 0.0;
+    while (true) {
+        auto start = Clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            op();
+        }
+        batchMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (batchMs >= options.minTimeMs || iterations >= (1u << 30)) break;
+        iterations *= 2;
+    }
+    // Very slow operations get fewer samples so large inputs stay tractable
+    size_t samples = batchMs > 250.0 ? std::min<size_t>(options.samples, 5) : options.samples;
+
+    std::vector<double> nsPerOp;
+    nsPerOp.reserve(samples);
+    unsigned long long allocsBefore = allocationCount.load();
+    unsigned long long bytesBefore = allocationBytes.load();
+    for (size_t s = 0; s < samples; ++s) {
+        auto start = Clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            op();
+        }
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        nsPerOp.push_back(ns / iterations);
+    }
+    double totalOps = static_cast<double>(samples * iterations);
+    double allocsPerOp = (allocationCount.load() - allocsBefore) / totalOps;
+    double bytesPerOp = (allocationBytes.load() - bytesBefore) / totalOps;
+
+    double median = percentile(nsPerOp, 0.5);
+    std::vector<double> deviations;
+    for (double v : nsPerOp) {
+        deviations.push_back(std::fabs(v - median));
+    }
+    double mad = percentile(deviations, 0.5);
+    double minimum = *std::min_element(nsPerOp.begin(), nsPerOp.end());
+    double p90 = percentile(nsPerOp, 0.9);
+
+    std::printf("{\"benchmark\":\"%s\",\"params\":{%s},\"samples\":%zu,\"iterations\":%zu,"
+                "\"ns_per_op\":{\"median\":%.1f,\"mad\":%.1f,\"min\":%.1f,\"p90\":%.1f},"
+                "\"allocs_per_op\":%.2f,\"bytes_per_op\":%.1f}\n",
+                name.c_str(), params.c_str(), samples, iterations,
+                median, mad, minimum, p90, allocsPerOp, bytesPerOp);
+    std::fflush(stdout);
+    std::fprintf(stderr, "%-32s %-40s %14.1f ns/op  (+/- %.1f)  %10.2f allocs/op\n",
+                 name.c_str(), params.c_str(), median, mad, allocsPerOp);
+}
+
+std::string param(const std::string& key, size_t value) {
+    return "\"" + key + "\":" + std::to_string(value);
+}
+
+std::string param(const std::string& key, const std::string& value) {
+    return "\"" + key + "\":\"" + value + "\"";
+}
+
+// Synthetic data -----------------------------------------------------------
+
+const size_t VOCABULARY_SIZE = 2000;
+
+std::string word(size_t index) {
+    return "w" + std::to_string(index);
+}
+
+std::string foodName(size_t index) {
+    return "Food " + std::to_string(index);
+}
+
+std::string dateForDay(size_t day) {
+    int year = 2000 + static_cast<int>(day / 336);
+    int month = 1 + static_cast<int>((day / 28) % 12);
+    int dayOfMonth = 1 + static_cast<int>(day % 28);
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d", year, month, dayOfMonth);
+    return buffer;
+}
+
+std::unique_ptr<FoodDatabase> makeCatalog(size_t foodCount, std::mt19937& rng) {
+    auto database = std::make_unique<FoodDatabase>();
+    std::uniform_int_distribution<size_t> wordDist(0, VOCABULARY_SIZE - 1);
+    std::uniform_int_distribution<int> keywordCountDist(3, 5);
+    std::uniform_real_distribution<double> calorieDist(10.0, 800.0);
+    for (size_t i = 0; i < foodCount; ++i) {
+        auto food = std::make_shared<BasicFood>(foodName(i), calorieDist(rng));
+        int keywordCount = keywordCountDist(rng);
+        for (int k = 0; k < keywordCount; ++k) {
+            food->addKeyword(word(wordDist(rng)));
+        }
+        database->addFood(food);
+    }
+    return database;
+}
+
+// Builds a complete tree of composites with the given depth and fan-out
+std::shared_ptr<Food> makeCompositeTree(size_t depth, size_t fanOut, size_t& counter) {
+    if (depth == 0) {
+        return std::make_shared<BasicFood>("Leaf " + std::to_string(counter++), 100.0);
+    }
+    auto composite = std::make_shared<CompositeFood>("Composite " + std::to_string(counter++));
+    for (size_t i = 0; i < fanOut; ++i) {
+        composite->addComponent(makeCompositeTree(depth - 1, fanOut, counter), 1.5);
+    }
+    return composite;
+}
+
+std::string writeFoodDatabaseFile(size_t records, std::mt19937& rng) {
+    auto path = (std::filesystem::temp_directory_path() / ("yada_bench_foods_" + std::to_string(records) + ".txt")).string();
+    std::ofstream file(path);
+    std::uniform_int_distribution<size_t> wordDist(0, VOCABULARY_SIZE - 1);
+    size_t basicCount = records - records / 10;
+    std::uniform_int_distribution<size_t> basicDist(0, basicCount - 1);
+    for (size_t i = 0; i < records; ++i) {
+        bool composite = i >= basicCount;
+        file << (composite ? "Composite" : "Basic") << "|" << foodName(i) << "|" << 100 + i % 500
+             << "|3|" << word(wordDist(rng)) << "|" << word(wordDist(rng)) << "|" << word(wordDist(rng));
+        if (composite) {
+            file << "|3";
+            for (int c = 0; c < 3; ++c) {
+                file << "|" << foodName(basicDist(rng)) << "|" << 1.5;
+            }
+        }
+        file << "\n";
+    }
+    return path;
+}
+
+std::string writeFoodLogFile(size_t records, std::mt19937& rng) {
+    auto path = (std::filesystem::temp_directory_path() / ("yada_bench_log_" + std::to_string(records) + ".txt")).string();
+    std::ofstream file(path);
+    std::uniform_int_distribution<size_t> foodDist(0, 999);
+    const size_t entriesPerDay = 8;
+    for (size_t i = 0; i < records; ++i) {
+        file << dateForDay(i / entriesPerDay) << "|" << foodName(foodDist(rng)) << "|" << 1.5
+             << "|" << 1700000000 + i << "\n";
+    }
+    return path;
+}
+
+// Nutrient table in the shape of a public dataset dump
+std::string writeNutrientCsvFile(size_t records, std::mt19937& rng) {
+    auto path = (std::filesystem::temp_directory_path() / ("yada_bench_import_" + std::to_string(records) + ".csv")).string();
+    std::ofstream file(path);
+    std::uniform_int_distribution<size_t> wordDist(0, VOCABULARY_SIZE - 1);
+    file << "description,energy_kcal,protein,fat,carbohydrate,fiber,sodium,category\n";
+    for (size_t i = 0; i < records; ++i) {
+        file << "\"" << foodName(i) << ", " << word(wordDist(rng)) << "\"," << 100 + i % 500 << ".5,"
+             << i % 30 << ",2.5,40," << i % 7 << "," << i % 400 << "," << word(wordDist(rng)) << "\n";
+    }
+    return path;
+}
+
+// Benchmarks ---------------------------------------------------------------
+
+void benchSearch(std::mt19937& rng) {
+    for (size_t foods = 1000; foods <= options.maxRecords; foods *= 10) {
+        auto database = makeCatalog(foods, rng);
+        runBenchmark("search_keywords", param("foods", foods) + "," + param("mode", "any"), [&] {
+            auto results = database->searchFoodByKeywords("w12 w345 w1999", false);
+            doNotOptimize(results);
+        });
+        runBenchmark("search_keywords", param("foods", foods) + "," + param("mode", "all"), [&] {
+            auto results = database->searchFoodByKeywords("w1 w2", true);
+            doNotOptimize(results);
+        });
+    }
+}
+
+void benchSearchText(std::mt19937& rng) {
+    for (size_t foods = 1000; foods <= options.maxRecords; foods *= 10) {
+        auto database = makeCatalog(foods, rng);
+        std::vector<uint32_t> ids;
+        runBenchmark("search_text", param("foods", foods) + "," + param("query", "infix"), [&] {
+            database->searchText("OD 99", ids);
+            doNotOptimize(ids);
+        });
+        runBenchmark("search_text", param("foods", foods) + "," + param("query", "absent"), [&] {
+            database->searchText("quinoa", ids);
+            doNotOptimize(ids);
+        });
+    }
+}
+
+void benchSearchRanked(std::mt19937& rng) {
+    for (size_t foods = 1000; foods <= options.maxRecords; foods *= 10) {
+        auto database = makeCatalog(foods, rng);
+        database->searchRanked("warm up", 1);  // Builds the index
+        runBenchmark("search_ranked", param("foods", foods) + "," + param("query", "typo"), [&] {
+            auto results = database->searchRanked("w1243", 10);
+            doNotOptimize(results);
+        });
+        runBenchmark("search_ranked", param("foods", foods) + "," + param("query", "common"), [&] {
+            auto results = database->searchRanked("fod 77", 10);
+            doNotOptimize(results);
+        });
+    }
+}
+
+void benchCompleteName(std::mt19937& rng) {
+    for (size_t foods = 1000; foods <= options.maxRecords; foods *= 10) {
+        auto database = makeCatalog(foods, rng);
+        database->completeName("warm up", 1);  // Sorts the names
+        runBenchmark("complete_name", param("foods", foods), [&] {
+            auto results = database->completeName("food 12", 10);
+            doNotOptimize(results);
+        });
+    }
+}
+
+void benchMealSuggester(std::mt19937& rng) {
+    for (size_t foods = 1000; foods <= options.maxRecords; foods *= 10) {
+        auto database = makeCatalog(foods, rng);
+        MealSuggester suggester(*database);
+        for (double calories : {600.0, 2400.0}) {
+            MealRequest request;
+            request.calories = calories;
+            // A truncated search stops at the time budget, so its timing says little
+            suggester.suggest(request);
+            std::string truncated = suggester.wasTruncated() ? "yes" : "no";
+            runBenchmark("meal_suggest", param("foods", foods) + "," + param("calories", static_cast<size_t>(calories)) +
+                                         "," + param("truncated", truncated), [&] {
+                auto plans = suggester.suggest(request);
+                doNotOptimize(plans);
+            });
+        }
+    }
+}
+
+void benchFindByName(std::mt19937& rng) {
+    for (size_t foods = 1000; foods <= options.maxRecords; foods *= 10) {
+        auto database = makeCatalog(foods, rng);
+        std::vector<std::string> names;
+        std::uniform_int_distribution<size_t> nameDist(0, foods - 1);
+        for (int i = 0; i < 256; ++i) {
+            names.push_back(foodName(nameDist(rng)));
+        }
+        size_t next = 0;
+        runBenchmark("find_food_by_name", param("foods", foods), [&] {
+            auto food = database->findFoodByName(names[next++ & 255]);
+            doNotOptimize(food);
+        });
+    }
+}
+
+void benchConcurrentFindByName(std::mt19937& rng) {
+    // Each round spreads a fixed number of lookups per thread; readers share
+    // one version without locking, so a round should take as long however
+    // many threads run it, up to the core count
+    const size_t foods = std::min<size_t>(100000, options.maxRecords);
+    const size_t LOOKUPS_PER_THREAD = 20000;
+    if (foods == 0) {
+        return;
+    }
+    auto database = makeCatalog(foods, rng);
+    std::vector<std::string> names;
+    std::uniform_int_distribution<size_t> nameDist(0, foods - 1);
+    for (int i = 0; i < 1024; ++i) {
+        names.push_back(foodName(nameDist(rng)));
+    }
+    database->findFoodByName(names[0]);  // Indexes the names
+    size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        runBenchmark("find_food_by_name_concurrent", param("foods", foods) + "," + param("threads", threads), [&] {
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t] {
+                    for (size_t i = 0; i < LOOKUPS_PER_THREAD; ++i) {
+                        auto food = database->findFoodByName(names[(i + t * 131) & 1023]);
+                        doNotOptimize(food);
+                    }
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        });
+    }
+}
+
+void benchAddThenFind(std::mt19937& rng) {
+    // Each operation adds a food and looks it up, as the UI does after a
+    // new food is entered; the catalog grows by one food per operation
+    for (size_t foods = 1000; foods <= options.maxRecords; foods *= 10) {
+        for (bool composite : {false, true}) {
+            auto database = makeCatalog(foods, rng);
+            std::uniform_int_distribution<size_t> componentDist(0, foods - 1);
+            size_t added = 0;
+            runBenchmark("add_then_find_by_name",
+                         param("foods", foods) + "," + param("kind", composite ? "composite" : "basic"), [&] {
+                std::string name = foodName(foods + added++);
+                std::shared_ptr<Food> food;
+                if (composite) {
+                    auto recipe = std::make_shared<CompositeFood>(name);
+                    for (int c = 0; c < 3; ++c) {
+                        recipe->addComponent(database->getFoods()[componentDist(rng)], 1.5);
+                    }
+                    food = recipe;
+                } else {
+                    food = std::make_shared<BasicFood>(name, 120.0);
+                }
+                database->addFood(food);
+                auto found = database->findFoodByName(name);
+                doNotOptimize(found);
+            });
+        }
+    }
+}
+
+void benchWhereUsed(std::mt19937& rng) {
+    for (size_t records = 1000; records <= options.maxRecords; records *= 10) {
+        std::string foodFile = writeFoodDatabaseFile(records, rng);
+        FoodDatabase database;
+        database.loadFromFile(foodFile);
+        std::remove(foodFile.c_str());
+
+        // Basic foods, each used by a few of the generated recipes
+        std::vector<std::shared_ptr<Food>> probes;
+        std::uniform_int_distribution<size_t> basicDist(0, records - records / 10 - 1);
+        for (int i = 0; i < 256; ++i) {
+            probes.push_back(database.getFoods()[basicDist(rng)]);
+        }
+        database.findUsedBy(*probes[0]);  // Indexes the names
+        size_t next = 0;
+        runBenchmark("where_used", param("foods", records), [&] {
+            auto results = database.findUsedBy(*probes[next++ & 255]);
+            doNotOptimize(results);
+        });
+    }
+}
+
+void benchComposite() {
+    const std::pair<size_t, size_t> shapes[] = {{1, 2}, {2, 2}, {4, 2}, {8, 2}, {4, 4}};
+    for (const auto& shape : shapes) {
+        size_t counter = 0;
+        auto root = makeCompositeTree(shape.first, shape.second, counter);
+        runBenchmark("composite_calories",
+                     param("depth", shape.first) + "," + param("fan_out", shape.second) + "," + param("nodes", counter),
+                     [&] {
+            double calories = root->getCaloriesPerServing();
+            doNotOptimize(calories);
+        });
+        runBenchmark("composite_nutrients",
+                     param("depth", shape.first) + "," + param("fan_out", shape.second) + "," + param("nodes", counter),
+                     [&] {
+            Nutrients nutrients = root->getNutrientsPerServing();
+            doNotOptimize(nutrients);
+        });
+    }
+}
+
+void benchFoodLog(std::mt19937& rng) {
+    const std::string date = "2024-03-15";
+    for (size_t entriesPerDay : {10u, 100u, 1000u}) {
+        FoodLog log;
+        std::vector<std::shared_ptr<Food>> foods;
+        for (size_t i = 0; i < entriesPerDay; ++i) {
+            foods.push_back(std::make_shared<BasicFood>(foodName(i), 100.0));
+            log.addEntry(foods.back(), 1.0, date);
+        }
+        size_t next = 0;
+        runBenchmark("food_log_add_entry", param("entries_per_day", entriesPerDay), [&] {
+            size_t index = log.addEntry(foods[next++ % entriesPerDay], 0.5, date);
+            doNotOptimize(index);
+        });
+    }
+
+    for (size_t foods = 1000; foods <= std::min<size_t>(10000, options.maxRecords); foods *= 10) {
+        auto database = makeCatalog(foods, rng);
+        for (size_t entriesPerDay : {10u, 100u}) {
+            FoodLog log;
+            for (size_t i = 0; i < entriesPerDay; ++i) {
+                log.addEntry(database->getFoods()[(i * 7919) % foods], 1.0, date);
+            }
+            auto lookup = [&database](const std::string& name) { return database->findFoodByName(name); };
+            runBenchmark("food_log_total_calories",
+                         param("foods", foods) + "," + param("entries_per_day", entriesPerDay), [&] {
+                double total = log.getTotalCaloriesForDate(date, lookup);
+                doNotOptimize(total);
+            });
+        }
+    }
+}
+
+void benchLoading(std::mt19937& rng) {
+    for (size_t records = 1000; records <= options.maxRecords; records *= 10) {
+        std::string foodFile = writeFoodDatabaseFile(records, rng);
+        runBenchmark("load_food_database", param("records", records), [&] {
+            FoodDatabase database;
+            database.loadFromFile(foodFile);
+            doNotOptimize(database);
+        });
+        std::remove(foodFile.c_str());
+
+        std::string logFile = writeFoodLogFile(records, rng);
+        runBenchmark("load_food_log", param("records", records), [&] {
+            FoodLog log;
+            log.loadFromFile(logFile);
+            doNotOptimize(log);
+        });
+        std::remove(logFile.c_str());
+    }
+}
+
+void benchImport(std::mt19937& rng) {
+    for (size_t records = 10000; records <= options.maxRecords; records *= 10) {
+        std::string csvFile = writeNutrientCsvFile(records, rng);
+        for (size_t threads : {1u, 4u}) {
+            ImportOptions importOptions;
+            importOptions.threads = threads;
+            runBenchmark("import_foods", param("records", records) + "," + param("threads", threads), [&] {
+                FoodDatabase database;
+                ImportReport report = FoodImporter(database).importFile(csvFile, importOptions);
+                doNotOptimize(report);
+            });
+        }
+        ImportOptions flagOptions;
+        flagOptions.nearDuplicates = NearDuplicatePolicy::FLAG;
+        runBenchmark("import_foods_flag_near_duplicates", param("records", records), [&] {
+            FoodDatabase database;
+            ImportReport report = FoodImporter(database).importFile(csvFile, flagOptions);
+            doNotOptimize(report);
+        });
+
+        FoodDatabase database;
+        FoodImporter(database).importFile(csvFile);
+        runBenchmark("find_near_duplicates", param("records", records), [&] {
+            auto groups = database.findNearDuplicates();
+            doNotOptimize(groups);
+        });
+        std::remove(csvFile.c_str());
+    }
+}
+
+void benchFoodHistory(std::mt19937& rng) {
+    for (size_t records = 10000; records <= options.maxRecords; records *= 10) {
+        std::string logFile = writeFoodLogFile(records, rng);
+        FoodLog log;
+        log.loadFromFile(logFile);
+        std::remove(logFile.c_str());
+
+        // The log covers records / 8 days of 1000 foods
+        std::string firstDate = dateForDay(0);
+        std::string lastDate = dateForDay(records / 8 - 1);
+        runBenchmark("food_days_count", param("records", records), [&] {
+            size_t days = log.countDaysWithFood(foodName(7), firstDate, lastDate);
+            doNotOptimize(days);
+        });
+        runBenchmark("food_days_intersect", param("records", records), [&] {
+            auto dates = log.getDatesWithAllFoods({foodName(7), foodName(11)});
+            doNotOptimize(dates);
+        });
+    }
+}
+
+void benchTrends(std::mt19937& rng) {
+    for (size_t records = 10000; records <= options.maxRecords; records *= 10) {
+        std::string logFile = writeFoodLogFile(records, rng);
+        FoodLog log;
+        log.loadFromFile(logFile);
+        std::remove(logFile.c_str());
+
+        auto food = std::make_shared<BasicFood>(foodName(3), 250.0);
+        TrendEngine trends(log, [&food](const std::string&) { return food; });
+        log.setListener(&trends);
+        std::string lastDate = dateForDay(records / 8 - 1);
+        std::string yearBefore = dateForDay(records / 8 > 336 ? records / 8 - 336 : 0);
+        trends.getSummary(lastDate, 2000.0);  // Builds the daily totals
+
+        // An add and its removal, each adjusting the totals in place
+        runBenchmark("trends_log_change", param("records", records), [&] {
+            size_t index = log.addEntry(food, 1.0, lastDate);
+            log.updateServings(index, log.getServings(index, lastDate) - 1.0, lastDate);
+        });
+        runBenchmark("trends_summary", param("records", records), [&] {
+            auto summary = trends.getSummary(lastDate, 2000.0);
+            doNotOptimize(summary);
+        });
+        runBenchmark("trends_series", param("records", records) + "," + param("days", 336), [&] {
+            auto series = trends.getSeries(yearBefore, lastDate, 2000.0);
+            doNotOptimize(series);
+        });
+        log.setListener(nullptr);
+    }
+}
+
+void benchArchive(std::mt19937& rng) {
+    auto database = makeCatalog(1000, rng);
+    auto lookup = [&database](const std::string& name) { return database->findFoodByName(name); };
+    for (size_t records = 10000; records <= options.maxRecords; records *= 10) {
+        std::string logFile = writeFoodLogFile(records, rng);
+        FoodLog log;
+        log.loadFromFile(logFile);
+        std::remove(logFile.c_str());
+
+        // Saves and whole-history totals with every day in memory, then with
+        // all but the last 90 days archived as the retention policy would
+        size_t days = records / 8;
+        std::string firstDate = dateForDay(0);
+        std::string lastDate = dateForDay(days - 1);
+        auto measure = [&](const std::string& history) {
+            runBenchmark("log_serialize", param("records", records) + "," + param("history", history), [&] {
+                std::ostringstream out;
+                log.writeTo(out);
+                doNotOptimize(out);
+            });
+            runBenchmark("log_totals", param("records", records) + "," + param("history", history), [&] {
+                auto totals = log.getLoggedTotals(firstDate, lastDate, lookup);
+                doNotOptimize(totals);
+            });
+        };
+        measure("hot");
+        log.archiveBefore(dateForDay(days > 90 ? days - 90 : 0), lookup);
+        measure("archived");
+
+        auto archiveFile = (std::filesystem::temp_directory_path() /
+            ("yada_bench_archive_" + std::to_string(records) + ".bin")).string();
+        {
+            std::ofstream file(archiveFile, std::ios::binary);
+            log.writeArchiveTo(file);
+        }
+        runBenchmark("load_log_archive", param("records", records), [&] {
+            FoodLog loaded;
+            loaded.loadArchiveFromFile(archiveFile);
+            doNotOptimize(loaded);
+        });
+        std::remove(archiveFile.c_str());
+    }
+}
+
+// Discards everything written, so exports measure encoding rather than the disk
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+void benchExport(std::mt19937& rng) {
+    auto database = makeCatalog(1000, rng);
+    auto lookup = [&database](const std::string& name) { return database->findFoodByName(name); };
+    for (size_t records = 100000; records <= options.maxRecords; records *= 10) {
+        std::string logFile = writeFoodLogFile(records, rng);
+        FoodLog log;
+        log.loadFromFile(logFile);
+        std::remove(logFile.c_str());
+        size_t days = records / 8;
+        log.archiveBefore(dateForDay(days > 90 ? days - 90 : 0), lookup);
+
+        std::string firstDate = dateForDay(0);
+        std::string lastDate = dateForDay(days - 1);
+        NullBuffer sink;
+        std::ostream out(&sink);
+        for (ExportFormat format : {ExportFormat::CSV, ExportFormat::JSON_LINES}) {
+            for (size_t threads : {1u, 4u}) {
+                ExportOptions exportOptions;
+                exportOptions.format = format;
+                exportOptions.threads = threads;
+                runBenchmark("export_log", param("records", records) + "," +
+                             param("format", format == ExportFormat::CSV ? "csv" : "jsonl") + "," +
+                             param("threads", threads), [&] {
+                    LogExporter exporter(log, lookup);
+                    size_t rows = exporter.exportRange(firstDate, lastDate, out, exportOptions);
+                    doNotOptimize(rows);
+                });
+            }
+        }
+    }
+}
+
+void benchUndo() {
+    const std::string date = "2024-03-15";
+    auto food = std::make_shared<BasicFood>("Apple", 95.0);
+
+    FoodLog churnLog;
+    CommandManager churnManager;
+    runBenchmark("undo_churn", param("pattern", "execute_undo"), [&] {
+        churnManager.executeCommand(std::make_unique<AddFoodCommand>(churnLog, food, 1.0, date));
+        churnManager.undo();
+    });
+
+    for (size_t depth : {100u, 1000u}) {
+        FoodLog log;
+        CommandManager manager;
+        runBenchmark("undo_churn", param("pattern", "fill_then_drain") + "," + param("depth", depth), [&] {
+            for (size_t i = 0; i < depth; ++i) {
+                manager.executeCommand(std::make_unique<AddFoodCommand>(log, food, 1.0, date));
+            }
+            while (manager.canUndo()) {
+                manager.undo();
+            }
+        });
+    }
+}
+
+void printUsage() {
+    std::cerr << "Usage: yada_bench [--max-records N] [--samples N] [--min-time-ms MS] [--filter NAME]\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help") {
+            printUsage();
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            printUsage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--max-records") {
+            options.maxRecords = std::stoul(value);
+        } else if (arg == "--samples") {
+            options.samples = std::max<size_t>(1, std::stoul(value));
+        } else if (arg == "--min-time-ms") {
+            options.minTimeMs = std::stod(value);
+        } else if (arg == "--filter") {
+            options.filter = value;
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    std::mt19937 rng(42);
+    benchSearch(rng);
+    benchSearchText(rng);
+    benchSearchRanked(rng);
+    benchCompleteName(rng);
+    benchMealSuggester(rng);
+    benchFindByName(rng);
+    benchConcurrentFindByName(rng);
+    benchAddThenFind(rng);
+    benchWhereUsed(rng);
+    benchComposite();
+    benchFoodLog(rng);
+    benchLoading(rng);
+    benchImport(rng);
+    benchFoodHistory(rng);
+    benchTrends(rng);
+    benchArchive(rng);
+    benchExport(rng);
+    benchUndo();
+    return 0;
+}
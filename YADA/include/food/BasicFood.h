@@ -6,16 +6,20 @@
 class BasicFood : public Food {
 public:
     BasicFood(const std::string& name, double caloriesPerServing);
+    BasicFood(const std::string& name, const Nutrients& nutrientsPerServing);
 
     // Implementation of pure virtual functions
     double getCaloriesPerServing() const override;
     std::string getType() const override;
+    void accumulateNutrients(Nutrients& total, double scale) const override;
 
     // BasicFood specific functions
     void setCaloriesPerServing(double calories);
+    const Nutrients& getNutrients() const;
+    void setNutrients(const Nutrients& nutrientsPerServing);
 
 private:
-    double caloriesPerServing;
+    Nutrients nutrients;  // Per serving, calories included
 };
 
 #endif // YADA_BASIC_FOOD_H 
\ No newline at end of file
@@ -2,8 +2,9 @@
 #define YADA_COMPOSITE_FOOD_H
 
 #include "food/Food.h"
-#include <map>
 #include <memory>
+#include <utility>
+#include <vector>
 
 class CompositeFood : public Food {
 public:
@@ -12,14 +13,19 @@ public:
     // Implementation of pure virtual functions
     double getCaloriesPerServing() const override;
     std::string getType() const override;
+    void accumulateNutrients(Nutrients& total, double scale) const override;
 
     // CompositeFood specific functions
     void addComponent(const std::shared_ptr<Food>& food, double servings);
     void removeComponent(const std::string& foodName);
-    const std::map<std::shared_ptr<Food>, double>& getComponents() const;
+    // Puts food in place of the index-th component, keeping its servings
+    void setComponentFood(size_t index, const std::shared_ptr<Food>& food);
+    void reserveComponents(size_t count);
+    const std::vector<std::pair<std::shared_ptr<Food>, double>>& getComponents() const;
 
 private:
-    std::map<std::shared_ptr<Food>, double> components; // Food component and its servings
+    // Food component and its servings, stored contiguously for fast evaluation
+    std::vector<std::pair<std::shared_ptr<Food>, double>> components;
 };
 
 #endif // YADA_COMPOSITE_FOOD_H 
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef YADA_FEDERATED_CATALOG_H
+#define YADA_FEDERATED_CATALOG_H
+
+#include "food/BasicFood.h"
+#include "food/FoodDataSource.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A food as the catalog resolves it, with the layer it comes from
+struct CatalogFood {
+    std::shared_ptr<BasicFood> food;
+    size_t layer;
+};
+
+// Foods of several data sources merged into one name index. Layers are
+// stacked in precedence order, e.g. user overrides over a local file over a
+// remote source: a food hides the foods of the same name in lower layers.
+// Lookups cost one hash probe however many layers are configured.
+class FederatedCatalog {
+public:
+    static const size_t MAX_LAYERS = 64;
+    static const size_t NO_LAYER = SIZE_MAX;
+
+    // Adds a layer below those added before; returns its index
+    size_t addLayer(const std::string& name, std::shared_ptr<FoodDataSource> source);
+    size_t layerCount() const;
+    const std::string& getLayerName(size_t layer) const;
+
+    // Reads every layer, one thread per layer, and rebuilds the index
+    void load();
+
+    std::shared_ptr<BasicFood> findFood(const std::string& name) const;
+    // Layer of the food findFood returns, or NO_LAYER
+    size_t findLayer(const std::string& name) const;
+    // The visible foods in the order their names were first seen, so after
+    // load() those of higher layers come first
+    const std::vector<CatalogFood>& getFoods() const;
+    size_t size() const;
+    // Foods hidden by a food of the same name in a higher layer, or repeated
+    // within their own layer
+    size_t getShadowedCount() const;
+
+    // Adds food to layer; false if the layer already has a food of that name.
+    // The food becomes visible unless a higher layer has one of that name.
+    bool addFood(const std::shared_ptr<BasicFood>& food, size_t layer);
+    void saveChanges();
+
+private:
+    struct Layer {
+        std::string name;
+        std::shared_ptr<FoodDataSource> source;
+    };
+    struct Slot {
+        uint32_t position;    // Into foods
+        uint64_t layerMask;   // Layers holding a food of this name
+    };
+
+    std::vector<Layer> layers;
+    std::vector<CatalogFood> foods;
+    std::unordered_map<std::string, Slot> index;  // Exact name -> visible food
+    size_t shadowedCount = 0;
+
+    // Returns false if layer already has a food of that name
+    bool merge(const std::shared_ptr<BasicFood>& food, size_t layer);
+};
+
+#endif // YADA_FEDERATED_CATALOG_H
@@ -0,0 +1,49 @@
+#ifndef YADA_FIELD_READER_H
+#define YADA_FIELD_READER_H
+
+#include <charconv>
+#include <cstddef>
+#include <string_view>
+
+// Splits a '|'-separated record into fields without copying
+class FieldReader {
+public:
+    explicit FieldReader(std::string_view line) : rest(line), done(false) {}
+
+    bool next(std::string_view& field) {
+        if (done) return false;
+        size_t separator = rest.find('|');
+        if (separator == std::string_view::npos) {
+            field = rest;
+            done = true;
+        } else {
+            field = rest.substr(0, separator);
+            rest.remove_prefix(separator + 1);
+        }
+        return true;
+    }
+
+    bool nextNumber(double& value) {
+        std::string_view field;
+        if (!next(field)) return false;
+        auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+        return result.ec == std::errc();
+    }
+
+    bool nextCount(size_t& value) {
+        std::string_view field;
+        if (!next(field)) return false;
+        auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+        return result.ec == std::errc();
+    }
+
+    bool atEnd() const {
+        return done;
+    }
+
+private:
+    std::string_view rest;
+    bool done;
+};
+
+#endif // YADA_FIELD_READER_H
@@ -1,6 +1,8 @@
 #ifndef YADA_FOOD_H
 #define YADA_FOOD_H
 
+#include "food/KeywordDictionary.h"
+#include "food/Nutrients.h"
 #include <string>
 #include <vector>
 
@@ -12,15 +14,22 @@ public:
     // Pure virtual functions
     virtual double getCaloriesPerServing() const = 0;
     virtual std::string getType() const = 0;
+    // Adds this food's nutrients times scale to total, in one pass over any components
+    virtual void accumulateNutrients(Nutrients& total, double scale) const = 0;
 
     // Common functions
     const std::string& getName() const;
-    const std::vector<std::string>& getKeywords() const;
+    Nutrients getNutrientsPerServing() const;
+    std::vector<std::string> getKeywords() const;
+    const std::vector<KeywordId>& getKeywordIds() const;
+    bool hasKeyword(KeywordId id) const;
+    // Normalizes and interns the keyword; blank and duplicate keywords are ignored
     void addKeyword(const std::string& keyword);
+    void reserveKeywords(size_t count);
 
 protected:
     std::string name;
-    std::vector<std::string> keywords;
+    std::vector<KeywordId> keywordIds;  // Sorted, unique ids into KeywordDictionary
 };
 
 #endif // YADA_FOOD_H 
\ No newline at end of file
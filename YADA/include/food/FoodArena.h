@@ -0,0 +1,64 @@
+#ifndef YADA_FOOD_ARENA_H
+#define YADA_FOOD_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Bump allocator for foods created while loading a catalog.
+// Individual deallocation is a no-op; every chunk is released at once when the
+// arena is destroyed. Not thread-safe: one loader owns an arena at a time.
+class FoodArena {
+public:
+    explicit FoodArena(size_t initialChunkSize = 64 * 1024);
+
+    FoodArena(const FoodArena&) = delete;
+    FoodArena& operator=(const FoodArena&) = delete;
+
+    void* allocate(size_t size, size_t alignment);
+
+    size_t getAllocationCount() const;
+    size_t getBytesAllocated() const;
+    size_t getChunkCount() const;
+
+private:
+    std::vector<std::unique_ptr<unsigned char[]>> chunks;
+    unsigned char* current;
+    size_t remaining;
+    size_t nextChunkSize;
+    size_t allocationCount;
+    size_t bytesAllocated;
+
+    void addChunk(size_t minimumSize);
+};
+
+// STL allocator backed by a FoodArena. Each copy shares ownership of the
+// arena, so objects made with std::allocate_shared keep it alive until the
+// last of them is released.
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(std::shared_ptr<FoodArena> arena) : arena(std::move(arena)) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) noexcept {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+private:
+    template <typename U> friend class ArenaAllocator;
+    std::shared_ptr<FoodArena> arena;
+};
+
+#endif // YADA_FOOD_ARENA_H
@@ -2,54 +2,94 @@
 #define YADA_FOOD_DATA_SOURCE_H
 
 #include "food/BasicFood.h"
-#include <vector>
+#include <cstddef>
+#include <limits>
 #include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// Foods a cursor should return. Sources apply the filter where the data
+// lives, e.g. a file source skips non-matching lines before building foods.
+struct FoodFilter {
+    std::string namePrefix;  // Case-insensitive; empty matches every name
+    std::string keyword;     // The food must have this keyword; empty matches all
+    double minCalories = std::numeric_limits<double>::lowest();
+    double maxCalories = std::numeric_limits<double>::max();
+
+    bool isEmpty() const;
+    // Checks a single food; cursors prepare the filter once instead
+    bool matches(const BasicFood& food) const;
+};
+
+// One food as a line of a foods file: "name|calories|keyword count|
+// keywords...", then optionally "|nutrient count|nutrients..."
+void writeFoodRecord(std::ostream& out, const BasicFood& food);
+// Null if record is malformed
+std::shared_ptr<BasicFood> readFoodRecord(std::string_view record);
+
+// Hands out a source's foods a batch at a time. A cursor must not outlive
+// its source; foods added to the source while a cursor is open may or may
+// not be returned by it.
+class FoodCursor {
+public:
+    static const size_t DEFAULT_BATCH_SIZE = 256;
+
+    virtual ~FoodCursor() = default;
+    // Replaces batch with up to maxCount more foods; returns false, with
+    // batch empty, once every food has been returned
+    virtual bool next(std::vector<std::shared_ptr<BasicFood>>& batch, size_t maxCount = DEFAULT_BATCH_SIZE) = 0;
+};
+
+struct FoodCountEstimate {
+    size_t count;
+    bool exact;  // Otherwise count is an upper bound
+};
 
 class FoodDataSource {
 public:
     virtual ~FoodDataSource() = default;
-    virtual std::vector<std::shared_ptr<BasicFood>> getFoods() = 0;
+    virtual std::unique_ptr<FoodCursor> openCursor(const FoodFilter& filter = FoodFilter()) = 0;
+    virtual FoodCountEstimate estimateCount(const FoodFilter& filter = FoodFilter()) = 0;
     virtual bool addFood(const std::shared_ptr<BasicFood>& food) = 0;
     virtual void saveChanges() = 0;
+
+    // Every food at once, read through a cursor; prefer a cursor for large sources
+    std::vector<std::shared_ptr<BasicFood>> getFoods();
 };
 
-// File-based food source
+// File-based food source. Foods are streamed from the file by each cursor
+// rather than held in memory; foods added since the last save follow them.
 class FileFoodSource : public FoodDataSource {
 public:
     explicit FileFoodSource(const std::string& filename);
-    std::vector<std::shared_ptr<BasicFood>> getFoods() override;
+    std::unique_ptr<FoodCursor> openCursor(const FoodFilter& filter = FoodFilter()) override;
+    // Counts the file's well-formed lines, so exact only without a filter
+    FoodCountEstimate estimateCount(const FoodFilter& filter = FoodFilter()) override;
     bool addFood(const std::shared_ptr<BasicFood>& food) override;
     void saveChanges() override;
 
 private:
     std::string filename;
-    std::vector<std::shared_ptr<BasicFood>> foods;
-    void loadFromFile();
-    void saveToFile();
+    std::vector<std::shared_ptr<BasicFood>> pending;  // Added but not yet saved
+    std::unordered_set<std::string> names;  // Read on the first addFood, for duplicate checks
+    bool namesLoaded;
+
+    void loadNames();
 };
 
 // User input food source
 class UserInputFoodSource : public FoodDataSource {
 public:
-    std::vector<std::shared_ptr<BasicFood>> getFoods() override;
-    bool addFood(const std::shared_ptr<BasicFood>& food) override;
-    void saveChanges() override;
-
-private:
-    std::vector<std::shared_ptr<BasicFood>> foods;
-};
-
-// Web-based food source (placeholder for future implementation)
-class WebFoodSource : public FoodDataSource {
-public:
-    explicit WebFoodSource(const std::string& apiUrl);
-    std::vector<std::shared_ptr<BasicFood>> getFoods() override;
+    std::unique_ptr<FoodCursor> openCursor(const FoodFilter& filter = FoodFilter()) override;
+    FoodCountEstimate estimateCount(const FoodFilter& filter = FoodFilter()) override;
     bool addFood(const std::shared_ptr<BasicFood>& food) override;
     void saveChanges() override;
 
 private:
-    std::string apiUrl;
     std::vector<std::shared_ptr<BasicFood>> foods;
 };
 
-#endif // YADA_FOOD_DATA_SOURCE_H 
\ No newline at end of file
+#endif // YADA_FOOD_DATA_SOURCE_H
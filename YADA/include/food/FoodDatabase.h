@@ -0,0 +1,136 @@
+#ifndef YADA_FOOD_DATABASE_H
+#define YADA_FOOD_DATABASE_H
+
+#include "food/BasicFood.h"
+#include "food/Food.h"
+#include "food/FoodArena.h"
+#include "food/FoodDependencyIndex.h"
+#include "food/FuzzySearchIndex.h"
+#include "food/NearDuplicateIndex.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct RankedFood {
+    std::shared_ptr<Food> food;
+    double score;
+};
+
+// Calories per serving of a recipe before and after a proposed change
+struct CalorieImpact {
+    std::shared_ptr<Food> food;
+    double oldCalories;
+    double newCalories;
+};
+
+// Component named by a composite in the file but missing from the catalog
+struct DanglingComponent {
+    std::string compositeName;
+    std::string componentName;
+};
+
+// Catalog of basic and composite foods, persisted as food_database.txt.
+// Queries read an immutable version of the catalog reached through an
+// atomic pointer, so any number of threads can search while one thread
+// changes the catalog, without taking a lock. Each change publishes a new
+// version, which shares every segment of foods it did not touch with the
+// last one; replaced versions are freed through epoch-based reclamation.
+// Published foods are not changed; see changeCalories(). Foods keep their
+// ids until the next load. getFoods() belongs to the writing thread.
+class FoodDatabase {
+public:
+    FoodDatabase();
+    ~FoodDatabase();
+
+    FoodDatabase(const FoodDatabase&) = delete;
+    FoodDatabase& operator=(const FoodDatabase&) = delete;
+
+    void addFood(const std::shared_ptr<Food>& food);
+    // Appends many foods at once, as one segment
+    void addBasicFoods(const std::vector<std::shared_ptr<BasicFood>>& batch);
+    const std::vector<std::shared_ptr<Food>>& getFoods() const;
+    size_t size() const;
+    bool empty() const;
+
+    // Query operations, safe from any thread
+    // Food with the given id, or null once it is removed
+    std::shared_ptr<Food> getFood(uint32_t id) const;
+    std::shared_ptr<Food> findFoodByName(const std::string& name) const;
+    std::vector<std::shared_ptr<Food>> searchFoodByKeywords(const std::string& keywords, bool matchAll = false) const;
+    // Case-insensitive infix match against names and keywords. Replaces ids
+    // with the ids of the matching foods, in catalog order, for getFood();
+    // allocates only to grow ids.
+    void searchText(const std::string& text, std::vector<uint32_t>& ids) const;
+    // Best matches first, tolerating typos; scores favour exact and prefix
+    // matches, name over keyword matches and rarer words
+    std::vector<RankedFood> searchRanked(const std::string& query, size_t limit = 10) const;
+    // Foods whose name starts with prefix (case-insensitive), in name order
+    std::vector<std::shared_ptr<Food>> completeName(const std::string& prefix, size_t limit = 10) const;
+
+    // Where-used queries walk the reverse recipe edges, so they cost the
+    // number of affected recipes rather than a scan of the catalog. They
+    // take the writer's lock.
+    // Composite foods containing food, directly or (if transitive) through
+    // other recipes, nearest first
+    std::vector<std::shared_ptr<Food>> findUsedBy(const Food& food, bool transitive = true) const;
+    // Recipes whose calories would change if food had newCalories per serving
+    std::vector<CalorieImpact> previewCalorieChange(const BasicFood& food, double newCalories) const;
+    // Gives food newCalories per serving. Food and the recipes using it are
+    // replaced by changed copies under the same ids, so readers of earlier
+    // versions keep the calories they saw; look them up again afterwards.
+    void changeCalories(const BasicFood& food, double newCalories);
+    // Removes food, and every recipe using it if cascade is set; a food still
+    // in use is otherwise refused. Returns the removed foods, food first.
+    std::vector<std::shared_ptr<Food>> removeFood(const Food& food, bool cascade = false);
+    // Removes every food of batch in one pass; refused, removing nothing,
+    // if a recipe outside the batch uses one of them
+    void removeFoods(const std::vector<std::shared_ptr<Food>>& batch);
+    // Groups of foods whose names and keywords are near-identical and whose
+    // calories agree, oldest food first; groups are ordered by their first food
+    std::vector<std::vector<std::shared_ptr<Food>>> findNearDuplicates(
+        double threshold = NearDuplicateIndex::DEFAULT_THRESHOLD,
+        double calorieTolerance = NearDuplicateIndex::DEFAULT_CALORIE_TOLERANCE) const;
+    // Components the last load could not resolve and left out
+    const std::vector<DanglingComponent>& getDanglingComponents() const;
+
+    // File operations
+    void writeTo(std::ostream& out) const;
+    void loadFromFile(const std::string& filename);
+
+    // Arena holding the foods of the last load (null before the first load)
+    const FoodArena* getArena() const;
+
+private:
+    struct Segment;
+    struct Version;
+
+    // Writer's state, changed under writeMutex
+    mutable std::mutex writeMutex;
+    std::shared_ptr<FoodArena> arena;
+    // Component id -> ids of the composites that use it
+    FoodDependencyIndex dependencies;
+    std::vector<DanglingComponent> danglingComponents;
+    // Live foods in order for getFoods(); rebuilt on demand after removals
+    mutable std::vector<std::shared_ptr<Food>> foods;
+    mutable bool foodsStale;
+
+    // Latest published version, never null; only the writer replaces it
+    std::atomic<const Version*> published;
+
+    static const uint32_t NO_FOOD = UINT32_MAX;
+
+    // Readers hold an EpochGuard for as long as they use the version; the
+    // writer holds writeMutex, or is the writing thread
+    const Version& currentVersion() const;
+    // Called with writeMutex held
+    void publish(std::unique_ptr<const Version> next);
+    void appendLocked(std::vector<std::shared_ptr<Food>> batch);
+    void removeLocked(std::vector<uint32_t> ids);
+    static uint32_t findFoodId(const Version& version, const Food& food);
+};
+
+#endif // YADA_FOOD_DATABASE_H
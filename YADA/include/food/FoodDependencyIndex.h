@@ -0,0 +1,31 @@
+#ifndef YADA_FOOD_DEPENDENCY_INDEX_H
+#define YADA_FOOD_DEPENDENCY_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Reverse edges of the recipe graph: for each food, the composite foods that
+// list it as a component. Foods are identified by their id in the database,
+// which stays fixed until the next load, so walking up from a food touches
+// only the recipes it affects.
+class FoodDependencyIndex {
+public:
+    void clear();
+    void resize(size_t foodCount);
+    void addEdge(uint32_t componentId, uint32_t compositeId);
+    void removeEdge(uint32_t componentId, uint32_t compositeId);
+    // Drops the edges to the composites that use the food
+    void clearParents(uint32_t foodId);
+
+    // Composites that use the food directly
+    const std::vector<uint32_t>& getDirectParents(uint32_t foodId) const;
+    // Composites that use the food directly or through other composites,
+    // each once, nearest first
+    std::vector<uint32_t> collectDependents(uint32_t foodId) const;
+
+private:
+    std::vector<std::vector<uint32_t>> parents;
+};
+
+#endif // YADA_FOOD_DEPENDENCY_INDEX_H
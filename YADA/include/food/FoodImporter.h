@@ -0,0 +1,83 @@
+#ifndef YADA_FOOD_IMPORTER_H
+#define YADA_FOOD_IMPORTER_H
+
+#include "food/FoodDatabase.h"
+#include "food/NearDuplicateIndex.h"
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+// What to do with a row near-identical to a food already in the catalog
+// or imported earlier
+enum class NearDuplicatePolicy {
+    KEEP,   // Import it without checking
+    FLAG,   // Import it and report the match
+    MERGE   // Drop it in favour of the food it matches and report the match
+};
+
+struct ImportOptions {
+    size_t threads = 1;          // Parse workers, and as many normalize workers
+    size_t chunkBytes = 1 << 20; // Input is split into line-aligned chunks of about this size
+    size_t chunksInFlight = 8;   // Chunks read but not yet inserted; bounds memory use
+    NearDuplicatePolicy nearDuplicates = NearDuplicatePolicy::KEEP;
+    double similarityThreshold = NearDuplicateIndex::DEFAULT_THRESHOLD;
+    double calorieTolerance = NearDuplicateIndex::DEFAULT_CALORIE_TOLERANCE;
+};
+
+struct ImportProgress {
+    size_t bytesDone;
+    size_t totalBytes;
+    size_t imported;
+    size_t rejected;
+};
+
+struct RejectedRow {
+    size_t line;
+    std::string reason;
+};
+
+struct NearDuplicateRow {
+    size_t line;
+    std::string name;
+    std::string similarTo;
+};
+
+struct ImportReport {
+    size_t imported = 0;
+    size_t rejected = 0;
+    std::vector<RejectedRow> rejectedRows;  // The first MAX_REPORTED_REJECTS, in file order
+    size_t nearDuplicates = 0;  // Flagged or merged, depending on the policy
+    std::vector<NearDuplicateRow> nearDuplicateRows;  // The first MAX_REPORTED_REJECTS
+};
+
+// Bulk-loads basic foods from a CSV (or tab-separated) nutrient table. The
+// header names the columns: name and calories are required; protein, fat,
+// carbohydrates, fiber, sodium and keywords (';'-separated) are optional,
+// and common aliases such as "description" or "energy_kcal" are accepted.
+// Words of each name become keywords as well. Rows are one line each;
+// quoted fields may hold delimiters and doubled quotes.
+//
+// The file is memory-mapped and cut into chunks that flow through parse and
+// normalize workers to a single writer, with bounded queues between the
+// stages. The writer inserts in file order, so the first of several rows
+// with the same name wins and rejected rows are reported by line. Near-
+// duplicate checks sign foods in the normalize workers and look them up in
+// a NearDuplicateIndex in the writer.
+class FoodImporter {
+public:
+    static const size_t MAX_REPORTED_REJECTS = 100;
+
+    explicit FoodImporter(FoodDatabase& database);
+
+    // Throws if the file cannot be read or its header lacks a name or
+    // calories column; bad rows are rejected and reported instead.
+    // progress, if set, is called from the calling thread after each chunk.
+    ImportReport importFile(const std::string& filename, const ImportOptions& options = ImportOptions(),
+                            const std::function<void(const ImportProgress&)>& progress = nullptr);
+
+private:
+    FoodDatabase& database;
+};
+
+#endif // YADA_FOOD_IMPORTER_H
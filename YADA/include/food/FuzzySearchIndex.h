@@ -0,0 +1,81 @@
+#ifndef YADA_FUZZY_SEARCH_INDEX_H
+#define YADA_FUZZY_SEARCH_INDEX_H
+
+#include "food/Food.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct FuzzyMatch {
+    uint32_t foodId;
+    double score;
+};
+
+// Token index for ranked, typo-tolerant search. Name words and keywords are
+// split into tokens; each token keeps a posting list of foods, and a bigram
+// index over tokens finds the spellings close to a query term.
+// An index is not changed by searches, so any number of threads can search
+// it at once; each thread keeps its own scratch buffers.
+class FuzzySearchIndex {
+public:
+    // An index searched as foods firstId onwards of a larger catalog
+    struct Part {
+        const FuzzySearchIndex* index;
+        uint32_t firstId;
+    };
+
+    // Foods must be added with consecutive ids starting at zero
+    void addFood(uint32_t foodId, const Food& food);
+    // Adds other's foods after this index's, their ids offset by getFoodCount()
+    void append(const FuzzySearchIndex& other);
+    // Drops the postings of the given foods (sorted ids); their ids stay
+    void removeFoods(const std::vector<uint32_t>& foodIds);
+    size_t getFoodCount() const;
+
+    // Best matches first, at most limit of them
+    std::vector<FuzzyMatch> search(const std::string& query, size_t limit) const;
+    // Searches parts, which must not overlap, as one index: a word's weight
+    // counts the foods of every part, and matches carry catalog ids
+    static std::vector<FuzzyMatch> search(const std::vector<Part>& parts, const std::string& query, size_t limit);
+
+    // Levenshtein distance by Myers' bit-parallel algorithm; the pattern is
+    // cut to 64 bytes
+    static int editDistance(std::string_view pattern, std::string_view text);
+
+private:
+    struct Posting {
+        uint32_t foodId;
+        uint16_t count;         // Occurrences in the food's name and keywords
+        uint8_t namePosition;   // Word position in the name, NOT_IN_NAME if absent
+    };
+    static const uint8_t NOT_IN_NAME = 255;
+
+    // Per-food scores while a search runs
+    struct Accumulator {
+        float termScore = 0.0f;  // Best score for the current term
+        float score = 0.0f;
+        uint8_t termKind = 0;
+        uint8_t termNamePosition = 0;
+        uint8_t nameTerms = 0;       // Query terms matched in the name
+        uint8_t exactNameTerms = 0;
+        uint8_t nameWords = 0;       // Words in the food's name
+        bool startsName = false;
+        bool touched = false;
+    };
+    // Buffers reused by the searches of one thread
+    struct Scratch;
+    static Scratch& threadScratch();
+
+    uint32_t internToken(const std::string& token);
+    void addPosting(uint32_t tokenId, uint32_t foodId, uint8_t namePosition);
+
+    std::vector<std::string> tokens;
+    std::unordered_map<std::string, uint32_t> tokenIds;
+    std::vector<std::vector<Posting>> postings;  // token id -> foods
+    std::unordered_map<uint32_t, std::vector<uint32_t>> bigramTokens;  // bigram -> token ids
+    std::vector<uint8_t> nameTokenCounts;  // food id -> words in its name
+};
+
+#endif // YADA_FUZZY_SEARCH_INDEX_H
@@ -0,0 +1,47 @@
+#ifndef YADA_KEYWORD_DICTIONARY_H
+#define YADA_KEYWORD_DICTIONARY_H
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using KeywordId = uint32_t;
+
+// Process-wide table of normalized keywords. Each distinct keyword is stored
+// once and foods refer to it by a small integer id.
+class KeywordDictionary {
+public:
+    static KeywordDictionary& instance();
+
+    // Trims surrounding whitespace and case-folds. ASCII takes a byte-wise
+    // fast path; Latin-1 letters are folded and combining accents after a
+    // base letter are composed (NFC) so "Café" and "CAFÉ" agree.
+    static std::string normalize(std::string_view keyword);
+    // Drops the surrounding whitespace normalize() ignores
+    static std::string_view trim(std::string_view text);
+
+    KeywordId intern(const std::string& normalizedKeyword);
+    bool find(const std::string& normalizedKeyword, KeywordId& id) const;
+    std::string getKeyword(KeywordId id) const;
+    // Appends the given keywords to out, each followed by separator
+    void appendKeywords(const std::vector<KeywordId>& keywordIds, char separator, std::string& out) const;
+    size_t size() const;
+
+    // Marks (in matches, indexed by id) every keyword containing term
+    void markContaining(const std::string& normalizedTerm, std::vector<char>& matches) const;
+
+private:
+    KeywordDictionary() = default;
+
+    mutable std::shared_mutex mutex;
+    std::deque<std::string> keywords;  // id -> keyword; deque keeps elements in place
+    std::unordered_map<std::string_view, KeywordId> ids;  // views into keywords
+    std::string text;  // All keywords back to back, each followed by '\0'
+    std::vector<size_t> textOffsets;  // id -> start of the keyword in text
+};
+
+#endif // YADA_KEYWORD_DICTIONARY_H
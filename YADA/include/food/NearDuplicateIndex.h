@@ -0,0 +1,77 @@
+#ifndef YADA_NEAR_DUPLICATE_INDEX_H
+#define YADA_NEAR_DUPLICATE_INDEX_H
+
+#include "food/Food.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Normalized name words and keywords of a food as sorted, unique token
+// hashes, with their MinHash signature
+struct FoodSignature {
+    static const size_t SIZE = 24;
+    std::vector<uint64_t> tokens;
+    std::array<uint32_t, SIZE> minHashes;
+};
+
+struct SimilarFood {
+    uint32_t id;
+    double similarity;  // Jaccard similarity of the token sets
+};
+
+// Locality-sensitive index for foods with near-identical names and
+// keywords ("Milk, whole" and "Whole milk"). Signatures are cut into bands;
+// foods sharing any band are candidates, which are then checked against
+// their exact token similarity. Adding and querying cost a few hash probes
+// per band, so clustering a catalog is close to linear in its size.
+// Queries reuse scratch buffers, so callers must not query concurrently.
+class NearDuplicateIndex {
+public:
+    // Six bands of four rows: foods sharing 80% of their tokens meet in
+    // some band 96% of the time, foods sharing half only 32% of the time
+    static const size_t BANDS = 6;
+    static const size_t ROWS = FoodSignature::SIZE / BANDS;
+    // Candidates looked at per band. A crowded bucket is mostly foods that
+    // share one common word; true duplicates also meet in their other bands.
+    static const size_t MAX_BUCKET_SCAN = 8;
+    static constexpr double DEFAULT_THRESHOLD = 0.8;
+    // Near-identical foods also agree on calories within this fraction
+    static constexpr double DEFAULT_CALORIE_TOLERANCE = 0.1;
+
+    // Pure function of the food, safe to call from several threads
+    static FoodSignature signatureOf(const Food& food);
+    static double similarity(const FoodSignature& a, const FoodSignature& b);
+    static bool similarCalories(double a, double b, double tolerance);
+
+    // Ids are consecutive from zero
+    uint32_t add(const FoodSignature& signature);
+    size_t size() const;
+
+    // Indexed foods at least threshold similar to signature, most similar first
+    std::vector<SimilarFood> findSimilar(const FoodSignature& signature, double threshold) const;
+
+private:
+    // Open-addressed map from band hash to the newest food in that bucket;
+    // older foods are chained through nextInBucket. Hashes are 32-bit: a
+    // collision only adds a candidate that the exact check turns away.
+    struct BandTable {
+        std::vector<uint32_t> keys;  // 0 marks an empty slot
+        std::vector<uint32_t> heads;
+        size_t used = 0;
+    };
+
+    // Token sets of every food back to back; signatures are not kept
+    std::vector<uint64_t> tokenData;
+    std::vector<size_t> tokenStarts;  // food id -> start in tokenData, plus the end
+    std::array<BandTable, BANDS> bands;
+    std::vector<std::array<uint32_t, BANDS>> nextInBucket;  // food id -> older food per band
+    mutable std::vector<uint32_t> seenStamps;  // food id -> last query that saw it
+    mutable uint32_t queryStamp = 0;
+
+    static uint32_t bandKey(const FoodSignature& signature, size_t band);
+    // Slot holding key, or the empty slot where it belongs
+    static size_t findSlot(const BandTable& table, uint32_t key);
+    static void grow(BandTable& table);
+};
+
+#endif // YADA_NEAR_DUPLICATE_INDEX_H
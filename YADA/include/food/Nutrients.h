@@ -0,0 +1,58 @@
+#ifndef YADA_NUTRIENTS_H
+#define YADA_NUTRIENTS_H
+
+#include <cstddef>
+#include <ostream>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+enum Nutrient {
+    CALORIES,
+    PROTEIN,        // grams
+    FAT,            // grams
+    CARBOHYDRATES,  // grams
+    FIBER,          // grams
+    SODIUM,         // milligrams
+    NUTRIENT_COUNT
+};
+
+// Nutrients per serving in a fixed, padded vector so whole vectors are added
+// and scaled at once rather than one nutrient at a time
+struct alignas(32) Nutrients {
+    static const size_t LANES = 8;  // NUTRIENT_COUNT rounded up; spare lanes stay zero
+    double values[LANES] = {};
+
+    double& operator[](Nutrient nutrient) { return values[nutrient]; }
+    double operator[](Nutrient nutrient) const { return values[nutrient]; }
+
+    // this += other * scale
+    void addScaled(const Nutrients& other, double scale) {
+#ifdef __SSE2__
+        const __m128d factor = _mm_set1_pd(scale);
+        for (size_t i = 0; i < LANES; i += 2) {
+            __m128d sum = _mm_load_pd(values + i);
+            __m128d product = _mm_mul_pd(_mm_load_pd(other.values + i), factor);
+            _mm_store_pd(values + i, _mm_add_pd(sum, product));
+        }
+#else
+        for (size_t i = 0; i < LANES; ++i) {
+            values[i] += other.values[i] * scale;
+        }
+#endif
+    }
+
+    // True when anything other than calories is set
+    bool hasMacros() const;
+
+    static const char* getName(Nutrient nutrient);
+    static const char* getUnit(Nutrient nutrient);
+};
+
+// Foods files keep calories in their own field. Any other nutrients follow
+// the keywords as "count|protein|fat|carbohydrates|fiber|sodium"; files
+// written before nutrients existed simply lack these fields.
+void writeNutrientFields(std::ostream& out, const Nutrients& nutrients);
+
+#endif // YADA_NUTRIENTS_H
@@ -0,0 +1,14 @@
+#ifndef YADA_SUBSTRING_SEARCH_H
+#define YADA_SUBSTRING_SEARCH_H
+
+#include <cstddef>
+
+constexpr size_t SUBSTRING_NOT_FOUND = static_cast<size_t>(-1);
+
+// Offset of the first occurrence of needle in haystack, or SUBSTRING_NOT_FOUND.
+// Vectorized with AVX2 or SSE2 where the CPU has them, scalar otherwise.
+// Case-insensitive search works by running it over text folded in advance.
+size_t findSubstring(const char* haystack, size_t haystackLength,
+                     const char* needle, size_t needleLength);
+
+#endif // YADA_SUBSTRING_SEARCH_H
@@ -0,0 +1,115 @@
+#ifndef YADA_WEB_FOOD_SOURCE_H
+#define YADA_WEB_FOOD_SOURCE_H
+
+#include "food/BasicFood.h"
+#include "food/FoodDataSource.h"
+#include "net/HttpClient.h"
+#include "net/Json.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// A food on the wire: {"name":..,"calories":..,"keywords":[..],
+// "nutrients":{"protein":..,"fat":..,"carbohydrates":..,"fiber":..,"sodium":..}}
+JsonValue foodToJson(const BasicFood& food);
+// Throws std::runtime_error if json does not describe a food
+std::shared_ptr<BasicFood> foodFromJson(const JsonValue& json);
+
+struct WebFoodSourceOptions {
+    std::string cacheFile;         // Empty keeps lookup responses in memory only
+    size_t maxBatchSize = 64;      // Names per lookup request
+    size_t pageSize = 256;         // Foods per request when a cursor lists the catalog
+    int timeoutMs = HttpClient::DEFAULT_TIMEOUT_MS;
+    int defaultMaxAgeSeconds = 3600;  // For responses without a max-age
+};
+
+struct WebSourceStats {
+    size_t lookups = 0;
+    size_t cacheHits = 0;    // Answered by a fresh cache entry
+    size_t coalesced = 0;    // Joined a fetch of the same name already under way
+    size_t revalidated = 0;  // Stale entries the server confirmed unchanged
+    size_t requests = 0;     // Lookup round-trips
+    size_t connections = 0;  // Opened for lookups
+};
+
+// Food catalog behind an HTTP/JSON endpoint at apiUrl:
+//   POST /foods/lookup {"items":[{"name":..,"etag":..}]}
+//        -> {"items":[{"name":..,"status":"ok"|"not_modified"|"missing","etag":..,"food":{..}}]}
+//        with Cache-Control: max-age=N
+//   GET  /foods?offset=&limit=&prefix=&keyword=&min_calories=&max_calories=
+//        -> {"foods":[..],"next":offset or null}
+//   GET  /foods/count?<the same filter> -> {"count":N}
+//   POST /foods {"foods":[..]} -> {"added":N}
+// Lookups are answered from a cache of lookup responses, kept on disk if
+// cacheFile is set. Names missing from it or stale are queued for a
+// background thread that sends everything queued meanwhile as one request
+// over a kept-alive connection, revalidating stale entries by ETag; a name
+// already queued or in flight is not fetched again. If the server cannot be
+// reached, stale entries are served as they are.
+class WebFoodSource : public FoodDataSource {
+public:
+    explicit WebFoodSource(const std::string& apiUrl, const WebFoodSourceOptions& options = WebFoodSourceOptions());
+    ~WebFoodSource() override;
+
+    // Pages through the remote catalog, the filter applied by the server
+    std::unique_ptr<FoodCursor> openCursor(const FoodFilter& filter = FoodFilter()) override;
+    FoodCountEstimate estimateCount(const FoodFilter& filter = FoodFilter()) override;
+    // Queued until saveChanges(); false if a food of that name is queued
+    bool addFood(const std::shared_ptr<BasicFood>& food) override;
+    // Sends the queued foods in one request and saves the cache
+    void saveChanges() override;
+
+    // The food named name, or null if the catalog has none. Never waits for
+    // the network itself; the future fails if the food could not be fetched.
+    std::shared_future<std::shared_ptr<BasicFood>> lookupAsync(const std::string& name);
+    // Waits for every name, fetched in as few requests as the batch size allows
+    std::vector<std::shared_ptr<BasicFood>> lookup(const std::vector<std::string>& names);
+
+    WebSourceStats getStats() const;
+    void saveCache();
+
+private:
+    using FoodFuture = std::shared_future<std::shared_ptr<BasicFood>>;
+    struct CacheEntry {
+        std::shared_ptr<BasicFood> food;  // Null if the catalog has no such food
+        std::string etag;
+        int64_t expiresAt;  // Unix time
+    };
+    struct Fetch {
+        std::promise<std::shared_ptr<BasicFood>> promise;
+        FoodFuture future;
+    };
+
+    std::string apiUrl;
+    WebFoodSourceOptions options;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::unordered_map<std::string, CacheEntry> cache;
+    bool cacheDirty;
+    std::unordered_map<std::string, Fetch> fetches;  // Queued or in flight
+    std::deque<std::string> queued;
+    WebSourceStats stats;
+    bool stopping;
+    std::thread fetcher;  // Started by the first lookup that needs the network
+
+    // Touched only by the fetcher thread
+    std::unique_ptr<HttpClient> lookupClient;
+
+    std::vector<std::shared_ptr<BasicFood>> pending;
+    std::unordered_set<std::string> pendingNames;
+
+    void fetchLoop();
+    void fetchBatch(const std::vector<std::string>& names);
+    void loadCache();
+};
+
+#endif // YADA_WEB_FOOD_SOURCE_H
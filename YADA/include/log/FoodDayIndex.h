@@ -0,0 +1,72 @@
+#ifndef YADA_FOOD_DAY_INDEX_H
+#define YADA_FOOD_DAY_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Days since 1970-01-01 in the Gregorian calendar
+using DayNumber = int32_t;
+
+enum class HistogramBucket { WEEK, MONTH, YEAR };
+
+struct HistogramBin {
+    DayNumber firstDay;  // Start of the bucket, clipped to the queried range
+    size_t days;         // Days in the bucket on which the food was logged
+};
+
+// Inverted index from food to the sorted days it was logged on. Each list is
+// stored as varint deltas in blocks of BLOCK_SIZE days with a skip entry per
+// block, so lists stay a byte or two per day and range and intersection
+// queries step over whole blocks. Appending a later day is constant time;
+// changes to earlier days re-encode only that food's list.
+class FoodDayIndex {
+public:
+    // Adding a day already present or removing an absent one does nothing
+    void add(const std::string& foodName, DayNumber day);
+    void remove(const std::string& foodName, DayNumber day);
+    void clear();
+
+    std::vector<DayNumber> getDays(const std::string& foodName) const;
+    // Days in [from, to] on which the food was logged
+    size_t countDays(const std::string& foodName, DayNumber from, DayNumber to) const;
+    // Days on which every one of the foods was logged, in order
+    std::vector<DayNumber> intersect(const std::vector<std::string>& foodNames) const;
+    // Logged days per week, calendar month or calendar year over [from, to],
+    // empty buckets included
+    std::vector<HistogramBin> histogram(const std::string& foodName, DayNumber from, DayNumber to,
+                                        HistogramBucket bucket) const;
+    size_t getEncodedBytes() const;
+
+    // Strict YYYY-MM-DD with a real month and day
+    static bool parseDay(const std::string& date, DayNumber& day);
+    static std::string formatDay(DayNumber day);
+    // First day of each week (counted from from), calendar month or year
+    // overlapping [from, to]; the first is from itself
+    static std::vector<DayNumber> bucketStarts(DayNumber from, DayNumber to, HistogramBucket bucket);
+
+private:
+    static const uint32_t BLOCK_SIZE = 64;
+
+    struct Skip {
+        DayNumber firstDay;
+        uint32_t offset;  // Byte offset of the block, whose first day is absolute
+    };
+    struct PostingList {
+        std::vector<uint8_t> bytes;
+        std::vector<Skip> skips;
+        uint32_t count = 0;
+        DayNumber lastDay = 0;
+    };
+    class Cursor;
+
+    std::unordered_map<std::string, PostingList> lists;
+
+    const PostingList* find(const std::string& foodName) const;
+    static void append(PostingList& list, DayNumber day);
+    static std::vector<DayNumber> decode(const PostingList& list);
+};
+
+#endif // YADA_FOOD_DAY_INDEX_H
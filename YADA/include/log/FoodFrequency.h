@@ -0,0 +1,59 @@
+#ifndef YADA_FOOD_FREQUENCY_H
+#define YADA_FOOD_FREQUENCY_H
+
+#include <cstdint>
+#include <list>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Tracks which foods are logged most often and most recently. Counts live in
+// a count-min sketch, so memory stays fixed however long the history; a few
+// recent foods (LRU) and heavy hitters (LFU) are kept by name for quick picks.
+class FoodFrequency {
+public:
+    static const size_t RECENT_CAPACITY = 8;
+    static const size_t FAVOURITE_CAPACITY = 32;
+
+    FoodFrequency();
+    // The recent list is indexed by iterator, so copies are not allowed
+    FoodFrequency(const FoodFrequency&) = delete;
+    FoodFrequency& operator=(const FoodFrequency&) = delete;
+    FoodFrequency(FoodFrequency&&) = default;
+    FoodFrequency& operator=(FoodFrequency&&) = default;
+
+    void record(const std::string& foodName);
+    // Upper bound on how often the food was recorded
+    uint32_t estimate(const std::string& foodName) const;
+    // Most recent foods first, then favourites by count; no duplicates
+    std::vector<std::string> getQuickPicks(size_t count) const;
+
+    bool empty() const;
+    void clear();
+
+    // File operations
+    void writeTo(std::ostream& out) const;
+    void loadFromFile(const std::string& filename);
+
+private:
+    static const size_t SKETCH_DEPTH = 4;
+    static const size_t SKETCH_WIDTH = 1024;
+
+    struct Favourite {
+        std::string foodName;
+        uint32_t count;
+    };
+
+    std::vector<uint32_t> sketch;  // SKETCH_DEPTH rows of SKETCH_WIDTH counters
+    uint64_t totalRecorded;
+    std::list<std::string> recent;  // Most recent first
+    std::unordered_map<std::string, std::list<std::string>::iterator> recentIndex;
+    std::vector<Favourite> favourites;
+
+    size_t cell(size_t row, const std::string& foodName) const;
+    void touchRecent(const std::string& foodName);
+    void updateFavourites(const std::string& foodName, uint32_t count);
+};
+
+#endif // YADA_FOOD_FREQUENCY_H
@@ -2,23 +2,38 @@
 #define YADA_FOOD_LOG_H
 
 #include "food/Food.h"
+#include "log/FoodDayIndex.h"
+#include "log/FoodFrequency.h"
+#include "log/LogArchive.h"
+#include "log/LogEntry.h"
 #include <memory>
 #include <map>
 #include <vector>
 #include <string>
 #include <ctime>
 #include <functional>
+#include <ostream>
 
-struct LogEntry {
-    std::string foodId;  // Store food name as reference
-    double servings;
-    std::time_t timestamp;
+// Told of every change to logged servings, so views derived from the log
+// can update in place instead of re-reading it
+class FoodLogListener {
+public:
+    virtual ~FoodLogListener() = default;
+    // entryDelta is +1 for a new entry, -1 for a removed one and 0 when only
+    // the servings of an existing entry changed
+    virtual void entryChanged(const std::string& date, const std::string& foodId,
+                              double servingsDelta, int entryDelta) = 0;
+    // The whole log was replaced
+    virtual void logReloaded() = 0;
 };
 
 class FoodLog {
 public:
     FoodLog();
 
+    // Not owned; null to stop notifications
+    void setListener(FoodLogListener* listener);
+
     // Log operations
     size_t addEntry(const std::shared_ptr<Food>& food, double servings, const std::string& date = "");
     void removeEntry(size_t index, const std::string& date = "");
@@ -30,22 +45,85 @@ public:
     std::vector<LogEntry> getEntriesForDate(const std::string& date) const;
     double getTotalCaloriesForDate(const std::string& date, 
         const std::function<std::shared_ptr<Food>(const std::string&)>& foodLookup) const;
+    Nutrients getTotalNutrientsForDate(const std::string& date,
+        const std::function<std::shared_ptr<Food>(const std::string&)>& foodLookup) const;
+    std::vector<std::string> findUnknownFoods(const std::function<bool(const std::string&)>& isKnown) const;
+    // Entries of the days held in memory; archived days are visited as rollups
+    void forEachEntry(const std::function<void(const std::string& date, const LogEntry& entry)>& visit) const;
+    void forEachArchivedDay(const std::function<void(const DayRollup& rollup)>& visit) const;
+    // Entries of [fromDate, toDate] in date order, in memory or archived,
+    // decoded one at a time; safe to call from several threads at once
+    void forEachEntryBetween(const std::string& fromDate, const std::string& toDate,
+        const std::function<void(DayNumber day, const LogEntry& entry)>& visit) const;
+    // Usage counts for quick picks; rebuilt from the history on first use
+    // unless loaded from a frequency file since the log was loaded
+    FoodFrequency& getFrequency();
+
+    // History queries answered from the food -> days index
+    std::vector<std::string> getDatesWithFood(const std::string& foodId) const;
+    // Dates on which every one of the foods was logged
+    std::vector<std::string> getDatesWithAllFoods(const std::vector<std::string>& foodIds) const;
+    size_t countDaysWithFood(const std::string& foodId, const std::string& fromDate, const std::string& toDate) const;
+    // Days with the food per week, month or year; labels are the first date of each bucket
+    std::vector<std::pair<std::string, size_t>> getFoodHistogram(const std::string& foodId,
+        const std::string& fromDate, const std::string& toDate, HistogramBucket bucket) const;
+
+    // Retention: days before cutoffDate move to the archive with their
+    // calories as of now. Returns the number of days moved.
+    size_t archiveBefore(const std::string& cutoffDate,
+        const std::function<std::shared_ptr<Food>(const std::string&)>& foodLookup);
+    // Totals over [fromDate, toDate]; archived days are read from their rollups
+    LogTotals getLoggedTotals(const std::string& fromDate, const std::string& toDate,
+        const std::function<std::shared_ptr<Food>(const std::string&)>& foodLookup) const;
+    // Earliest date with entries, or empty if nothing is logged
+    std::string getFirstDate() const;
+    size_t getArchivedDayCount() const;
+    // Changes whenever the archive does, so callers can tell when to save it
+    size_t getArchiveVersion() const;
     
     // File operations
+    void writeTo(std::ostream& out) const;
     void saveToFile(const std::string& filename) const;
     void loadFromFile(const std::string& filename);
+    void writeFrequencyTo(std::ostream& out);
+    void loadFrequencyFromFile(const std::string& filename);
+    void writeArchiveTo(std::ostream& out) const;
+    // Load before the log file; days in both are taken from the log
+    void loadArchiveFromFile(const std::string& filename);
 
     // Date operations
     static std::string getCurrentDate();
     static bool isValidDate(const std::string& date);
 
 private:
-    std::map<std::string, std::vector<LogEntry>> dailyLogs;  // date -> entries
+    std::map<std::string, std::vector<LogEntry>> dailyLogs;  // date -> entries; shadows archived days
+    LogArchive archive;
+    size_t archiveVersion;
+    FoodFrequency frequency;
+    bool frequencyStale;  // Needs rebuilding from dailyLogs
+    FoodDayIndex dayIndex;  // Kept in step with dailyLogs by every mutation
+    FoodLogListener* listener;
     
     // Helper functions
     static std::string formatDate(const std::time_t& time);
     static std::time_t parseDate(const std::string& date);
     size_t findExistingEntry(const std::string& foodId, const std::string& date);
+    // Entries to change for date, copied up from the archive the first time
+    std::vector<LogEntry>& hotEntries(const std::string& date);
+    // Entries to read for date; archived ones are decoded into scratch
+    const std::vector<LogEntry>& entriesFor(const std::string& date, std::vector<LogEntry>& scratch) const;
+    // A copied-up day emptied in memory must not come back from the archive file
+    void dropArchivedIfEmpty(const std::string& date);
+    // Days held in memory, in order; dates that do not parse are left out
+    std::vector<std::pair<DayNumber, const std::vector<LogEntry>*>> getHotDays() const;
+    // Archived entries in [from, to] merged in day order with hotDays,
+    // which take the place of archived copies of the same day
+    void mergeEntries(const std::vector<std::pair<DayNumber, const std::vector<LogEntry>*>>& hotDays,
+        DayNumber from, DayNumber to, const std::function<void(DayNumber day, const LogEntry& entry)>& visit) const;
+    void rebuildDayIndex();
+    // Drops date from the food's days once no entry for it remains there
+    void unindexIfGone(const std::string& foodId, const std::string& date);
+    static DayNumber toDayNumber(const std::string& date);
 };
 
 #endif // YADA_FOOD_LOG_H 
\ No newline at end of file
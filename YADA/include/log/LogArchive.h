@@ -0,0 +1,80 @@
+#ifndef YADA_LOG_ARCHIVE_H
+#define YADA_LOG_ARCHIVE_H
+
+#include "log/FoodDayIndex.h"
+#include "log/LogEntry.h"
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Precomputed totals of one archived day
+struct DayRollup {
+    DayNumber day;
+    uint32_t entries;
+    double servings;
+    double calories;  // As of archiving; archived days keep the calories they were eaten with
+};
+
+struct LogTotals {
+    size_t days = 0;
+    size_t entries = 0;
+    double servings = 0.0;
+    double calories = 0.0;
+};
+
+// Cold history in one compact segment. Food names are dictionary-coded,
+// servings are quantized to 1/SERVING_SCALE and timestamps are stored as
+// zigzag varint deltas, so a day costs a few bytes per entry. Each day also
+// keeps a rollup, so totals over archived ranges never decode entries.
+class LogArchive {
+public:
+    static const uint32_t SERVING_SCALE = 100;
+
+    // Replaces the day if it is already archived
+    void putDay(DayNumber day, const std::vector<LogEntry>& entries, double calories);
+    void removeDay(DayNumber day);
+    void clear();
+
+    bool contains(DayNumber day) const;
+    bool empty() const;
+    size_t getDayCount() const;
+    DayNumber getFirstDay() const;  // The archive must not be empty
+    size_t getEncodedBytes() const;
+    std::vector<LogEntry> getEntries(DayNumber day) const;
+    // Rollups in day order
+    void forEachDay(const std::function<void(const DayRollup& rollup)>& visit) const;
+    void forEachDayBetween(DayNumber from, DayNumber to,
+                           const std::function<void(const DayRollup& rollup)>& visit) const;
+    // Every entry, in day order
+    void forEachEntry(const std::function<void(DayNumber day, const LogEntry& entry)>& visit) const;
+    void forEachEntryBetween(DayNumber from, DayNumber to,
+                             const std::function<void(DayNumber day, const LogEntry& entry)>& visit) const;
+    const std::vector<std::string>& getFoodNames() const;
+
+    // File operations
+    void writeTo(std::ostream& out) const;
+    void loadFromFile(const std::string& filename);
+
+private:
+    struct Day {
+        DayRollup rollup;
+        uint32_t offset;  // Start of the day's entries in segment
+    };
+
+    std::vector<std::string> foodNames;  // Dictionary: food code -> name
+    std::unordered_map<std::string, uint32_t> foodCodes;
+    std::vector<Day> days;  // Sorted by day
+    std::vector<uint8_t> segment;
+
+    std::vector<Day>::const_iterator findDay(DayNumber day) const;
+    uint32_t endOffset(size_t index) const;
+    uint32_t codeFor(const std::string& foodName);
+    std::vector<Day>::const_iterator lowerBound(DayNumber day) const;
+    // Decodes into entry, reusing its name buffer between entries
+    void decodeDay(size_t index, LogEntry& entry, const std::function<void(const LogEntry& entry)>& visit) const;
+};
+
+#endif // YADA_LOG_ARCHIVE_H
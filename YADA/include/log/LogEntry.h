@@ -0,0 +1,13 @@
+#ifndef YADA_LOG_ENTRY_H
+#define YADA_LOG_ENTRY_H
+
+#include <ctime>
+#include <string>
+
+struct LogEntry {
+    std::string foodId;  // Store food name as reference
+    double servings;
+    std::time_t timestamp;
+};
+
+#endif // YADA_LOG_ENTRY_H
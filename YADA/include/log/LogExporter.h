@@ -0,0 +1,48 @@
+#ifndef YADA_LOG_EXPORTER_H
+#define YADA_LOG_EXPORTER_H
+
+#include "food/Food.h"
+#include "log/FoodLog.h"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+enum class ExportFormat { CSV, JSON_LINES };
+
+struct ExportOptions {
+    ExportFormat format = ExportFormat::CSV;
+    size_t threads = 1;            // Months encoded side by side; 1 encodes in the calling thread
+    size_t bufferBytes = 1 << 20;  // Output is written in chunks of about this size
+};
+
+// Writes the entries of a date range oldest first, one row each with date,
+// food, servings, calories and timestamp. Rows are encoded straight from
+// the log into reused buffers, so memory does not grow with the range; with
+// several threads each encodes whole months and months are written in order.
+class LogExporter {
+public:
+    LogExporter(const FoodLog& log, std::function<std::shared_ptr<Food>(const std::string&)> foodLookup);
+
+    // Returns the number of entries written; throws on an invalid date or a failed write
+    size_t exportRange(const std::string& fromDate, const std::string& toDate, std::ostream& out,
+                       const ExportOptions& options = ExportOptions());
+
+private:
+    using CalorieCache = std::unordered_map<std::string, double>;  // Calories per serving by food
+
+    const FoodLog& log;
+    std::function<std::shared_ptr<Food>(const std::string&)> foodLookup;
+    CalorieCache sharedCalories;  // Filled under lookupMutex, so the lookup is never called concurrently
+    std::mutex lookupMutex;
+
+    double caloriesOf(const std::string& foodId, CalorieCache& cache);
+    // Appends rows for [from, to] to buffer, writing it to out (if given)
+    // whenever it reaches flushBytes
+    size_t encode(DayNumber from, DayNumber to, ExportFormat format, CalorieCache& cache,
+                  std::string& buffer, std::ostream* out, size_t flushBytes);
+};
+
+#endif // YADA_LOG_EXPORTER_H
@@ -0,0 +1,89 @@
+#ifndef YADA_TREND_ENGINE_H
+#define YADA_TREND_ENGINE_H
+
+#include "food/Food.h"
+#include "log/FoodDayIndex.h"
+#include "log/FoodLog.h"
+#include <array>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Rolling averages, deficits and streaks for one day of a trend series
+struct TrendPoint {
+    std::string date;
+    double calories;  // Zero on days with nothing logged
+    bool logged;
+    // Average intake over the logged days of each window ending here
+    std::array<double, 3> averages;
+    // Target minus intake summed over logged days since the series start
+    double cumulativeDeficit;
+    size_t streak;  // Consecutive on-target days ending here
+};
+
+struct TrendSummary {
+    std::array<double, 3> averages;  // Windows ending at the summary date
+    double cumulativeDeficit;        // Over every logged day
+    size_t loggedDays;
+    size_t streak;
+};
+
+// Daily calorie totals kept up to date from FoodLog notifications. Each log
+// change adjusts one day and the running window sums in constant time;
+// series are produced in a single sliding-window pass. Totals are rebuilt
+// from the log only after invalidate(), e.g. when food calories change;
+// archived days contribute their rollups as archived.
+class TrendEngine : public FoodLogListener {
+public:
+    static constexpr std::array<int, 3> WINDOW_DAYS = {7, 30, 90};
+    // A logged day is on target within this fraction of the target
+    static constexpr double ON_TARGET_TOLERANCE = 0.1;
+
+    TrendEngine(const FoodLog& log, std::function<std::shared_ptr<Food>(const std::string&)> foodLookup);
+
+    // Foods changed; totals are rebuilt on the next query
+    void invalidate();
+
+    double getCaloriesForDate(const std::string& date);
+    TrendSummary getSummary(const std::string& date, double targetCalories);
+    // One point per day in [fromDate, toDate]
+    std::vector<TrendPoint> getSeries(const std::string& fromDate, const std::string& toDate,
+                                      double targetCalories);
+
+    void entryChanged(const std::string& date, const std::string& foodId,
+                      double servingsDelta, int entryDelta) override;
+    void logReloaded() override;
+
+private:
+    struct DayTotal {
+        double calories = 0.0;
+        uint32_t entries = 0;
+    };
+    struct WindowSum {
+        double calories = 0.0;
+        size_t loggedDays = 0;
+    };
+
+    const FoodLog& log;
+    std::function<std::shared_ptr<Food>(const std::string&)> foodLookup;
+    std::unordered_map<std::string, double> caloriesPerServing;  // Looked up once per food
+    std::deque<DayTotal> days;  // Dense from firstDay
+    DayNumber firstDay;
+    double totalCalories;
+    size_t loggedDays;
+    DayNumber anchor;  // Last day of the running windows
+    std::array<WindowSum, 3> windows;
+    bool stale;
+
+    void rebuild();
+    void apply(DayNumber day, double calories, int entryDelta);
+    void moveAnchor(DayNumber day);
+    double caloriesOf(const std::string& foodId);
+    const DayTotal* find(DayNumber day) const;
+    static bool isOnTarget(double calories, double targetCalories);
+};
+
+#endif // YADA_TREND_ENGINE_H
@@ -0,0 +1,37 @@
+#ifndef YADA_VARINT_H
+#define YADA_VARINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// LEB128 variable-length integers: seven bits per byte, small values in one byte
+
+inline void writeVarint(std::vector<uint8_t>& bytes, uint64_t value) {
+    while (value >= 0x80) {
+        bytes.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back(static_cast<uint8_t>(value));
+}
+
+// Callers make sure the value is complete within bytes
+inline uint64_t readVarint(const std::vector<uint8_t>& bytes, size_t& offset) {
+    uint64_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t byte = bytes[offset++];
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+}
+
+// Signed values are zigzag-mapped so small negatives stay small
+inline uint64_t zigzagEncode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigzagDecode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+#endif // YADA_VARINT_H
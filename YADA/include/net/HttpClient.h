@@ -0,0 +1,69 @@
+#ifndef YADA_HTTP_CLIENT_H
+#define YADA_HTTP_CLIENT_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using HttpHeaders = std::vector<std::pair<std::string, std::string>>;
+
+struct HttpResponse {
+    int status = 0;
+    HttpHeaders headers;
+    std::string body;
+
+    // Header value by case-insensitive name, or null
+    const std::string* findHeader(std::string_view name) const;
+};
+
+// Plain HTTP/1.1 over one keep-alive connection to the host of baseUrl
+// ("http://host[:port][/path]"). The connection is opened on the first
+// request and reused; a GET or idempotent POST on a connection the server has
+// since closed is retried once on a new one. Blocking, with a timeout per socket
+// operation, and not thread-safe: give each thread its own client.
+class HttpClient {
+public:
+    static const int DEFAULT_TIMEOUT_MS = 5000;
+    static const size_t MAX_BODY_BYTES = 256 << 20;  // Longer responses are refused
+
+    explicit HttpClient(const std::string& baseUrl, int timeoutMs = DEFAULT_TIMEOUT_MS);
+    ~HttpClient();
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+    // path is appended to the base URL's path. Throws std::runtime_error on
+    // network or protocol errors; HTTP error statuses are returned as is.
+    HttpResponse get(const std::string& path, const HttpHeaders& headers = {});
+    // Set idempotent only if the server may safely act on body twice
+    HttpResponse post(const std::string& path, const std::string& body,
+                      const std::string& contentType = "application/json", const HttpHeaders& headers = {},
+                      bool idempotent = false);
+
+    // Connections opened so far; stays at one while the server keeps it alive
+    size_t getConnectionCount() const;
+
+    // Percent-encodes text for use in a URL query
+    static std::string encodeQuery(std::string_view text);
+
+private:
+    std::string host;
+    std::string port;
+    std::string basePath;
+    int timeoutMs;
+    int socketFd;
+    size_t connectionCount;
+    std::string received;  // Read past the end of the last response
+
+    HttpResponse request(const std::string& method, const std::string& path, const HttpHeaders& headers,
+                         const std::string& body, bool retryable);
+    void connect();
+    void disconnect();
+    void sendAll(const std::string& data);
+    // Reads more bytes into received; false at end of stream
+    bool receiveMore();
+    HttpResponse readResponse();
+};
+
+#endif // YADA_HTTP_CLIENT_H
@@ -0,0 +1,60 @@
+#ifndef YADA_JSON_H
+#define YADA_JSON_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// A JSON document small enough to hold in memory: enough of JSON for the
+// web food protocol, parsed from and written back to compact text
+class JsonValue {
+public:
+    enum class Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+    JsonValue();
+    JsonValue(bool value);
+    JsonValue(double value);
+    JsonValue(const std::string& value);
+    JsonValue(const char* value);
+    static JsonValue array();
+    static JsonValue object();
+
+    // Throws std::runtime_error on malformed text
+    static JsonValue parse(std::string_view text);
+
+    Type getType() const;
+    bool isNull() const;
+    // The accessors throw std::runtime_error if the value has another type
+    bool asBool() const;
+    double asNumber() const;
+    const std::string& asString() const;
+    const std::vector<JsonValue>& asArray() const;
+    const std::vector<std::pair<std::string, JsonValue>>& asObject() const;
+    // Member of an object, or null if absent or not an object
+    const JsonValue* find(const std::string& key) const;
+
+    // Appends to an array
+    void push(JsonValue value);
+    // Adds a member to an object; keys are not checked for repeats
+    void set(const std::string& key, JsonValue value);
+
+    void write(std::string& out) const;
+    std::string toString() const;
+
+private:
+    Type type;
+    bool boolean;
+    double number;
+    std::string text;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    explicit JsonValue(Type type);
+    friend class JsonParser;
+};
+
+void appendJsonString(std::string& out, std::string_view text);
+
+#endif // YADA_JSON_H
@@ -0,0 +1,49 @@
+#ifndef YADA_MEAL_SUGGESTER_H
+#define YADA_MEAL_SUGGESTER_H
+
+#include "food/FoodDatabase.h"
+#include "food/Nutrients.h"
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <vector>
+
+struct MealRequest {
+    double calories = 0.0;           // Calories left to fill
+    Nutrients nutrientTargets;       // Zero means no target for that nutrient
+    size_t maxItems = 3;             // Foods per plan, at most MAX_PLAN_ITEMS
+    size_t planCount = 5;
+    double calorieTolerance = 0.05;  // Allowed miss, as a fraction of calories
+    std::chrono::milliseconds timeBudget{250};
+};
+
+struct MealPlan {
+    std::vector<std::pair<std::shared_ptr<Food>, double>> items;  // food, servings
+    Nutrients totals;
+    double score;  // Lower is better
+};
+
+// Suggests combinations of foods and servings that fill a calorie budget.
+// Candidates are sorted by calories and searched branch-and-bound: plans
+// with fewer foods and whole servings are preferred, the last food of each
+// plan is found by binary search, and the first food is split across threads
+// that share the pruning bound. A branch is cut once the calories its
+// remaining picks can still reach within the bound miss the target. Stops
+// at the time budget with the best plans found so far.
+class MealSuggester {
+public:
+    static constexpr size_t MAX_PLAN_ITEMS = 4;
+
+    explicit MealSuggester(const FoodDatabase& foodDatabase);
+
+    std::vector<MealPlan> suggest(const MealRequest& request) const;
+
+    // Whether the last suggest() ran out of time before finishing
+    bool wasTruncated() const;
+
+private:
+    const FoodDatabase& foodDatabase;
+    mutable bool truncated;
+};
+
+#endif // YADA_MEAL_SUGGESTER_H
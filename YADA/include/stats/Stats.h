@@ -0,0 +1,96 @@
+#ifndef YADA_STATS_H
+#define YADA_STATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+// Log-linear latency histogram (four buckets per power of two, in nanoseconds).
+// Recording is lock-free, so it can be used from any thread.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(uint64_t nanos);
+    uint64_t getCount() const;
+    uint64_t getTotalNanos() const;
+    uint64_t getMaxNanos() const;
+    uint64_t getPercentileNanos(double fraction) const;
+
+private:
+    static const int BUCKET_COUNT = 256;
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets;
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> totalNanos;
+    std::atomic<uint64_t> maxNanos;
+
+    static int bucketIndex(uint64_t nanos);
+    static uint64_t bucketUpperBound(int index);
+};
+
+// Process-wide registry of per-operation latencies and named counters
+class Stats {
+public:
+    static Stats& instance();
+    static bool isEnabled();
+
+    LatencyHistogram& operation(const std::string& name);
+    std::atomic<uint64_t>& counter(const std::string& name);
+
+    void writeText(std::ostream& out) const;
+    void writeJson(std::ostream& out) const;
+    void writeToFile(const std::string& filename) const;  // JSON for *.json, text otherwise
+
+private:
+    Stats() = default;
+
+    mutable std::mutex mutex;
+    std::map<std::string, std::unique_ptr<LatencyHistogram>> operations;
+    std::map<std::string, std::unique_ptr<std::atomic<uint64_t>>> counters;
+};
+
+// Records the lifetime of the enclosing scope into a histogram
+class ScopedTimer {
+public:
+    explicit ScopedTimer(LatencyHistogram& histogram)
+        : histogram(histogram), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        histogram.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    LatencyHistogram& histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Instrumentation hooks. They compile to nothing unless the build defines
+// YADA_ENABLE_STATS, so uninstrumented builds pay no cost on hot paths.
+#ifdef YADA_ENABLE_STATS
+#define YADA_STATS_CONCAT_INNER(a, b) a##b
+#define YADA_STATS_CONCAT(a, b) YADA_STATS_CONCAT_INNER(a, b)
+#define YADA_STATS_TIMER(name) \
+    static LatencyHistogram& YADA_STATS_CONCAT(yadaStatsHistogram, __LINE__) = \
+        Stats::instance().operation(name); \
+    ScopedTimer YADA_STATS_CONCAT(yadaStatsTimer, __LINE__)(YADA_STATS_CONCAT(yadaStatsHistogram, __LINE__))
+#define YADA_STATS_COUNT(name, amount) \
+    do { \
+        static std::atomic<uint64_t>& yadaStatsCounter = Stats::instance().counter(name); \
+        yadaStatsCounter.fetch_add(static_cast<uint64_t>(amount), std::memory_order_relaxed); \
+    } while (0)
+#else
+#define YADA_STATS_TIMER(name) do {} while (0)
+#define YADA_STATS_COUNT(name, amount) do {} while (0)
+#endif
+
+#endif // YADA_STATS_H
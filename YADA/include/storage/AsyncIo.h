@@ -0,0 +1,77 @@
+#ifndef YADA_ASYNC_IO_H
+#define YADA_ASYNC_IO_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Whole-file reads and atomic writes that do not block the caller. On Linux
+// they go through an io_uring: a file is read or written as CHUNK_BYTES
+// requests submitted together, and operations on several files overlap in
+// the kernel. Where io_uring is missing or refused (older kernels, seccomp
+// filters, other systems) a small thread pool runs the same steps with
+// blocking calls. Setting YADA_ASYNC_IO=threads forces the thread pool.
+class AsyncIo {
+public:
+    enum class Backend { IO_URING, THREAD_POOL };
+
+    static constexpr size_t CHUNK_BYTES = 1 << 20;
+    static constexpr unsigned QUEUE_DEPTH = 64;  // Requests in flight at once
+    static constexpr size_t DEFAULT_THREADS = 2;
+
+    // Shared by the stores; created on first use
+    static AsyncIo& instance();
+
+    explicit AsyncIo(Backend preferred = Backend::IO_URING, size_t threads = DEFAULT_THREADS);
+    ~AsyncIo();
+    AsyncIo(const AsyncIo&) = delete;
+    AsyncIo& operator=(const AsyncIo&) = delete;
+
+    Backend getBackend() const;
+    const char* getBackendName() const;
+
+    // The future throws std::runtime_error if the file cannot be opened or read
+    std::future<std::string> readFile(const std::string& filename);
+    // As writeFileAtomically(): contents go to a temporary file that is
+    // synced and renamed over filename, then the directory is synced.
+    // Writes to the same file must not overlap: they share the temporary.
+    std::future<void> writeFileAtomically(const std::string& filename, std::string contents);
+
+private:
+    struct Request;
+    struct Ring;
+    struct ReadState;
+    struct WriteState;
+
+    Backend backend;
+    std::unique_ptr<Ring> ring;  // Null for the thread pool
+
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::deque<Request*> backlog;  // Waiting for a free slot, or for a pool thread
+    unsigned inFlight;
+    bool stopping;
+    std::vector<std::thread> threads;
+
+    // Runs done(result) once the request completes; result is the byte count
+    // or a negated errno, as the kernel reports it
+    void submit(Request* request);
+    void submitToRing(Request* request);  // Caller holds mutex
+    void reapLoop();
+    void poolLoop();
+    static int perform(const Request& request);
+
+    void readChunk(const std::shared_ptr<ReadState>& state, size_t offset, size_t length);
+    void writeChunk(const std::shared_ptr<WriteState>& state, size_t offset, size_t length);
+    void finishWrite(const std::shared_ptr<WriteState>& state);
+};
+
+#endif // YADA_ASYNC_IO_H
@@ -0,0 +1,10 @@
+#ifndef YADA_ATOMIC_FILE_H
+#define YADA_ATOMIC_FILE_H
+
+#include <string>
+
+// Writes contents to a temporary file next to filename, flushes it to disk
+// and renames it over filename, so readers never observe a partial file.
+void writeFileAtomically(const std::string& filename, const std::string& contents);
+
+#endif // YADA_ATOMIC_FILE_H
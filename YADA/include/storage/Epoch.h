@@ -0,0 +1,69 @@
+#ifndef YADA_EPOCH_H
+#define YADA_EPOCH_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Epoch-based reclamation for objects that readers reach through an atomic
+// pointer. A reader pins the current epoch with an EpochGuard for as long as
+// it uses what it loaded; a writer that swaps an object out retires it, and
+// it is deleted once every reader that could still hold it has left. Readers
+// only write their own slot, so pinning shares no written cache line.
+class EpochDomain {
+public:
+    // Process-wide; never destroyed, so guards stay valid during exit
+    static EpochDomain& instance();
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    // Call once new readers can no longer load the object; deleter runs when
+    // no earlier reader can hold it, here or in a later collect()
+    void retire(std::function<void()> deleter);
+    template <typename T>
+    void retire(const T* object) {
+        retire([object] { delete object; });
+    }
+
+    // Runs the deleters no reader blocks any more; returns how many still wait
+    size_t collect();
+
+private:
+    friend class EpochGuard;
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{0};  // Zero while the owner holds no guard
+        std::atomic<bool> claimed{false};
+        unsigned depth = 0;  // Nested guards; only touched by the owner
+        Slot* next = nullptr;
+    };
+
+    std::atomic<uint64_t> epoch{1};
+    std::atomic<Slot*> slots{nullptr};  // One per thread; freed slots are reused
+    std::mutex retiredMutex;
+    std::vector<std::pair<uint64_t, std::function<void()>>> retired;
+
+    EpochDomain() = default;
+    Slot* claimSlot();
+    static void releaseSlot(Slot* slot);
+    friend struct EpochThreadSlot;
+};
+
+// Pins the calling thread's epoch for the guard's lifetime. Guards nest.
+class EpochGuard {
+public:
+    EpochGuard();
+    ~EpochGuard();
+
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+
+private:
+    EpochDomain::Slot* slot;
+};
+
+#endif // YADA_EPOCH_H
@@ -0,0 +1,31 @@
+#ifndef YADA_MAPPED_FILE_H
+#define YADA_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only view of a whole file. On POSIX systems the file is memory-mapped
+// so large inputs are paged in on demand rather than copied; elsewhere it is
+// read into memory up front.
+class MappedFile {
+public:
+    // Throws std::runtime_error if the file cannot be opened or mapped
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const;
+    size_t size() const;
+    // Hints that [offset, offset + length) will be read soon, so the kernel
+    // can start reading it from disk
+    void prefetch(size_t offset, size_t length) const;
+
+private:
+    const char* begin;
+    size_t length;
+    std::string contents;  // Only used where files are read rather than mapped
+};
+
+#endif // YADA_MAPPED_FILE_H
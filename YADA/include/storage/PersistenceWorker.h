@@ -0,0 +1,53 @@
+#ifndef YADA_PERSISTENCE_WORKER_H
+#define YADA_PERSISTENCE_WORKER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct WriteError {
+    std::string filename;
+    std::string message;
+};
+
+struct FileWrite {
+    std::string filename;
+    std::string contents;
+};
+
+// Background thread that writes serialized stores to disk.
+// Submitting the same file again before it is written replaces the pending
+// contents, so bursts of save points collapse into a single write.
+class PersistenceWorker {
+public:
+    PersistenceWorker();
+    ~PersistenceWorker();
+
+    PersistenceWorker(const PersistenceWorker&) = delete;
+    PersistenceWorker& operator=(const PersistenceWorker&) = delete;
+
+    void submit(const std::string& filename, std::string contents);
+    // Writes the files of group in order, each once the one before is on
+    // disk; if one fails, the rest are not written and fail with it
+    void submit(std::vector<FileWrite> group);
+    void flush();  // Blocks until every submitted write has completed
+    std::vector<WriteError> takeErrors();
+
+private:
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable workDone;
+    // Groups written side by side; a file is in at most one of them, with
+    // its latest contents
+    std::vector<std::vector<FileWrite>> pending;
+    std::vector<WriteError> errors;
+    bool writing;
+    bool stopping;
+    std::thread worker;
+
+    void run();
+};
+
+#endif // YADA_PERSISTENCE_WORKER_H
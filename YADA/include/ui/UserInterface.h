@@ -4,41 +4,88 @@
 #include "food/Food.h"
 #include "food/BasicFood.h"
 #include "food/CompositeFood.h"
+#include "food/FederatedCatalog.h"
+#include "food/FoodDatabase.h"
+#include "food/WebFoodSource.h"
 #include "log/FoodLog.h"
+#include "log/TrendEngine.h"
 #include "profile/UserProfile.h"
 #include "command/Command.h"
+#include "storage/PersistenceWorker.h"
+#include <functional>
 #include <memory>
+#include <ostream>
+#include <utility>
 #include <vector>
 #include <string>
 
 class UserInterface {
 public:
-    UserInterface();
+    // Log days older than archiveAfterDays move to the archive at startup; 0 keeps them all in memory
+    static const int DEFAULT_ARCHIVE_AFTER_DAYS = 365;
+    // Foods typed but not in the database are looked up at foodApiUrl, if set
+    explicit UserInterface(int archiveAfterDays = DEFAULT_ARCHIVE_AFTER_DAYS, const std::string& foodApiUrl = "");
     void run();
 
 private:
-    std::vector<std::shared_ptr<Food>> foodDatabase;
+    std::unique_ptr<FoodDatabase> foodDatabase;
+    // Read-only food sources layered over the database; see findFood()
+    std::unique_ptr<FederatedCatalog> foodCatalog;
+    std::unique_ptr<WebFoodSource> webFoods;  // Null without a food API
     std::unique_ptr<FoodLog> foodLog;
+    std::unique_ptr<TrendEngine> trendEngine;  // Listens to foodLog
     std::unique_ptr<UserProfile> userProfile;
     std::unique_ptr<CommandManager> commandManager;
+    std::unique_ptr<PersistenceWorker> persistenceWorker;
+
+    // Stores changed since they were last handed to the persistence worker
+    bool foodDatabaseDirty;
+    bool userProfileDirty;
+    bool foodLogDirty;
+    size_t savedArchiveVersion;  // Log archive version last written to disk
+    int archiveAfterDays;
+
+    enum class LoadStatus { LOADED, MISSING, FAILED };
+    struct LoadResult {
+        std::string store;
+        LoadStatus status;
+        std::string error;
+        double milliseconds;
+    };
 
     // Menu functions
     void showMainMenu();
     void handleFoodManagement();
     void handleLogManagement();
     void handleProfileManagement();
+    void viewStatistics();
     
     // Food management functions
     void addBasicFood();
     void addCompositeFood();
     void searchFood();
     void listAllFoods();
+    void showWhereUsed();
+    void changeFoodCalories();
+    void removeFood();
+    void importFoods();
+    void findNearDuplicates();
+    // Resolves a name through the catalog layers and the database:
+    // overrides first, then the database, then the other layers
+    std::shared_ptr<Food> findFood(const std::string& name) const;
+    std::shared_ptr<Food> findFoodOnline(const std::string& name);
+    std::shared_ptr<Food> selectFood(const std::string& prompt,
+                                     const std::vector<std::shared_ptr<Food>>& quickPicks = {});
     
     // Log management functions
     void addFoodToLog();
     void removeFoodFromLog();
     void viewLogForDate();
     void undoLastAction();
+    void suggestMeals();
+    void viewFoodHistory();
+    void viewTrends();
+    void exportLog();
     
     // Profile management functions
     void createProfile();
@@ -49,16 +96,18 @@ private:
     // Helper functions
     std::string getInput(const std::string& prompt);
     double getNumericInput(const std::string& prompt);
-    std::vector<std::shared_ptr<Food>> searchFoodByKeywords(const std::string& keywords, bool matchAll = false);
     
     // File operations
     void saveData();
+    void scheduleSave();
+    bool reportSaveErrors();
     void loadData();
-    void saveFoodDatabase(const std::string& filename) const;
-    void loadFoodDatabase(const std::string& filename);
-    void saveUserProfile(const std::string& filename) const;
+    // Catalog foods the database lacks, and overrides of its basic foods
+    std::pair<size_t, size_t> countCatalogFoods() const;
+    static LoadResult loadStore(const std::string& store, const std::string& filename,
+        const std::function<void()>& load);
+    void writeUserProfile(std::ostream& out) const;
     void loadUserProfile(const std::string& filename);
-    std::shared_ptr<Food> findFoodByName(const std::string& name) const;
 };
 
 #endif // YADA_USER_INTERFACE_H 
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "command/Command.h"
+#include "stats/Stats.h"
 
 // AddFoodCommand implementation
 AddFoodCommand::AddFoodCommand(FoodLog& log, std::shared_ptr<Food> food, double servings, const std::string& date)
@@ -49,11 +50,13 @@ std::string RemoveFoodCommand::getDescription() const {
 
 // CommandManager implementation
 void CommandManager::executeCommand(std::unique_ptr<Command> command) {
+    YADA_STATS_TIMER("command.execute");
     command->execute();
     undoStack.push(std::move(command));
 }
 
 void CommandManager::undo() {
+    YADA_STATS_TIMER("command.undo");
     if (!undoStack.empty()) {
         undoStack.top()->undo();
         undoStack.pop();
@@ -1,16 +1,33 @@
 #include "food/BasicFood.h"
 
 BasicFood::BasicFood(const std::string& name, double caloriesPerServing)
-    : Food(name), caloriesPerServing(caloriesPerServing) {}
+    : Food(name) {
+    nutrients[CALORIES] = caloriesPerServing;
+}
+
+BasicFood::BasicFood(const std::string& name, const Nutrients& nutrientsPerServing)
+    : Food(name), nutrients(nutrientsPerServing) {}
 
 double BasicFood::getCaloriesPerServing() const {
-    return caloriesPerServing;
+    return nutrients[CALORIES];
 }
 
 std::string BasicFood::getType() const {
     return "Basic";
 }
 
+void BasicFood::accumulateNutrients(Nutrients& total, double scale) const {
+    total.addScaled(nutrients, scale);
+}
+
 void BasicFood::setCaloriesPerServing(double calories) {
-    caloriesPerServing = calories;
+    nutrients[CALORIES] = calories;
+}
+
+const Nutrients& BasicFood::getNutrients() const {
+    return nutrients;
+}
+
+void BasicFood::setNutrients(const Nutrients& nutrientsPerServing) {
+    nutrients = nutrientsPerServing;
 } 
\ No newline at end of file
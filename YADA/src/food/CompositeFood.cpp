@@ -1,10 +1,12 @@
 #include "food/CompositeFood.h"
+#include "stats/Stats.h"
 #include <algorithm>
 
 CompositeFood::CompositeFood(const std::string& name)
     : Food(name) {}
 
 double CompositeFood::getCaloriesPerServing() const {
+    YADA_STATS_TIMER("composite.calories");
     double totalCalories = 0.0;
     for (const auto& pair : components) {
         const auto& component = pair.first;
@@ -14,12 +16,26 @@ double CompositeFood::getCaloriesPerServing() const {
     return totalCalories;
 }
 
+void CompositeFood::accumulateNutrients(Nutrients& total, double scale) const {
+    // Nested components fold their scaled vectors straight into total
+    for (const auto& pair : components) {
+        pair.first->accumulateNutrients(total, scale * pair.second);
+    }
+}
+
 std::string CompositeFood::getType() const {
     return "Composite";
 }
 
 void CompositeFood::addComponent(const std::shared_ptr<Food>& food, double servings) {
-    components[food] = servings;
+    // Adding the same food again replaces its servings
+    auto it = std::find_if(components.begin(), components.end(),
+        [&food](const auto& pair) { return pair.first == food; });
+    if (it != components.end()) {
+        it->second = servings;
+    } else {
+        components.emplace_back(food, servings);
+    }
 }
 
 void CompositeFood::removeComponent(const std::string& foodName) {
@@ -33,6 +49,14 @@ void CompositeFood::removeComponent(const std::string& foodName) {
     }
 }
 
-const std::map<std::shared_ptr<Food>, double>& CompositeFood::getComponents() const {
+void CompositeFood::setComponentFood(size_t index, const std::shared_ptr<Food>& food) {
+    components.at(index).first = food;
+}
+
+void CompositeFood::reserveComponents(size_t count) {
+    components.reserve(count);
+}
+
+const std::vector<std::pair<std::shared_ptr<Food>, double>>& CompositeFood::getComponents() const {
     return components;
 } 
\ No newline at end of file
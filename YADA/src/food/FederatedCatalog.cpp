@@ -0,0 +1,118 @@
+#include "food/FederatedCatalog.h"
+#include "stats/Stats.h"
+#include <future>
+#include <stdexcept>
+
+size_t FederatedCatalog::addLayer(const std::string& name, std::shared_ptr<FoodDataSource> source) {
+    if (layers.size() >= MAX_LAYERS) {
+        throw std::runtime_error("Too many catalog layers");
+    }
+    if (!source) {
+        throw std::runtime_error("Catalog layer '" + name + "' has no data source");
+    }
+    layers.push_back({name, std::move(source)});
+    return layers.size() - 1;
+}
+
+size_t FederatedCatalog::layerCount() const {
+    return layers.size();
+}
+
+const std::string& FederatedCatalog::getLayerName(size_t layer) const {
+    return layers.at(layer).name;
+}
+
+void FederatedCatalog::load() {
+    YADA_STATS_TIMER("catalog.load");
+    // Sources are independent, so a slow one (a remote source, a large file)
+    // does not hold up reading the others
+    std::vector<std::future<std::vector<std::shared_ptr<BasicFood>>>> reads;
+    reads.reserve(layers.size());
+    for (const auto& layer : layers) {
+        FoodDataSource* source = layer.source.get();
+        reads.push_back(std::async(std::launch::async, [source] { return source->getFoods(); }));
+    }
+    std::vector<std::vector<std::shared_ptr<BasicFood>>> layerFoods;
+    layerFoods.reserve(reads.size());
+    size_t total = 0;
+    for (auto& read : reads) {
+        layerFoods.push_back(read.get());  // Rethrows a source's error
+        total += layerFoods.back().size();
+    }
+
+    foods.clear();
+    index.clear();
+    shadowedCount = 0;
+    index.reserve(total);
+    foods.reserve(total);
+    // Highest layer first, so a food is inserted at most once
+    for (size_t layer = 0; layer < layerFoods.size(); ++layer) {
+        for (const auto& food : layerFoods[layer]) {
+            merge(food, layer);
+        }
+    }
+}
+
+bool FederatedCatalog::merge(const std::shared_ptr<BasicFood>& food, size_t layer) {
+    uint64_t bit = uint64_t(1) << layer;
+    auto inserted = index.try_emplace(food->getName(), Slot{static_cast<uint32_t>(foods.size()), bit});
+    if (inserted.second) {
+        foods.push_back({food, layer});
+        return true;
+    }
+    Slot& slot = inserted.first->second;
+    if (slot.layerMask & bit) {
+        ++shadowedCount;
+        return false;
+    }
+    slot.layerMask |= bit;
+    ++shadowedCount;
+    CatalogFood& visible = foods[slot.position];
+    if (layer < visible.layer) {
+        visible = {food, layer};  // Hides the food it replaces
+    }
+    return true;
+}
+
+std::shared_ptr<BasicFood> FederatedCatalog::findFood(const std::string& name) const {
+    auto it = index.find(name);
+    return it != index.end() ? foods[it->second.position].food : nullptr;
+}
+
+size_t FederatedCatalog::findLayer(const std::string& name) const {
+    auto it = index.find(name);
+    return it != index.end() ? foods[it->second.position].layer : NO_LAYER;
+}
+
+const std::vector<CatalogFood>& FederatedCatalog::getFoods() const {
+    return foods;
+}
+
+size_t FederatedCatalog::size() const {
+    return foods.size();
+}
+
+size_t FederatedCatalog::getShadowedCount() const {
+    return shadowedCount;
+}
+
+bool FederatedCatalog::addFood(const std::shared_ptr<BasicFood>& food, size_t layer) {
+    if (layer >= layers.size()) {
+        throw std::runtime_error("No such catalog layer");
+    }
+    auto it = index.find(food->getName());
+    if (it != index.end() && (it->second.layerMask & (uint64_t(1) << layer))) {
+        return false;
+    }
+    if (!layers[layer].source->addFood(food)) {
+        return false;
+    }
+    merge(food, layer);
+    return true;
+}
+
+void FederatedCatalog::saveChanges() {
+    for (const auto& layer : layers) {
+        layer.source->saveChanges();
+    }
+}
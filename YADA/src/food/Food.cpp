@@ -1,4 +1,5 @@
 #include "food/Food.h"
+#include "stats/Stats.h"
 #include <algorithm>
 
 Food::Food(const std::string& name) : name(name) {}
@@ -7,13 +8,44 @@ const std::string& Food::getName() const {
     return name;
 }
 
-const std::vector<std::string>& Food::getKeywords() const {
+Nutrients Food::getNutrientsPerServing() const {
+    YADA_STATS_TIMER("food.nutrients");
+    Nutrients total;
+    accumulateNutrients(total, 1.0);
+    return total;
+}
+
+std::vector<std::string> Food::getKeywords() const {
+    const auto& dictionary = KeywordDictionary::instance();
+    std::vector<std::string> keywords;
+    keywords.reserve(keywordIds.size());
+    for (KeywordId id : keywordIds) {
+        keywords.push_back(dictionary.getKeyword(id));
+    }
     return keywords;
 }
 
+const std::vector<KeywordId>& Food::getKeywordIds() const {
+    return keywordIds;
+}
+
+bool Food::hasKeyword(KeywordId id) const {
+    return std::binary_search(keywordIds.begin(), keywordIds.end(), id);
+}
+
 void Food::addKeyword(const std::string& keyword) {
-    // Check if keyword already exists
-    if (std::find(keywords.begin(), keywords.end(), keyword) == keywords.end()) {
-        keywords.push_back(keyword);
+    std::string normalized = KeywordDictionary::normalize(keyword);
+    if (normalized.empty()) {
+        return;
+    }
+    KeywordId id = KeywordDictionary::instance().intern(normalized);
+    // Keep ids sorted so duplicates are found by binary search
+    auto it = std::lower_bound(keywordIds.begin(), keywordIds.end(), id);
+    if (it == keywordIds.end() || *it != id) {
+        keywordIds.insert(it, id);
     }
+}
+
+void Food::reserveKeywords(size_t count) {
+    keywordIds.reserve(count);
 } 
\ No newline at end of file
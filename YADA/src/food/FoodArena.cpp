@@ -0,0 +1,47 @@
+#include "food/FoodArena.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+const size_t MAX_CHUNK_SIZE = 1024 * 1024;
+
+} // namespace
+
+FoodArena::FoodArena(size_t initialChunkSize)
+    : current(nullptr), remaining(0), nextChunkSize(initialChunkSize),
+      allocationCount(0), bytesAllocated(0) {}
+
+void* FoodArena::allocate(size_t size, size_t alignment) {
+    size_t padding = (alignment - reinterpret_cast<uintptr_t>(current) % alignment) % alignment;
+    if (current == nullptr || padding + size > remaining) {
+        addChunk(size + alignment);
+        padding = (alignment - reinterpret_cast<uintptr_t>(current) % alignment) % alignment;
+    }
+    unsigned char* result = current + padding;
+    current += padding + size;
+    remaining -= padding + size;
+    ++allocationCount;
+    bytesAllocated += size;
+    return result;
+}
+
+size_t FoodArena::getAllocationCount() const {
+    return allocationCount;
+}
+
+size_t FoodArena::getBytesAllocated() const {
+    return bytesAllocated;
+}
+
+size_t FoodArena::getChunkCount() const {
+    return chunks.size();
+}
+
+void FoodArena::addChunk(size_t minimumSize) {
+    size_t chunkSize = std::max(nextChunkSize, minimumSize);
+    chunks.emplace_back(new unsigned char[chunkSize]);
+    current = chunks.back().get();
+    remaining = chunkSize;
+    nextChunkSize = std::min(nextChunkSize * 2, MAX_CHUNK_SIZE);
+}
@@ -1,110 +1,313 @@
 #include "food/FoodDataSource.h"
+#include "food/FieldReader.h"
+#include "storage/AsyncIo.h"
+#include <algorithm>
 #include <fstream>
+#include <iterator>
 #include <sstream>
+#include <string_view>
 
-FileFoodSource::FileFoodSource(const std::string& filename) : filename(filename) {
-    loadFromFile();
-}
+namespace {
 
-std::vector<std::shared_ptr<BasicFood>> FileFoodSource::getFoods() {
-    return foods;
+bool isAscii(std::string_view text) {
+    return std::all_of(text.begin(), text.end(), [](char c) { return static_cast<unsigned char>(c) < 0x80; });
 }
 
-bool FileFoodSource::addFood(const std::shared_ptr<BasicFood>& food) {
-    // Check for duplicates
-    for (const auto& existingFood : foods) {
-        if (existingFood->getName() == food->getName()) {
-            return false;
+// The filter with its prefix and keyword normalized once per cursor
+class CompiledFilter {
+public:
+    explicit CompiledFilter(const FoodFilter& filter)
+        : prefix(KeywordDictionary::normalize(filter.namePrefix)),
+          keyword(KeywordDictionary::normalize(filter.keyword)),
+          minCalories(filter.minCalories), maxCalories(filter.maxCalories),
+          keywordKnown(false), keywordId(0) {
+        // Foods intern their keywords, so one never interned matches no food in memory
+        keywordKnown = !keyword.empty() && KeywordDictionary::instance().find(keyword, keywordId);
+    }
+
+    bool matchesCalories(double calories) const {
+        return calories >= minCalories && calories <= maxCalories;
+    }
+
+    bool matchesName(std::string_view name) const {
+        if (prefix.empty()) return true;
+        if (isAscii(name)) {
+            // Compare case-folded bytes without building the folded name
+            size_t start = name.find_first_not_of(" \t\r\n");
+            if (start == std::string_view::npos || name.size() - start < prefix.size()) return false;
+            for (size_t i = 0; i < prefix.size(); ++i) {
+                char c = name[start + i];
+                if (c >= 'A' && c <= 'Z') c = static_cast<char>(c + ('a' - 'A'));
+                if (c != prefix[i]) return false;
+            }
+            return true;
         }
+        return KeywordDictionary::normalize(name).compare(0, prefix.size(), prefix) == 0;
     }
-    foods.push_back(food);
-    return true;
-}
 
-void FileFoodSource::saveChanges() {
-    saveToFile();
-}
+    // For keywords still in text form, as in a file
+    bool matchesKeyword(std::string_view text) const {
+        return KeywordDictionary::normalize(text) == keyword;
+    }
 
-void FileFoodSource::loadFromFile() {
-    std::ifstream file(filename);
-    if (!file) {
-        return; // New file will be created on save
+    bool matches(const BasicFood& food) const {
+        if (!keyword.empty() && !(keywordKnown && food.hasKeyword(keywordId))) return false;
+        return matchesCalories(food.getCaloriesPerServing()) && matchesName(food.getName());
     }
 
-    foods.clear();
-    std::string line;
-    while (std::getline(file, line)) {
-        std::stringstream ss(line);
-        std::string name;
-        double calories;
-        size_t keywordCount;
+    bool wantsKeyword() const {
+        return !keyword.empty();
+    }
 
-        std::getline(ss, name, '|');
-        ss >> calories;
-        ss.ignore();
-        ss >> keywordCount;
-        ss.ignore();
+private:
+    std::string prefix;
+    std::string keyword;
+    double minCalories;
+    double maxCalories;
+    bool keywordKnown;
+    KeywordId keywordId;
+};
 
-        auto food = std::make_shared<BasicFood>(name, calories);
+// Walks foods held in memory; indices stay valid as foods are appended
+class VectorFoodCursor : public FoodCursor {
+public:
+    VectorFoodCursor(const std::vector<std::shared_ptr<BasicFood>>& foods, const FoodFilter& filter)
+        : foods(foods), filter(filter), position(0) {}
 
-        // Load keywords
-        for (size_t i = 0; i < keywordCount; ++i) {
-            std::string keyword;
-            std::getline(ss, keyword, '|');
-            food->addKeyword(keyword);
+    bool next(std::vector<std::shared_ptr<BasicFood>>& batch, size_t maxCount) override {
+        batch.clear();
+        while (position < foods.size() && batch.size() < maxCount) {
+            const auto& food = foods[position++];
+            if (filter.matches(*food)) {
+                batch.push_back(food);
+            }
         }
-
-        foods.push_back(food);
+        return !batch.empty();
     }
+
+private:
+    const std::vector<std::shared_ptr<BasicFood>>& foods;
+    CompiledFilter filter;
+    size_t position;
+};
+
+size_t countMatches(const std::vector<std::shared_ptr<BasicFood>>& foods, const FoodFilter& filter) {
+    if (filter.isEmpty()) return foods.size();
+    CompiledFilter compiled(filter);
+    return static_cast<size_t>(std::count_if(foods.begin(), foods.end(),
+        [&compiled](const auto& food) { return compiled.matches(*food); }));
 }
 
-void FileFoodSource::saveToFile() {
-    std::ofstream file(filename);
-    if (!file) {
-        throw std::runtime_error("Could not open file for writing: " + filename);
+// Builds the food on line if it passes filter. Name, calories and keywords
+// are checked on the raw fields, so skipped lines allocate nothing.
+std::shared_ptr<BasicFood> parseFoodLine(std::string_view line, const CompiledFilter& filter) {
+    FieldReader fields(line);
+    std::string_view name;
+    double calories;
+    size_t keywordCount;
+    if (!fields.next(name) || !fields.nextNumber(calories) || !fields.nextCount(keywordCount)) {
+        return nullptr;  // Malformed
+    }
+    if (!filter.matchesCalories(calories) || !filter.matchesName(name)) {
+        return nullptr;
     }
 
-    for (const auto& food : foods) {
-        const auto& keywords = food->getKeywords();
-        file << food->getName() << "|"
-             << food->getCaloriesPerServing() << "|"
-             << keywords.size();
-        
-        for (const auto& keyword : keywords) {
-            file << "|" << keyword;
+    std::string_view keywordFields[64];
+    std::vector<std::string_view> moreKeywords;
+    bool keywordFound = !filter.wantsKeyword();
+    for (size_t i = 0; i < keywordCount; ++i) {
+        std::string_view keyword;
+        if (!fields.next(keyword)) break;
+        keywordFound = keywordFound || filter.matchesKeyword(keyword);
+        if (i < 64) {
+            keywordFields[i] = keyword;
+        } else {
+            moreKeywords.push_back(keyword);
         }
-        file << "\n";
     }
+    if (!keywordFound) {
+        return nullptr;
+    }
+
+    auto food = std::make_shared<BasicFood>(std::string(name), calories);
+    food->reserveKeywords(keywordCount);
+    for (size_t i = 0; i < keywordCount && i < 64; ++i) {
+        food->addKeyword(std::string(keywordFields[i]));
+    }
+    for (std::string_view keyword : moreKeywords) {
+        food->addKeyword(std::string(keyword));
+    }
+
+    // Optional nutrients beyond calories
+    size_t nutrientCount;
+    if (!fields.atEnd() && fields.nextCount(nutrientCount)) {
+        Nutrients nutrients = food->getNutrients();
+        for (size_t i = 0; i < nutrientCount; ++i) {
+            double value;
+            if (!fields.nextNumber(value)) break;
+            if (PROTEIN + i < NUTRIENT_COUNT) {
+                nutrients.values[PROTEIN + i] = value;
+            }
+        }
+        food->setNutrients(nutrients);
+    }
+    return food;
 }
 
-// UserInputFoodSource implementation
-std::vector<std::shared_ptr<BasicFood>> UserInputFoodSource::getFoods() {
+// Streams the foods file line by line, then the unsaved foods
+class FileFoodCursor : public FoodCursor {
+public:
+    FileFoodCursor(const std::string& filename, std::vector<std::shared_ptr<BasicFood>> pending,
+                   const FoodFilter& filter)
+        : file(filename), pending(std::move(pending)), filter(filter), pendingPosition(0) {}
+
+    bool next(std::vector<std::shared_ptr<BasicFood>>& batch, size_t maxCount) override {
+        batch.clear();
+        while (batch.size() < maxCount && file && std::getline(file, line)) {
+            std::string_view text(line);
+            if (!text.empty() && text.back() == '\r') text.remove_suffix(1);
+            if (text.empty()) continue;
+            if (auto food = parseFoodLine(text, filter)) {
+                batch.push_back(std::move(food));
+            }
+        }
+        while (batch.size() < maxCount && pendingPosition < pending.size()) {
+            const auto& food = pending[pendingPosition++];
+            if (filter.matches(*food)) {
+                batch.push_back(food);
+            }
+        }
+        return !batch.empty();
+    }
+
+private:
+    std::ifstream file;  // Not open if the file does not exist yet
+    std::string line;
+    std::vector<std::shared_ptr<BasicFood>> pending;  // As of opening the cursor
+    CompiledFilter filter;
+    size_t pendingPosition;
+};
+
+} // namespace
+
+void writeFoodRecord(std::ostream& out, const BasicFood& food) {
+    const auto& keywords = food.getKeywords();
+    out << food.getName() << "|" << food.getCaloriesPerServing() << "|" << keywords.size();
+    for (const auto& keyword : keywords) {
+        out << "|" << keyword;
+    }
+    writeNutrientFields(out, food.getNutrients());
+}
+
+std::shared_ptr<BasicFood> readFoodRecord(std::string_view record) {
+    return parseFoodLine(record, CompiledFilter(FoodFilter()));
+}
+
+bool FoodFilter::matches(const BasicFood& food) const {
+    return CompiledFilter(*this).matches(food);
+}
+
+bool FoodFilter::isEmpty() const {
+    return namePrefix.empty() && keyword.empty() &&
+           minCalories == std::numeric_limits<double>::lowest() &&
+           maxCalories == std::numeric_limits<double>::max();
+}
+
+std::vector<std::shared_ptr<BasicFood>> FoodDataSource::getFoods() {
+    std::vector<std::shared_ptr<BasicFood>> foods;
+    std::vector<std::shared_ptr<BasicFood>> batch;
+    auto cursor = openCursor();
+    while (cursor->next(batch)) {
+        foods.insert(foods.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+    }
     return foods;
 }
 
-bool UserInputFoodSource::addFood(const std::shared_ptr<BasicFood>& food) {
-    foods.push_back(food);
+FileFoodSource::FileFoodSource(const std::string& filename) : filename(filename), namesLoaded(false) {}
+
+std::unique_ptr<FoodCursor> FileFoodSource::openCursor(const FoodFilter& filter) {
+    return std::make_unique<FileFoodCursor>(filename, pending, filter);
+}
+
+FoodCountEstimate FileFoodSource::estimateCount(const FoodFilter& filter) {
+    // Checking the leading fields is far cheaper than building foods, and
+    // skips the malformed lines a cursor would skip
+    size_t lines = 0;
+    std::ifstream file(filename);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::string_view text(line);
+        if (!text.empty() && text.back() == '\r') text.remove_suffix(1);
+        FieldReader fields(text);
+        std::string_view name;
+        double calories;
+        size_t keywordCount;
+        if (fields.next(name) && fields.nextNumber(calories) && fields.nextCount(keywordCount)) ++lines;
+    }
+    return {lines + countMatches(pending, filter), filter.isEmpty()};
+}
+
+bool FileFoodSource::addFood(const std::shared_ptr<BasicFood>& food) {
+    if (!namesLoaded) {
+        loadNames();
+    }
+    // Check for duplicates
+    if (!names.insert(food->getName()).second) {
+        return false;
+    }
+    pending.push_back(food);
     return true;
 }
 
-void UserInputFoodSource::saveChanges() {
-    // Nothing to save for user input source
+void FileFoodSource::saveChanges() {
+    if (pending.empty()) {
+        return;
+    }
+    // Saved foods are copied as they are and the new ones appended
+    std::ostringstream contents;
+    try {
+        contents << AsyncIo::instance().readFile(filename).get();
+    } catch (const std::runtime_error&) {
+        // No saved foods yet
+    }
+    std::string text = contents.str();
+    if (!text.empty() && text.back() != '\n') {
+        contents << "\n";
+    }
+    for (const auto& food : pending) {
+        writeFoodRecord(contents, *food);
+        contents << "\n";
+    }
+    AsyncIo::instance().writeFileAtomically(filename, contents.str()).get();
+    pending.clear();
+}
+
+void FileFoodSource::loadNames() {
+    std::ifstream file(filename);
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t separator = line.find('|');
+        if (separator != std::string::npos) {
+            names.insert(line.substr(0, separator));
+        }
+    }
+    namesLoaded = true;
 }
 
-// WebFoodSource implementation (placeholder)
-WebFoodSource::WebFoodSource(const std::string& apiUrl) : apiUrl(apiUrl) {}
+// UserInputFoodSource implementation
+std::unique_ptr<FoodCursor> UserInputFoodSource::openCursor(const FoodFilter& filter) {
+    return std::make_unique<VectorFoodCursor>(foods, filter);
+}
 
-std::vector<std::shared_ptr<BasicFood>> WebFoodSource::getFoods() {
-    // TODO: Implement API call to get foods
-    return foods;
+FoodCountEstimate UserInputFoodSource::estimateCount(const FoodFilter& filter) {
+    return {countMatches(foods, filter), true};
 }
 
-bool WebFoodSource::addFood(const std::shared_ptr<BasicFood>& food) {
-    // TODO: Implement API call to add food
+bool UserInputFoodSource::addFood(const std::shared_ptr<BasicFood>& food) {
     foods.push_back(food);
     return true;
 }
 
-void WebFoodSource::saveChanges() {
-    // TODO: Implement API call to save changes
-} 
\ No newline at end of file
+void UserInputFoodSource::saveChanges() {
+    // Nothing to save for user input source
+}
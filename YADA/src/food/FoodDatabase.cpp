@@ -0,0 +1,1290 @@
+#include "food/FoodDatabase.h"
+#include "food/BasicFood.h"
+#include "food/CompositeFood.h"
+#include "food/FieldReader.h"
+#include "food/KeywordDictionary.h"
+#include "food/SubstringSearch.h"
+#include "stats/Stats.h"
+#include "storage/AsyncIo.h"
+#include "storage/Epoch.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <future>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// Field and record separators in the search blob; queries never contain them
+const char FIELD_SEPARATOR = '\x1f';
+const char RECORD_SEPARATOR = '\x1e';
+
+// Appends name folded as KeywordDictionary::normalize() folds it; every
+// comparison against the folded names in the search blob goes through here
+void appendFoldedName(std::string_view name, std::string& text) {
+    name = KeywordDictionary::trim(name);
+    bool ascii = std::all_of(name.begin(), name.end(),
+        [](char c) { return static_cast<unsigned char>(c) < 0x80; });
+    if (ascii) {
+        size_t begin = text.size();
+        text += name;
+        for (size_t i = begin; i < text.size(); ++i) {
+            if (text[i] >= 'A' && text[i] <= 'Z') text[i] = static_cast<char>(text[i] + ('a' - 'A'));
+        }
+    } else {
+        text += KeywordDictionary::normalize(name);
+    }
+}
+
+// Appends the folded name and keywords of food as one record
+void appendSearchText(const Food& food, std::string& text, std::vector<size_t>& starts) {
+    starts.push_back(text.size());
+    appendFoldedName(food.getName(), text);
+    text += FIELD_SEPARATOR;
+    // Keywords are already normalized by the dictionary; the last separator
+    // becomes the record end, but the one after the name must stay
+    size_t keywordsStart = text.size();
+    KeywordDictionary::instance().appendKeywords(food.getKeywordIds(), FIELD_SEPARATOR, text);
+    if (text.size() == keywordsStart) {
+        text += RECORD_SEPARATOR;
+    } else {
+        text.back() = RECORD_SEPARATOR;
+    }
+}
+
+// Name with its hash, computed once however many segments are probed
+struct HashedName {
+    std::string_view name;
+    size_t hash;
+
+    explicit HashedName(std::string_view text) : name(text), hash(std::hash<std::string_view>()(text)) {}
+
+    bool operator==(const HashedName& other) const {
+        return name == other.name;
+    }
+};
+
+struct HashedNameHash {
+    size_t operator()(const HashedName& key) const {
+        return key.hash;
+    }
+};
+
+using NameIndex = std::unordered_map<HashedName, uint32_t, HashedNameHash>;
+
+// Stands in for a removed food where an index must be given every id
+const Food& removedFood() {
+    static const BasicFood placeholder("", 0.0);
+    return placeholder;
+}
+
+} // namespace
+
+// Foods with consecutive ids from firstId, and their search data. A segment
+// is not changed once a published version holds it, so later versions share
+// it, except for the removal marks and replacements. Its indices are built by the first query
+// needing them, or by the writer when the segments it was merged from had
+// theirs; they cover marked foods too, which queries skip.
+struct FoodDatabase::Segment {
+    uint32_t firstId = 0;
+    // Slot i holds food firstId + i, or null once it is emptied out
+    std::vector<std::shared_ptr<Food>> foods;
+    size_t liveCount = 0;  // Foods not emptied out, marked or not
+    // Folded name and keywords of each slot, one record per slot; records
+    // of emptied slots are empty
+    std::string searchBlob;
+    std::vector<size_t> recordStarts;
+    // Removal that marked each slot (see Version::removals), or 0. The
+    // writer marks a slot before publishing the version removing it, so
+    // versions published earlier still see the food.
+    std::unique_ptr<std::atomic<uint32_t>[]> removedIn;
+    // A food a calorie change put in place of a slot's food, with the
+    // change that did (see Version::changes) and the one it replaced
+    struct Replacement {
+        std::shared_ptr<Food> food;
+        uint32_t change;
+        const Replacement* older;
+    };
+    // Latest replacement of each slot, or null. Like a removal mark, the
+    // writer links one in before publishing the version making the change.
+    std::unique_ptr<std::atomic<const Replacement*>[]> replacedBy;
+    mutable std::vector<std::unique_ptr<Replacement>> replacements;  // Owns them; writer only
+
+    // Exact name -> first slot with it; views into the foods' names
+    mutable std::once_flag nameIndexOnce;
+    mutable NameIndex nameIndex;
+    mutable std::atomic<bool> nameIndexBuilt{false};
+    // Slots ordered by folded name
+    mutable std::once_flag nameOrderOnce;
+    mutable std::vector<uint32_t> nameOrder;
+    mutable std::atomic<bool> nameOrderBuilt{false};
+    // Each keyword of the segment's foods, in id order, with its slots in
+    // slots[starts[i], starts[i + 1])
+    struct Postings {
+        std::vector<KeywordId> keywords;
+        std::vector<uint32_t> starts;
+        std::vector<uint32_t> slots;
+
+        void startKeyword(KeywordId keyword) {
+            keywords.push_back(keyword);
+            starts.push_back(static_cast<uint32_t>(slots.size()));
+        }
+
+        void finish() {
+            starts.push_back(static_cast<uint32_t>(slots.size()));
+        }
+    };
+    mutable std::once_flag postingsOnce;
+    mutable Postings postings;
+    mutable std::atomic<bool> postingsBuilt{false};
+    // Ranked search index over the slots; emptied slots have no postings
+    mutable std::once_flag rankedOnce;
+    mutable FuzzySearchIndex ranked;
+    mutable std::atomic<bool> rankedBuilt{false};
+
+    uint32_t endId() const {
+        return firstId + static_cast<uint32_t>(foods.size());
+    }
+
+    void clearMarks() {
+        removedIn = std::make_unique<std::atomic<uint32_t>[]>(foods.size());
+        replacedBy = std::make_unique<std::atomic<const Replacement*>[]>(foods.size());
+    }
+
+    bool isLive(uint32_t slot, uint32_t removals) const {
+        if (!foods[slot]) return false;
+        uint32_t removal = removedIn[slot].load(std::memory_order_relaxed);
+        return removal == 0 || removal > removals;
+    }
+
+    std::string_view foldedName(uint32_t slot) const {
+        // Each search record starts with the folded name
+        const char* begin = searchBlob.data() + recordStarts[slot];
+        const void* end = std::memchr(begin, FIELD_SEPARATOR, searchBlob.size() - recordStarts[slot]);
+        return std::string_view(begin, static_cast<const char*>(end) - begin);
+    }
+
+    const NameIndex& getNameIndex() const {
+        std::call_once(nameIndexOnce, [this] {
+            nameIndex.reserve(liveCount);
+            for (size_t slot = 0; slot < foods.size(); ++slot) {
+                if (foods[slot]) {
+                    nameIndex.emplace(HashedName(foods[slot]->getName()), static_cast<uint32_t>(slot));
+                }
+            }
+            nameIndexBuilt = true;
+        });
+        return nameIndex;
+    }
+
+    const std::vector<uint32_t>& getNameOrder() const {
+        std::call_once(nameOrderOnce, [this] {
+            nameOrder.reserve(liveCount);
+            for (size_t slot = 0; slot < foods.size(); ++slot) {
+                if (foods[slot]) {
+                    nameOrder.push_back(static_cast<uint32_t>(slot));
+                }
+            }
+            std::stable_sort(nameOrder.begin(), nameOrder.end(),
+                [this](uint32_t a, uint32_t b) { return foldedName(a) < foldedName(b); });
+            nameOrderBuilt = true;
+        });
+        return nameOrder;
+    }
+
+    const Postings& getPostings() const {
+        std::call_once(postingsOnce, [this] {
+            std::vector<std::pair<KeywordId, uint32_t>> pairs;
+            for (size_t slot = 0; slot < foods.size(); ++slot) {
+                if (!foods[slot]) continue;
+                for (KeywordId keyword : foods[slot]->getKeywordIds()) {
+                    pairs.emplace_back(keyword, static_cast<uint32_t>(slot));
+                }
+            }
+            std::sort(pairs.begin(), pairs.end());
+            postings.slots.reserve(pairs.size());
+            for (const auto& pair : pairs) {
+                if (postings.keywords.empty() || postings.keywords.back() != pair.first) {
+                    postings.startKeyword(pair.first);
+                }
+                postings.slots.push_back(pair.second);
+            }
+            postings.finish();
+            postingsBuilt = true;
+        });
+        return postings;
+    }
+
+    const FuzzySearchIndex& getRankedIndex() const {
+        std::call_once(rankedOnce, [this] {
+            for (size_t slot = 0; slot < foods.size(); ++slot) {
+                ranked.addFood(static_cast<uint32_t>(slot), foods[slot] ? *foods[slot] : removedFood());
+            }
+            rankedBuilt = true;
+        });
+        return ranked;
+    }
+
+    static std::shared_ptr<Segment> build(uint32_t firstId, std::vector<std::shared_ptr<Food>> foods) {
+        auto segment = std::make_shared<Segment>();
+        segment->firstId = firstId;
+        segment->recordStarts.reserve(foods.size());
+        for (const auto& food : foods) {
+            appendSearchText(*food, segment->searchBlob, segment->recordStarts);
+        }
+        segment->liveCount = foods.size();
+        segment->foods = std::move(foods);
+        segment->clearMarks();
+        return segment;
+    }
+
+    // first followed by second, whose ids must follow on; neither may have
+    // marked foods. Indices both have are merged, or rebuilt for the name
+    // index, so readers of the new version do not stall building them.
+    static std::shared_ptr<Segment> merge(const Segment& first, const Segment& second) {
+        auto merged = std::make_shared<Segment>();
+        merged->firstId = first.firstId;
+        merged->foods.reserve(first.foods.size() + second.foods.size());
+        merged->foods = first.foods;
+        merged->foods.insert(merged->foods.end(), second.foods.begin(), second.foods.end());
+        merged->liveCount = first.liveCount + second.liveCount;
+        merged->searchBlob.reserve(first.searchBlob.size() + second.searchBlob.size());
+        merged->searchBlob = first.searchBlob;
+        merged->searchBlob += second.searchBlob;
+        merged->recordStarts.reserve(merged->foods.size());
+        merged->recordStarts = first.recordStarts;
+        for (size_t start : second.recordStarts) {
+            merged->recordStarts.push_back(start + first.searchBlob.size());
+        }
+        merged->clearMarks();
+
+        uint32_t offset = static_cast<uint32_t>(first.foods.size());
+        if (first.nameIndexBuilt && second.nameIndexBuilt) {
+            merged->getNameIndex();
+        }
+        if (first.nameOrderBuilt && second.nameOrderBuilt) {
+            std::call_once(merged->nameOrderOnce, [&] {
+                auto& order = merged->nameOrder;
+                order.reserve(first.nameOrder.size() + second.nameOrder.size());
+                order = first.nameOrder;
+                for (uint32_t slot : second.nameOrder) {
+                    order.push_back(slot + offset);
+                }
+                // Ties keep the first segment's foods, which are older
+                std::inplace_merge(order.begin(), order.begin() + first.nameOrder.size(), order.end(),
+                    [&merged](uint32_t a, uint32_t b) { return merged->foldedName(a) < merged->foldedName(b); });
+                merged->nameOrderBuilt = true;
+            });
+        }
+        if (first.postingsBuilt && second.postingsBuilt) {
+            std::call_once(merged->postingsOnce, [&] {
+                // Keyword by keyword; the second segment's slots come after
+                // the first's, so each keyword's slots stay sorted
+                const Postings& a = first.postings;
+                const Postings& b = second.postings;
+                Postings& postings = merged->postings;
+                postings.slots.reserve(a.slots.size() + b.slots.size());
+                size_t i = 0;
+                size_t j = 0;
+                while (i < a.keywords.size() || j < b.keywords.size()) {
+                    KeywordId keyword = j == b.keywords.size() || (i < a.keywords.size() && a.keywords[i] < b.keywords[j])
+                        ? a.keywords[i] : b.keywords[j];
+                    postings.startKeyword(keyword);
+                    if (i < a.keywords.size() && a.keywords[i] == keyword) {
+                        postings.slots.insert(postings.slots.end(), a.slots.begin() + a.starts[i],
+                                              a.slots.begin() + a.starts[i + 1]);
+                        ++i;
+                    }
+                    if (j < b.keywords.size() && b.keywords[j] == keyword) {
+                        for (uint32_t k = b.starts[j]; k < b.starts[j + 1]; ++k) {
+                            postings.slots.push_back(b.slots[k] + offset);
+                        }
+                        ++j;
+                    }
+                }
+                postings.finish();
+                merged->postingsBuilt = true;
+            });
+        }
+        if (first.rankedBuilt && second.rankedBuilt) {
+            std::call_once(merged->rankedOnce, [&] {
+                merged->ranked = first.ranked;
+                merged->ranked.append(second.ranked);
+                merged->rankedBuilt = true;
+            });
+        }
+        return merged;
+    }
+
+    // Copy holding slotFoods, one per slot, with no marks or replacements.
+    // They may differ from foods only by emptied slots, which stay so the
+    // other foods keep their ids, and by foods replaced with copies.
+    std::shared_ptr<Segment> rebuilt(std::vector<std::shared_ptr<Food>> slotFoods) const {
+        std::vector<uint32_t> slots;  // Emptied out here
+        for (uint32_t slot = 0; slot < foods.size(); ++slot) {
+            if (foods[slot] && !slotFoods[slot]) slots.push_back(slot);
+        }
+        auto next = std::make_shared<Segment>();
+        next->firstId = firstId;
+        next->foods = std::move(slotFoods);
+        next->liveCount = liveCount - slots.size();
+        next->searchBlob.reserve(searchBlob.size());
+        next->recordStarts.reserve(recordStarts.size());
+        for (size_t slot = 0; slot < foods.size(); ++slot) {
+            next->recordStarts.push_back(next->searchBlob.size());
+            if (!next->foods[slot]) continue;
+            size_t start = recordStarts[slot];
+            size_t end = slot + 1 < recordStarts.size() ? recordStarts[slot + 1] : searchBlob.size();
+            next->searchBlob.append(searchBlob, start, end - start);
+        }
+        next->clearMarks();
+
+        const auto& kept = next->foods;
+        if (nameIndexBuilt) {
+            next->getNameIndex();
+        }
+        if (nameOrderBuilt) {
+            std::call_once(next->nameOrderOnce, [&] {
+                next->nameOrder.reserve(next->liveCount);
+                std::copy_if(nameOrder.begin(), nameOrder.end(), std::back_inserter(next->nameOrder),
+                    [&kept](uint32_t slot) { return kept[slot] != nullptr; });
+                next->nameOrderBuilt = true;
+            });
+        }
+        if (postingsBuilt) {
+            std::call_once(next->postingsOnce, [&] {
+                Postings& keptPostings = next->postings;
+                keptPostings.slots.reserve(postings.slots.size());
+                for (size_t i = 0; i < postings.keywords.size(); ++i) {
+                    uint32_t start = static_cast<uint32_t>(keptPostings.slots.size());
+                    for (uint32_t k = postings.starts[i]; k < postings.starts[i + 1]; ++k) {
+                        if (kept[postings.slots[k]]) keptPostings.slots.push_back(postings.slots[k]);
+                    }
+                    if (keptPostings.slots.size() > start) {
+                        keptPostings.keywords.push_back(postings.keywords[i]);
+                        keptPostings.starts.push_back(start);
+                    }
+                }
+                keptPostings.finish();
+                next->postingsBuilt = true;
+            });
+        }
+        if (rankedBuilt) {
+            std::call_once(next->rankedOnce, [&] {
+                next->ranked = ranked;
+                next->ranked.removeFoods(slots);
+                next->rankedBuilt = true;
+            });
+        }
+        return next;
+    }
+};
+
+// One published state of the catalog: segments covering ids [0, nextId) in
+// order. Copying a version copies only its list of segments.
+struct FoodDatabase::Version {
+    std::vector<std::shared_ptr<const Segment>> segments;
+    // Foods of each segment marked removed by this version or earlier ones
+    std::vector<uint32_t> markedCounts;
+    uint32_t nextId = 0;
+    size_t liveCount = 0;
+    uint32_t removals = 0;  // Removals so far; the latest marked its foods with this
+    uint32_t changes = 0;   // Calorie changes so far; the latest replaced its foods with this
+
+    bool isLive(const Segment& segment, uint32_t slot) const {
+        return segment.isLive(slot, removals);
+    }
+
+    // The food in slot as of this version, whether live or not
+    const std::shared_ptr<Food>& at(const Segment& segment, uint32_t slot) const {
+        const Segment::Replacement* replacement = segment.replacedBy[slot].load(std::memory_order_acquire);
+        while (replacement && replacement->change > changes) {
+            replacement = replacement->older;
+        }
+        return replacement ? replacement->food : segment.foods[slot];
+    }
+
+    size_t segmentOf(uint32_t id) const {
+        auto it = std::upper_bound(segments.begin(), segments.end(), id,
+            [](uint32_t value, const std::shared_ptr<const Segment>& segment) { return value < segment->firstId; });
+        return static_cast<size_t>(it - segments.begin()) - 1;
+    }
+
+    // Null once removed
+    std::shared_ptr<Food> food(uint32_t id) const {
+        if (id >= nextId) return nullptr;
+        const Segment& segment = *segments[segmentOf(id)];
+        uint32_t slot = id - segment.firstId;
+        return isLive(segment, slot) ? at(segment, slot) : nullptr;
+    }
+
+    // Slot in segment of the first live food named key, or of food itself
+    // if given; NO_FOOD if there is none
+    uint32_t findSlot(const Segment& segment, const HashedName& key, const Food* food) const {
+        const auto& index = segment.getNameIndex();
+        auto it = index.find(key);
+        if (it == index.end()) return NO_FOOD;
+        if ((!food || at(segment, it->second).get() == food) && isLive(segment, it->second)) {
+            return it->second;
+        }
+        // The first food of that name is removed or another one; equal
+        // folded names are in slot order
+        std::string folded;
+        appendFoldedName(key.name, folded);
+        const auto& nameOrder = segment.getNameOrder();
+        auto match = std::lower_bound(nameOrder.begin(), nameOrder.end(), std::string_view(folded),
+            [&segment](uint32_t slot, std::string_view value) { return segment.foldedName(slot) < value; });
+        for (; match != nameOrder.end() && segment.foldedName(*match) == folded; ++match) {
+            const auto& candidate = at(segment, *match);
+            bool wanted = food ? candidate.get() == food : candidate->getName() == key.name;
+            if (wanted && isLive(segment, *match)) {
+                return *match;
+            }
+        }
+        return NO_FOOD;
+    }
+
+    // Appends the live foods in id order
+    void appendLive(std::vector<std::shared_ptr<Food>>& out) const {
+        out.reserve(out.size() + liveCount);
+        for (const auto& segment : segments) {
+            for (uint32_t slot = 0; slot < segment->foods.size(); ++slot) {
+                if (isLive(*segment, slot)) out.push_back(at(*segment, slot));
+            }
+        }
+    }
+
+    // Segment index with its marked foods emptied out and its replacements
+    // in place
+    std::shared_ptr<const Segment> purged(size_t index) const {
+        const Segment& segment = *segments[index];
+        if (markedCounts[index] == 0 && segment.replacements.empty()) return segments[index];
+        std::vector<std::shared_ptr<Food>> kept(segment.foods.size());
+        for (uint32_t slot = 0; slot < segment.foods.size(); ++slot) {
+            if (isLive(segment, slot)) kept[slot] = at(segment, slot);
+        }
+        return segment.rebuilt(std::move(kept));
+    }
+
+    // Whether index holds so many marked or replaced foods that copying it
+    // without them is due
+    bool needsPurge(size_t index) const {
+        const Segment& segment = *segments[index];
+        return (markedCounts[index] + segment.replacements.size()) * 4 > segment.liveCount;
+    }
+
+    // Segments are merged while the older of the last two is at most twice
+    // the size of the newer, so sizes fall geometrically: there are O(log n)
+    // of them, and each food is copied O(log n) times however it was added
+    void append(std::shared_ptr<const Segment> segment) {
+        segments.push_back(std::move(segment));
+        markedCounts.push_back(0);
+        while (segments.size() >= 2) {
+            size_t last = segments.size() - 1;
+            if (segments[last - 1]->foods.size() > 2 * segments[last]->foods.size()) break;
+            auto merged = Segment::merge(*purged(last - 1), *purged(last));
+            segments.pop_back();
+            markedCounts.pop_back();
+            segments.back() = std::move(merged);
+            markedCounts.back() = 0;
+        }
+    }
+};
+
+FoodDatabase::FoodDatabase() : foodsStale(false), published(new Version()) {}
+
+FoodDatabase::~FoodDatabase() {
+    // No query can still be running, but versions retired earlier may wait
+    // on readers of other catalogs
+    delete published.load();
+    EpochDomain::instance().collect();
+}
+
+const FoodDatabase::Version& FoodDatabase::currentVersion() const {
+    return *published.load();
+}
+
+void FoodDatabase::publish(std::unique_ptr<const Version> next) {
+    const Version* previous = published.exchange(next.release());
+    EpochDomain::instance().retire(previous);
+}
+
+const FoodArena* FoodDatabase::getArena() const {
+    return arena.get();
+}
+
+void FoodDatabase::addFood(const std::shared_ptr<Food>& food) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    const Version& current = currentVersion();
+    uint32_t foodId = current.nextId;
+    dependencies.resize(foodId + 1);
+    if (auto composite = dynamic_cast<const CompositeFood*>(food.get())) {
+        for (const auto& component : composite->getComponents()) {
+            uint32_t componentId = findFoodId(current, *component.first);
+            if (componentId != NO_FOOD) {
+                dependencies.addEdge(componentId, foodId);
+            }
+        }
+    }
+    appendLocked({food});
+}
+
+void FoodDatabase::addBasicFoods(const std::vector<std::shared_ptr<BasicFood>>& batch) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    appendLocked(std::vector<std::shared_ptr<Food>>(batch.begin(), batch.end()));
+}
+
+void FoodDatabase::appendLocked(std::vector<std::shared_ptr<Food>> batch) {
+    if (batch.empty()) return;
+    const Version& current = currentVersion();
+    auto next = std::make_unique<Version>(current);
+    next->nextId += static_cast<uint32_t>(batch.size());
+    next->liveCount += batch.size();
+    if (!foodsStale) {
+        foods.insert(foods.end(), batch.begin(), batch.end());
+    }
+    next->append(Segment::build(current.nextId, std::move(batch)));
+    dependencies.resize(next->nextId);
+    publish(std::move(next));
+}
+
+const std::vector<std::shared_ptr<Food>>& FoodDatabase::getFoods() const {
+    if (foodsStale) {
+        // Removals leave holes in the ids; the list is closed up only when
+        // it is asked for
+        foods.clear();
+        currentVersion().appendLive(foods);
+        foodsStale = false;
+    }
+    return foods;
+}
+
+size_t FoodDatabase::size() const {
+    return currentVersion().liveCount;
+}
+
+bool FoodDatabase::empty() const {
+    return size() == 0;
+}
+
+std::shared_ptr<Food> FoodDatabase::getFood(uint32_t id) const {
+    EpochGuard guard;
+    return currentVersion().food(id);
+}
+
+std::shared_ptr<Food> FoodDatabase::findFoodByName(const std::string& name) const {
+    YADA_STATS_TIMER("food_database.find_by_name");
+    EpochGuard guard;
+    // Older segments first, so the first food of that name is found
+    HashedName key(name);
+    const Version& version = currentVersion();
+    for (const auto& segment : version.segments) {
+        uint32_t slot = version.findSlot(*segment, key, nullptr);
+        if (slot != NO_FOOD) {
+            return version.at(*segment, slot);
+        }
+    }
+    return nullptr;
+}
+
+std::vector<std::shared_ptr<Food>> FoodDatabase::searchFoodByKeywords(const std::string& keywords, bool matchAll) const {
+    YADA_STATS_TIMER("food_database.search");
+    std::vector<std::shared_ptr<Food>> results;
+    std::stringstream ss(keywords);
+    std::string keyword;
+    const auto& dictionary = KeywordDictionary::instance();
+
+    // Resolve each term once to the set of dictionary ids whose keyword
+    // contains it
+    std::vector<std::vector<char>> termMatches;
+    while (std::getline(ss, keyword, ' ')) {
+        std::string term = KeywordDictionary::normalize(keyword);
+        if (!term.empty()) {
+            termMatches.emplace_back();
+            dictionary.markContaining(term, termMatches.back());
+        }
+    }
+
+    EpochGuard guard;
+    const Version& version = currentVersion();
+    if (termMatches.empty()) {
+        if (matchAll) {
+            version.appendLive(results);  // Nothing required, so everything matches
+        }
+        return results;
+    }
+
+    // A term matches the foods posted under its keywords. Each food counts
+    // the terms it matched; for matchAll a count only moves from t to t + 1
+    // on term t, so foods missing an earlier term fall behind.
+    std::vector<uint32_t> counts(version.nextId, 0);
+    // The same ids as sorted lists, listed when a segment first needs them
+    std::vector<std::vector<KeywordId>> termKeywords(termMatches.size());
+    std::vector<size_t> termSizes;
+    for (const auto& matches : termMatches) {
+        termSizes.push_back(static_cast<size_t>(std::count(matches.begin(), matches.end(), 1)));
+    }
+    for (const auto& segment : version.segments) {
+        const auto& postings = segment->getPostings();
+        const auto& segmentKeywords = postings.keywords;
+        uint32_t* segmentCounts = counts.data() + segment->firstId;
+        for (uint32_t term = 0; term < termMatches.size(); ++term) {
+            auto count = [&](size_t index) {
+                for (uint32_t k = postings.starts[index]; k < postings.starts[index + 1]; ++k) {
+                    uint32_t slot = postings.slots[k];
+                    if (!matchAll) {
+                        segmentCounts[slot] = 1;
+                    } else if (segmentCounts[slot] == term) {
+                        segmentCounts[slot] = term + 1;
+                    }
+                }
+            };
+            // Check the segment's keywords against the term's mask, unless
+            // the term matches so few that seeking each one is cheaper
+            const auto& matches = termMatches[term];
+            if (termSizes[term] * 8 >= segmentKeywords.size()) {
+                for (size_t index = 0; index < segmentKeywords.size(); ++index) {
+                    KeywordId present = segmentKeywords[index];
+                    if (present < matches.size() && matches[present]) count(index);
+                }
+            } else {
+                auto& matched = termKeywords[term];
+                if (matched.empty()) {
+                    matched.reserve(termSizes[term]);
+                    for (size_t id = 0; id < matches.size(); ++id) {
+                        if (matches[id]) matched.push_back(static_cast<KeywordId>(id));
+                    }
+                }
+                auto it = segmentKeywords.begin();
+                for (KeywordId wanted : matched) {
+                    it = std::lower_bound(it, segmentKeywords.end(), wanted);
+                    if (it == segmentKeywords.end()) break;
+                    if (*it == wanted) count(static_cast<size_t>(it - segmentKeywords.begin()));
+                }
+            }
+        }
+    }
+
+    uint32_t required = matchAll ? static_cast<uint32_t>(termMatches.size()) : 1;
+    for (const auto& segment : version.segments) {
+        for (size_t slot = 0; slot < segment->foods.size(); ++slot) {
+            if (counts[segment->firstId + slot] == required && version.isLive(*segment, slot)) {
+                results.push_back(version.at(*segment, slot));
+            }
+        }
+    }
+    return results;
+}
+
+void FoodDatabase::searchText(const std::string& text, std::vector<uint32_t>& ids) const {
+    YADA_STATS_TIMER("food_database.search_text");
+    ids.clear();
+    std::string needle = KeywordDictionary::normalize(text);
+    if (needle.empty()) {
+        return;
+    }
+    EpochGuard guard;
+    const Version& version = currentVersion();
+    for (const auto& segment : version.segments) {
+        const std::string& searchBlob = segment->searchBlob;
+        const std::vector<size_t>& recordStarts = segment->recordStarts;
+        size_t position = 0;
+        while (position < searchBlob.size()) {
+            size_t found = findSubstring(searchBlob.data() + position, searchBlob.size() - position,
+                                         needle.data(), needle.size());
+            if (found == SUBSTRING_NOT_FOUND) break;
+            // Report each food once and resume at the next record; records
+            // of emptied slots are empty, so a match is never theirs
+            auto next = std::upper_bound(recordStarts.begin(), recordStarts.end(), position + found);
+            uint32_t slot = static_cast<uint32_t>(next - recordStarts.begin() - 1);
+            if (version.isLive(*segment, slot)) {
+                ids.push_back(segment->firstId + slot);
+            }
+            position = next == recordStarts.end() ? searchBlob.size() : *next;
+        }
+    }
+}
+
+std::vector<RankedFood> FoodDatabase::searchRanked(const std::string& query, size_t limit) const {
+    YADA_STATS_TIMER("food_database.search_ranked");
+    EpochGuard guard;
+    const Version& version = currentVersion();
+    // Each segment's index is searched in place; words are weighed across
+    // the whole catalog, as if it had one index
+    std::vector<FuzzySearchIndex::Part> parts;
+    parts.reserve(version.segments.size());
+    for (const auto& segment : version.segments) {
+        parts.push_back({&segment->getRankedIndex(), segment->firstId});
+    }
+    // Marked foods keep their postings; ask for enough matches to make up
+    // for them
+    auto matches = FuzzySearchIndex::search(parts, query, limit + (version.nextId - version.liveCount));
+
+    std::vector<RankedFood> results;
+    results.reserve(std::min(limit, matches.size()));
+    for (const auto& match : matches) {
+        if (results.size() == limit) break;
+        if (auto food = version.food(match.foodId)) {
+            results.push_back({std::move(food), match.score});
+        }
+    }
+    return results;
+}
+
+uint32_t FoodDatabase::findFoodId(const Version& version, const Food& food) {
+    HashedName key(food.getName());
+    for (const auto& segment : version.segments) {
+        uint32_t slot = version.findSlot(*segment, key, &food);
+        if (slot != NO_FOOD) {
+            return segment->firstId + slot;
+        }
+    }
+    return NO_FOOD;
+}
+
+std::vector<std::shared_ptr<Food>> FoodDatabase::completeName(const std::string& prefix, size_t limit) const {
+    YADA_STATS_TIMER("food_database.complete_name");
+    std::string folded = KeywordDictionary::normalize(prefix);
+
+    std::vector<std::shared_ptr<Food>> results;
+    EpochGuard guard;
+    const Version& version = currentVersion();
+
+    // Position in one segment's name order, at a live food whose name has
+    // the prefix
+    struct Cursor {
+        const Segment* segment;
+        std::vector<uint32_t>::const_iterator next;
+        std::vector<uint32_t>::const_iterator end;
+        std::string_view name;
+    };
+    auto matches = [&folded, &version](Cursor& cursor) {
+        for (; cursor.next != cursor.end; ++cursor.next) {
+            cursor.name = cursor.segment->foldedName(*cursor.next);
+            if (cursor.name.compare(0, folded.size(), folded) != 0) return false;
+            if (version.isLive(*cursor.segment, *cursor.next)) return true;
+        }
+        return false;
+    };
+    std::vector<Cursor> cursors;
+    cursors.reserve(version.segments.size());
+    for (const auto& segment : version.segments) {
+        const auto& nameOrder = segment->getNameOrder();
+        auto it = std::lower_bound(nameOrder.begin(), nameOrder.end(), std::string_view(folded),
+            [&segment](uint32_t slot, std::string_view value) { return segment->foldedName(slot) < value; });
+        Cursor cursor{segment.get(), it, nameOrder.end(), {}};
+        if (matches(cursor)) {
+            cursors.push_back(cursor);
+        }
+    }
+
+    // Merge the segments' name orders; on equal names the older segment,
+    // listed first, wins, so ties stay in catalog order
+    while (results.size() < limit && !cursors.empty()) {
+        size_t best = 0;
+        for (size_t i = 1; i < cursors.size(); ++i) {
+            if (cursors[i].name < cursors[best].name) best = i;
+        }
+        Cursor& cursor = cursors[best];
+        results.push_back(version.at(*cursor.segment, *cursor.next));
+        ++cursor.next;
+        if (!matches(cursor)) {
+            cursors.erase(cursors.begin() + best);
+        }
+    }
+    return results;
+}
+
+std::vector<std::shared_ptr<Food>> FoodDatabase::findUsedBy(const Food& food, bool transitive) const {
+    YADA_STATS_TIMER("food_database.find_used_by");
+    std::vector<std::shared_ptr<Food>> results;
+    std::lock_guard<std::mutex> lock(writeMutex);
+    const Version& version = currentVersion();
+    uint32_t foodId = findFoodId(version, food);
+    if (foodId == NO_FOOD) {
+        return results;
+    }
+    auto ids = transitive ? dependencies.collectDependents(foodId) : dependencies.getDirectParents(foodId);
+    results.reserve(ids.size());
+    for (uint32_t id : ids) {
+        results.push_back(version.food(id));
+    }
+    return results;
+}
+
+std::vector<CalorieImpact> FoodDatabase::previewCalorieChange(const BasicFood& food, double newCalories) const {
+    YADA_STATS_TIMER("food_database.preview_calorie_change");
+    std::vector<CalorieImpact> impacts;
+    std::lock_guard<std::mutex> lock(writeMutex);
+    const Version& version = currentVersion();
+    uint32_t foodId = findFoodId(version, food);
+    if (foodId == NO_FOOD) {
+        return impacts;
+    }
+
+    // Calories are linear in components, so each affected recipe changes by
+    // the servings-weighted change of its affected components. Components
+    // outside the affected set contribute nothing and are not evaluated.
+    std::unordered_map<const Food*, double> changes;
+    changes[&food] = newCalories - food.getCaloriesPerServing();
+    std::vector<std::shared_ptr<Food>> dependents;
+    for (uint32_t id : dependencies.collectDependents(foodId)) {
+        dependents.push_back(version.food(id));
+    }
+    std::unordered_set<const Food*> affected;
+    for (const auto& dependent : dependents) {
+        affected.insert(dependent.get());
+    }
+    std::function<double(const Food*)> changeOf = [&](const Food* current) -> double {
+        auto known = changes.find(current);
+        if (known != changes.end()) return known->second;
+        double change = 0.0;
+        for (const auto& component : static_cast<const CompositeFood*>(current)->getComponents()) {
+            const Food* child = component.first.get();
+            if (child == &food || affected.count(child)) {
+                change += component.second * changeOf(child);
+            }
+        }
+        changes[current] = change;
+        return change;
+    };
+
+    impacts.reserve(dependents.size());
+    for (const auto& dependent : dependents) {
+        double oldCalories = dependent->getCaloriesPerServing();
+        impacts.push_back({dependent, oldCalories, oldCalories + changeOf(dependent.get())});
+    }
+    return impacts;
+}
+
+void FoodDatabase::changeCalories(const BasicFood& food, double newCalories) {
+    YADA_STATS_TIMER("food_database.change_calories");
+    std::lock_guard<std::mutex> lock(writeMutex);
+    const Version& current = currentVersion();
+    uint32_t foodId = findFoodId(current, food);
+    if (foodId == NO_FOOD) {
+        throw std::runtime_error("Food is not in the database: " + food.getName());
+    }
+
+    // Readers may be using food and the recipes over it, so those are
+    // copied rather than changed: the copy of a recipe points at the copies
+    // of its changed components
+    auto ids = dependencies.collectDependents(foodId);
+    ids.push_back(foodId);
+    std::unordered_map<const Food*, std::shared_ptr<Food>> copies;
+    for (uint32_t id : ids) {
+        copies.emplace(current.food(id).get(), nullptr);
+    }
+    auto changed = std::make_shared<BasicFood>(food);
+    changed->setCaloriesPerServing(newCalories);
+    copies[&food] = changed;
+    std::function<const std::shared_ptr<Food>&(const std::shared_ptr<Food>&)> copyOf =
+        [&](const std::shared_ptr<Food>& original) -> const std::shared_ptr<Food>& {
+        auto known = copies.find(original.get());
+        if (known == copies.end()) return original;  // Unaffected
+        if (!known->second) {
+            auto recipe = std::make_shared<CompositeFood>(static_cast<const CompositeFood&>(*original));
+            const auto& components = recipe->getComponents();
+            for (size_t i = 0; i < components.size(); ++i) {
+                recipe->setComponentFood(i, copyOf(components[i].first));
+            }
+            // Every key went in up front, so known is still valid
+            known->second = recipe;
+        }
+        return known->second;
+    };
+
+    auto next = std::make_unique<Version>(current);
+    next->changes = current.changes + 1;
+    std::vector<size_t> touched;
+    for (uint32_t id : ids) {
+        size_t index = current.segmentOf(id);
+        const Segment& segment = *current.segments[index];
+        uint32_t slot = id - segment.firstId;
+        auto& latest = segment.replacedBy[slot];
+        segment.replacements.push_back(std::make_unique<Segment::Replacement>(
+            Segment::Replacement{copyOf(current.food(id)), next->changes, latest.load(std::memory_order_relaxed)}));
+        latest.store(segment.replacements.back().get(), std::memory_order_release);
+        touched.push_back(index);
+    }
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+    // Replacements are folded into a copy of their segment, as marks are
+    for (size_t index : touched) {
+        if (next->needsPurge(index)) {
+            next->segments[index] = next->purged(index);
+            next->markedCounts[index] = 0;
+        }
+    }
+    foodsStale = true;
+    publish(std::move(next));
+}
+
+std::vector<std::shared_ptr<Food>> FoodDatabase::removeFood(const Food& food, bool cascade) {
+    YADA_STATS_TIMER("food_database.remove");
+    std::lock_guard<std::mutex> lock(writeMutex);
+    const Version& version = currentVersion();
+    uint32_t foodId = findFoodId(version, food);
+    if (foodId == NO_FOOD) {
+        throw std::runtime_error("Food is not in the database: " + food.getName());
+    }
+    auto dependents = dependencies.collectDependents(foodId);
+    if (!dependents.empty() && !cascade) {
+        throw std::runtime_error(food.getName() + " is used by " + std::to_string(dependents.size()) +
+                                 " composite food(s)");
+    }
+
+    std::vector<std::shared_ptr<Food>> removed;
+    removed.push_back(version.food(foodId));
+    for (uint32_t id : dependents) {
+        removed.push_back(version.food(id));
+    }
+    dependents.push_back(foodId);
+    removeLocked(std::move(dependents));
+    return removed;
+}
+
+void FoodDatabase::removeFoods(const std::vector<std::shared_ptr<Food>>& batch) {
+    YADA_STATS_TIMER("food_database.remove_batch");
+    std::lock_guard<std::mutex> lock(writeMutex);
+    const Version& version = currentVersion();
+    std::unordered_set<uint32_t> chosen;
+    std::vector<uint32_t> ids;
+    ids.reserve(batch.size());
+    for (const auto& food : batch) {
+        uint32_t foodId = findFoodId(version, *food);
+        if (foodId == NO_FOOD) {
+            throw std::runtime_error("Food is not in the database: " + food->getName());
+        }
+        if (chosen.insert(foodId).second) {
+            ids.push_back(foodId);
+        }
+    }
+    // Check before changing anything, so a refused batch removes nothing
+    for (uint32_t foodId : ids) {
+        for (uint32_t dependent : dependencies.collectDependents(foodId)) {
+            if (!chosen.count(dependent)) {
+                throw std::runtime_error(version.food(foodId)->getName() + " is used by " +
+                                         version.food(dependent)->getName());
+            }
+        }
+    }
+    removeLocked(std::move(ids));
+}
+
+void FoodDatabase::removeLocked(std::vector<uint32_t> ids) {
+    const Version& current = currentVersion();
+    // Recipe edges of the removed foods go first, while their components
+    // can still be found; whatever used them is being removed as well
+    for (uint32_t id : ids) {
+        if (auto composite = dynamic_cast<const CompositeFood*>(current.food(id).get())) {
+            for (const auto& component : composite->getComponents()) {
+                uint32_t componentId = findFoodId(current, *component.first);
+                if (componentId != NO_FOOD) {
+                    dependencies.removeEdge(componentId, id);
+                }
+            }
+        }
+        dependencies.clearParents(id);
+    }
+
+    // Ids stay fixed and every segment is shared: the removed foods are
+    // only marked, so a removal costs the foods it removes. A segment is
+    // copied without its marked foods once they pass a quarter of it, which
+    // spreads the copy over as many removals as it has foods.
+    auto next = std::make_unique<Version>(current);
+    next->removals = current.removals + 1;
+    std::vector<size_t> touched;
+    for (uint32_t id : ids) {
+        size_t index = current.segmentOf(id);
+        const Segment& segment = *current.segments[index];
+        segment.removedIn[id - segment.firstId].store(next->removals, std::memory_order_relaxed);
+        if (next->markedCounts[index]++ == current.markedCounts[index]) {
+            touched.push_back(index);
+        }
+    }
+    for (size_t index : touched) {
+        if (next->needsPurge(index)) {
+            next->segments[index] = next->purged(index);
+            next->markedCounts[index] = 0;
+        }
+    }
+    next->liveCount -= ids.size();
+    foodsStale = true;
+    publish(std::move(next));
+}
+
+std::vector<std::vector<std::shared_ptr<Food>>> FoodDatabase::findNearDuplicates(double threshold,
+                                                                                double calorieTolerance) const {
+    YADA_STATS_TIMER("food_database.find_near_duplicates");
+    EpochGuard guard;
+    std::vector<std::shared_ptr<Food>> live;
+    currentVersion().appendLive(live);
+
+    // Recipes sharing sub-recipes evaluate each one once
+    std::unordered_map<const Food*, double> recipes;
+    std::function<double(const Food&)> caloriesOf = [&](const Food& food) -> double {
+        auto composite = dynamic_cast<const CompositeFood*>(&food);
+        if (!composite) return food.getCaloriesPerServing();
+        auto known = recipes.find(&food);
+        if (known != recipes.end()) return known->second;
+        double total = 0.0;
+        for (const auto& component : composite->getComponents()) {
+            total += caloriesOf(*component.first) * component.second;
+        }
+        recipes.emplace(&food, total);
+        return total;
+    };
+    std::vector<double> calories;
+    calories.reserve(live.size());
+    for (const auto& food : live) {
+        calories.push_back(caloriesOf(*food));
+    }
+
+    // Each food is linked to the earlier foods it resembles; groups are the
+    // connected foods, rooted at their oldest member
+    std::vector<uint32_t> parent(live.size());
+    for (size_t id = 0; id < live.size(); ++id) {
+        parent[id] = static_cast<uint32_t>(id);
+    }
+    auto root = [&parent](uint32_t id) {
+        while (parent[id] != id) {
+            parent[id] = parent[parent[id]];
+            id = parent[id];
+        }
+        return id;
+    };
+
+    // Signatures are computed in parallel a block at a time, which bounds
+    // memory, and indexed in food order
+    const size_t BLOCK_SIZE = 65536;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    NearDuplicateIndex index;
+    std::vector<FoodSignature> signatures;
+    for (size_t blockStart = 0; blockStart < live.size(); blockStart += BLOCK_SIZE) {
+        size_t blockEnd = std::min(live.size(), blockStart + BLOCK_SIZE);
+        signatures.assign(blockEnd - blockStart, FoodSignature());
+        size_t step = (signatures.size() + threads - 1) / threads;
+        std::vector<std::future<void>> workers;
+        for (size_t begin = 0; begin < signatures.size(); begin += step) {
+            size_t end = std::min(signatures.size(), begin + step);
+            workers.push_back(std::async(std::launch::async, [&, begin, end] {
+                for (size_t i = begin; i < end; ++i) {
+                    signatures[i] = NearDuplicateIndex::signatureOf(*live[blockStart + i]);
+                }
+            }));
+        }
+        for (auto& worker : workers) {
+            worker.get();
+        }
+
+        for (size_t id = blockStart; id < blockEnd; ++id) {
+            const FoodSignature& signature = signatures[id - blockStart];
+            for (const auto& similar : index.findSimilar(signature, threshold)) {
+                if (NearDuplicateIndex::similarCalories(calories[id], calories[similar.id], calorieTolerance)) {
+                    uint32_t a = root(static_cast<uint32_t>(id));
+                    uint32_t b = root(similar.id);
+                    parent[std::max(a, b)] = std::min(a, b);
+                }
+            }
+            index.add(signature);
+        }
+    }
+
+    std::vector<std::vector<std::shared_ptr<Food>>> groups;
+    std::unordered_map<uint32_t, size_t> groupOf;  // root -> index into groups
+    std::vector<size_t> groupSizes(live.size(), 0);
+    for (size_t id = 0; id < live.size(); ++id) {
+        ++groupSizes[root(static_cast<uint32_t>(id))];
+    }
+    for (size_t id = 0; id < live.size(); ++id) {
+        uint32_t groupRoot = root(static_cast<uint32_t>(id));
+        if (groupSizes[groupRoot] < 2) continue;
+        auto inserted = groupOf.emplace(groupRoot, groups.size());
+        if (inserted.second) {
+            groups.emplace_back();
+        }
+        groups[inserted.first->second].push_back(live[id]);
+    }
+    return groups;
+}
+
+const std::vector<DanglingComponent>& FoodDatabase::getDanglingComponents() const {
+    return danglingComponents;
+}
+
+void FoodDatabase::writeTo(std::ostream& file) const {
+    YADA_STATS_TIMER("food_database.serialize");
+    for (const auto& food : getFoods()) {
+        file << food->getType() << "|" << food->getName() << "|" << food->getCaloriesPerServing();
+        
+        // Save keywords
+        const auto& keywords = food->getKeywords();
+        file << "|" << keywords.size();
+        for (const auto& keyword : keywords) {
+            file << "|" << keyword;
+        }
+
+        if (auto basicFood = dynamic_cast<const BasicFood*>(food.get())) {
+            writeNutrientFields(file, basicFood->getNutrients());
+        }
+
+        // Save components for composite foods
+        if (food->getType() == "Composite") {
+            auto compositeFood = std::dynamic_pointer_cast<CompositeFood>(food);
+            const auto& components = compositeFood->getComponents();
+            file << "|" << components.size();
+            for (const auto& comp : components) {
+                const auto& component = comp.first;
+                const auto& servings = comp.second;
+                file << "|" << component->getName() << "|" << servings;
+            }
+        }
+        file << "\n";
+    }
+}
+
+void FoodDatabase::loadFromFile(const std::string& filename) {
+    YADA_STATS_TIMER("food_database.load");
+    std::string contents = AsyncIo::instance().readFile(filename).get();
+    YADA_STATS_COUNT("food_database.bytes_read", contents.size());
+
+    // Build into locals so a malformed file leaves the current database intact.
+    // Foods and their shared_ptr control blocks come from one fresh arena;
+    // the previous arena is freed in bulk once its last food is released.
+    auto newArena = std::make_shared<FoodArena>();
+    std::vector<std::shared_ptr<Food>> loaded;
+    loaded.reserve(std::count(contents.begin(), contents.end(), '\n') + 1);
+    std::unordered_map<std::string_view, size_t> byName;
+    byName.reserve(loaded.capacity());
+
+    struct PendingComponent {
+        size_t compositeIndex;
+        std::string_view componentName;  // Points into contents
+        double servings;
+    };
+    std::vector<PendingComponent> pendingComponents;
+
+    size_t lineNumber = 0;
+    size_t lineStart = 0;
+    while (lineStart < contents.size()) {
+        size_t lineEnd = contents.find('\n', lineStart);
+        if (lineEnd == std::string::npos) lineEnd = contents.size();
+        std::string_view line(contents.data() + lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+        ++lineNumber;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) continue;
+
+        auto malformed = [&](const char* what) {
+            return std::runtime_error(std::string("Malformed ") + what + " on line " +
+                                      std::to_string(lineNumber) + " of " + filename);
+        };
+
+        FieldReader fields(line);
+        std::string_view type, name;
+        double calories;
+        size_t keywordCount;
+        if (!fields.next(type) || !fields.next(name) || !fields.nextNumber(calories) ||
+            !fields.nextCount(keywordCount) || (type != "Basic" && type != "Composite")) {
+            throw malformed("entry");
+        }
+
+        std::shared_ptr<Food> food;
+        if (type == "Basic") {
+            food = std::allocate_shared<BasicFood>(ArenaAllocator<BasicFood>(newArena), std::string(name), calories);
+        } else {
+            food = std::allocate_shared<CompositeFood>(ArenaAllocator<CompositeFood>(newArena), std::string(name));
+        }
+
+        // Load keywords
+        food->reserveKeywords(keywordCount);
+        for (size_t i = 0; i < keywordCount; ++i) {
+            std::string_view keyword;
+            fields.next(keyword);
+            food->addKeyword(std::string(keyword));
+        }
+
+        // Optional nutrients beyond calories (absent in older files)
+        if (type == "Basic" && !fields.atEnd()) {
+            size_t nutrientCount;
+            if (!fields.nextCount(nutrientCount)) {
+                throw malformed("nutrients");
+            }
+            Nutrients nutrients;
+            nutrients[CALORIES] = calories;
+            for (size_t i = 0; i < nutrientCount; ++i) {
+                double value;
+                if (!fields.nextNumber(value)) {
+                    throw malformed("nutrients");
+                }
+                // Nutrients added by newer versions are skipped
+                if (PROTEIN + i < NUTRIENT_COUNT) {
+                    nutrients.values[PROTEIN + i] = value;
+                }
+            }
+            static_cast<BasicFood&>(*food).setNutrients(nutrients);
+        }
+
+        // Handle composite food components
+        if (type == "Composite") {
+            size_t componentCount;
+            if (!fields.nextCount(componentCount)) {
+                throw malformed("components");
+            }
+            static_cast<CompositeFood&>(*food).reserveComponents(componentCount);
+            for (size_t i = 0; i < componentCount; ++i) {
+                std::string_view componentName;
+                double servings;
+                if (!fields.next(componentName) || !fields.nextNumber(servings)) {
+                    throw malformed("components");
+                }
+                pendingComponents.push_back({loaded.size(), componentName, servings});
+            }
+        }
+
+        byName.emplace(food->getName(), loaded.size());
+        loaded.push_back(std::move(food));
+    }
+
+    // Resolve composite food components, recording the reverse edges and
+    // any component that names no food
+    FoodDependencyIndex newDependencies;
+    newDependencies.resize(loaded.size());
+    std::vector<DanglingComponent> newDanglingComponents;
+    for (const auto& pending : pendingComponents) {
+        auto it = byName.find(pending.componentName);
+        if (it != byName.end()) {
+            static_cast<CompositeFood&>(*loaded[pending.compositeIndex])
+                .addComponent(loaded[it->second], pending.servings);
+            newDependencies.addEdge(static_cast<uint32_t>(it->second),
+                                    static_cast<uint32_t>(pending.compositeIndex));
+        } else {
+            newDanglingComponents.push_back({loaded[pending.compositeIndex]->getName(),
+                                             std::string(pending.componentName)});
+        }
+    }
+
+    YADA_STATS_COUNT("food_arena.allocations", newArena->getAllocationCount());
+    YADA_STATS_COUNT("food_arena.bytes", newArena->getBytesAllocated());
+    YADA_STATS_COUNT("food_arena.chunks", newArena->getChunkCount());
+    auto segment = Segment::build(0, loaded);
+    auto next = std::make_unique<Version>();
+    next->nextId = static_cast<uint32_t>(loaded.size());
+    next->liveCount = loaded.size();
+    next->append(std::move(segment));
+
+    std::lock_guard<std::mutex> lock(writeMutex);
+    foods.swap(loaded);
+    foodsStale = false;
+    arena.swap(newArena);
+    dependencies = std::move(newDependencies);
+    danglingComponents.swap(newDanglingComponents);
+    publish(std::move(next));
+}
@@ -0,0 +1,66 @@
+#include "food/FoodDependencyIndex.h"
+#include <algorithm>
+#include <unordered_set>
+
+namespace {
+
+const std::vector<uint32_t> NO_PARENTS;
+
+} // namespace
+
+void FoodDependencyIndex::clear() {
+    parents.clear();
+}
+
+void FoodDependencyIndex::resize(size_t foodCount) {
+    parents.resize(foodCount);
+}
+
+void FoodDependencyIndex::addEdge(uint32_t componentId, uint32_t compositeId) {
+    if (componentId >= parents.size()) {
+        parents.resize(componentId + 1);
+    }
+    auto& edges = parents[componentId];
+    if (std::find(edges.begin(), edges.end(), compositeId) == edges.end()) {
+        edges.push_back(compositeId);
+    }
+}
+
+void FoodDependencyIndex::removeEdge(uint32_t componentId, uint32_t compositeId) {
+    if (componentId >= parents.size()) return;
+    auto& edges = parents[componentId];
+    auto it = std::find(edges.begin(), edges.end(), compositeId);
+    if (it != edges.end()) {
+        edges.erase(it);
+    }
+}
+
+void FoodDependencyIndex::clearParents(uint32_t foodId) {
+    if (foodId < parents.size()) {
+        std::vector<uint32_t>().swap(parents[foodId]);
+    }
+}
+
+const std::vector<uint32_t>& FoodDependencyIndex::getDirectParents(uint32_t foodId) const {
+    return foodId < parents.size() ? parents[foodId] : NO_PARENTS;
+}
+
+std::vector<uint32_t> FoodDependencyIndex::collectDependents(uint32_t foodId) const {
+    // Breadth-first over parent edges; the visited set grows with the answer,
+    // not with the catalog
+    std::vector<uint32_t> dependents;
+    std::unordered_set<uint32_t> visited;
+    visited.insert(foodId);
+    const std::vector<uint32_t>* frontier = &getDirectParents(foodId);
+    size_t next = 0;
+    while (true) {
+        for (uint32_t parent : *frontier) {
+            if (visited.insert(parent).second) {
+                dependents.push_back(parent);
+            }
+        }
+        if (next == dependents.size()) break;
+        frontier = &getDirectParents(dependents[next++]);
+    }
+    return dependents;
+}
@@ -0,0 +1,525 @@
+#include "food/FoodImporter.h"
+#include "food/FoodArena.h"
+#include "stats/Stats.h"
+#include "storage/BoundedQueue.h"
+#include "storage/MappedFile.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+
+namespace {
+
+// Nutrient columns share the Nutrient numbering; the rest follow
+const size_t NAME_COLUMN = NUTRIENT_COUNT;
+const size_t KEYWORDS_COLUMN = NUTRIENT_COUNT + 1;
+const size_t COLUMN_COUNT = NUTRIENT_COUNT + 2;
+const size_t NO_COLUMN = COLUMN_COUNT;
+
+const size_t MAX_KEYWORDS = 16;
+
+struct ColumnAlias {
+    const char* header;
+    size_t column;
+};
+
+const ColumnAlias COLUMN_ALIASES[] = {
+    {"name", NAME_COLUMN}, {"description", NAME_COLUMN}, {"food", NAME_COLUMN}, {"food_name", NAME_COLUMN},
+    {"calories", CALORIES}, {"kcal", CALORIES}, {"energy", CALORIES}, {"energy_kcal", CALORIES},
+    {"protein", PROTEIN}, {"protein_g", PROTEIN},
+    {"fat", FAT}, {"total_fat", FAT}, {"fat_g", FAT},
+    {"carbohydrates", CARBOHYDRATES}, {"carbohydrate", CARBOHYDRATES}, {"carbs", CARBOHYDRATES},
+    {"carbohydrate_g", CARBOHYDRATES},
+    {"fiber", FIBER}, {"fibre", FIBER}, {"fiber_g", FIBER},
+    {"sodium", SODIUM}, {"sodium_mg", SODIUM},
+    {"keywords", KEYWORDS_COLUMN}, {"category", KEYWORDS_COLUMN}, {"tags", KEYWORDS_COLUMN},
+};
+
+const char* const INVALID_NUTRIENT[] = {
+    "invalid calories", "invalid protein", "invalid fat", "invalid carbohydrates", "invalid fiber", "invalid sodium",
+};
+
+using Fields = std::array<std::string_view, COLUMN_COUNT>;
+
+// A line-aligned slice of the input
+struct Chunk {
+    size_t sequence;
+    size_t begin;
+    size_t end;
+};
+
+// Fields are raw views into the mapped file, quotes included
+struct RawRow {
+    uint32_t line;       // Within the chunk, from 0
+    const char* error;   // Set if the line could not be split
+    Fields fields;
+};
+
+struct RawChunk {
+    size_t sequence;
+    size_t end;
+    size_t lines;
+    std::vector<RawRow> rows;
+};
+
+struct ParsedChunk {
+    size_t sequence;
+    size_t end;
+    size_t lines;
+    std::vector<std::shared_ptr<BasicFood>> foods;
+    std::vector<FoodSignature> signatures;  // Parallel to foods when near-duplicates are checked
+    std::vector<uint32_t> foodLines;
+    std::vector<RejectedRow> rejects;  // Lines within the chunk
+};
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && isBlank(text.front())) text.remove_prefix(1);
+    while (!text.empty() && isBlank(text.back())) text.remove_suffix(1);
+    return text;
+}
+
+// Splits line into its raw fields; a quoted field runs to its closing quote
+// and may contain the delimiter. Returns an error text or null.
+const char* splitLine(std::string_view line, char delimiter, const std::vector<size_t>& columns, Fields& fields) {
+    fields.fill(std::string_view());
+    size_t index = 0;
+    size_t position = 0;
+    while (true) {
+        size_t start = position;
+        if (position < line.size() && line[position] == '"') {
+            ++position;
+            while (true) {
+                size_t quote = line.find('"', position);
+                if (quote == std::string_view::npos) return "unterminated quote";
+                position = quote + 1;
+                if (position < line.size() && line[position] == '"') {
+                    ++position;  // Doubled quote inside the field
+                } else {
+                    break;
+                }
+            }
+            if (position < line.size() && line[position] != delimiter) return "text after closing quote";
+        } else {
+            size_t next = line.find(delimiter, position);
+            position = next == std::string_view::npos ? line.size() : next;
+        }
+        if (index < columns.size() && columns[index] != NO_COLUMN) {
+            fields[columns[index]] = line.substr(start, position - start);
+        }
+        ++index;
+        if (position >= line.size()) return nullptr;
+        ++position;  // Skip the delimiter
+    }
+}
+
+// Field text without surrounding quotes and blanks; doubled quotes are
+// collapsed into scratch
+std::string_view unquote(std::string_view raw, std::string& scratch) {
+    raw = trim(raw);
+    if (raw.size() < 2 || raw.front() != '"') return raw;
+    raw = raw.substr(1, raw.size() - 2);
+    if (raw.find('"') == std::string_view::npos) return trim(raw);
+    scratch.clear();
+    for (size_t i = 0; i < raw.size(); ++i) {
+        scratch += raw[i];
+        if (raw[i] == '"') ++i;
+    }
+    return trim(scratch);
+}
+
+// Empty fields count as zero
+bool parseAmount(std::string_view text, double& value) {
+    if (text.empty()) {
+        value = 0.0;
+        return true;
+    }
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size() &&
+           std::isfinite(value) && value >= 0.0;
+}
+
+bool isWordByte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+// Adds the words of name (two or more characters, at least one not a digit)
+// and the ';'-separated keywords as keywords of food
+void addKeywords(BasicFood& food, std::string_view name, std::string_view keywords) {
+    food.reserveKeywords(MAX_KEYWORDS);
+    size_t added = 0;
+    size_t position = 0;
+    while (position < name.size() && added < MAX_KEYWORDS) {
+        while (position < name.size() && !isWordByte(static_cast<unsigned char>(name[position]))) ++position;
+        size_t start = position;
+        bool hasLetter = false;
+        while (position < name.size() && isWordByte(static_cast<unsigned char>(name[position]))) {
+            hasLetter = hasLetter || name[position] < '0' || name[position] > '9';
+            ++position;
+        }
+        if (position - start >= 2 && hasLetter) {
+            food.addKeyword(std::string(name.substr(start, position - start)));
+            ++added;
+        }
+    }
+    while (!keywords.empty() && added < MAX_KEYWORDS) {
+        size_t separator = keywords.find(';');
+        std::string_view keyword = trim(keywords.substr(0, separator));
+        keywords.remove_prefix(separator == std::string_view::npos ? keywords.size() : separator + 1);
+        // '|' separates fields in the foods file
+        if (!keyword.empty() && keyword.find('|') == std::string_view::npos) {
+            food.addKeyword(std::string(keyword));
+            ++added;
+        }
+    }
+}
+
+struct Pipeline {
+    const MappedFile& file;
+    char delimiter;
+    std::vector<size_t> columns;  // Input field index -> column
+    size_t chunkBytes;
+    size_t chunksInFlight;
+    bool signFoods = false;
+
+    BoundedQueue<Chunk> chunks;
+    BoundedQueue<RawChunk> rawChunks;
+    BoundedQueue<ParsedChunk> parsedChunks;
+    std::atomic<size_t> parsersRunning;
+    std::atomic<size_t> normalizersRunning;
+
+    // The reader stays at most chunksInFlight chunks ahead of the writer
+    std::mutex progressMutex;
+    std::condition_variable progressMade;
+    size_t chunksInserted = 0;
+    bool failed = false;
+    std::exception_ptr error;
+
+    Pipeline(const MappedFile& file, size_t chunkBytes, size_t chunksInFlight, size_t workers)
+        : file(file), delimiter(','), chunkBytes(chunkBytes), chunksInFlight(chunksInFlight),
+          chunks(chunksInFlight), rawChunks(chunksInFlight), parsedChunks(chunksInFlight),
+          parsersRunning(workers), normalizersRunning(workers) {}
+
+    // Stops every stage; the first error is kept for the caller
+    void fail(std::exception_ptr exception) {
+        {
+            std::lock_guard<std::mutex> lock(progressMutex);
+            if (!failed) {
+                failed = true;
+                error = exception;
+            }
+        }
+        progressMade.notify_all();
+        chunks.close();
+        rawChunks.close();
+        parsedChunks.close();
+    }
+};
+
+void readChunks(Pipeline& pipeline, size_t offset) {
+    const char* data = pipeline.file.data();
+    size_t size = pipeline.file.size();
+    size_t sequence = 0;
+    pipeline.file.prefetch(offset, pipeline.chunkBytes);
+    while (offset < size) {
+        size_t end = std::min(size, offset + pipeline.chunkBytes);
+        if (end < size) {
+            const void* newline = std::memchr(data + end, '\n', size - end);
+            end = newline ? static_cast<size_t>(static_cast<const char*>(newline) - data) + 1 : size;
+        }
+        {
+            std::unique_lock<std::mutex> lock(pipeline.progressMutex);
+            pipeline.progressMade.wait(lock, [&] {
+                return pipeline.failed || sequence < pipeline.chunksInserted + pipeline.chunksInFlight;
+            });
+            if (pipeline.failed) return;
+        }
+        pipeline.file.prefetch(end, pipeline.chunkBytes);
+        if (!pipeline.chunks.push({sequence++, offset, end})) return;
+        offset = end;
+    }
+    pipeline.chunks.close();
+}
+
+void parseChunks(Pipeline& pipeline) {
+    Chunk chunk;
+    while (pipeline.chunks.pop(chunk)) {
+        RawChunk raw{chunk.sequence, chunk.end, 0, {}};
+        std::string_view text(pipeline.file.data() + chunk.begin, chunk.end - chunk.begin);
+        while (!text.empty()) {
+            size_t newline = text.find('\n');
+            std::string_view line = text.substr(0, newline);
+            text.remove_prefix(newline == std::string_view::npos ? text.size() : newline + 1);
+            uint32_t lineNumber = static_cast<uint32_t>(raw.lines++);
+            if (trim(line).empty()) continue;
+            if (line.back() == '\r') line.remove_suffix(1);
+            raw.rows.emplace_back();
+            RawRow& row = raw.rows.back();
+            row.line = lineNumber;
+            row.error = splitLine(line, pipeline.delimiter, pipeline.columns, row.fields);
+        }
+        if (!pipeline.rawChunks.push(std::move(raw))) break;
+    }
+    if (--pipeline.parsersRunning == 0) {
+        pipeline.rawChunks.close();
+    }
+}
+
+void normalizeChunks(Pipeline& pipeline) {
+    RawChunk raw;
+    std::string nameScratch;
+    std::string keywordScratch;
+    std::string numberScratch;
+    while (pipeline.rawChunks.pop(raw)) {
+        ParsedChunk parsed{raw.sequence, raw.end, raw.lines, {}, {}, {}, {}};
+        parsed.foods.reserve(raw.rows.size());
+        parsed.foodLines.reserve(raw.rows.size());
+        // Foods of a chunk share one arena, released with the last of them
+        auto arena = std::make_shared<FoodArena>();
+        for (const RawRow& row : raw.rows) {
+            if (row.error) {
+                parsed.rejects.push_back({row.line, row.error});
+                continue;
+            }
+            std::string_view name = unquote(row.fields[NAME_COLUMN], nameScratch);
+            if (name.empty()) {
+                parsed.rejects.push_back({row.line, "missing name"});
+                continue;
+            }
+            if (name.find('|') != std::string_view::npos) {
+                parsed.rejects.push_back({row.line, "name contains '|'"});
+                continue;
+            }
+            if (trim(row.fields[CALORIES]).empty()) {
+                parsed.rejects.push_back({row.line, "missing calories"});
+                continue;
+            }
+            Nutrients nutrients;
+            const char* invalid = nullptr;
+            for (size_t i = 0; i < NUTRIENT_COUNT && !invalid; ++i) {
+                if (!parseAmount(unquote(row.fields[i], numberScratch), nutrients.values[i])) {
+                    invalid = INVALID_NUTRIENT[i];
+                }
+            }
+            if (invalid) {
+                parsed.rejects.push_back({row.line, invalid});
+                continue;
+            }
+            auto food = std::allocate_shared<BasicFood>(ArenaAllocator<BasicFood>(arena), std::string(name), nutrients);
+            addKeywords(*food, name, unquote(row.fields[KEYWORDS_COLUMN], keywordScratch));
+            if (pipeline.signFoods) {
+                parsed.signatures.push_back(NearDuplicateIndex::signatureOf(*food));
+            }
+            parsed.foods.push_back(std::move(food));
+            parsed.foodLines.push_back(row.line);
+        }
+        if (!pipeline.parsedChunks.push(std::move(parsed))) break;
+    }
+    if (--pipeline.normalizersRunning == 0) {
+        pipeline.parsedChunks.close();
+    }
+}
+
+std::string foldHeader(std::string_view header) {
+    std::string folded;
+    for (char c : header) {
+        if (c >= 'A' && c <= 'Z') {
+            folded += static_cast<char>(c + ('a' - 'A'));
+        } else if (c == ' ' || c == '-') {
+            folded += '_';
+        } else {
+            folded += c;
+        }
+    }
+    return folded;
+}
+
+} // namespace
+
+FoodImporter::FoodImporter(FoodDatabase& database) : database(database) {}
+
+ImportReport FoodImporter::importFile(const std::string& filename, const ImportOptions& options,
+                                      const std::function<void(const ImportProgress&)>& progress) {
+    YADA_STATS_TIMER("food_import.import");
+    MappedFile file(filename);
+    size_t workers = std::max<size_t>(1, options.threads);
+    Pipeline pipeline(file, std::max<size_t>(1, options.chunkBytes), std::max<size_t>(1, options.chunksInFlight),
+                      workers);
+
+    // The header picks the delimiter and maps fields to columns
+    std::string_view contents(file.data(), file.size());
+    size_t headerEnd = contents.find('\n');
+    std::string_view header = trim(contents.substr(0, headerEnd));
+    if (header.find(',') == std::string_view::npos && header.find('\t') != std::string_view::npos) {
+        pipeline.delimiter = '\t';
+    }
+    std::array<bool, COLUMN_COUNT> seen = {};
+    std::string scratch;
+    while (true) {
+        size_t next = header.find(pipeline.delimiter);
+        std::string folded = foldHeader(unquote(header.substr(0, next), scratch));
+        size_t column = NO_COLUMN;
+        for (const auto& alias : COLUMN_ALIASES) {
+            if (folded == alias.header && !seen[alias.column]) {
+                column = alias.column;
+                seen[column] = true;
+                break;
+            }
+        }
+        pipeline.columns.push_back(column);
+        if (next == std::string_view::npos) break;
+        header.remove_prefix(next + 1);
+    }
+    if (!seen[NAME_COLUMN] || !seen[CALORIES]) {
+        throw std::runtime_error("Import file needs a header with name and calories columns: " + filename);
+    }
+
+    // Names already in the catalog or imported earlier in the file
+    std::unordered_set<std::string_view> names;
+    names.reserve(database.size());
+    for (const auto& food : database.getFoods()) {
+        names.insert(food->getName());
+    }
+
+    // Foods new rows are compared with, by index id
+    pipeline.signFoods = options.nearDuplicates != NearDuplicatePolicy::KEEP;
+    NearDuplicateIndex nearIndex;
+    std::vector<const Food*> indexedFoods;
+    std::vector<double> indexedCalories;
+    auto indexFood = [&](const Food& food, const FoodSignature& signature) {
+        nearIndex.add(signature);
+        indexedFoods.push_back(&food);
+        indexedCalories.push_back(food.getCaloriesPerServing());
+    };
+    if (pipeline.signFoods) {
+        for (const auto& food : database.getFoods()) {
+            indexFood(*food, NearDuplicateIndex::signatureOf(*food));
+        }
+    }
+    auto findNearDuplicate = [&](const BasicFood& food, const FoodSignature& signature) -> const Food* {
+        for (const auto& similar : nearIndex.findSimilar(signature, options.similarityThreshold)) {
+            if (NearDuplicateIndex::similarCalories(food.getCaloriesPerServing(), indexedCalories[similar.id],
+                                                    options.calorieTolerance)) {
+                return indexedFoods[similar.id];
+            }
+        }
+        return nullptr;
+    };
+
+    std::vector<std::thread> threads;
+    size_t dataStart = headerEnd == std::string_view::npos ? contents.size() : headerEnd + 1;
+    auto guarded = [&pipeline](auto stage) {
+        return [&pipeline, stage] {
+            try {
+                stage();
+            } catch (...) {
+                pipeline.fail(std::current_exception());
+            }
+        };
+    };
+    try {
+        threads.emplace_back(guarded([&pipeline, dataStart] { readChunks(pipeline, dataStart); }));
+        for (size_t i = 0; i < workers; ++i) {
+            threads.emplace_back(guarded([&pipeline] { parseChunks(pipeline); }));
+            threads.emplace_back(guarded([&pipeline] { normalizeChunks(pipeline); }));
+        }
+    } catch (...) {
+        pipeline.fail(std::current_exception());
+    }
+
+    // Single writer: chunks may finish out of order and are inserted in order
+    ImportReport report;
+    size_t lineBase = 2;  // Line number of the first data line
+    std::map<size_t, ParsedChunk> waiting;
+    size_t nextSequence = 0;
+    std::vector<std::shared_ptr<BasicFood>> accepted;
+    auto reject = [&report](size_t line, std::string reason) {
+        if (report.rejectedRows.size() < MAX_REPORTED_REJECTS) {
+            report.rejectedRows.push_back({line, std::move(reason)});
+        }
+        ++report.rejected;
+    };
+    try {
+        ParsedChunk parsed;
+        while (pipeline.parsedChunks.pop(parsed)) {
+            size_t sequence = parsed.sequence;
+            waiting.emplace(sequence, std::move(parsed));
+            for (auto it = waiting.find(nextSequence); it != waiting.end(); it = waiting.find(nextSequence)) {
+                ParsedChunk& chunk = it->second;
+                if (nextSequence == 0 && chunk.end > dataStart) {
+                    // Size the name set once from the first chunk's line
+                    // length rather than rehashing as it grows
+                    names.reserve(names.size() + chunk.lines * (file.size() - dataStart) / (chunk.end - dataStart));
+                }
+                // Rejects and foods are each in line order; merge them so
+                // the report stays in file order
+                size_t rejectIndex = 0;
+                accepted.clear();
+                for (size_t i = 0; i < chunk.foods.size(); ++i) {
+                    for (; rejectIndex < chunk.rejects.size() && chunk.rejects[rejectIndex].line < chunk.foodLines[i];
+                         ++rejectIndex) {
+                        reject(lineBase + chunk.rejects[rejectIndex].line, std::move(chunk.rejects[rejectIndex].reason));
+                    }
+                    const auto& food = chunk.foods[i];
+                    if (names.count(food->getName())) {
+                        reject(lineBase + chunk.foodLines[i], "duplicate name");
+                        continue;
+                    }
+                    if (pipeline.signFoods) {
+                        if (const Food* match = findNearDuplicate(*food, chunk.signatures[i])) {
+                            if (report.nearDuplicateRows.size() < MAX_REPORTED_REJECTS) {
+                                report.nearDuplicateRows.push_back({lineBase + chunk.foodLines[i], food->getName(),
+                                                                    match->getName()});
+                            }
+                            ++report.nearDuplicates;
+                            if (options.nearDuplicates == NearDuplicatePolicy::MERGE) continue;
+                        }
+                        indexFood(*food, chunk.signatures[i]);
+                    }
+                    names.insert(food->getName());
+                    accepted.push_back(std::move(chunk.foods[i]));
+                }
+                for (; rejectIndex < chunk.rejects.size(); ++rejectIndex) {
+                    reject(lineBase + chunk.rejects[rejectIndex].line, std::move(chunk.rejects[rejectIndex].reason));
+                }
+                database.addBasicFoods(accepted);
+                report.imported += accepted.size();
+                lineBase += chunk.lines;
+                size_t bytesDone = chunk.end;
+                waiting.erase(it);
+                ++nextSequence;
+                {
+                    std::lock_guard<std::mutex> lock(pipeline.progressMutex);
+                    ++pipeline.chunksInserted;
+                }
+                pipeline.progressMade.notify_all();
+                if (progress) {
+                    progress({bytesDone, file.size(), report.imported, report.rejected});
+                }
+            }
+        }
+    } catch (...) {
+        pipeline.fail(std::current_exception());
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (pipeline.error) {
+        std::rethrow_exception(pipeline.error);
+    }
+    YADA_STATS_COUNT("food_import.rows", report.imported);
+    YADA_STATS_COUNT("food_import.rejected", report.rejected);
+    return report;
+}
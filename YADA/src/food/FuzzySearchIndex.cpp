@@ -0,0 +1,363 @@
+#include "food/FuzzySearchIndex.h"
+#include "food/KeywordDictionary.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <queue>
+
+namespace {
+
+const size_t MAX_PATTERN_LENGTH = 64;
+
+// Words are runs of ASCII letters and digits or of non-ASCII (UTF-8) bytes
+bool isTokenByte(unsigned char c) {
+    return c >= 0x80 || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9');
+}
+
+std::vector<std::string> tokenize(const std::string& normalized) {
+    std::vector<std::string> words;
+    size_t i = 0;
+    while (i < normalized.size()) {
+        while (i < normalized.size() && !isTokenByte(static_cast<unsigned char>(normalized[i]))) ++i;
+        size_t begin = i;
+        while (i < normalized.size() && isTokenByte(static_cast<unsigned char>(normalized[i]))) ++i;
+        if (i > begin) {
+            words.push_back(normalized.substr(begin, i - begin));
+        }
+    }
+    return words;
+}
+
+// Bigrams of the token padded with '\0' on both sides, so a word of length n
+// has n + 1 of them and the first ones are shared by all its prefixes
+std::vector<uint32_t> bigrams(std::string_view token) {
+    std::vector<uint32_t> result;
+    result.reserve(token.size() + 1);
+    unsigned char previous = 0;
+    for (char c : token) {
+        unsigned char current = static_cast<unsigned char>(c);
+        result.push_back((static_cast<uint32_t>(previous) << 8) | current);
+        previous = current;
+    }
+    result.push_back(static_cast<uint32_t>(previous) << 8);
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+// Typos tolerated for a query term of the given length
+int maxEdits(size_t length) {
+    if (length <= 2 || length > MAX_PATTERN_LENGTH) return 0;
+    if (length <= 5) return 1;
+    return 2;
+}
+
+enum MatchKind : uint8_t { EXACT, PREFIX, FUZZY };
+
+struct WorseFirst {
+    bool operator()(const FuzzyMatch& a, const FuzzyMatch& b) const {
+        if (a.score != b.score) return a.score > b.score;
+        return a.foodId < b.foodId;
+    }
+};
+
+} // namespace
+
+struct FuzzySearchIndex::Scratch {
+    // A token of one part matching the current query term
+    struct TermToken {
+        uint32_t part;
+        uint32_t tokenId;
+        MatchKind kind;
+        double quality;
+        size_t foodCount;  // Foods posted under its spelling in every part
+    };
+
+    std::vector<uint16_t> sharedBigramCounts;  // token id -> count, one part at a time
+    std::vector<uint32_t> candidateTokens;
+    std::vector<TermToken> termTokens;
+    std::vector<uint32_t> spellingOrder;
+    std::vector<Accumulator> accumulators;  // catalog id -> scores
+    std::vector<uint32_t> termFoods;
+    std::vector<uint32_t> matchedFoods;
+};
+
+FuzzySearchIndex::Scratch& FuzzySearchIndex::threadScratch() {
+    thread_local Scratch scratch;
+    return scratch;
+}
+
+uint32_t FuzzySearchIndex::internToken(const std::string& token) {
+    auto it = tokenIds.find(token);
+    if (it != tokenIds.end()) {
+        return it->second;
+    }
+    uint32_t id = static_cast<uint32_t>(tokens.size());
+    tokens.push_back(token);
+    tokenIds.emplace(token, id);
+    postings.emplace_back();
+    for (uint32_t bigram : bigrams(token)) {
+        bigramTokens[bigram].push_back(id);
+    }
+    return id;
+}
+
+void FuzzySearchIndex::addPosting(uint32_t tokenId, uint32_t foodId, uint8_t namePosition) {
+    auto& list = postings[tokenId];
+    if (!list.empty() && list.back().foodId == foodId) {
+        Posting& posting = list.back();
+        if (posting.count < UINT16_MAX) ++posting.count;
+        posting.namePosition = std::min(posting.namePosition, namePosition);
+        return;
+    }
+    list.push_back({foodId, 1, namePosition});
+}
+
+void FuzzySearchIndex::addFood(uint32_t foodId, const Food& food) {
+    auto nameWords = tokenize(KeywordDictionary::normalize(food.getName()));
+    for (size_t position = 0; position < nameWords.size(); ++position) {
+        uint8_t namePosition = static_cast<uint8_t>(std::min<size_t>(position, NOT_IN_NAME - 1));
+        addPosting(internToken(nameWords[position]), foodId, namePosition);
+    }
+    for (const auto& keyword : food.getKeywords()) {
+        for (const auto& word : tokenize(keyword)) {
+            addPosting(internToken(word), foodId, NOT_IN_NAME);
+        }
+    }
+    nameTokenCounts.push_back(static_cast<uint8_t>(std::min<size_t>(nameWords.size(), UINT8_MAX)));
+}
+
+void FuzzySearchIndex::append(const FuzzySearchIndex& other) {
+    uint32_t offset = static_cast<uint32_t>(getFoodCount());
+    for (uint32_t tokenId = 0; tokenId < other.tokens.size(); ++tokenId) {
+        uint32_t merged = internToken(other.tokens[tokenId]);
+        auto& list = postings[merged];
+        list.reserve(list.size() + other.postings[tokenId].size());
+        for (Posting posting : other.postings[tokenId]) {
+            posting.foodId += offset;
+            list.push_back(posting);
+        }
+    }
+    nameTokenCounts.insert(nameTokenCounts.end(), other.nameTokenCounts.begin(), other.nameTokenCounts.end());
+}
+
+void FuzzySearchIndex::removeFoods(const std::vector<uint32_t>& foodIds) {
+    if (foodIds.empty()) return;
+    for (auto& list : postings) {
+        list.erase(std::remove_if(list.begin(), list.end(), [&foodIds](const Posting& posting) {
+            return std::binary_search(foodIds.begin(), foodIds.end(), posting.foodId);
+        }), list.end());
+    }
+    for (uint32_t foodId : foodIds) {
+        nameTokenCounts[foodId] = 0;
+    }
+}
+
+size_t FuzzySearchIndex::getFoodCount() const {
+    return nameTokenCounts.size();
+}
+
+int FuzzySearchIndex::editDistance(std::string_view pattern, std::string_view text) {
+    pattern = pattern.substr(0, MAX_PATTERN_LENGTH);
+    const size_t m = pattern.size();
+    if (m == 0) return static_cast<int>(text.size());
+
+    uint64_t peq[256] = {};
+    for (size_t i = 0; i < m; ++i) {
+        peq[static_cast<unsigned char>(pattern[i])] |= uint64_t(1) << i;
+    }
+    const uint64_t highBit = uint64_t(1) << (m - 1);
+    uint64_t pv = ~uint64_t(0);
+    uint64_t mv = 0;
+    int score = static_cast<int>(m);
+    for (char c : text) {
+        uint64_t eq = peq[static_cast<unsigned char>(c)];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        if (ph & highBit) {
+            ++score;
+        } else if (mh & highBit) {
+            --score;
+        }
+        // The top row grows by one per text byte (global alignment)
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+    return score;
+}
+
+std::vector<FuzzyMatch> FuzzySearchIndex::search(const std::string& query, size_t limit) const {
+    return search({Part{this, 0}}, query, limit);
+}
+
+std::vector<FuzzyMatch> FuzzySearchIndex::search(const std::vector<Part>& parts, const std::string& query,
+                                                 size_t limit) {
+    std::vector<FuzzyMatch> results;
+    auto terms = tokenize(KeywordDictionary::normalize(query));
+    if (terms.empty() || limit == 0) {
+        return results;
+    }
+    size_t totalFoods = 0;
+    size_t idEnd = 0;
+    for (const Part& part : parts) {
+        totalFoods += part.index->getFoodCount();
+        idEnd = std::max(idEnd, part.firstId + part.index->getFoodCount());
+    }
+    const double foodCount = static_cast<double>(totalFoods);
+    Scratch& scratch = threadScratch();
+    if (scratch.accumulators.size() < idEnd) {
+        scratch.accumulators.resize(idEnd);
+    }
+    auto& accumulators = scratch.accumulators;
+    auto& termTokens = scratch.termTokens;
+    auto& termFoods = scratch.termFoods;
+    auto& matchedFoods = scratch.matchedFoods;
+    matchedFoods.clear();
+
+    for (size_t termIndex = 0; termIndex < terms.size(); ++termIndex) {
+        const std::string& term = terms[termIndex];
+        // Candidates share enough bigrams with the term to be within the edit
+        // budget (each edit breaks at most two) or to start with it
+        auto termBigrams = bigrams(term);
+        int edits = maxEdits(term.size());
+        int bigramCount = static_cast<int>(termBigrams.size());
+        int needed = std::min(bigramCount - 1, bigramCount - 2 * edits);
+        size_t minLength = term.size() - edits;
+        termTokens.clear();
+        for (uint32_t partIndex = 0; partIndex < parts.size(); ++partIndex) {
+            const FuzzySearchIndex& index = *parts[partIndex].index;
+            auto& sharedBigramCounts = scratch.sharedBigramCounts;
+            if (sharedBigramCounts.size() < index.tokens.size()) {
+                sharedBigramCounts.resize(index.tokens.size());
+            }
+            auto& candidateTokens = scratch.candidateTokens;
+            candidateTokens.clear();
+            for (uint32_t bigram : termBigrams) {
+                auto it = index.bigramTokens.find(bigram);
+                if (it == index.bigramTokens.end()) continue;
+                for (uint32_t tokenId : it->second) {
+                    if (index.tokens[tokenId].size() < minLength) continue;
+                    if (sharedBigramCounts[tokenId]++ == 0) {
+                        candidateTokens.push_back(tokenId);
+                    }
+                }
+            }
+
+            for (uint32_t tokenId : candidateTokens) {
+                int shared = sharedBigramCounts[tokenId];
+                sharedBigramCounts[tokenId] = 0;
+                if (shared < needed || index.postings[tokenId].empty()) continue;
+                const std::string& token = index.tokens[tokenId];
+                MatchKind kind;
+                double quality;
+                if (token == term) {
+                    kind = EXACT;
+                    quality = 1.0;
+                } else if (token.compare(0, term.size(), term) == 0) {
+                    kind = PREFIX;
+                    quality = 0.5 + 0.4 * term.size() / token.size();
+                } else {
+                    if (token.size() > term.size() + edits) continue;
+                    int distance = editDistance(term, token);
+                    if (distance > edits) continue;
+                    kind = FUZZY;
+                    quality = 0.6 - 0.2 * (distance - 1);
+                }
+                termTokens.push_back({partIndex, tokenId, kind, quality, index.postings[tokenId].size()});
+            }
+        }
+
+        // A spelling found in several parts is weighed by all its foods
+        if (parts.size() > 1 && termTokens.size() > 1) {
+            auto spelling = [&](uint32_t i) -> const std::string& {
+                return parts[termTokens[i].part].index->tokens[termTokens[i].tokenId];
+            };
+            auto& order = scratch.spellingOrder;
+            order.resize(termTokens.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return spelling(a) < spelling(b); });
+            for (size_t begin = 0; begin < order.size();) {
+                size_t end = begin;
+                size_t total = 0;
+                while (end < order.size() && spelling(order[end]) == spelling(order[begin])) {
+                    total += termTokens[order[end++]].foodCount;
+                }
+                for (size_t i = begin; i < end; ++i) {
+                    termTokens[order[i]].foodCount = total;
+                }
+                begin = end;
+            }
+        }
+
+        termFoods.clear();
+        for (const auto& match : termTokens) {
+            const FuzzySearchIndex& index = *parts[match.part].index;
+            uint32_t firstId = parts[match.part].firstId;
+            double weight = std::log(1.0 + foodCount / match.foodCount) * match.quality;
+            for (const auto& posting : index.postings[match.tokenId]) {
+                bool inName = posting.namePosition != NOT_IN_NAME;
+                float score = static_cast<float>(weight * (1.0 + std::log(static_cast<double>(posting.count))) *
+                                                 (inName ? 1.5 : 1.0));
+                uint32_t foodId = firstId + posting.foodId;
+                Accumulator& food = accumulators[foodId];
+                if (food.termScore == 0.0f) {
+                    termFoods.push_back(foodId);
+                    food.nameWords = index.nameTokenCounts[posting.foodId];
+                }
+                if (score > food.termScore) {
+                    food.termScore = score;
+                    food.termKind = match.kind;
+                    food.termNamePosition = posting.namePosition;
+                }
+            }
+        }
+
+        // A food earns each term once, through its best matching token
+        for (uint32_t foodId : termFoods) {
+            Accumulator& food = accumulators[foodId];
+            food.score += food.termScore;
+            if (food.termNamePosition != NOT_IN_NAME) {
+                ++food.nameTerms;
+                if (food.termKind == EXACT) ++food.exactNameTerms;
+            }
+            if (termIndex == 0 && food.termNamePosition == 0) {
+                food.startsName = true;
+            }
+            food.termScore = 0.0f;
+            if (!food.touched) {
+                food.touched = true;
+                matchedFoods.push_back(foodId);
+            }
+        }
+    }
+
+    std::priority_queue<FuzzyMatch, std::vector<FuzzyMatch>, WorseFirst> top;
+    for (uint32_t foodId : matchedFoods) {
+        Accumulator& food = accumulators[foodId];
+        double score = food.score;
+        if (food.startsName) score *= 1.25;
+        if (food.nameTerms == terms.size() && food.nameWords == terms.size()) {
+            // The query is the whole name, possibly misspelt
+            score *= food.exactNameTerms == terms.size() ? 1.5 : 1.25;
+        }
+        food = Accumulator();
+        FuzzyMatch match{foodId, score};
+        if (top.size() < limit) {
+            top.push(match);
+        } else if (WorseFirst()(match, top.top())) {
+            top.pop();
+            top.push(match);
+        }
+    }
+
+    results.resize(top.size());
+    for (size_t i = results.size(); i-- > 0;) {
+        results[i] = top.top();
+        top.pop();
+    }
+    return results;
+}
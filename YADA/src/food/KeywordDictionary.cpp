@@ -0,0 +1,155 @@
+#include "food/KeywordDictionary.h"
+#include "food/SubstringSearch.h"
+#include <algorithm>
+#include <mutex>
+
+namespace {
+
+bool isSpace(unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Precomposed lowercase Latin-1 letter for base + combining mark, or 0
+unsigned composeLatin1(char base, unsigned char mark) {
+    struct Composition { char base; unsigned char mark; unsigned codePoint; };
+    static const Composition table[] = {
+        {'a', 0x80, 0xE0}, {'e', 0x80, 0xE8}, {'i', 0x80, 0xEC}, {'o', 0x80, 0xF2}, {'u', 0x80, 0xF9},
+        {'a', 0x81, 0xE1}, {'e', 0x81, 0xE9}, {'i', 0x81, 0xED}, {'o', 0x81, 0xF3}, {'u', 0x81, 0xFA},
+        {'y', 0x81, 0xFD},
+        {'a', 0x82, 0xE2}, {'e', 0x82, 0xEA}, {'i', 0x82, 0xEE}, {'o', 0x82, 0xF4}, {'u', 0x82, 0xFB},
+        {'a', 0x83, 0xE3}, {'n', 0x83, 0xF1}, {'o', 0x83, 0xF5},
+        {'a', 0x88, 0xE4}, {'e', 0x88, 0xEB}, {'i', 0x88, 0xEF}, {'o', 0x88, 0xF6}, {'u', 0x88, 0xFC},
+        {'y', 0x88, 0xFF},
+        {'a', 0x8A, 0xE5},
+        {'c', 0xA7, 0xE7},  // U+0327 combining cedilla
+    };
+    for (const auto& entry : table) {
+        if (entry.base == base && entry.mark == mark) {
+            return entry.codePoint;
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+KeywordDictionary& KeywordDictionary::instance() {
+    static KeywordDictionary dictionary;
+    return dictionary;
+}
+
+std::string_view KeywordDictionary::trim(std::string_view text) {
+    size_t begin = 0;
+    size_t end = text.size();
+    while (begin < end && isSpace(static_cast<unsigned char>(text[begin]))) ++begin;
+    while (end > begin && isSpace(static_cast<unsigned char>(text[end - 1]))) --end;
+    return text.substr(begin, end - begin);
+}
+
+std::string KeywordDictionary::normalize(std::string_view keyword) {
+    std::string result(trim(keyword));
+    bool ascii = true;
+    for (char& c : result) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (byte >= 0x80) {
+            ascii = false;
+        } else if (byte >= 'A' && byte <= 'Z') {
+            c = static_cast<char>(byte + ('a' - 'A'));
+        }
+    }
+    if (ascii) {
+        return result;
+    }
+
+    // Slow path for UTF-8: fold Latin-1 capitals and compose accents
+    std::string folded;
+    folded.reserve(result.size());
+    for (size_t i = 0; i < result.size(); ++i) {
+        unsigned char byte = static_cast<unsigned char>(result[i]);
+        unsigned char nextByte = i + 1 < result.size() ? static_cast<unsigned char>(result[i + 1]) : 0;
+        if (byte == 0xC3 && nextByte >= 0x80 && nextByte <= 0x9E && nextByte != 0x97) {
+            // U+00C0..U+00DE capitals (except the multiplication sign)
+            folded += static_cast<char>(0xC3);
+            folded += static_cast<char>(nextByte + 0x20);
+            ++i;
+        } else if (byte == 0xCC && !folded.empty() && (nextByte & 0xC0) == 0x80) {
+            unsigned codePoint = composeLatin1(folded.back(), nextByte);
+            if (codePoint != 0) {
+                folded.back() = static_cast<char>(0xC3);
+                folded += static_cast<char>(0x80 + (codePoint - 0xC0));
+            } else {
+                folded += result[i];
+                folded += result[i + 1];
+            }
+            ++i;
+        } else {
+            folded += result[i];
+        }
+    }
+    return folded;
+}
+
+KeywordId KeywordDictionary::intern(const std::string& normalizedKeyword) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = ids.find(normalizedKeyword);
+        if (it != ids.end()) {
+            return it->second;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(normalizedKeyword);
+    if (it != ids.end()) {
+        return it->second;  // Interned by another thread in the meantime
+    }
+    KeywordId id = static_cast<KeywordId>(keywords.size());
+    keywords.push_back(normalizedKeyword);
+    ids.emplace(keywords.back(), id);
+    textOffsets.push_back(text.size());
+    text += normalizedKeyword;
+    text += '\0';
+    return id;
+}
+
+bool KeywordDictionary::find(const std::string& normalizedKeyword, KeywordId& id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(normalizedKeyword);
+    if (it == ids.end()) {
+        return false;
+    }
+    id = it->second;
+    return true;
+}
+
+std::string KeywordDictionary::getKeyword(KeywordId id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return keywords.at(id);
+}
+
+size_t KeywordDictionary::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return keywords.size();
+}
+
+void KeywordDictionary::appendKeywords(const std::vector<KeywordId>& keywordIds, char separator, std::string& out) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    for (KeywordId id : keywordIds) {
+        out += keywords.at(id);
+        out += separator;
+    }
+}
+
+void KeywordDictionary::markContaining(const std::string& normalizedTerm, std::vector<char>& matches) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    matches.assign(keywords.size(), 0);
+    // One vectorized scan over all keywords; a hit skips to the next keyword
+    size_t position = 0;
+    while (position < text.size()) {
+        size_t found = findSubstring(text.data() + position, text.size() - position,
+                                     normalizedTerm.data(), normalizedTerm.size());
+        if (found == SUBSTRING_NOT_FOUND) break;
+        auto next = std::upper_bound(textOffsets.begin(), textOffsets.end(), position + found);
+        matches[next - textOffsets.begin() - 1] = 1;
+        position = next == textOffsets.end() ? text.size() : *next;
+    }
+}
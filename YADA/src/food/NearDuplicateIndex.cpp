@@ -0,0 +1,190 @@
+#include "food/NearDuplicateIndex.h"
+#include "food/KeywordDictionary.h"
+#include <algorithm>
+#include <cmath>
+#include <string_view>
+
+namespace {
+
+const uint32_t NO_FOOD = UINT32_MAX;
+
+// SplitMix64 finalizer: every input bit affects every output bit
+uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t hashToken(std::string_view token) {
+    uint64_t hash = 0xcbf29ce484222325ULL;  // FNV-1a
+    for (char c : token) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Same word boundaries as ranked search: runs of ASCII letters and digits
+// or of non-ASCII (UTF-8) bytes
+bool isTokenByte(unsigned char c) {
+    return c >= 0x80 || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9');
+}
+
+void addWords(std::string_view normalized, std::vector<uint64_t>& tokens) {
+    size_t i = 0;
+    while (i < normalized.size()) {
+        while (i < normalized.size() && !isTokenByte(static_cast<unsigned char>(normalized[i]))) ++i;
+        size_t begin = i;
+        while (i < normalized.size() && isTokenByte(static_cast<unsigned char>(normalized[i]))) ++i;
+        if (i > begin) {
+            tokens.push_back(hashToken(normalized.substr(begin, i - begin)));
+        }
+    }
+}
+
+// Jaccard similarity of two sorted, unique token sets; empty sets match nothing
+double jaccard(const uint64_t* a, size_t aSize, const uint64_t* b, size_t bSize) {
+    if (aSize == 0 || bSize == 0) return 0.0;
+    size_t i = 0, j = 0, shared = 0;
+    while (i < aSize && j < bSize) {
+        if (a[i] < b[j]) {
+            ++i;
+        } else if (b[j] < a[i]) {
+            ++j;
+        } else {
+            ++shared;
+            ++i;
+            ++j;
+        }
+    }
+    return static_cast<double>(shared) / static_cast<double>(aSize + bSize - shared);
+}
+
+} // namespace
+
+FoodSignature NearDuplicateIndex::signatureOf(const Food& food) {
+    FoodSignature signature;
+    addWords(KeywordDictionary::normalize(food.getName()), signature.tokens);
+    // Keywords are normalized already
+    const auto& dictionary = KeywordDictionary::instance();
+    for (KeywordId id : food.getKeywordIds()) {
+        addWords(dictionary.getKeyword(id), signature.tokens);
+    }
+    std::sort(signature.tokens.begin(), signature.tokens.end());
+    signature.tokens.erase(std::unique(signature.tokens.begin(), signature.tokens.end()), signature.tokens.end());
+
+    // One salted hash per signature position stands in for a permutation
+    signature.minHashes.fill(UINT32_MAX);
+    for (size_t i = 0; i < FoodSignature::SIZE; ++i) {
+        uint64_t salt = mix(0x9e3779b97f4a7c15ULL * (i + 1));
+        for (uint64_t token : signature.tokens) {
+            signature.minHashes[i] = std::min(signature.minHashes[i], static_cast<uint32_t>(mix(token ^ salt)));
+        }
+    }
+    return signature;
+}
+
+double NearDuplicateIndex::similarity(const FoodSignature& a, const FoodSignature& b) {
+    return jaccard(a.tokens.data(), a.tokens.size(), b.tokens.data(), b.tokens.size());
+}
+
+bool NearDuplicateIndex::similarCalories(double a, double b, double tolerance) {
+    return std::fabs(a - b) <= tolerance * std::max(std::fabs(a), std::fabs(b));
+}
+
+uint32_t NearDuplicateIndex::bandKey(const FoodSignature& signature, size_t band) {
+    uint64_t hash = mix(band + 1);
+    for (size_t row = 0; row < ROWS; ++row) {
+        hash = mix(hash + signature.minHashes[band * ROWS + row]);
+    }
+    uint32_t key = static_cast<uint32_t>(hash);
+    return key ? key : 1;
+}
+
+size_t NearDuplicateIndex::findSlot(const BandTable& table, uint32_t key) {
+    size_t mask = table.keys.size() - 1;
+    size_t slot = key & mask;
+    while (table.keys[slot] != 0 && table.keys[slot] != key) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void NearDuplicateIndex::grow(BandTable& table) {
+    BandTable bigger;
+    bigger.keys.assign(std::max<size_t>(64, table.keys.size() * 2), 0);
+    bigger.heads.assign(bigger.keys.size(), NO_FOOD);
+    bigger.used = table.used;
+    for (size_t slot = 0; slot < table.keys.size(); ++slot) {
+        if (table.keys[slot] != 0) {
+            size_t target = findSlot(bigger, table.keys[slot]);
+            bigger.keys[target] = table.keys[slot];
+            bigger.heads[target] = table.heads[slot];
+        }
+    }
+    table = std::move(bigger);
+}
+
+uint32_t NearDuplicateIndex::add(const FoodSignature& signature) {
+    uint32_t id = static_cast<uint32_t>(nextInBucket.size());
+    if (tokenStarts.empty()) tokenStarts.push_back(0);
+    tokenData.insert(tokenData.end(), signature.tokens.begin(), signature.tokens.end());
+    tokenStarts.push_back(tokenData.size());
+
+    nextInBucket.emplace_back();
+    for (size_t band = 0; band < BANDS; ++band) {
+        BandTable& table = bands[band];
+        // Keep the load under 3/4 so probe runs stay short
+        if ((table.used + 1) * 4 > table.keys.size() * 3) {
+            grow(table);
+        }
+        uint32_t key = bandKey(signature, band);
+        size_t slot = findSlot(table, key);
+        if (table.keys[slot] == 0) {
+            table.keys[slot] = key;
+            ++table.used;
+        }
+        nextInBucket[id][band] = table.heads[slot];
+        table.heads[slot] = id;
+    }
+    return id;
+}
+
+size_t NearDuplicateIndex::size() const {
+    return nextInBucket.size();
+}
+
+std::vector<SimilarFood> NearDuplicateIndex::findSimilar(const FoodSignature& signature, double threshold) const {
+    std::vector<SimilarFood> results;
+    if (nextInBucket.empty() || signature.tokens.empty()) {
+        return results;
+    }
+    seenStamps.resize(nextInBucket.size(), 0);
+    if (++queryStamp == 0) {
+        std::fill(seenStamps.begin(), seenStamps.end(), 0);
+        queryStamp = 1;
+    }
+    for (size_t band = 0; band < BANDS; ++band) {
+        const BandTable& table = bands[band];
+        size_t slot = findSlot(table, bandKey(signature, band));
+        if (table.keys[slot] == 0) continue;
+        size_t scanned = 0;
+        for (uint32_t id = table.heads[slot]; id != NO_FOOD && scanned < MAX_BUCKET_SCAN;
+             id = nextInBucket[id][band], ++scanned) {
+            if (seenStamps[id] == queryStamp) continue;
+            seenStamps[id] = queryStamp;
+            double score = jaccard(signature.tokens.data(), signature.tokens.size(),
+                                   tokenData.data() + tokenStarts[id], tokenStarts[id + 1] - tokenStarts[id]);
+            if (score >= threshold) {
+                results.push_back({id, score});
+            }
+        }
+    }
+    std::sort(results.begin(), results.end(), [](const SimilarFood& a, const SimilarFood& b) {
+        return a.similarity != b.similarity ? a.similarity > b.similarity : a.id < b.id;
+    });
+    return results;
+}
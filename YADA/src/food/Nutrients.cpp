@@ -0,0 +1,42 @@
+#include "food/Nutrients.h"
+
+bool Nutrients::hasMacros() const {
+    for (size_t i = PROTEIN; i < NUTRIENT_COUNT; ++i) {
+        if (values[i] != 0.0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* Nutrients::getName(Nutrient nutrient) {
+    switch (nutrient) {
+        case CALORIES: return "Calories";
+        case PROTEIN: return "Protein";
+        case FAT: return "Fat";
+        case CARBOHYDRATES: return "Carbohydrates";
+        case FIBER: return "Fiber";
+        case SODIUM: return "Sodium";
+        default: return "";
+    }
+}
+
+const char* Nutrients::getUnit(Nutrient nutrient) {
+    switch (nutrient) {
+        case CALORIES: return "kcal";
+        case SODIUM: return "mg";
+        case NUTRIENT_COUNT: return "";
+        default: return "g";
+    }
+}
+
+void writeNutrientFields(std::ostream& out, const Nutrients& nutrients) {
+    // Calorie-only foods are written exactly as before
+    if (!nutrients.hasMacros()) {
+        return;
+    }
+    out << "|" << NUTRIENT_COUNT - PROTEIN;
+    for (size_t i = PROTEIN; i < NUTRIENT_COUNT; ++i) {
+        out << "|" << nutrients.values[i];
+    }
+}
@@ -0,0 +1,111 @@
+#include "food/SubstringSearch.h"
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define YADA_SUBSTRING_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+size_t findScalar(const char* haystack, size_t haystackLength,
+                  const char* needle, size_t needleLength, size_t from) {
+    const char last = needle[needleLength - 1];
+    for (size_t i = from; i + needleLength <= haystackLength; ++i) {
+        const void* hit = std::memchr(haystack + i, needle[0], haystackLength - needleLength + 1 - i);
+        if (!hit) break;
+        i = static_cast<const char*>(hit) - haystack;
+        if (haystack[i + needleLength - 1] == last &&
+            std::memcmp(haystack + i + 1, needle + 1, needleLength - 1) == 0) {
+            return i;
+        }
+    }
+    return SUBSTRING_NOT_FOUND;
+}
+
+#ifdef YADA_SUBSTRING_X86
+
+// Both kernels compare a block of candidate start positions against the
+// needle's first and last bytes at once and only verify the survivors.
+
+#ifdef __SSE2__
+size_t findSse2(const char* haystack, size_t haystackLength, const char* needle, size_t needleLength) {
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needleLength - 1]);
+    size_t i = 0;
+    for (; i + needleLength - 1 + 16 <= haystackLength; i += 16) {
+        __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack + i));
+        __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack + i + needleLength - 1));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast))));
+        while (mask != 0) {
+            unsigned bit = static_cast<unsigned>(__builtin_ctz(mask));
+            if (std::memcmp(haystack + i + bit + 1, needle + 1, needleLength - 2) == 0) {
+                return i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return findScalar(haystack, haystackLength, needle, needleLength, i);
+}
+#endif
+
+__attribute__((target("avx2")))
+size_t findAvx2(const char* haystack, size_t haystackLength, const char* needle, size_t needleLength) {
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needleLength - 1]);
+    size_t i = 0;
+    for (; i + needleLength - 1 + 32 <= haystackLength; i += 32) {
+        __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(haystack + i));
+        __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(haystack + i + needleLength - 1));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(first, blockFirst), _mm256_cmpeq_epi8(last, blockLast))));
+        while (mask != 0) {
+            unsigned bit = static_cast<unsigned>(__builtin_ctz(mask));
+            if (std::memcmp(haystack + i + bit + 1, needle + 1, needleLength - 2) == 0) {
+                return i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return findScalar(haystack, haystackLength, needle, needleLength, i);
+}
+
+#endif
+
+using Kernel = size_t (*)(const char*, size_t, const char*, size_t);
+
+size_t findPortable(const char* haystack, size_t haystackLength, const char* needle, size_t needleLength) {
+    return findScalar(haystack, haystackLength, needle, needleLength, 0);
+}
+
+Kernel selectKernel() {
+#ifdef YADA_SUBSTRING_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return findAvx2;
+    }
+#ifdef __SSE2__
+    return findSse2;
+#endif
+#endif
+    return findPortable;
+}
+
+} // namespace
+
+size_t findSubstring(const char* haystack, size_t haystackLength,
+                     const char* needle, size_t needleLength) {
+    static const Kernel kernel = selectKernel();
+    if (needleLength == 0) {
+        return 0;
+    }
+    if (needleLength > haystackLength) {
+        return SUBSTRING_NOT_FOUND;
+    }
+    if (needleLength == 1) {
+        const void* hit = std::memchr(haystack, needle[0], haystackLength);
+        return hit ? static_cast<const char*>(hit) - haystack : SUBSTRING_NOT_FOUND;
+    }
+    return kernel(haystack, haystackLength, needle, needleLength);
+}
@@ -0,0 +1,468 @@
+#include "food/WebFoodSource.h"
+#include "stats/Stats.h"
+#include "storage/AtomicFile.h"
+#include <algorithm>
+#include <charconv>
+#include <ctime>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+const char* const NUTRIENT_KEYS[NUTRIENT_COUNT] = {"calories", "protein", "fat", "carbohydrates", "fiber", "sodium"};
+
+int64_t now() {
+    return static_cast<int64_t>(std::time(nullptr));
+}
+
+std::string formatNumber(double value) {
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    return std::string(buffer, result.ptr);
+}
+
+// The filter as query parameters, each starting with '&'
+std::string filterParameters(const FoodFilter& filter) {
+    std::string parameters;
+    if (!filter.namePrefix.empty()) {
+        parameters += "&prefix=" + HttpClient::encodeQuery(filter.namePrefix);
+    }
+    if (!filter.keyword.empty()) {
+        parameters += "&keyword=" + HttpClient::encodeQuery(filter.keyword);
+    }
+    if (filter.minCalories != std::numeric_limits<double>::lowest()) {
+        parameters += "&min_calories=" + formatNumber(filter.minCalories);
+    }
+    if (filter.maxCalories != std::numeric_limits<double>::max()) {
+        parameters += "&max_calories=" + formatNumber(filter.maxCalories);
+    }
+    return parameters;
+}
+
+JsonValue parseReply(const HttpResponse& response, const char* what) {
+    if (response.status != 200) {
+        throw std::runtime_error(std::string("Food server ") + what + " failed with HTTP " +
+                                 std::to_string(response.status));
+    }
+    return JsonValue::parse(response.body);
+}
+
+// Seconds a response may be used without revalidating it
+int maxAgeOf(const HttpResponse& response, int defaultMaxAge) {
+    const std::string* cacheControl = response.findHeader("Cache-Control");
+    if (!cacheControl) return defaultMaxAge;
+    if (cacheControl->find("no-cache") != std::string::npos || cacheControl->find("no-store") != std::string::npos) {
+        return 0;
+    }
+    size_t position = cacheControl->find("max-age=");
+    if (position == std::string::npos) return defaultMaxAge;
+    const char* start = cacheControl->data() + position + 8;
+    int maxAge = defaultMaxAge;
+    std::from_chars(start, cacheControl->data() + cacheControl->size(), maxAge);
+    return std::max(maxAge, 0);
+}
+
+// Pages through GET /foods over one connection, then yields the foods added
+// locally but not sent yet
+class WebFoodCursor : public FoodCursor {
+public:
+    WebFoodCursor(const std::string& apiUrl, const WebFoodSourceOptions& options, const FoodFilter& filter,
+                  std::vector<std::shared_ptr<BasicFood>> pending)
+        : client(apiUrl, options.timeoutMs), pageSize(options.pageSize), filter(filter),
+          parameters(filterParameters(filter)), position(0), nextOffset(0),
+          pending(std::move(pending)), pendingPosition(0) {}
+
+    bool next(std::vector<std::shared_ptr<BasicFood>>& batch, size_t maxCount) override {
+        batch.clear();
+        while (batch.size() < maxCount) {
+            if (position < page.size()) {
+                batch.push_back(std::move(page[position++]));
+            } else if (nextOffset >= 0) {
+                fetchPage();
+            } else {
+                break;
+            }
+        }
+        while (batch.size() < maxCount && pendingPosition < pending.size()) {
+            const auto& food = pending[pendingPosition++];
+            if (filter.matches(*food)) {
+                batch.push_back(food);
+            }
+        }
+        return !batch.empty();
+    }
+
+private:
+    HttpClient client;
+    size_t pageSize;
+    FoodFilter filter;
+    std::string parameters;
+    std::vector<std::shared_ptr<BasicFood>> page;
+    size_t position;
+    int64_t nextOffset;  // -1 after the last page
+    std::vector<std::shared_ptr<BasicFood>> pending;
+    size_t pendingPosition;
+
+    void fetchPage() {
+        YADA_STATS_TIMER("web_source.page");
+        auto reply = parseReply(client.get("/foods?offset=" + std::to_string(nextOffset) + "&limit=" +
+                                           std::to_string(pageSize) + parameters), "listing");
+        page.clear();
+        position = 0;
+        if (const JsonValue* foods = reply.find("foods")) {
+            for (const auto& food : foods->asArray()) {
+                page.push_back(foodFromJson(food));
+            }
+        }
+        const JsonValue* next = reply.find("next");
+        int64_t offset = next && !next->isNull() ? static_cast<int64_t>(next->asNumber()) : -1;
+        // A server that does not move forward would page forever
+        nextOffset = offset > nextOffset ? offset : -1;
+    }
+};
+
+} // namespace
+
+JsonValue foodToJson(const BasicFood& food) {
+    JsonValue json = JsonValue::object();
+    json.set("name", food.getName());
+    json.set("calories", food.getCaloriesPerServing());
+    JsonValue keywords = JsonValue::array();
+    for (const auto& keyword : food.getKeywords()) {
+        keywords.push(keyword);
+    }
+    json.set("keywords", std::move(keywords));
+    const Nutrients& values = food.getNutrients();
+    if (values.hasMacros()) {
+        JsonValue nutrients = JsonValue::object();
+        for (size_t i = PROTEIN; i < NUTRIENT_COUNT; ++i) {
+            nutrients.set(NUTRIENT_KEYS[i], values.values[i]);
+        }
+        json.set("nutrients", std::move(nutrients));
+    }
+    return json;
+}
+
+std::shared_ptr<BasicFood> foodFromJson(const JsonValue& json) {
+    const JsonValue* name = json.find("name");
+    const JsonValue* calories = json.find("calories");
+    if (!name || !calories || name->asString().empty()) {
+        throw std::runtime_error("Food server sent a food without a name or calories");
+    }
+    Nutrients values;
+    values.values[CALORIES] = calories->asNumber();
+    if (const JsonValue* nutrients = json.find("nutrients")) {
+        for (size_t i = PROTEIN; i < NUTRIENT_COUNT; ++i) {
+            if (const JsonValue* value = nutrients->find(NUTRIENT_KEYS[i])) {
+                values.values[i] = value->asNumber();
+            }
+        }
+    }
+    auto food = std::make_shared<BasicFood>(name->asString(), values);
+    if (const JsonValue* keywords = json.find("keywords")) {
+        food->reserveKeywords(keywords->asArray().size());
+        for (const auto& keyword : keywords->asArray()) {
+            food->addKeyword(keyword.asString());
+        }
+    }
+    return food;
+}
+
+WebFoodSource::WebFoodSource(const std::string& apiUrl, const WebFoodSourceOptions& options)
+    : apiUrl(apiUrl), options(options), cacheDirty(false), stopping(false) {
+    HttpClient check(apiUrl);  // Rejects a malformed URL now rather than on the first lookup
+    if (this->options.maxBatchSize == 0) this->options.maxBatchSize = 1;
+    if (this->options.pageSize == 0) this->options.pageSize = 1;
+    loadCache();
+}
+
+WebFoodSource::~WebFoodSource() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (fetcher.joinable()) {
+        fetcher.join();
+    }
+    try {
+        saveCache();
+    } catch (const std::exception&) {
+        // The cache only saves round-trips; losing it is harmless
+    }
+}
+
+std::unique_ptr<FoodCursor> WebFoodSource::openCursor(const FoodFilter& filter) {
+    return std::make_unique<WebFoodCursor>(apiUrl, options, filter, pending);
+}
+
+FoodCountEstimate WebFoodSource::estimateCount(const FoodFilter& filter) {
+    HttpClient client(apiUrl, options.timeoutMs);
+    std::string parameters = filterParameters(filter);
+    if (!parameters.empty()) {
+        parameters[0] = '?';
+    }
+    auto reply = parseReply(client.get("/foods/count" + parameters), "count");
+    const JsonValue* count = reply.find("count");
+    if (!count) {
+        throw std::runtime_error("Food server sent no count");
+    }
+    size_t pendingMatches = static_cast<size_t>(std::count_if(pending.begin(), pending.end(),
+        [&filter](const auto& food) { return filter.matches(*food); }));
+    return {static_cast<size_t>(count->asNumber()) + pendingMatches, true};
+}
+
+bool WebFoodSource::addFood(const std::shared_ptr<BasicFood>& food) {
+    if (!pendingNames.insert(food->getName()).second) {
+        return false;
+    }
+    pending.push_back(food);
+    return true;
+}
+
+void WebFoodSource::saveChanges() {
+    if (!pending.empty()) {
+        JsonValue foods = JsonValue::array();
+        for (const auto& food : pending) {
+            foods.push(foodToJson(*food));
+        }
+        JsonValue body = JsonValue::object();
+        body.set("foods", std::move(foods));
+        HttpClient client(apiUrl, options.timeoutMs);
+        auto response = client.post("/foods", body.toString());
+        if (response.status / 100 != 2) {
+            throw std::runtime_error("Food server rejected new foods with HTTP " + std::to_string(response.status));
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& food : pending) {
+            cache.erase(food->getName());  // May have been cached as missing
+        }
+        pending.clear();
+        pendingNames.clear();
+    }
+    saveCache();
+}
+
+std::shared_future<std::shared_ptr<BasicFood>> WebFoodSource::lookupAsync(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++stats.lookups;
+    auto cached = cache.find(name);
+    if (cached != cache.end() && cached->second.expiresAt > now()) {
+        ++stats.cacheHits;
+        std::promise<std::shared_ptr<BasicFood>> ready;
+        ready.set_value(cached->second.food);
+        return ready.get_future().share();
+    }
+    auto existing = fetches.find(name);
+    if (existing != fetches.end()) {
+        ++stats.coalesced;
+        return existing->second.future;
+    }
+    Fetch& fetch = fetches[name];
+    fetch.future = fetch.promise.get_future().share();
+    queued.push_back(name);
+    if (!fetcher.joinable()) {
+        fetcher = std::thread(&WebFoodSource::fetchLoop, this);
+    }
+    wake.notify_one();
+    return fetch.future;
+}
+
+std::vector<std::shared_ptr<BasicFood>> WebFoodSource::lookup(const std::vector<std::string>& names) {
+    // Queue every name before waiting so they travel together
+    std::vector<FoodFuture> futures;
+    futures.reserve(names.size());
+    for (const auto& name : names) {
+        futures.push_back(lookupAsync(name));
+    }
+    std::vector<std::shared_ptr<BasicFood>> foods;
+    foods.reserve(names.size());
+    for (auto& future : futures) {
+        foods.push_back(future.get());
+    }
+    return foods;
+}
+
+WebSourceStats WebFoodSource::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void WebFoodSource::fetchLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !queued.empty(); });
+        if (stopping) break;
+        std::vector<std::string> names;
+        while (!queued.empty() && names.size() < options.maxBatchSize) {
+            names.push_back(std::move(queued.front()));
+            queued.pop_front();
+        }
+        lock.unlock();
+        fetchBatch(names);
+        lock.lock();
+    }
+    auto closed = std::make_exception_ptr(std::runtime_error("Web food source closed"));
+    for (auto& fetch : fetches) {
+        fetch.second.promise.set_exception(closed);
+    }
+    fetches.clear();
+    queued.clear();
+}
+
+void WebFoodSource::fetchBatch(const std::vector<std::string>& names) {
+    YADA_STATS_TIMER("web_source.lookup_batch");
+    struct Answer {
+        std::string name;
+        std::string status;
+        std::string etag;
+        std::shared_ptr<BasicFood> food;
+    };
+
+    JsonValue items = JsonValue::array();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& name : names) {
+            JsonValue item = JsonValue::object();
+            item.set("name", name);
+            auto cached = cache.find(name);
+            if (cached != cache.end() && !cached->second.etag.empty()) {
+                item.set("etag", cached->second.etag);
+            }
+            items.push(std::move(item));
+        }
+    }
+    JsonValue body = JsonValue::object();
+    body.set("items", std::move(items));
+
+    // Network and parsing happen outside the lock
+    std::vector<Answer> answers;
+    int maxAge = options.defaultMaxAgeSeconds;
+    std::exception_ptr failure;
+    try {
+        if (!lookupClient) {
+            lookupClient = std::make_unique<HttpClient>(apiUrl, options.timeoutMs);
+        }
+        // A lookup changes nothing on the server, so it may be resent
+        auto response = lookupClient->post("/foods/lookup", body.toString(), "application/json", {}, true);
+        auto reply = parseReply(response, "lookup");
+        maxAge = maxAgeOf(response, options.defaultMaxAgeSeconds);
+        if (const JsonValue* replyItems = reply.find("items")) {
+            for (const auto& item : replyItems->asArray()) {
+                Answer answer;
+                const JsonValue* name = item.find("name");
+                const JsonValue* status = item.find("status");
+                if (!name || !status) continue;
+                answer.name = name->asString();
+                answer.status = status->asString();
+                if (const JsonValue* etag = item.find("etag")) {
+                    answer.etag = etag->asString();
+                }
+                if (answer.status == "ok") {
+                    const JsonValue* food = item.find("food");
+                    if (!food) continue;
+                    answer.food = foodFromJson(*food);
+                }
+                answers.push_back(std::move(answer));
+            }
+        }
+    } catch (...) {
+        failure = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ++stats.requests;
+    if (lookupClient) {
+        stats.connections = lookupClient->getConnectionCount();
+    }
+    int64_t expiresAt = now() + maxAge;
+    for (auto& answer : answers) {
+        auto fetch = fetches.find(answer.name);
+        if (fetch == fetches.end()) continue;  // Not asked for
+        auto cached = cache.find(answer.name);
+        if (answer.status == "not_modified" && cached != cache.end()) {
+            cached->second.expiresAt = expiresAt;
+            ++stats.revalidated;
+        } else if (answer.status == "ok" || answer.status == "missing") {
+            // ETags may not hold the separators of the cache file
+            if (answer.etag.find_first_of("|\r\n") != std::string::npos) answer.etag.clear();
+            cache[answer.name] = {answer.food, answer.etag, expiresAt};
+        } else {
+            continue;
+        }
+        cacheDirty = true;
+        fetch->second.promise.set_value(cache[answer.name].food);
+        fetches.erase(fetch);
+    }
+    // Unanswered names get their stale entry if there is one, else the error
+    if (!failure) {
+        failure = std::make_exception_ptr(std::runtime_error("Food server sent no answer for a food"));
+    }
+    for (const auto& name : names) {
+        auto fetch = fetches.find(name);
+        if (fetch == fetches.end()) continue;
+        auto cached = cache.find(name);
+        if (cached != cache.end()) {
+            fetch->second.promise.set_value(cached->second.food);
+        } else {
+            fetch->second.promise.set_exception(failure);
+        }
+        fetches.erase(fetch);
+    }
+}
+
+// Cache lines are "expires|found|etag|record": record is a foods file line
+// for a found food and just the name otherwise
+void WebFoodSource::saveCache() {
+    std::ostringstream out;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!cacheDirty || options.cacheFile.empty()) {
+            return;
+        }
+        for (const auto& item : cache) {
+            const CacheEntry& entry = item.second;
+            out << entry.expiresAt << "|" << (entry.food ? 1 : 0) << "|" << entry.etag << "|";
+            if (entry.food) {
+                writeFoodRecord(out, *entry.food);
+            } else {
+                out << item.first;
+            }
+            out << "\n";
+        }
+        cacheDirty = false;
+    }
+    writeFileAtomically(options.cacheFile, out.str());
+}
+
+void WebFoodSource::loadCache() {
+    if (options.cacheFile.empty()) {
+        return;
+    }
+    std::ifstream file(options.cacheFile);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::string_view text(line);
+        if (!text.empty() && text.back() == '\r') text.remove_suffix(1);
+        size_t first = text.find('|');
+        size_t second = first == std::string_view::npos ? first : text.find('|', first + 1);
+        size_t third = second == std::string_view::npos ? second : text.find('|', second + 1);
+        if (third == std::string_view::npos) continue;
+
+        CacheEntry entry;
+        auto parsed = std::from_chars(text.data(), text.data() + first, entry.expiresAt);
+        if (parsed.ec != std::errc()) continue;
+        bool found = text.substr(first + 1, second - first - 1) == "1";
+        entry.etag = std::string(text.substr(second + 1, third - second - 1));
+        std::string_view record = text.substr(third + 1);
+        if (found) {
+            entry.food = readFoodRecord(record);
+            if (!entry.food) continue;
+            cache[entry.food->getName()] = std::move(entry);
+        } else if (!record.empty()) {
+            cache[std::string(record)] = std::move(entry);
+        }
+    }
+}
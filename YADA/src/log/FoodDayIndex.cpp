@@ -0,0 +1,307 @@
+#include "log/FoodDayIndex.h"
+#include "log/Varint.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+// Calendar conversions after Howard Hinnant's days_from_civil and civil_from_days
+DayNumber daysFromCivil(int year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+    unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + static_cast<DayNumber>(dayOfEra) - 719468;
+}
+
+void civilFromDays(DayNumber days, int& year, unsigned& month, unsigned& day) {
+    days += 719468;
+    int era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned dayOfEra = static_cast<unsigned>(days - era * 146097);
+    unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    unsigned monthIndex = (5 * dayOfYear + 2) / 153;
+    day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    year = static_cast<int>(yearOfEra) + era * 400 + (month <= 2);
+}
+
+// First day of the bucket after the one holding day
+DayNumber nextBucketStart(DayNumber day, DayNumber rangeStart, HistogramBucket bucket) {
+    if (bucket == HistogramBucket::WEEK) {
+        return day + 7 - (day - rangeStart) % 7;
+    }
+    int year;
+    unsigned month, dayOfMonth;
+    civilFromDays(day, year, month, dayOfMonth);
+    if (bucket == HistogramBucket::YEAR || month == 12) {
+        return daysFromCivil(year + 1, 1, 1);
+    }
+    return daysFromCivil(year, month + 1, 1);
+}
+
+} // namespace
+
+// Walks one posting list in order, jumping between blocks on seek
+class FoodDayIndex::Cursor {
+public:
+    explicit Cursor(const PostingList& list) : list(list), index(0), block(0), offset(0), day(0) {
+        if (list.count > 0) {
+            day = static_cast<DayNumber>(readVarint(list.bytes, offset));
+        }
+    }
+
+    bool valid() const { return index < list.count; }
+    DayNumber value() const { return day; }
+
+    void next() {
+        if (++index >= list.count) return;
+        if (index % BLOCK_SIZE == 0) {
+            ++block;
+            day = static_cast<DayNumber>(readVarint(list.bytes, offset));
+        } else {
+            day += static_cast<DayNumber>(readVarint(list.bytes, offset));
+        }
+    }
+
+    // Moves to the first day not before target
+    void seek(DayNumber target) {
+        if (!valid() || day >= target) return;
+        auto it = std::upper_bound(list.skips.begin() + block + 1, list.skips.end(), target,
+            [](DayNumber value, const Skip& skip) { return value < skip.firstDay; });
+        size_t targetBlock = static_cast<size_t>(it - list.skips.begin()) - 1;
+        if (targetBlock > block) {
+            jumpToBlock(targetBlock);
+        }
+        while (valid() && day < target) {
+            next();
+        }
+    }
+
+    // BLOCK_SIZE if the cursor is at a block start and the whole block is
+    // within limit (the next block starts no later than limit), else zero
+    uint32_t wholeBlockBefore(DayNumber limit) const {
+        if (index % BLOCK_SIZE != 0 || block + 1 >= list.skips.size() || list.skips[block + 1].firstDay > limit) {
+            return 0;
+        }
+        return BLOCK_SIZE;
+    }
+
+    void nextBlock() {
+        jumpToBlock(block + 1);
+    }
+
+private:
+    const PostingList& list;
+    uint32_t index;
+    size_t block;
+    size_t offset;
+    DayNumber day;
+
+    void jumpToBlock(size_t target) {
+        block = target;
+        index = static_cast<uint32_t>(block * BLOCK_SIZE);
+        offset = list.skips[block].offset;
+        day = static_cast<DayNumber>(readVarint(list.bytes, offset));
+    }
+};
+
+void FoodDayIndex::append(PostingList& list, DayNumber day) {
+    if (list.count % BLOCK_SIZE == 0) {
+        list.skips.push_back({day, static_cast<uint32_t>(list.bytes.size())});
+        writeVarint(list.bytes, static_cast<uint32_t>(day));
+    } else {
+        writeVarint(list.bytes, static_cast<uint32_t>(day - list.lastDay));
+    }
+    list.lastDay = day;
+    ++list.count;
+}
+
+std::vector<DayNumber> FoodDayIndex::decode(const PostingList& list) {
+    std::vector<DayNumber> days;
+    days.reserve(list.count);
+    for (Cursor cursor(list); cursor.valid(); cursor.next()) {
+        days.push_back(cursor.value());
+    }
+    return days;
+}
+
+const FoodDayIndex::PostingList* FoodDayIndex::find(const std::string& foodName) const {
+    auto it = lists.find(foodName);
+    return it == lists.end() ? nullptr : &it->second;
+}
+
+void FoodDayIndex::add(const std::string& foodName, DayNumber day) {
+    PostingList& list = lists[foodName];
+    if (list.count == 0 || day > list.lastDay) {
+        append(list, day);
+        return;
+    }
+    if (day == list.lastDay) return;
+    // Back-dated entry: rebuild this food's list only
+    std::vector<DayNumber> days = decode(list);
+    auto it = std::lower_bound(days.begin(), days.end(), day);
+    if (it != days.end() && *it == day) return;
+    days.insert(it, day);
+    PostingList rebuilt;
+    for (DayNumber value : days) {
+        append(rebuilt, value);
+    }
+    list = std::move(rebuilt);
+}
+
+void FoodDayIndex::remove(const std::string& foodName, DayNumber day) {
+    auto found = lists.find(foodName);
+    if (found == lists.end()) return;
+    std::vector<DayNumber> days = decode(found->second);
+    auto it = std::lower_bound(days.begin(), days.end(), day);
+    if (it == days.end() || *it != day) return;
+    days.erase(it);
+    if (days.empty()) {
+        lists.erase(found);
+        return;
+    }
+    PostingList rebuilt;
+    for (DayNumber value : days) {
+        append(rebuilt, value);
+    }
+    found->second = std::move(rebuilt);
+}
+
+void FoodDayIndex::clear() {
+    lists.clear();
+}
+
+std::vector<DayNumber> FoodDayIndex::getDays(const std::string& foodName) const {
+    const PostingList* list = find(foodName);
+    return list ? decode(*list) : std::vector<DayNumber>();
+}
+
+size_t FoodDayIndex::countDays(const std::string& foodName, DayNumber from, DayNumber to) const {
+    const PostingList* list = find(foodName);
+    if (!list || from > to) return 0;
+    size_t count = 0;
+    Cursor cursor(*list);
+    cursor.seek(from);
+    while (cursor.valid() && cursor.value() <= to) {
+        // Blocks wholly inside the range are counted without decoding
+        if (uint32_t whole = cursor.wholeBlockBefore(to)) {
+            count += whole;
+            cursor.nextBlock();
+        } else {
+            ++count;
+            cursor.next();
+        }
+    }
+    return count;
+}
+
+std::vector<DayNumber> FoodDayIndex::intersect(const std::vector<std::string>& foodNames) const {
+    std::vector<const PostingList*> inputs;
+    for (const auto& name : foodNames) {
+        const PostingList* list = find(name);
+        if (!list) return {};
+        inputs.push_back(list);
+    }
+    if (inputs.empty()) return {};
+
+    // Drive from the shortest list and seek through the others
+    std::sort(inputs.begin(), inputs.end(),
+        [](const PostingList* a, const PostingList* b) { return a->count < b->count; });
+    std::vector<Cursor> cursors;
+    cursors.reserve(inputs.size());
+    for (const PostingList* list : inputs) {
+        cursors.emplace_back(*list);
+    }
+
+    std::vector<DayNumber> result;
+    Cursor& lead = cursors.front();
+    while (lead.valid()) {
+        DayNumber candidate = lead.value();
+        bool everywhere = true;
+        for (size_t i = 1; i < cursors.size(); ++i) {
+            cursors[i].seek(candidate);
+            if (!cursors[i].valid()) return result;
+            if (cursors[i].value() != candidate) {
+                // Skip the lead ahead to the first day this list could match
+                lead.seek(cursors[i].value());
+                everywhere = false;
+                break;
+            }
+        }
+        if (everywhere) {
+            result.push_back(candidate);
+            lead.next();
+        }
+    }
+    return result;
+}
+
+std::vector<HistogramBin> FoodDayIndex::histogram(const std::string& foodName, DayNumber from, DayNumber to,
+                                                  HistogramBucket bucket) const {
+    std::vector<HistogramBin> bins;
+    for (DayNumber start : bucketStarts(from, to, bucket)) {
+        bins.push_back({start, 0});
+    }
+    const PostingList* list = find(foodName);
+    if (!list || bins.empty()) return bins;
+
+    size_t bin = 0;
+    Cursor cursor(*list);
+    for (cursor.seek(from); cursor.valid() && cursor.value() <= to; cursor.next()) {
+        while (bin + 1 < bins.size() && bins[bin + 1].firstDay <= cursor.value()) {
+            ++bin;
+        }
+        ++bins[bin].days;
+    }
+    return bins;
+}
+
+size_t FoodDayIndex::getEncodedBytes() const {
+    size_t bytes = 0;
+    for (const auto& pair : lists) {
+        bytes += pair.second.bytes.size() + pair.second.skips.size() * sizeof(Skip);
+    }
+    return bytes;
+}
+
+std::vector<DayNumber> FoodDayIndex::bucketStarts(DayNumber from, DayNumber to, HistogramBucket bucket) {
+    std::vector<DayNumber> starts;
+    for (DayNumber start = from; start <= to; start = nextBucketStart(start, from, bucket)) {
+        starts.push_back(start);
+    }
+    return starts;
+}
+
+bool FoodDayIndex::parseDay(const std::string& date, DayNumber& day) {
+    if (date.size() != 10 || date[4] != '-' || date[7] != '-') return false;
+    int parts[3] = {0, 0, 0};
+    const size_t starts[3] = {0, 5, 8};
+    const size_t lengths[3] = {4, 2, 2};
+    for (int part = 0; part < 3; ++part) {
+        for (size_t i = starts[part]; i < starts[part] + lengths[part]; ++i) {
+            if (date[i] < '0' || date[i] > '9') return false;
+            parts[part] = parts[part] * 10 + (date[i] - '0');
+        }
+    }
+    int year = parts[0];
+    unsigned month = static_cast<unsigned>(parts[1]);
+    unsigned dayOfMonth = static_cast<unsigned>(parts[2]);
+    if (month < 1 || month > 12 || dayOfMonth < 1) return false;
+    static const unsigned monthLengths[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    unsigned length = monthLengths[month - 1] + (month == 2 && leap ? 1 : 0);
+    if (dayOfMonth > length) return false;
+    day = daysFromCivil(year, month, dayOfMonth);
+    return true;
+}
+
+std::string FoodDayIndex::formatDay(DayNumber day) {
+    int year;
+    unsigned month, dayOfMonth;
+    civilFromDays(day, year, month, dayOfMonth);
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u", year, month, dayOfMonth);
+    return buffer;
+}
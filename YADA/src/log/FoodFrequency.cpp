@@ -0,0 +1,185 @@
+#include "log/FoodFrequency.h"
+#include "storage/AsyncIo.h"
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// Independent row hashes from one string hash
+const uint64_t ROW_SEEDS[] = {
+    0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull, 0xd6e8feb86659fd93ull
+};
+
+uint64_t mix(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdull;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ull;
+    value ^= value >> 33;
+    return value;
+}
+
+} // namespace
+
+FoodFrequency::FoodFrequency()
+    : sketch(SKETCH_DEPTH * SKETCH_WIDTH, 0), totalRecorded(0) {}
+
+size_t FoodFrequency::cell(size_t row, const std::string& foodName) const {
+    uint64_t hash = std::hash<std::string>()(foodName);
+    return row * SKETCH_WIDTH + mix(hash ^ ROW_SEEDS[row]) % SKETCH_WIDTH;
+}
+
+void FoodFrequency::record(const std::string& foodName) {
+    // Conservative update: only raise the counters that hold the minimum
+    uint32_t current = estimate(foodName);
+    uint32_t updated = current == std::numeric_limits<uint32_t>::max() ? current : current + 1;
+    for (size_t row = 0; row < SKETCH_DEPTH; ++row) {
+        uint32_t& counter = sketch[cell(row, foodName)];
+        counter = std::max(counter, updated);
+    }
+    ++totalRecorded;
+    touchRecent(foodName);
+    updateFavourites(foodName, updated);
+}
+
+uint32_t FoodFrequency::estimate(const std::string& foodName) const {
+    uint32_t result = std::numeric_limits<uint32_t>::max();
+    for (size_t row = 0; row < SKETCH_DEPTH; ++row) {
+        result = std::min(result, sketch[cell(row, foodName)]);
+    }
+    return result;
+}
+
+void FoodFrequency::touchRecent(const std::string& foodName) {
+    auto it = recentIndex.find(foodName);
+    if (it != recentIndex.end()) {
+        recent.splice(recent.begin(), recent, it->second);
+        return;
+    }
+    recent.push_front(foodName);
+    recentIndex[foodName] = recent.begin();
+    if (recent.size() > RECENT_CAPACITY) {
+        recentIndex.erase(recent.back());
+        recent.pop_back();
+    }
+}
+
+void FoodFrequency::updateFavourites(const std::string& foodName, uint32_t count) {
+    // Bounded list, so every step here is constant time
+    auto it = std::find_if(favourites.begin(), favourites.end(),
+        [&foodName](const Favourite& favourite) { return favourite.foodName == foodName; });
+    if (it != favourites.end()) {
+        it->count = count;
+        return;
+    }
+    if (favourites.size() < FAVOURITE_CAPACITY) {
+        favourites.push_back({foodName, count});
+        return;
+    }
+    auto least = std::min_element(favourites.begin(), favourites.end(),
+        [](const Favourite& a, const Favourite& b) { return a.count < b.count; });
+    if (count > least->count) {
+        *least = {foodName, count};
+    }
+}
+
+std::vector<std::string> FoodFrequency::getQuickPicks(size_t count) const {
+    std::vector<std::string> picks;
+    size_t recentShown = std::min(count / 2 + count % 2, recent.size());
+    for (auto it = recent.begin(); picks.size() < recentShown; ++it) {
+        picks.push_back(*it);
+    }
+
+    std::vector<Favourite> byCount(favourites);
+    std::stable_sort(byCount.begin(), byCount.end(),
+        [](const Favourite& a, const Favourite& b) { return a.count > b.count; });
+    for (const auto& favourite : byCount) {
+        if (picks.size() >= count) break;
+        if (std::find(picks.begin(), picks.end(), favourite.foodName) == picks.end()) {
+            picks.push_back(favourite.foodName);
+        }
+    }
+    // Fill any space left with older recent foods
+    for (const auto& foodName : recent) {
+        if (picks.size() >= count) break;
+        if (std::find(picks.begin(), picks.end(), foodName) == picks.end()) {
+            picks.push_back(foodName);
+        }
+    }
+    return picks;
+}
+
+bool FoodFrequency::empty() const {
+    return totalRecorded == 0;
+}
+
+void FoodFrequency::clear() {
+    std::fill(sketch.begin(), sketch.end(), 0);
+    totalRecorded = 0;
+    recent.clear();
+    recentIndex.clear();
+    favourites.clear();
+}
+
+void FoodFrequency::writeTo(std::ostream& out) const {
+    out << "total|" << totalRecorded << "\n";
+    // Oldest first, so loading replays them in order
+    for (auto it = recent.rbegin(); it != recent.rend(); ++it) {
+        out << "recent|" << *it << "\n";
+    }
+    for (const auto& favourite : favourites) {
+        out << "favourite|" << favourite.foodName << "|" << favourite.count << "\n";
+    }
+    // Most counters stay zero, so only the non-zero cells are written
+    for (size_t index = 0; index < sketch.size(); ++index) {
+        if (sketch[index] != 0) {
+            out << "sketch|" << index / SKETCH_WIDTH << "|" << index % SKETCH_WIDTH << "|" << sketch[index] << "\n";
+        }
+    }
+}
+
+void FoodFrequency::loadFromFile(const std::string& filename) {
+    std::istringstream file(AsyncIo::instance().readFile(filename).get());
+
+    FoodFrequency loaded;
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        if (line.empty()) continue;
+        auto malformed = [&]() {
+            return std::runtime_error("Malformed entry on line " + std::to_string(lineNumber) + " of " + filename);
+        };
+
+        std::stringstream ss(line);
+        std::string kind;
+        std::getline(ss, kind, '|');
+        if (kind == "total") {
+            if (!(ss >> loaded.totalRecorded)) throw malformed();
+        } else if (kind == "recent") {
+            std::string foodName;
+            std::getline(ss, foodName);
+            loaded.touchRecent(foodName);
+        } else if (kind == "favourite") {
+            std::string foodName;
+            uint32_t count;
+            std::getline(ss, foodName, '|');
+            if (!(ss >> count)) throw malformed();
+            loaded.updateFavourites(foodName, count);
+        } else if (kind == "sketch") {
+            size_t row, column;
+            uint32_t count;
+            if (!(ss >> row) || ss.get() != '|' || !(ss >> column) || ss.get() != '|' || !(ss >> count) ||
+                row >= SKETCH_DEPTH || column >= SKETCH_WIDTH) {
+                throw malformed();
+            }
+            loaded.sketch[row * SKETCH_WIDTH + column] = count;
+        } else {
+            throw malformed();
+        }
+    }
+    *this = std::move(loaded);
+}
@@ -1,49 +1,80 @@
 #include "log/FoodLog.h"
-#include <fstream>
+#include "storage/AsyncIo.h"
+#include "stats/Stats.h"
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 #include <stdexcept>
-#include <regex>
+#include <limits>
+#include <set>
 
-FoodLog::FoodLog() {}
+FoodLog::FoodLog() : archiveVersion(0), frequencyStale(false), listener(nullptr) {}
+
+void FoodLog::setListener(FoodLogListener* newListener) {
+    listener = newListener;
+}
 
 size_t FoodLog::addEntry(const std::shared_ptr<Food>& food, double servings, const std::string& date) {
+    YADA_STATS_TIMER("food_log.add_entry");
     std::string targetDate = date.empty() ? getCurrentDate() : date;
     if (!isValidDate(targetDate)) {
         throw std::runtime_error("Invalid date format. Use YYYY-MM-DD");
     }
+    if (!frequencyStale) {
+        frequency.record(food->getName());
+    }
     
     // Check if this food already exists in today's log
     size_t existingIndex = findExistingEntry(food->getName(), targetDate);
     
     if (existingIndex != static_cast<size_t>(-1)) {
         // Food exists, update servings
-        auto& entries = dailyLogs[targetDate];
+        auto& entries = hotEntries(targetDate);
         entries[existingIndex].servings += servings;
         entries[existingIndex].timestamp = std::time(nullptr);  // Update timestamp
+        if (listener) {
+            listener->entryChanged(targetDate, food->getName(), servings, 0);
+        }
         return existingIndex;
     } else {
         // Add new entry
         LogEntry entry{food->getName(), servings, std::time(nullptr)};
-        auto& entries = dailyLogs[targetDate];
+        auto& entries = hotEntries(targetDate);
         size_t index = entries.size();
         entries.push_back(entry);
+        DayNumber day;
+        if (FoodDayIndex::parseDay(targetDate, day)) {
+            dayIndex.add(entry.foodId, day);
+        }
+        if (listener) {
+            listener->entryChanged(targetDate, entry.foodId, servings, 1);
+        }
         return index;
     }
 }
 
 void FoodLog::updateServings(size_t index, double newServings, const std::string& date) {
+    YADA_STATS_TIMER("food_log.update_servings");
     std::string targetDate = date.empty() ? getCurrentDate() : date;
     if (!isValidDate(targetDate)) {
         throw std::runtime_error("Invalid date format. Use YYYY-MM-DD");
     }
 
-    auto& entries = dailyLogs[targetDate];
+    auto& entries = hotEntries(targetDate);
     if (index < entries.size()) {
         if (newServings <= 0) {
             // If servings reduced to 0 or less, remove the entry
+            LogEntry removed = entries[index];
             entries.erase(entries.begin() + index);
+            unindexIfGone(removed.foodId, targetDate);
+            dropArchivedIfEmpty(targetDate);
+            if (listener) {
+                listener->entryChanged(targetDate, removed.foodId, -removed.servings, -1);
+            }
         } else {
+            if (listener) {
+                listener->entryChanged(targetDate, entries[index].foodId, newServings - entries[index].servings, 0);
+            }
             entries[index].servings = newServings;
             entries[index].timestamp = std::time(nullptr);
         }
@@ -56,15 +87,13 @@ double FoodLog::getServings(size_t index, const std::string& date) const {
         throw std::runtime_error("Invalid date format. Use YYYY-MM-DD");
     }
 
-    auto it = dailyLogs.find(targetDate);
-    if (it != dailyLogs.end() && index < it->second.size()) {
-        return it->second[index].servings;
-    }
-    return 0.0;
+    std::vector<LogEntry> scratch;
+    const auto& entries = entriesFor(targetDate, scratch);
+    return index < entries.size() ? entries[index].servings : 0.0;
 }
 
 size_t FoodLog::findExistingEntry(const std::string& foodId, const std::string& date) {
-    auto& entries = dailyLogs[date];
+    auto& entries = hotEntries(date);
     for (size_t i = 0; i < entries.size(); ++i) {
         if (entries[i].foodId == foodId) {
             return i;
@@ -73,15 +102,40 @@ size_t FoodLog::findExistingEntry(const std::string& foodId, const std::string&
     return static_cast<size_t>(-1);  // Not found
 }
 
+void FoodLog::unindexIfGone(const std::string& foodId, const std::string& date) {
+    const auto& entries = dailyLogs[date];
+    bool remaining = std::any_of(entries.begin(), entries.end(),
+        [&foodId](const LogEntry& entry) { return entry.foodId == foodId; });
+    DayNumber day;
+    if (!remaining && FoodDayIndex::parseDay(date, day)) {
+        dayIndex.remove(foodId, day);
+    }
+}
+
+DayNumber FoodLog::toDayNumber(const std::string& date) {
+    DayNumber day;
+    if (!FoodDayIndex::parseDay(date, day)) {
+        throw std::runtime_error("Invalid date format. Use YYYY-MM-DD");
+    }
+    return day;
+}
+
 void FoodLog::removeEntry(size_t index, const std::string& date) {
+    YADA_STATS_TIMER("food_log.remove_entry");
     std::string targetDate = date.empty() ? getCurrentDate() : date;
     if (!isValidDate(targetDate)) {
         throw std::runtime_error("Invalid date format. Use YYYY-MM-DD");
     }
     
-    auto& entries = dailyLogs[targetDate];
+    auto& entries = hotEntries(targetDate);
     if (index < entries.size()) {
+        LogEntry removed = entries[index];
         entries.erase(entries.begin() + index);
+        unindexIfGone(removed.foodId, targetDate);
+        dropArchivedIfEmpty(targetDate);
+        if (listener) {
+            listener->entryChanged(targetDate, removed.foodId, -removed.servings, -1);
+        }
     }
 }
 
@@ -89,22 +143,128 @@ void FoodLog::clearEntriesForDate(const std::string& date) {
     if (!isValidDate(date)) {
         throw std::runtime_error("Invalid date format. Use YYYY-MM-DD");
     }
-    dailyLogs[date].clear();
+    auto& entries = hotEntries(date);
+    DayNumber day;
+    if (FoodDayIndex::parseDay(date, day)) {
+        for (const auto& entry : entries) {
+            dayIndex.remove(entry.foodId, day);
+        }
+    }
+    if (listener) {
+        for (const auto& entry : entries) {
+            listener->entryChanged(date, entry.foodId, -entry.servings, -1);
+        }
+    }
+    entries.clear();
+    dropArchivedIfEmpty(date);
 }
 
-std::vector<LogEntry> FoodLog::getEntriesForDate(const std::string& date) const {
-    if (!isValidDate(date)) {
-        throw std::runtime_error("Invalid date format. Use YYYY-MM-DD");
+std::vector<LogEntry>& FoodLog::hotEntries(const std::string& date) {
+    auto it = dailyLogs.find(date);
+    if (it != dailyLogs.end()) {
+        return it->second;
     }
+    auto& entries = dailyLogs[date];
+    DayNumber day;
+    if (!archive.empty() && FoodDayIndex::parseDay(date, day) && archive.contains(day)) {
+        // The archived copy stays until the day is archived again, so the
+        // archive file can always be written before the log that now holds it
+        YADA_STATS_TIMER("food_log.copy_up_archived_day");
+        entries = archive.getEntries(day);
+        if (listener) {
+            listener->logReloaded();  // Archived calories give way to current ones
+        }
+    }
+    return entries;
+}
+
+const std::vector<LogEntry>& FoodLog::entriesFor(const std::string& date, std::vector<LogEntry>& scratch) const {
     auto it = dailyLogs.find(date);
     if (it != dailyLogs.end()) {
         return it->second;
     }
-    return std::vector<LogEntry>();
+    DayNumber day;
+    if (!archive.empty() && FoodDayIndex::parseDay(date, day)) {
+        scratch = archive.getEntries(day);
+    }
+    return scratch;
+}
+
+void FoodLog::dropArchivedIfEmpty(const std::string& date) {
+    DayNumber day;
+    auto it = dailyLogs.find(date);
+    if (it != dailyLogs.end() && it->second.empty() && FoodDayIndex::parseDay(date, day) && archive.contains(day)) {
+        archive.removeDay(day);
+        ++archiveVersion;
+    }
+}
+
+std::vector<std::pair<DayNumber, const std::vector<LogEntry>*>> FoodLog::getHotDays() const {
+    std::vector<std::pair<DayNumber, const std::vector<LogEntry>*>> days;
+    for (const auto& pair : dailyLogs) {
+        DayNumber day;
+        if (FoodDayIndex::parseDay(pair.first, day)) {
+            days.emplace_back(day, &pair.second);
+        }
+    }
+    return days;
+}
+
+void FoodLog::mergeEntries(const std::vector<std::pair<DayNumber, const std::vector<LogEntry>*>>& hotDays,
+    DayNumber from, DayNumber to, const std::function<void(DayNumber day, const LogEntry& entry)>& visit) const {
+    size_t next = 0;
+    auto visitHotBefore = [&](DayNumber limit) {
+        for (; next < hotDays.size() && hotDays[next].first < limit; ++next) {
+            for (const auto& entry : *hotDays[next].second) {
+                visit(hotDays[next].first, entry);
+            }
+        }
+    };
+    archive.forEachEntryBetween(from, to, [&](DayNumber day, const LogEntry& entry) {
+        visitHotBefore(day);
+        if (next < hotDays.size() && hotDays[next].first == day) return;  // Shadowed
+        visit(day, entry);
+    });
+    visitHotBefore(std::numeric_limits<DayNumber>::max());
+}
+
+void FoodLog::rebuildDayIndex() {
+    // Days come in calendar order, so every list is appended to
+    FoodDayIndex rebuilt;
+    mergeEntries(getHotDays(), std::numeric_limits<DayNumber>::min(), std::numeric_limits<DayNumber>::max(),
+        [&rebuilt](DayNumber day, const LogEntry& entry) { rebuilt.add(entry.foodId, day); });
+    dayIndex = std::move(rebuilt);
+}
+
+void FoodLog::forEachEntryBetween(const std::string& fromDate, const std::string& toDate,
+    const std::function<void(DayNumber day, const LogEntry& entry)>& visit) const {
+    DayNumber from = toDayNumber(fromDate);
+    DayNumber to = toDayNumber(toDate);
+    std::vector<std::pair<DayNumber, const std::vector<LogEntry>*>> hotDays;
+    for (auto it = dailyLogs.lower_bound(fromDate); it != dailyLogs.end() && it->first <= toDate; ++it) {
+        DayNumber day;
+        if (FoodDayIndex::parseDay(it->first, day)) {
+            hotDays.emplace_back(day, &it->second);
+        }
+    }
+    mergeEntries(hotDays, from, to, visit);
+}
+
+std::vector<LogEntry> FoodLog::getEntriesForDate(const std::string& date) const {
+    if (!isValidDate(date)) {
+        throw std::runtime_error("Invalid date format. Use YYYY-MM-DD");
+    }
+    std::vector<LogEntry> scratch;
+    const auto& entries = entriesFor(date, scratch);
+    if (&entries == &scratch) {
+        return scratch;
+    }
+    return entries;
 }
 
 double FoodLog::getTotalCaloriesForDate(const std::string& date, 
     const std::function<std::shared_ptr<Food>(const std::string&)>& foodLookup) const {
+    YADA_STATS_TIMER("food_log.total_calories");
     if (!isValidDate(date)) {
         throw std::runtime_error("Invalid date format. Use YYYY-MM-DD");
     }
@@ -119,45 +279,281 @@ double FoodLog::getTotalCaloriesForDate(const std::string& date,
     return total;
 }
 
-bool FoodLog::isValidDate(const std::string& date) {
-    std::regex datePattern("^\\d{4}-\\d{2}-\\d{2}$");
-    if (!std::regex_match(date, datePattern)) {
-        return false;
+Nutrients FoodLog::getTotalNutrientsForDate(const std::string& date,
+    const std::function<std::shared_ptr<Food>(const std::string&)>& foodLookup) const {
+    YADA_STATS_TIMER("food_log.total_nutrients");
+    if (!isValidDate(date)) {
+        throw std::runtime_error("Invalid date format. Use YYYY-MM-DD");
     }
-    
-    std::tm tm = {};
-    std::istringstream ss(date);
-    ss >> std::get_time(&tm, "%Y-%m-%d");
-    return !ss.fail();
+    Nutrients total;
+    std::vector<LogEntry> scratch;
+    // Every entry and its components fold into the one vector
+    for (const auto& entry : entriesFor(date, scratch)) {
+        auto food = foodLookup(entry.foodId);
+        if (food) {
+            food->accumulateNutrients(total, entry.servings);
+        }
+    }
+    return total;
 }
 
-void FoodLog::saveToFile(const std::string& filename) const {
-    std::ofstream file(filename);
-    if (!file) {
-        throw std::runtime_error("Could not open file for writing: " + filename);
+FoodFrequency& FoodLog::getFrequency() {
+    if (frequencyStale) {
+        YADA_STATS_TIMER("food_log.rebuild_frequency");
+        // Replay the history in order so the recent list ends up right
+        frequency.clear();
+        auto replay = [this](const std::vector<LogEntry>& day) {
+            std::vector<const LogEntry*> entries;
+            for (const auto& entry : day) {
+                entries.push_back(&entry);
+            }
+            std::stable_sort(entries.begin(), entries.end(),
+                [](const LogEntry* a, const LogEntry* b) { return a->timestamp < b->timestamp; });
+            for (const auto* entry : entries) {
+                frequency.record(entry->foodId);
+            }
+        };
+        auto hotDays = getHotDays();
+        size_t next = 0;
+        archive.forEachDay([&](const DayRollup& rollup) {
+            for (; next < hotDays.size() && hotDays[next].first < rollup.day; ++next) {
+                replay(*hotDays[next].second);
+            }
+            if (next < hotDays.size() && hotDays[next].first == rollup.day) return;  // Shadowed
+            replay(archive.getEntries(rollup.day));
+        });
+        for (; next < hotDays.size(); ++next) {
+            replay(*hotDays[next].second);
+        }
+        frequencyStale = false;
+    }
+    return frequency;
+}
+
+void FoodLog::forEachEntry(const std::function<void(const std::string& date, const LogEntry& entry)>& visit) const {
+    for (const auto& pair : dailyLogs) {
+        for (const auto& entry : pair.second) {
+            visit(pair.first, entry);
+        }
+    }
+}
+
+void FoodLog::forEachArchivedDay(const std::function<void(const DayRollup& rollup)>& visit) const {
+    auto hotDays = getHotDays();
+    size_t next = 0;
+    archive.forEachDay([&](const DayRollup& rollup) {
+        while (next < hotDays.size() && hotDays[next].first < rollup.day) {
+            ++next;
+        }
+        if (next < hotDays.size() && hotDays[next].first == rollup.day) return;  // Shadowed
+        visit(rollup);
+    });
+}
+
+std::vector<std::string> FoodLog::getDatesWithFood(const std::string& foodId) const {
+    std::vector<std::string> dates;
+    for (DayNumber day : dayIndex.getDays(foodId)) {
+        dates.push_back(FoodDayIndex::formatDay(day));
+    }
+    return dates;
+}
+
+std::vector<std::string> FoodLog::getDatesWithAllFoods(const std::vector<std::string>& foodIds) const {
+    YADA_STATS_TIMER("food_log.dates_with_all_foods");
+    std::vector<std::string> dates;
+    for (DayNumber day : dayIndex.intersect(foodIds)) {
+        dates.push_back(FoodDayIndex::formatDay(day));
+    }
+    return dates;
+}
+
+size_t FoodLog::countDaysWithFood(const std::string& foodId, const std::string& fromDate,
+                                  const std::string& toDate) const {
+    return dayIndex.countDays(foodId, toDayNumber(fromDate), toDayNumber(toDate));
+}
+
+std::vector<std::pair<std::string, size_t>> FoodLog::getFoodHistogram(const std::string& foodId,
+    const std::string& fromDate, const std::string& toDate, HistogramBucket bucket) const {
+    YADA_STATS_TIMER("food_log.food_histogram");
+    std::vector<std::pair<std::string, size_t>> histogram;
+    for (const auto& bin : dayIndex.histogram(foodId, toDayNumber(fromDate), toDayNumber(toDate), bucket)) {
+        histogram.emplace_back(FoodDayIndex::formatDay(bin.firstDay), bin.days);
+    }
+    return histogram;
+}
+
+size_t FoodLog::archiveBefore(const std::string& cutoffDate,
+    const std::function<std::shared_ptr<Food>(const std::string&)>& foodLookup) {
+    YADA_STATS_TIMER("food_log.archive");
+    toDayNumber(cutoffDate);
+    size_t archived = 0;
+    // Valid dates sort as strings in calendar order
+    for (auto it = dailyLogs.begin(); it != dailyLogs.end() && it->first < cutoffDate;) {
+        DayNumber day;
+        if (!FoodDayIndex::parseDay(it->first, day)) {
+            ++it;
+            continue;
+        }
+        if (!it->second.empty()) {
+            double calories = 0.0;
+            for (const auto& entry : it->second) {
+                auto food = foodLookup(entry.foodId);
+                if (food) {
+                    calories += food->getCaloriesPerServing() * entry.servings;
+                }
+            }
+            archive.putDay(day, it->second, calories);
+            ++archived;
+        }
+        it = dailyLogs.erase(it);
+    }
+    if (archived > 0) {
+        ++archiveVersion;
+        if (listener) {
+            listener->logReloaded();
+        }
+    }
+    return archived;
+}
+
+LogTotals FoodLog::getLoggedTotals(const std::string& fromDate, const std::string& toDate,
+    const std::function<std::shared_ptr<Food>(const std::string&)>& foodLookup) const {
+    YADA_STATS_TIMER("food_log.logged_totals");
+    DayNumber from = toDayNumber(fromDate);
+    DayNumber to = toDayNumber(toDate);
+    LogTotals totals;
+    for (auto it = dailyLogs.lower_bound(fromDate); it != dailyLogs.end() && it->first <= toDate; ++it) {
+        if (it->second.empty()) continue;
+        ++totals.days;
+        for (const auto& entry : it->second) {
+            ++totals.entries;
+            totals.servings += entry.servings;
+            auto food = foodLookup(entry.foodId);
+            if (food) {
+                totals.calories += food->getCaloriesPerServing() * entry.servings;
+            }
+        }
+    }
+    auto hotDays = getHotDays();
+    size_t next = 0;
+    archive.forEachDayBetween(from, to, [&](const DayRollup& rollup) {
+        while (next < hotDays.size() && hotDays[next].first < rollup.day) {
+            ++next;
+        }
+        if (next < hotDays.size() && hotDays[next].first == rollup.day) return;  // Shadowed
+        ++totals.days;
+        totals.entries += rollup.entries;
+        totals.servings += rollup.servings;
+        totals.calories += rollup.calories;
+    });
+    return totals;
+}
+
+std::string FoodLog::getFirstDate() const {
+    std::string first;
+    for (const auto& pair : dailyLogs) {
+        if (!pair.second.empty()) {
+            first = pair.first;
+            break;
+        }
+    }
+    if (!archive.empty()) {
+        std::string archived = FoodDayIndex::formatDay(archive.getFirstDay());
+        if (first.empty() || archived < first) {
+            first = archived;
+        }
+    }
+    return first;
+}
+
+size_t FoodLog::getArchivedDayCount() const {
+    return archive.getDayCount();
+}
+
+size_t FoodLog::getArchiveVersion() const {
+    return archiveVersion;
+}
+
+std::vector<std::string> FoodLog::findUnknownFoods(const std::function<bool(const std::string&)>& isKnown) const {
+    std::vector<std::string> unknown;
+    std::set<std::string> checked;
+    for (const auto& pair : dailyLogs) {
+        for (const auto& entry : pair.second) {
+            if (checked.insert(entry.foodId).second && !isKnown(entry.foodId)) {
+                unknown.push_back(entry.foodId);
+            }
+        }
     }
+    for (const auto& name : archive.getFoodNames()) {
+        if (checked.insert(name).second && !isKnown(name)) {
+            unknown.push_back(name);
+        }
+    }
+    return unknown;
+}
+
+bool FoodLog::isValidDate(const std::string& date) {
+    // The day index's check, so every date the log accepts can be archived
+    // and bucketed; it parses by hand, as a regex per operation dominated them
+    DayNumber day;
+    return FoodDayIndex::parseDay(date, day);
+}
 
+void FoodLog::writeTo(std::ostream& out) const {
+    YADA_STATS_TIMER("food_log.serialize");
     for (const auto& pair : dailyLogs) {
         const auto& date = pair.first;
         const auto& entries = pair.second;
         for (const auto& entry : entries) {
-            file << date << "|"
-                 << entry.foodId << "|"
-                 << entry.servings << "|"
-                 << entry.timestamp << "\n";
+            out << date << "|"
+                << entry.foodId << "|"
+                << entry.servings << "|"
+                << entry.timestamp << "\n";
         }
     }
 }
 
-void FoodLog::loadFromFile(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file) {
-        throw std::runtime_error("Could not open file for reading: " + filename);
+void FoodLog::saveToFile(const std::string& filename) const {
+    std::ostringstream out;
+    writeTo(out);
+    AsyncIo::instance().writeFileAtomically(filename, out.str()).get();
+}
+
+void FoodLog::writeFrequencyTo(std::ostream& out) {
+    getFrequency().writeTo(out);
+}
+
+void FoodLog::loadFrequencyFromFile(const std::string& filename) {
+    frequency.loadFromFile(filename);
+    frequencyStale = false;
+}
+
+void FoodLog::writeArchiveTo(std::ostream& out) const {
+    archive.writeTo(out);
+}
+
+void FoodLog::loadArchiveFromFile(const std::string& filename) {
+    archive.loadFromFile(filename);
+    ++archiveVersion;
+    rebuildDayIndex();
+    if (listener) {
+        listener->logReloaded();
     }
+    frequencyStale = true;
+}
+
+void FoodLog::loadFromFile(const std::string& filename) {
+    YADA_STATS_TIMER("food_log.load");
+    std::istringstream file(AsyncIo::instance().readFile(filename).get());
 
-    dailyLogs.clear();
+    std::map<std::string, std::vector<LogEntry>> loaded;
     std::string line;
+    size_t lineNumber = 0;
     while (std::getline(file, line)) {
+        ++lineNumber;
+        YADA_STATS_COUNT("food_log.bytes_read", line.size() + 1);
+        if (line.empty()) continue;
+
         std::stringstream ss(line);
         std::string date, foodId;
         double servings;
@@ -168,10 +564,20 @@ void FoodLog::loadFromFile(const std::string& filename) {
         ss >> servings;
         ss.ignore();
         ss >> timestamp;
+        if (ss.fail()) {
+            throw std::runtime_error("Malformed entry on line " + std::to_string(lineNumber) + " of " + filename);
+        }
 
         LogEntry entry{foodId, servings, timestamp};
-        dailyLogs[date].push_back(entry);
+        loaded[date].push_back(entry);
+    }
+
+    dailyLogs.swap(loaded);
+    rebuildDayIndex();
+    if (listener) {
+        listener->logReloaded();
     }
+    frequencyStale = true;
 }
 
 std::string FoodLog::getCurrentDate() {
@@ -0,0 +1,273 @@
+#include "log/LogArchive.h"
+#include "log/Varint.h"
+#include "stats/Stats.h"
+#include "storage/AsyncIo.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+const char* const ARCHIVE_HEADER = "YADA-LOG-ARCHIVE 1\n";
+const int64_t SECONDS_PER_DAY = 86400;
+const double CALORIE_SCALE = 100.0;  // Rollup calories are kept to a hundredth
+
+// Reads a varint, throwing instead of running past the end of the bytes
+uint64_t readCheckedVarint(const std::vector<uint8_t>& bytes, size_t& offset, size_t end,
+                           const std::string& filename) {
+    for (size_t i = offset; i < end && i < offset + 10; ++i) {
+        if (!(bytes[i] & 0x80)) {
+            return readVarint(bytes, offset);
+        }
+    }
+    throw std::runtime_error("Truncated log archive: " + filename);
+}
+
+int64_t quantize(double value, double scale) {
+    return static_cast<int64_t>(std::llround(value * scale));
+}
+
+} // namespace
+
+std::vector<LogArchive::Day>::const_iterator LogArchive::lowerBound(DayNumber day) const {
+    return std::lower_bound(days.begin(), days.end(), day,
+        [](const Day& entry, DayNumber value) { return entry.rollup.day < value; });
+}
+
+std::vector<LogArchive::Day>::const_iterator LogArchive::findDay(DayNumber day) const {
+    auto it = lowerBound(day);
+    return (it != days.end() && it->rollup.day == day) ? it : days.end();
+}
+
+uint32_t LogArchive::endOffset(size_t index) const {
+    return index + 1 < days.size() ? days[index + 1].offset : static_cast<uint32_t>(segment.size());
+}
+
+uint32_t LogArchive::codeFor(const std::string& foodName) {
+    auto it = foodCodes.find(foodName);
+    if (it != foodCodes.end()) {
+        return it->second;
+    }
+    uint32_t code = static_cast<uint32_t>(foodNames.size());
+    foodNames.push_back(foodName);
+    foodCodes.emplace(foodName, code);
+    return code;
+}
+
+void LogArchive::putDay(DayNumber day, const std::vector<LogEntry>& entries, double calories) {
+    YADA_STATS_TIMER("log_archive.put_day");
+    removeDay(day);
+
+    std::vector<uint8_t> encoded;
+    DayRollup rollup{day, 0, 0.0, calories};
+    int64_t previous = static_cast<int64_t>(day) * SECONDS_PER_DAY;
+    int64_t totalServings = 0;
+    for (const auto& entry : entries) {
+        int64_t servings = quantize(entry.servings, SERVING_SCALE);
+        writeVarint(encoded, codeFor(entry.foodId));
+        writeVarint(encoded, zigzagEncode(servings));
+        writeVarint(encoded, zigzagEncode(static_cast<int64_t>(entry.timestamp) - previous));
+        previous = static_cast<int64_t>(entry.timestamp);
+        totalServings += servings;
+        ++rollup.entries;
+    }
+    rollup.servings = static_cast<double>(totalServings) / SERVING_SCALE;
+
+    // Days normally arrive in order and append; older ones are spliced in
+    auto position = std::lower_bound(days.begin(), days.end(), day,
+        [](const Day& entry, DayNumber value) { return entry.rollup.day < value; });
+    uint32_t offset = position != days.end() ? position->offset : static_cast<uint32_t>(segment.size());
+    segment.insert(segment.begin() + offset, encoded.begin(), encoded.end());
+    for (auto it = position; it != days.end(); ++it) {
+        it->offset += static_cast<uint32_t>(encoded.size());
+    }
+    days.insert(position, Day{rollup, offset});
+    YADA_STATS_COUNT("log_archive.bytes_encoded", encoded.size());
+}
+
+void LogArchive::removeDay(DayNumber day) {
+    auto found = findDay(day);
+    if (found == days.end()) return;
+    size_t index = static_cast<size_t>(found - days.begin());
+    uint32_t begin = days[index].offset;
+    uint32_t length = endOffset(index) - begin;
+    segment.erase(segment.begin() + begin, segment.begin() + begin + length);
+    days.erase(days.begin() + index);
+    for (size_t i = index; i < days.size(); ++i) {
+        days[i].offset -= length;
+    }
+}
+
+void LogArchive::clear() {
+    foodNames.clear();
+    foodCodes.clear();
+    days.clear();
+    segment.clear();
+}
+
+bool LogArchive::contains(DayNumber day) const {
+    return findDay(day) != days.end();
+}
+
+bool LogArchive::empty() const {
+    return days.empty();
+}
+
+size_t LogArchive::getDayCount() const {
+    return days.size();
+}
+
+DayNumber LogArchive::getFirstDay() const {
+    return days.front().rollup.day;
+}
+
+size_t LogArchive::getEncodedBytes() const {
+    return segment.size() + days.size() * sizeof(Day);
+}
+
+const std::vector<std::string>& LogArchive::getFoodNames() const {
+    return foodNames;
+}
+
+void LogArchive::decodeDay(size_t index, LogEntry& entry,
+                           const std::function<void(const LogEntry& entry)>& visit) const {
+    size_t offset = days[index].offset;
+    int64_t timestamp = static_cast<int64_t>(days[index].rollup.day) * SECONDS_PER_DAY;
+    for (uint32_t i = 0; i < days[index].rollup.entries; ++i) {
+        uint64_t code = readVarint(segment, offset);
+        int64_t servings = zigzagDecode(readVarint(segment, offset));
+        timestamp += zigzagDecode(readVarint(segment, offset));
+        entry.foodId.assign(foodNames[code]);
+        entry.servings = static_cast<double>(servings) / SERVING_SCALE;
+        entry.timestamp = static_cast<std::time_t>(timestamp);
+        visit(entry);
+    }
+}
+
+std::vector<LogEntry> LogArchive::getEntries(DayNumber day) const {
+    std::vector<LogEntry> entries;
+    auto found = findDay(day);
+    if (found != days.end()) {
+        entries.reserve(found->rollup.entries);
+        LogEntry entry;
+        decodeDay(static_cast<size_t>(found - days.begin()), entry,
+                  [&entries](const LogEntry& decoded) { entries.push_back(decoded); });
+    }
+    return entries;
+}
+
+void LogArchive::forEachDay(const std::function<void(const DayRollup& rollup)>& visit) const {
+    for (const auto& day : days) {
+        visit(day.rollup);
+    }
+}
+
+void LogArchive::forEachDayBetween(DayNumber from, DayNumber to,
+                                   const std::function<void(const DayRollup& rollup)>& visit) const {
+    for (auto it = lowerBound(from); it != days.end() && it->rollup.day <= to; ++it) {
+        visit(it->rollup);
+    }
+}
+
+void LogArchive::forEachEntry(const std::function<void(DayNumber day, const LogEntry& entry)>& visit) const {
+    forEachEntryBetween(std::numeric_limits<DayNumber>::min(), std::numeric_limits<DayNumber>::max(), visit);
+}
+
+void LogArchive::forEachEntryBetween(DayNumber from, DayNumber to,
+                                     const std::function<void(DayNumber day, const LogEntry& entry)>& visit) const {
+    LogEntry entry;
+    for (size_t i = static_cast<size_t>(lowerBound(from) - days.begin());
+         i < days.size() && days[i].rollup.day <= to; ++i) {
+        DayNumber day = days[i].rollup.day;
+        decodeDay(i, entry, [&visit, day](const LogEntry& decoded) { visit(day, decoded); });
+    }
+}
+
+void LogArchive::writeTo(std::ostream& out) const {
+    YADA_STATS_TIMER("log_archive.serialize");
+    std::vector<uint8_t> bytes;
+    writeVarint(bytes, foodNames.size());
+    for (const auto& name : foodNames) {
+        writeVarint(bytes, name.size());
+        bytes.insert(bytes.end(), name.begin(), name.end());
+    }
+    writeVarint(bytes, days.size());
+    DayNumber previousDay = 0;
+    for (size_t i = 0; i < days.size(); ++i) {
+        const DayRollup& rollup = days[i].rollup;
+        writeVarint(bytes, zigzagEncode(static_cast<int64_t>(rollup.day) - previousDay));
+        writeVarint(bytes, rollup.entries);
+        writeVarint(bytes, zigzagEncode(quantize(rollup.servings, SERVING_SCALE)));
+        writeVarint(bytes, zigzagEncode(quantize(rollup.calories, CALORIE_SCALE)));
+        writeVarint(bytes, endOffset(i) - days[i].offset);
+        previousDay = rollup.day;
+    }
+    writeVarint(bytes, segment.size());
+    bytes.insert(bytes.end(), segment.begin(), segment.end());
+
+    out << ARCHIVE_HEADER;
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+void LogArchive::loadFromFile(const std::string& filename) {
+    YADA_STATS_TIMER("log_archive.load");
+    std::string contents = AsyncIo::instance().readFile(filename).get();
+    std::vector<uint8_t> bytes(contents.begin(), contents.end());
+    YADA_STATS_COUNT("log_archive.bytes_read", bytes.size());
+    std::string header(ARCHIVE_HEADER);
+    if (bytes.size() < header.size() || !std::equal(header.begin(), header.end(), bytes.begin())) {
+        throw std::runtime_error("Not a log archive: " + filename);
+    }
+
+    LogArchive loaded;
+    size_t offset = header.size();
+    size_t end = bytes.size();
+    auto next = [&]() { return readCheckedVarint(bytes, offset, end, filename); };
+    auto malformed = [&filename]() { return std::runtime_error("Malformed log archive: " + filename); };
+
+    uint64_t nameCount = next();
+    for (uint64_t i = 0; i < nameCount; ++i) {
+        uint64_t length = next();
+        if (length > end - offset) throw malformed();
+        std::string name(bytes.begin() + offset, bytes.begin() + offset + length);
+        offset += length;
+        if (!loaded.foodCodes.emplace(name, static_cast<uint32_t>(loaded.foodNames.size())).second) {
+            throw malformed();
+        }
+        loaded.foodNames.push_back(std::move(name));
+    }
+
+    uint64_t dayCount = next();
+    int64_t day = 0;
+    uint64_t segmentOffset = 0;
+    for (uint64_t i = 0; i < dayCount; ++i) {
+        int64_t delta = zigzagDecode(next());
+        if (i > 0 && delta <= 0) throw malformed();
+        day += delta;
+        DayRollup rollup;
+        rollup.day = static_cast<DayNumber>(day);
+        rollup.entries = static_cast<uint32_t>(next());
+        rollup.servings = static_cast<double>(zigzagDecode(next())) / SERVING_SCALE;
+        rollup.calories = static_cast<double>(zigzagDecode(next())) / CALORIE_SCALE;
+        loaded.days.push_back(Day{rollup, static_cast<uint32_t>(segmentOffset)});
+        segmentOffset += next();
+    }
+    if (next() != segmentOffset || segmentOffset != end - offset) throw malformed();
+    loaded.segment.assign(bytes.begin() + offset, bytes.end());
+
+    // Check every entry once so later decoding can skip bounds checks
+    for (size_t i = 0; i < loaded.days.size(); ++i) {
+        size_t position = loaded.days[i].offset;
+        size_t dayEnd = loaded.endOffset(i);
+        for (uint32_t entry = 0; entry < loaded.days[i].rollup.entries; ++entry) {
+            if (readCheckedVarint(loaded.segment, position, dayEnd, filename) >= loaded.foodNames.size()) {
+                throw malformed();
+            }
+            readCheckedVarint(loaded.segment, position, dayEnd, filename);
+            readCheckedVarint(loaded.segment, position, dayEnd, filename);
+        }
+        if (position != dayEnd) throw malformed();
+    }
+    *this = std::move(loaded);
+}
@@ -0,0 +1,213 @@
+#include "log/LogExporter.h"
+#include "stats/Stats.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+const char* const CSV_HEADER = "date,food,servings,calories,timestamp\n";
+
+void appendInteger(std::string& buffer, long long value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, result.ptr);
+}
+
+// Servings and calories to a hundredth, trailing zeros dropped. Formatting
+// the integer number of hundredths is several times faster than formatting
+// the double, which dominated the cost of a row.
+void appendNumber(std::string& buffer, double value) {
+    double scaled = std::round(value * 100.0);
+    if (!(std::fabs(scaled) < 1e15)) {
+        char digits[32];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        buffer.append(digits, result.ptr);
+        return;
+    }
+    long long hundredths = static_cast<long long>(scaled);
+    if (hundredths < 0) {
+        buffer += '-';
+        hundredths = -hundredths;
+    }
+    appendInteger(buffer, hundredths / 100);
+    int fraction = static_cast<int>(hundredths % 100);
+    if (fraction != 0) {
+        buffer += '.';
+        buffer += static_cast<char>('0' + fraction / 10);
+        if (fraction % 10 != 0) {
+            buffer += static_cast<char>('0' + fraction % 10);
+        }
+    }
+}
+
+void appendCsvField(std::string& buffer, const std::string& text) {
+    if (text.find_first_of(",\"\r\n") == std::string::npos) {
+        buffer += text;
+        return;
+    }
+    buffer += '"';
+    for (char c : text) {
+        if (c == '"') buffer += '"';
+        buffer += c;
+    }
+    buffer += '"';
+}
+
+void appendJsonString(std::string& buffer, const std::string& text) {
+    static const char* const HEX = "0123456789abcdef";
+    buffer += '"';
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            buffer += '\\';
+            buffer += c;
+        } else if (byte < 0x20) {
+            buffer += "\\u00";
+            buffer += HEX[byte >> 4];
+            buffer += HEX[byte & 0xf];
+        } else {
+            buffer += c;
+        }
+    }
+    buffer += '"';
+}
+
+DayNumber parseOrThrow(const std::string& date) {
+    DayNumber day;
+    if (!FoodDayIndex::parseDay(date, day)) {
+        throw std::runtime_error("Invalid date format. Use YYYY-MM-DD");
+    }
+    return day;
+}
+
+} // namespace
+
+LogExporter::LogExporter(const FoodLog& log, std::function<std::shared_ptr<Food>(const std::string&)> foodLookup)
+    : log(log), foodLookup(std::move(foodLookup)) {}
+
+double LogExporter::caloriesOf(const std::string& foodId, CalorieCache& cache) {
+    auto it = cache.find(foodId);
+    if (it != cache.end()) {
+        return it->second;
+    }
+    double calories;
+    {
+        std::lock_guard<std::mutex> lock(lookupMutex);
+        auto shared = sharedCalories.find(foodId);
+        if (shared != sharedCalories.end()) {
+            calories = shared->second;
+        } else {
+            auto food = foodLookup(foodId);
+            calories = food ? food->getCaloriesPerServing() : 0.0;
+            sharedCalories.emplace(foodId, calories);
+        }
+    }
+    cache.emplace(foodId, calories);
+    return calories;
+}
+
+size_t LogExporter::encode(DayNumber from, DayNumber to, ExportFormat format, CalorieCache& cache,
+                           std::string& buffer, std::ostream* out, size_t flushBytes) {
+    size_t rows = 0;
+    DayNumber currentDay = from - 1;
+    std::string date;
+    log.forEachEntryBetween(FoodDayIndex::formatDay(from), FoodDayIndex::formatDay(to),
+        [&](DayNumber day, const LogEntry& entry) {
+            if (day != currentDay) {
+                currentDay = day;
+                date = FoodDayIndex::formatDay(day);
+            }
+            double calories = caloriesOf(entry.foodId, cache) * entry.servings;
+            if (format == ExportFormat::CSV) {
+                buffer += date;
+                buffer += ',';
+                appendCsvField(buffer, entry.foodId);
+                buffer += ',';
+                appendNumber(buffer, entry.servings);
+                buffer += ',';
+                appendNumber(buffer, calories);
+                buffer += ',';
+                appendInteger(buffer, static_cast<long long>(entry.timestamp));
+                buffer += '\n';
+            } else {
+                buffer += "{\"date\":\"";
+                buffer += date;
+                buffer += "\",\"food\":";
+                appendJsonString(buffer, entry.foodId);
+                buffer += ",\"servings\":";
+                appendNumber(buffer, entry.servings);
+                buffer += ",\"calories\":";
+                appendNumber(buffer, calories);
+                buffer += ",\"timestamp\":";
+                appendInteger(buffer, static_cast<long long>(entry.timestamp));
+                buffer += "}\n";
+            }
+            ++rows;
+            if (out && buffer.size() >= flushBytes) {
+                out->write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                buffer.clear();
+            }
+        });
+    return rows;
+}
+
+size_t LogExporter::exportRange(const std::string& fromDate, const std::string& toDate, std::ostream& out,
+                                const ExportOptions& options) {
+    YADA_STATS_TIMER("log_export.export");
+    DayNumber from = parseOrThrow(fromDate);
+    DayNumber to = parseOrThrow(toDate);
+    size_t flushBytes = std::max<size_t>(options.bufferBytes, 1);
+    size_t rows = 0;
+
+    std::vector<DayNumber> months;
+    if (from <= to) {
+        months = FoodDayIndex::bucketStarts(from, to, HistogramBucket::MONTH);
+    }
+    size_t threads = std::min(std::max<size_t>(options.threads, 1), std::max<size_t>(months.size(), 1));
+    std::vector<std::string> buffers(threads);
+    std::vector<CalorieCache> caches(threads);
+    for (auto& buffer : buffers) {
+        buffer.reserve(threads == 1 ? flushBytes + 256 : flushBytes);
+    }
+    if (options.format == ExportFormat::CSV) {
+        buffers[0] += CSV_HEADER;
+    }
+
+    if (threads == 1) {
+        if (from <= to) {
+            rows = encode(from, to, options.format, caches[0], buffers[0], &out, flushBytes);
+        }
+        out.write(buffers[0].data(), static_cast<std::streamsize>(buffers[0].size()));
+    } else {
+        out.write(buffers[0].data(), static_cast<std::streamsize>(buffers[0].size()));
+        // Encode up to one month per thread, then write them in order; the
+        // buffers keep their capacity from one round to the next
+        for (size_t first = 0; first < months.size(); first += threads) {
+            size_t count = std::min(threads, months.size() - first);
+            std::vector<std::future<size_t>> tasks;
+            for (size_t slot = 0; slot < count; ++slot) {
+                size_t month = first + slot;
+                DayNumber monthEnd = month + 1 < months.size() ? months[month + 1] - 1 : to;
+                tasks.push_back(std::async(std::launch::async, [this, &options, &buffers, &caches,
+                                                                slot, month, &months, monthEnd] {
+                    buffers[slot].clear();
+                    return encode(months[month], monthEnd, options.format, caches[slot], buffers[slot], nullptr, 0);
+                }));
+            }
+            for (size_t slot = 0; slot < count; ++slot) {
+                rows += tasks[slot].get();
+                out.write(buffers[slot].data(), static_cast<std::streamsize>(buffers[slot].size()));
+            }
+        }
+    }
+    out.flush();
+    if (!out) {
+        throw std::runtime_error("Could not write the export");
+    }
+    YADA_STATS_COUNT("log_export.rows", rows);
+    return rows;
+}
@@ -0,0 +1,227 @@
+#include "log/TrendEngine.h"
+#include "stats/Stats.h"
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+DayNumber parseOrThrow(const std::string& date) {
+    DayNumber day;
+    if (!FoodDayIndex::parseDay(date, day)) {
+        throw std::runtime_error("Invalid date format. Use YYYY-MM-DD");
+    }
+    return day;
+}
+
+} // namespace
+
+TrendEngine::TrendEngine(const FoodLog& log, std::function<std::shared_ptr<Food>(const std::string&)> foodLookup)
+    : log(log), foodLookup(std::move(foodLookup)), firstDay(0), totalCalories(0.0), loggedDays(0),
+      anchor(0), windows(), stale(true) {}
+
+void TrendEngine::invalidate() {
+    stale = true;
+    caloriesPerServing.clear();
+}
+
+void TrendEngine::rebuild() {
+    YADA_STATS_TIMER("trends.rebuild");
+    days.clear();
+    totalCalories = 0.0;
+    loggedDays = 0;
+    windows = {};
+    stale = false;
+    log.forEachEntry([this](const std::string& date, const LogEntry& entry) {
+        DayNumber day;
+        if (FoodDayIndex::parseDay(date, day)) {
+            apply(day, caloriesOf(entry.foodId) * entry.servings, 1);
+        }
+    });
+    log.forEachArchivedDay([this](const DayRollup& rollup) {
+        apply(rollup.day, rollup.calories, static_cast<int>(rollup.entries));
+    });
+}
+
+double TrendEngine::caloriesOf(const std::string& foodId) {
+    auto it = caloriesPerServing.find(foodId);
+    if (it != caloriesPerServing.end()) {
+        return it->second;
+    }
+    auto food = foodLookup(foodId);
+    double calories = food ? food->getCaloriesPerServing() : 0.0;
+    caloriesPerServing.emplace(foodId, calories);
+    return calories;
+}
+
+const TrendEngine::DayTotal* TrendEngine::find(DayNumber day) const {
+    if (days.empty() || day < firstDay || day - firstDay >= static_cast<DayNumber>(days.size())) {
+        return nullptr;
+    }
+    return &days[day - firstDay];
+}
+
+void TrendEngine::apply(DayNumber day, double calories, int entryDelta) {
+    if (days.empty()) {
+        firstDay = day;
+        days.emplace_back();
+    } else if (day < firstDay) {
+        days.insert(days.begin(), static_cast<size_t>(firstDay - day), DayTotal());
+        firstDay = day;
+    }
+    size_t index = static_cast<size_t>(day - firstDay);
+    if (index >= days.size()) {
+        days.resize(index + 1);
+    }
+
+    DayTotal& total = days[index];
+    bool wasLogged = total.entries > 0;
+    double before = total.calories;
+    total.calories += calories;
+    total.entries = static_cast<uint32_t>(static_cast<int64_t>(total.entries) + entryDelta);
+    bool isLogged = total.entries > 0;
+    if (!isLogged) {
+        total.calories = 0.0;  // No rounding residue on emptied days
+    }
+    double change = total.calories - before;
+    int loggedChange = static_cast<int>(isLogged) - static_cast<int>(wasLogged);
+
+    totalCalories += change;
+    loggedDays = static_cast<size_t>(static_cast<int64_t>(loggedDays) + loggedChange);
+    for (size_t w = 0; w < WINDOW_DAYS.size(); ++w) {
+        if (day <= anchor && day > anchor - WINDOW_DAYS[w]) {
+            windows[w].calories += change;
+            windows[w].loggedDays = static_cast<size_t>(static_cast<int64_t>(windows[w].loggedDays) + loggedChange);
+        }
+    }
+}
+
+void TrendEngine::moveAnchor(DayNumber day) {
+    if (day == anchor) return;
+    auto add = [](WindowSum& window, const DayTotal* total, int sign) {
+        if (total && total->entries > 0) {
+            window.calories += sign * total->calories;
+            window.loggedDays = static_cast<size_t>(static_cast<int64_t>(window.loggedDays) + sign);
+        }
+    };
+    if (day > anchor && day - anchor <= WINDOW_DAYS.back()) {
+        // Slide a day at a time: one day enters and one leaves each window
+        for (DayNumber next = anchor + 1; next <= day; ++next) {
+            for (size_t w = 0; w < WINDOW_DAYS.size(); ++w) {
+                add(windows[w], find(next), 1);
+                add(windows[w], find(next - WINDOW_DAYS[w]), -1);
+            }
+        }
+    } else {
+        windows = {};
+        for (size_t w = 0; w < WINDOW_DAYS.size(); ++w) {
+            for (DayNumber current = day - WINDOW_DAYS[w] + 1; current <= day; ++current) {
+                add(windows[w], find(current), 1);
+            }
+        }
+    }
+    anchor = day;
+}
+
+bool TrendEngine::isOnTarget(double calories, double targetCalories) {
+    return std::fabs(calories - targetCalories) <= ON_TARGET_TOLERANCE * targetCalories;
+}
+
+void TrendEngine::entryChanged(const std::string& date, const std::string& foodId,
+                               double servingsDelta, int entryDelta) {
+    if (stale) return;  // Picked up by the pending rebuild
+    DayNumber day;
+    if (FoodDayIndex::parseDay(date, day)) {
+        apply(day, caloriesOf(foodId) * servingsDelta, entryDelta);
+    }
+}
+
+void TrendEngine::logReloaded() {
+    stale = true;
+}
+
+double TrendEngine::getCaloriesForDate(const std::string& date) {
+    DayNumber day = parseOrThrow(date);
+    if (stale) rebuild();
+    const DayTotal* total = find(day);
+    return total ? total->calories : 0.0;
+}
+
+TrendSummary TrendEngine::getSummary(const std::string& date, double targetCalories) {
+    DayNumber day = parseOrThrow(date);
+    if (stale) rebuild();
+    moveAnchor(day);
+
+    TrendSummary summary;
+    for (size_t w = 0; w < WINDOW_DAYS.size(); ++w) {
+        summary.averages[w] = windows[w].loggedDays ? windows[w].calories / windows[w].loggedDays : 0.0;
+    }
+    summary.cumulativeDeficit = targetCalories * loggedDays - totalCalories;
+    summary.loggedDays = loggedDays;
+
+    // A day not logged yet does not break the streak leading up to it
+    const DayTotal* today = find(day);
+    DayNumber current = (today && today->entries > 0) ? day : day - 1;
+    summary.streak = 0;
+    for (const DayTotal* total = find(current);
+         total && total->entries > 0 && isOnTarget(total->calories, targetCalories);
+         total = find(--current)) {
+        ++summary.streak;
+    }
+    return summary;
+}
+
+std::vector<TrendPoint> TrendEngine::getSeries(const std::string& fromDate, const std::string& toDate,
+                                               double targetCalories) {
+    YADA_STATS_TIMER("trends.series");
+    DayNumber from = parseOrThrow(fromDate);
+    DayNumber to = parseOrThrow(toDate);
+    if (stale) rebuild();
+
+    std::vector<TrendPoint> series;
+    if (from > to) return series;
+    series.reserve(static_cast<size_t>(to - from + 1));
+
+    size_t streak = 0;
+    for (const DayTotal* total = find(from - 1);
+         total && total->entries > 0 && isOnTarget(total->calories, targetCalories);
+         total = find(from - 1 - static_cast<DayNumber>(streak))) {
+        ++streak;
+    }
+
+    // Every window slides along with the day: one day enters, one leaves
+    std::array<WindowSum, 3> sums = {};
+    double deficit = 0.0;
+    DayNumber start = from - WINDOW_DAYS.back() + 1;
+    for (DayNumber day = start; day <= to; ++day) {
+        const DayTotal* entering = find(day);
+        bool logged = entering && entering->entries > 0;
+        for (size_t w = 0; w < WINDOW_DAYS.size(); ++w) {
+            if (logged) {
+                sums[w].calories += entering->calories;
+                ++sums[w].loggedDays;
+            }
+            const DayTotal* leaving = day - WINDOW_DAYS[w] >= start ? find(day - WINDOW_DAYS[w]) : nullptr;
+            if (leaving && leaving->entries > 0) {
+                sums[w].calories -= leaving->calories;
+                --sums[w].loggedDays;
+            }
+        }
+        if (day < from) continue;
+
+        TrendPoint point;
+        point.date = FoodDayIndex::formatDay(day);
+        point.logged = logged;
+        point.calories = logged ? entering->calories : 0.0;
+        for (size_t w = 0; w < WINDOW_DAYS.size(); ++w) {
+            point.averages[w] = sums[w].loggedDays ? sums[w].calories / sums[w].loggedDays : 0.0;
+        }
+        if (logged) {
+            deficit += targetCalories - point.calories;
+        }
+        point.cumulativeDeficit = deficit;
+        streak = logged && isOnTarget(point.calories, targetCalories) ? streak + 1 : 0;
+        point.streak = streak;
+        series.push_back(std::move(point));
+    }
+    return series;
+}
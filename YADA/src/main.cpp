@@ -1,13 +1,46 @@
 #include "food/BasicFood.h"
 #include "food/CompositeFood.h"
 #include "ui/UserInterface.h"
+#include "stats/Stats.h"
 #include <iostream>
 #include <memory>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    // --stats-dump FILE writes session statistics on exit (JSON if FILE ends in .json)
+    // --archive-after DAYS archives older log days at startup (0 disables)
+    // --food-api URL looks up foods missing from the database at a food server
+    std::string statsDumpFile;
+    std::string foodApiUrl;
+    int archiveAfterDays = UserInterface::DEFAULT_ARCHIVE_AFTER_DAYS;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--stats-dump" && i + 1 < argc) {
+            statsDumpFile = argv[++i];
+        } else if (arg == "--archive-after" && i + 1 < argc) {
+            try {
+                archiveAfterDays = std::stoi(argv[++i]);
+            } catch (const std::exception&) {
+                archiveAfterDays = -1;
+            }
+            if (archiveAfterDays < 0) {
+                std::cerr << "--archive-after needs a number of days (0 disables archiving)\n";
+                return 1;
+            }
+        } else if (arg == "--food-api" && i + 1 < argc) {
+            foodApiUrl = argv[++i];
+        } else {
+            std::cerr << "Usage: yada [--stats-dump FILE] [--archive-after DAYS] [--food-api URL]\n";
+            return 1;
+        }
+    }
 
-int main() {
     try {
-        UserInterface ui;
+        UserInterface ui(archiveAfterDays, foodApiUrl);
         ui.run();
+        if (!statsDumpFile.empty()) {
+            Stats::instance().writeToFile(statsDumpFile);
+        }
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
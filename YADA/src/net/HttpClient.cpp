@@ -0,0 +1,342 @@
+#include "net/HttpClient.h"
+#include "stats/Stats.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// The server closed a kept-alive connection before answering; usually the
+// request never reached it, but only an idempotent one is sent again
+class StaleConnection : public std::runtime_error {
+public:
+    StaleConnection() : std::runtime_error("Connection closed by server") {}
+};
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+bool containsToken(const std::string* value, std::string_view token) {
+    if (!value) return false;
+    std::string lower(value->size(), '\0');
+    std::transform(value->begin(), value->end(), lower.begin(),
+                   [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+    return lower.find(token) != std::string::npos;
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) text.remove_suffix(1);
+    return text;
+}
+
+} // namespace
+
+const std::string* HttpResponse::findHeader(std::string_view name) const {
+    for (const auto& header : headers) {
+        if (equalsIgnoreCase(header.first, name)) {
+            return &header.second;
+        }
+    }
+    return nullptr;
+}
+
+HttpClient::HttpClient(const std::string& baseUrl, int timeoutMs)
+    : timeoutMs(timeoutMs), socketFd(-1), connectionCount(0) {
+    const std::string scheme = "http://";
+    if (baseUrl.compare(0, scheme.size(), scheme) != 0) {
+        throw std::runtime_error("Only http:// URLs are supported: " + baseUrl);
+    }
+    std::string rest = baseUrl.substr(scheme.size());
+    size_t slash = rest.find('/');
+    std::string authority = rest.substr(0, slash);
+    basePath = slash == std::string::npos ? "" : rest.substr(slash);
+    while (!basePath.empty() && basePath.back() == '/') {
+        basePath.pop_back();
+    }
+    size_t colon = authority.rfind(':');
+    if (colon != std::string::npos && authority.find(']', colon) == std::string::npos) {
+        host = authority.substr(0, colon);
+        port = authority.substr(colon + 1);
+    } else {
+        host = authority;
+        port = "80";
+    }
+    if (!host.empty() && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+    if (host.empty() || port.empty()) {
+        throw std::runtime_error("Invalid URL: " + baseUrl);
+    }
+}
+
+HttpClient::~HttpClient() {
+    disconnect();
+}
+
+HttpResponse HttpClient::get(const std::string& path, const HttpHeaders& headers) {
+    return request("GET", path, headers, "", true);
+}
+
+HttpResponse HttpClient::post(const std::string& path, const std::string& body,
+                              const std::string& contentType, const HttpHeaders& headers, bool idempotent) {
+    HttpHeaders all = headers;
+    all.emplace_back("Content-Type", contentType);
+    return request("POST", path, all, body, idempotent);
+}
+
+size_t HttpClient::getConnectionCount() const {
+    return connectionCount;
+}
+
+std::string HttpClient::encodeQuery(std::string_view text) {
+    static const char* const HEX = "0123456789ABCDEF";
+    std::string out;
+    out.reserve(text.size());
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (std::isalnum(byte) || c == '-' || c == '_' || c == '.' || c == '~') {
+            out += c;
+        } else {
+            out += '%';
+            out += HEX[byte >> 4];
+            out += HEX[byte & 0xf];
+        }
+    }
+    return out;
+}
+
+HttpResponse HttpClient::request(const std::string& method, const std::string& path, const HttpHeaders& headers,
+                                 const std::string& body, bool retryable) {
+    YADA_STATS_TIMER("http.request");
+    std::string message = method + " " + basePath + path + " HTTP/1.1\r\nHost: " + host +
+                          (port == "80" ? "" : ":" + port) + "\r\n";
+    for (const auto& header : headers) {
+        message += header.first + ": " + header.second + "\r\n";
+    }
+    if (method != "GET" || !body.empty()) {
+        message += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    }
+    message += "\r\n";
+    message += body;
+
+    for (int attempt = 0;; ++attempt) {
+        bool reused = socketFd >= 0;
+        if (!reused) {
+            connect();
+        }
+        try {
+            sendAll(message);
+            return readResponse();
+        } catch (const StaleConnection&) {
+            disconnect();
+            // The server may have acted on the request before closing
+            if (!reused || attempt > 0 || !retryable) {
+                throw;
+            }
+        } catch (...) {
+            disconnect();  // The connection is in an unknown state
+            throw;
+        }
+    }
+}
+
+#ifdef _WIN32
+
+void HttpClient::connect() {
+    throw std::runtime_error("HTTP requests are not supported on this platform");
+}
+
+void HttpClient::disconnect() {
+    received.clear();
+}
+
+void HttpClient::sendAll(const std::string&) {
+    throw std::runtime_error("HTTP requests are not supported on this platform");
+}
+
+bool HttpClient::receiveMore() {
+    return false;
+}
+
+#else
+
+void HttpClient::connect() {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    int error = getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses);
+    if (error != 0) {
+        throw std::runtime_error("Cannot resolve " + host + ": " + gai_strerror(error));
+    }
+    timeval timeout{timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+    std::string lastError = "no addresses";
+    for (addrinfo* address = addresses; address; address = address->ai_next) {
+        int fd = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (fd < 0) {
+            lastError = std::strerror(errno);
+            continue;
+        }
+        // The send timeout also bounds connect() on Linux
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        if (::connect(fd, address->ai_addr, address->ai_addrlen) == 0) {
+            socketFd = fd;
+            break;
+        }
+        lastError = std::strerror(errno);
+        ::close(fd);
+    }
+    freeaddrinfo(addresses);
+    if (socketFd < 0) {
+        throw std::runtime_error("Cannot connect to " + host + ":" + port + ": " + lastError);
+    }
+    received.clear();
+    ++connectionCount;
+}
+
+void HttpClient::disconnect() {
+    if (socketFd >= 0) {
+        ::close(socketFd);
+        socketFd = -1;
+    }
+    received.clear();
+}
+
+void HttpClient::sendAll(const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t count = ::send(socketFd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EPIPE || errno == ECONNRESET) throw StaleConnection();
+            throw std::runtime_error(std::string("Cannot send request: ") + std::strerror(errno));
+        }
+        sent += static_cast<size_t>(count);
+    }
+}
+
+bool HttpClient::receiveMore() {
+    char buffer[16384];
+    while (true) {
+        ssize_t count = ::recv(socketFd, buffer, sizeof(buffer), 0);
+        if (count > 0) {
+            received.append(buffer, static_cast<size_t>(count));
+            return true;
+        }
+        if (count == 0) return false;
+        if (errno == EINTR) continue;
+        if (errno == ECONNRESET) return false;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            throw std::runtime_error("Timed out waiting for " + host);
+        }
+        throw std::runtime_error(std::string("Cannot read response: ") + std::strerror(errno));
+    }
+}
+
+#endif
+
+HttpResponse HttpClient::readResponse() {
+    size_t headerEnd;
+    while ((headerEnd = received.find("\r\n\r\n")) == std::string::npos) {
+        bool nothingYet = received.empty();
+        if (!receiveMore()) {
+            if (nothingYet) throw StaleConnection();
+            throw std::runtime_error("Connection closed in the middle of a response");
+        }
+    }
+
+    HttpResponse response;
+    std::string_view head(received.data(), headerEnd);
+    size_t lineEnd = head.find("\r\n");
+    std::string_view statusLine = head.substr(0, lineEnd);
+    if (statusLine.compare(0, 5, "HTTP/") != 0 || statusLine.size() < 12) {
+        throw std::runtime_error("Invalid HTTP status line");
+    }
+    std::from_chars(statusLine.data() + 9, statusLine.data() + 12, response.status);
+    while (lineEnd != std::string_view::npos && lineEnd < head.size()) {
+        size_t start = lineEnd + 2;
+        lineEnd = head.find("\r\n", start);
+        std::string_view line = head.substr(start, lineEnd == std::string_view::npos ? std::string_view::npos
+                                                                                     : lineEnd - start);
+        size_t colon = line.find(':');
+        if (colon != std::string_view::npos) {
+            response.headers.emplace_back(std::string(trim(line.substr(0, colon))),
+                                          std::string(trim(line.substr(colon + 1))));
+        }
+    }
+    received.erase(0, headerEnd + 4);
+
+    bool closeAfter = containsToken(response.findHeader("Connection"), "close");
+    const std::string* length = response.findHeader("Content-Length");
+    if (response.status == 204 || response.status == 304 || response.status / 100 == 1) {
+        // No body
+    } else if (containsToken(response.findHeader("Transfer-Encoding"), "chunked")) {
+        while (true) {
+            size_t sizeEnd;
+            while ((sizeEnd = received.find("\r\n")) == std::string::npos) {
+                if (!receiveMore()) throw std::runtime_error("Connection closed in the middle of a response");
+            }
+            size_t chunkSize = 0;
+            auto result = std::from_chars(received.data(), received.data() + sizeEnd, chunkSize, 16);
+            bool extension = result.ptr != received.data() + sizeEnd && *result.ptr == ';';
+            if (result.ec != std::errc() || (result.ptr != received.data() + sizeEnd && !extension)) {
+                throw std::runtime_error("Invalid chunk size");
+            }
+            // Also keeps sizeEnd + 2 + chunkSize + 2 from overflowing
+            if (chunkSize > MAX_BODY_BYTES - response.body.size()) {
+                throw std::runtime_error("Response body is too long");
+            }
+            while (received.size() < sizeEnd + 2 + chunkSize + 2) {
+                if (!receiveMore()) throw std::runtime_error("Connection closed in the middle of a response");
+            }
+            response.body.append(received, sizeEnd + 2, chunkSize);
+            received.erase(0, sizeEnd + 2 + chunkSize + 2);
+            if (chunkSize == 0) break;  // Trailers are not supported
+        }
+    } else if (length) {
+        size_t contentLength = 0;
+        auto result = std::from_chars(length->data(), length->data() + length->size(), contentLength);
+        if (result.ec != std::errc()) {
+            throw std::runtime_error("Invalid Content-Length");
+        }
+        if (contentLength > MAX_BODY_BYTES) {
+            throw std::runtime_error("Response body is too long");
+        }
+        while (received.size() < contentLength) {
+            if (!receiveMore()) throw std::runtime_error("Connection closed in the middle of a response");
+        }
+        response.body = received.substr(0, contentLength);
+        received.erase(0, contentLength);
+    } else {
+        // Delimited by the end of the connection
+        while (receiveMore()) {
+            if (received.size() > MAX_BODY_BYTES) throw std::runtime_error("Response body is too long");
+        }
+        response.body = std::move(received);
+        received.clear();
+        closeAfter = true;
+    }
+    if (closeAfter) {
+        disconnect();
+    }
+    return response;
+}
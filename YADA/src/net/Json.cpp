@@ -0,0 +1,330 @@
+#include "net/Json.h"
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+
+// Recursive descent over the text; nesting is bounded so hostile input
+// cannot exhaust the stack
+class JsonParser {
+public:
+    explicit JsonParser(std::string_view text) : text(text), position(0) {}
+
+    JsonValue parseDocument() {
+        JsonValue value = parseValue(0);
+        skipSpace();
+        if (position != text.size()) {
+            fail("trailing characters");
+        }
+        return value;
+    }
+
+private:
+    static const int MAX_DEPTH = 64;
+
+    std::string_view text;
+    size_t position;
+
+    [[noreturn]] void fail(const char* what) const {
+        throw std::runtime_error(std::string("Invalid JSON: ") + what + " at offset " + std::to_string(position));
+    }
+
+    void skipSpace() {
+        while (position < text.size() &&
+               (text[position] == ' ' || text[position] == '\t' || text[position] == '\n' || text[position] == '\r')) {
+            ++position;
+        }
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (position < text.size() && text[position] == c) {
+            ++position;
+            return true;
+        }
+        return false;
+    }
+
+    void expectWord(std::string_view word) {
+        if (text.substr(position, word.size()) != word) {
+            fail("unexpected token");
+        }
+        position += word.size();
+    }
+
+    JsonValue parseValue(int depth) {
+        if (depth > MAX_DEPTH) {
+            fail("nested too deeply");
+        }
+        skipSpace();
+        if (position >= text.size()) {
+            fail("unexpected end");
+        }
+        char c = text[position];
+        if (c == '{') return parseObject(depth);
+        if (c == '[') return parseArray(depth);
+        if (c == '"') return JsonValue(parseString());
+        if (c == 't') { expectWord("true"); return JsonValue(true); }
+        if (c == 'f') { expectWord("false"); return JsonValue(false); }
+        if (c == 'n') { expectWord("null"); return JsonValue(); }
+        return JsonValue(parseNumber());
+    }
+
+    JsonValue parseObject(int depth) {
+        ++position;  // '{'
+        JsonValue object = JsonValue::object();
+        if (consume('}')) return object;
+        do {
+            skipSpace();
+            if (position >= text.size() || text[position] != '"') {
+                fail("expected a member name");
+            }
+            std::string key = parseString();
+            if (!consume(':')) {
+                fail("expected ':'");
+            }
+            object.members.emplace_back(std::move(key), parseValue(depth + 1));
+        } while (consume(','));
+        if (!consume('}')) {
+            fail("expected '}'");
+        }
+        return object;
+    }
+
+    JsonValue parseArray(int depth) {
+        ++position;  // '['
+        JsonValue array = JsonValue::array();
+        if (consume(']')) return array;
+        do {
+            array.items.push_back(parseValue(depth + 1));
+        } while (consume(','));
+        if (!consume(']')) {
+            fail("expected ']'");
+        }
+        return array;
+    }
+
+    double parseNumber() {
+        size_t start = position;
+        while (position < text.size() &&
+               (std::isdigit(static_cast<unsigned char>(text[position])) || text[position] == '-' ||
+                text[position] == '+' || text[position] == '.' || text[position] == 'e' || text[position] == 'E')) {
+            ++position;
+        }
+        double value;
+        auto result = std::from_chars(text.data() + start, text.data() + position, value);
+        if (start == position || result.ec != std::errc() || result.ptr != text.data() + position) {
+            position = start;
+            fail("invalid number");
+        }
+        return value;
+    }
+
+    unsigned parseHex4() {
+        if (position + 4 > text.size()) {
+            fail("truncated escape");
+        }
+        unsigned code = 0;
+        auto result = std::from_chars(text.data() + position, text.data() + position + 4, code, 16);
+        if (result.ptr != text.data() + position + 4) {
+            fail("invalid escape");
+        }
+        position += 4;
+        return code;
+    }
+
+    static void appendUtf8(std::string& out, unsigned code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xc0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xe0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        } else {
+            out += static_cast<char>(0xf0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        }
+    }
+
+    std::string parseString() {
+        ++position;  // '"'
+        std::string out;
+        while (true) {
+            size_t end = text.find_first_of("\"\\", position);
+            if (end == std::string_view::npos) {
+                fail("unterminated string");
+            }
+            out.append(text.data() + position, end - position);
+            position = end + 1;
+            if (text[end] == '"') {
+                return out;
+            }
+            if (position >= text.size()) {
+                fail("unterminated string");
+            }
+            char escape = text[position++];
+            switch (escape) {
+                case '"': case '\\': case '/': out += escape; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    unsigned code = parseHex4();
+                    if (code >= 0xd800 && code < 0xdc00 && text.substr(position, 2) == "\\u") {
+                        position += 2;
+                        unsigned low = parseHex4();
+                        code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                    }
+                    appendUtf8(out, code);
+                    break;
+                }
+                default: fail("invalid escape");
+            }
+        }
+    }
+};
+
+JsonValue::JsonValue() : type(Type::NUL), boolean(false), number(0.0) {}
+JsonValue::JsonValue(Type type) : type(type), boolean(false), number(0.0) {}
+JsonValue::JsonValue(bool value) : type(Type::BOOLEAN), boolean(value), number(0.0) {}
+JsonValue::JsonValue(double value) : type(Type::NUMBER), boolean(false), number(value) {}
+JsonValue::JsonValue(const std::string& value) : type(Type::STRING), boolean(false), number(0.0), text(value) {}
+JsonValue::JsonValue(const char* value) : type(Type::STRING), boolean(false), number(0.0), text(value) {}
+
+JsonValue JsonValue::array() {
+    return JsonValue(Type::ARRAY);
+}
+
+JsonValue JsonValue::object() {
+    return JsonValue(Type::OBJECT);
+}
+
+JsonValue JsonValue::parse(std::string_view text) {
+    return JsonParser(text).parseDocument();
+}
+
+JsonValue::Type JsonValue::getType() const {
+    return type;
+}
+
+bool JsonValue::isNull() const {
+    return type == Type::NUL;
+}
+
+bool JsonValue::asBool() const {
+    if (type != Type::BOOLEAN) throw std::runtime_error("JSON value is not a boolean");
+    return boolean;
+}
+
+double JsonValue::asNumber() const {
+    if (type != Type::NUMBER) throw std::runtime_error("JSON value is not a number");
+    return number;
+}
+
+const std::string& JsonValue::asString() const {
+    if (type != Type::STRING) throw std::runtime_error("JSON value is not a string");
+    return text;
+}
+
+const std::vector<JsonValue>& JsonValue::asArray() const {
+    if (type != Type::ARRAY) throw std::runtime_error("JSON value is not an array");
+    return items;
+}
+
+const std::vector<std::pair<std::string, JsonValue>>& JsonValue::asObject() const {
+    if (type != Type::OBJECT) throw std::runtime_error("JSON value is not an object");
+    return members;
+}
+
+const JsonValue* JsonValue::find(const std::string& key) const {
+    for (const auto& member : members) {
+        if (member.first == key) {
+            return &member.second;
+        }
+    }
+    return nullptr;
+}
+
+void JsonValue::push(JsonValue value) {
+    if (type != Type::ARRAY) throw std::runtime_error("JSON value is not an array");
+    items.push_back(std::move(value));
+}
+
+void JsonValue::set(const std::string& key, JsonValue value) {
+    if (type != Type::OBJECT) throw std::runtime_error("JSON value is not an object");
+    members.emplace_back(key, std::move(value));
+}
+
+void JsonValue::write(std::string& out) const {
+    switch (type) {
+        case Type::NUL:
+            out += "null";
+            break;
+        case Type::BOOLEAN:
+            out += boolean ? "true" : "false";
+            break;
+        case Type::NUMBER: {
+            if (!std::isfinite(number)) {
+                out += "null";  // JSON has no infinities
+                break;
+            }
+            char buffer[32];
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+            out.append(buffer, result.ptr);
+            break;
+        }
+        case Type::STRING:
+            appendJsonString(out, text);
+            break;
+        case Type::ARRAY:
+            out += '[';
+            for (size_t i = 0; i < items.size(); ++i) {
+                if (i > 0) out += ',';
+                items[i].write(out);
+            }
+            out += ']';
+            break;
+        case Type::OBJECT:
+            out += '{';
+            for (size_t i = 0; i < members.size(); ++i) {
+                if (i > 0) out += ',';
+                appendJsonString(out, members[i].first);
+                out += ':';
+                members[i].second.write(out);
+            }
+            out += '}';
+            break;
+    }
+}
+
+std::string JsonValue::toString() const {
+    std::string out;
+    write(out);
+    return out;
+}
+
+void appendJsonString(std::string& out, std::string_view text) {
+    static const char* const HEX = "0123456789abcdef";
+    out += '"';
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (byte < 0x20) {
+            out += "\\u00";
+            out += HEX[byte >> 4];
+            out += HEX[byte & 0xf];
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
@@ -0,0 +1,385 @@
+#include "planner/MealSuggester.h"
+#include "stats/Stats.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <queue>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const double SERVING_OPTIONS[] = {0.5, 1.0, 1.5, 2.0};
+const double SERVING_PENALTY = 0.1;   // Per serving away from one
+const double ITEM_PENALTY = 0.05;     // Per food beyond the first
+const double CALORIE_WEIGHT = 0.5;    // At the edge of the tolerance
+const double NUTRIENT_WEIGHT = 0.5;   // Per nutrient missed by its whole target
+const double MIN_TOLERANCE = 10.0;    // Calories
+
+// One food at one serving size
+struct Item {
+    uint32_t food;
+    float servings;
+    double calories;
+};
+
+struct Problem {
+    std::vector<Item> items;           // Sorted by calories
+    std::vector<double> prefixCalories;  // prefixCalories[i] = calories of items [0, i)
+    std::array<std::vector<uint32_t>, std::size(SERVING_OPTIONS)> byServings;  // Indices of items, by serving size
+    std::vector<Nutrients> nutrients;  // Per food and serving, only with targets
+    double maxFoodCalories;            // Of one serving of any food
+    bool hasTargets;
+    Nutrients targets;
+    double calories;
+    double tolerance;
+    size_t planCount;
+    Clock::time_point deadline;
+};
+
+struct Candidate {
+    double score;
+    std::array<uint32_t, MealSuggester::MAX_PLAN_ITEMS> items;  // Indices into Problem::items
+    size_t count;
+};
+
+struct WorseFirst {
+    bool operator()(const Candidate& a, const Candidate& b) const {
+        return a.score < b.score;
+    }
+};
+
+// Smallest score any thread still needs to beat
+class SharedBound {
+public:
+    SharedBound() : value(std::numeric_limits<double>::infinity()), timedOut(false) {}
+
+    double get() const { return value.load(std::memory_order_relaxed); }
+
+    void lower(double bound) {
+        double current = value.load(std::memory_order_relaxed);
+        while (bound < current && !value.compare_exchange_weak(current, bound, std::memory_order_relaxed)) {}
+    }
+
+    std::atomic<double> value;
+    std::atomic<bool> timedOut;
+};
+
+// Depth-first search state owned by one thread
+class Search {
+public:
+    Search(const Problem& problem, SharedBound& shared) : problem(problem), shared(shared), nodes(0) {}
+
+    // Plans of planSize items whose first item is items[first], for first
+    // items tried from the largest down. Returns false once even the largest
+    // completion within the bound falls short; since items are sorted, so
+    // does every earlier first item.
+    bool runFrom(size_t planSize, size_t first) {
+        size = planSize;
+        const Item& item = problem.items[first];
+        double penalty = ITEM_PENALTY * (size - 1);
+        double bound = threshold();
+        double most = maxItemCalories(bound - penalty);
+        if (item.calories + (size - 1) * most < problem.calories - allowedMiss(bound, penalty)) return false;
+        chosen[0] = static_cast<uint32_t>(first);
+        extend(1, first, item.calories, servingPenalty(item) + penalty);
+        return true;
+    }
+
+    // Single-item plans
+    void runSingles() {
+        size = 1;
+        finish(0, std::numeric_limits<size_t>::max(), 0.0, 0.0);
+    }
+
+    std::priority_queue<Candidate, std::vector<Candidate>, WorseFirst>& getBest() { return best; }
+
+private:
+    const Problem& problem;
+    SharedBound& shared;
+    std::priority_queue<Candidate, std::vector<Candidate>, WorseFirst> best;
+    std::array<uint32_t, MealSuggester::MAX_PLAN_ITEMS> chosen;
+    size_t size = 0;
+    size_t nodes;
+
+    static double servingPenalty(const Item& item) {
+        return SERVING_PENALTY * std::abs(item.servings - 1.0f);
+    }
+
+    double threshold() const {
+        double local = best.size() >= problem.planCount ? best.top().score
+                                                        : std::numeric_limits<double>::infinity();
+        return std::min(local, shared.get());
+    }
+
+    bool outOfTime() {
+        if ((++nodes & 255) == 0 && Clock::now() >= problem.deadline) {
+            shared.timedOut = true;
+        }
+        return shared.timedOut.load(std::memory_order_relaxed);
+    }
+
+    // Most calories one item can add while its serving penalty stays under
+    // budget; a plan that only ties the bound is not kept either
+    double maxItemCalories(double budget) const {
+        double most = 0.0;
+        for (double servings : SERVING_OPTIONS) {
+            if (SERVING_PENALTY * std::abs(servings - 1.0) < budget - 1e-9) {
+                most = std::max(most, problem.maxFoodCalories * servings);
+            }
+        }
+        return most;
+    }
+
+    // Calorie miss a plan may still have and beat bound, given its penalty
+    double allowedMiss(double bound, double penalty) const {
+        return std::min(problem.tolerance, (bound - penalty) * problem.tolerance / CALORIE_WEIGHT + 1e-9);
+    }
+
+    bool usesFood(size_t depth, uint32_t food) const {
+        for (size_t i = 0; i < depth; ++i) {
+            if (problem.items[chosen[i]].food == food) return true;
+        }
+        return false;
+    }
+
+    void extend(size_t depth, size_t last, double calories, double penalty) {
+        if (penalty >= threshold() || outOfTime()) return;
+        if (depth == size - 1) {
+            finish(depth, last, calories, penalty);
+            return;
+        }
+        const auto& items = problem.items;
+        size_t after = size - depth - 1;  // Items still to pick after the next one
+        auto byCalories = [&items](uint32_t index, double value) { return items[index].calories < value; };
+        // Each serving size is walked on its own. No later pick can add more
+        // than maxItemCalories() within the penalty the next one leaves, so
+        // smaller next items cannot come close enough, and larger ones (which
+        // the later picks must also be) are out of reach.
+        for (size_t option = 0; option < std::size(SERVING_OPTIONS); ++option) {
+            double withServing = penalty + SERVING_PENALTY * std::abs(SERVING_OPTIONS[option] - 1.0);
+            double bound = threshold();
+            if (withServing >= bound) continue;
+            double most = maxItemCalories(bound - withServing);
+            double smallest = problem.calories - allowedMiss(bound, withServing) - calories - after * most;
+            const auto& sized = problem.byServings[option];
+            auto from = std::lower_bound(sized.begin(), sized.end(), last + 1);
+            for (auto it = std::lower_bound(from, sized.end(), smallest, byCalories); it != sized.end(); ++it) {
+                size_t next = *it;
+                if (next + after >= items.size() || items[next].calories > most) break;
+                double withNext = calories + items[next].calories;
+                // Cheapest completion uses the next smallest items; sorted, so stop
+                double minRest = problem.prefixCalories[next + 1 + after] - problem.prefixCalories[next + 1];
+                if (withNext + minRest > problem.calories + allowedMiss(threshold(), withServing)) break;
+                if (usesFood(depth, items[next].food)) continue;
+                chosen[depth] = static_cast<uint32_t>(next);
+                extend(depth + 1, next, withNext, penalty + servingPenalty(items[next]));
+                if (shared.timedOut.load(std::memory_order_relaxed)) return;
+            }
+        }
+    }
+
+    // Picks the final item by binary search, nearest calories first. Each
+    // serving size is searched on its own, so sizes whose penalty alone
+    // cannot beat the bound are skipped instead of crowding the window.
+    void finish(size_t depth, size_t last, double calories, double penalty) {
+        const auto& items = problem.items;
+        double wanted = problem.calories - calories;
+        size_t begin = last == std::numeric_limits<size_t>::max() ? 0 : last + 1;
+        auto byCalories = [&items](uint32_t index, double value) { return items[index].calories < value; };
+        for (size_t option = 0; option < std::size(SERVING_OPTIONS); ++option) {
+            if (penalty + SERVING_PENALTY * std::abs(SERVING_OPTIONS[option] - 1.0) >= threshold()) continue;
+            const auto& sized = problem.byServings[option];
+            auto from = std::lower_bound(sized.begin(), sized.end(), begin);
+            size_t low = std::lower_bound(from, sized.end(), wanted - problem.tolerance, byCalories) - sized.begin();
+            size_t high = std::lower_bound(sized.begin() + low, sized.end(), wanted + problem.tolerance + 1e-9, byCalories) - sized.begin();
+            size_t middle = std::lower_bound(sized.begin() + low, sized.begin() + high, wanted, byCalories) - sized.begin();
+
+            size_t left = middle;   // Candidates below are [low, left)
+            size_t right = middle;  // Candidates above are [right, high)
+            while (left > low || right < high) {
+                size_t next;
+                if (left > low && (right >= high || wanted - items[sized[left - 1]].calories <= items[sized[right]].calories - wanted)) {
+                    next = sized[--left];
+                } else {
+                    next = sized[right++];
+                }
+                const Item& item = items[next];
+                double miss = std::abs(calories + item.calories - problem.calories);
+                double base = penalty + servingPenalty(item) + CALORIE_WEIGHT * miss / problem.tolerance;
+                // Later candidates of this size miss by more, so none can win
+                if (base >= threshold()) break;
+                if (outOfTime()) return;
+                if (usesFood(depth, item.food)) continue;
+                chosen[depth] = static_cast<uint32_t>(next);
+                offer(base + nutrientPenalty(depth + 1), depth + 1);
+            }
+        }
+    }
+
+    double nutrientPenalty(size_t count) const {
+        if (!problem.hasTargets) return 0.0;
+        Nutrients totals;
+        for (size_t i = 0; i < count; ++i) {
+            const Item& item = problem.items[chosen[i]];
+            totals.addScaled(problem.nutrients[item.food], item.servings);
+        }
+        double penalty = 0.0;
+        for (size_t n = PROTEIN; n < NUTRIENT_COUNT; ++n) {
+            double target = problem.targets.values[n];
+            if (target > 0.0) {
+                penalty += NUTRIENT_WEIGHT * std::min(1.0, std::abs(totals.values[n] - target) / target);
+            }
+        }
+        return penalty;
+    }
+
+    void offer(double score, size_t count) {
+        if (score >= threshold()) return;
+        Candidate candidate{score, chosen, count};
+        best.push(candidate);
+        if (best.size() > problem.planCount) best.pop();
+        if (best.size() == problem.planCount) shared.lower(best.top().score);
+    }
+};
+
+} // namespace
+
+MealSuggester::MealSuggester(const FoodDatabase& foodDatabase)
+    : foodDatabase(foodDatabase), truncated(false) {}
+
+bool MealSuggester::wasTruncated() const {
+    return truncated;
+}
+
+std::vector<MealPlan> MealSuggester::suggest(const MealRequest& request) const {
+    YADA_STATS_TIMER("meal_suggester.suggest");
+    truncated = false;
+    std::vector<MealPlan> plans;
+    const auto& foods = foodDatabase.getFoods();
+    if (request.calories <= 0.0 || request.planCount == 0 || foods.empty()) {
+        return plans;
+    }
+
+    Problem problem;
+    problem.hasTargets = request.nutrientTargets.hasMacros();
+    problem.targets = request.nutrientTargets;
+    problem.calories = request.calories;
+    problem.tolerance = std::max(MIN_TOLERANCE, request.calories * request.calorieTolerance);
+    problem.planCount = request.planCount;
+    problem.maxFoodCalories = 0.0;
+    problem.deadline = Clock::now() + request.timeBudget;
+
+    // Flatten foods once so the search never touches the component trees
+    problem.items.reserve(foods.size() * std::size(SERVING_OPTIONS));
+    if (problem.hasTargets) problem.nutrients.resize(foods.size());
+    for (size_t i = 0; i < foods.size(); ++i) {
+        double calories;
+        if (problem.hasTargets) {
+            problem.nutrients[i] = foods[i]->getNutrientsPerServing();
+            calories = problem.nutrients[i][CALORIES];
+        } else {
+            calories = foods[i]->getCaloriesPerServing();
+        }
+        if (calories <= 0.0) continue;
+        problem.maxFoodCalories = std::max(problem.maxFoodCalories, calories);
+        for (double servings : SERVING_OPTIONS) {
+            problem.items.push_back({static_cast<uint32_t>(i), static_cast<float>(servings), calories * servings});
+        }
+    }
+    if (problem.items.empty()) {
+        return plans;
+    }
+    std::sort(problem.items.begin(), problem.items.end(),
+        [](const Item& a, const Item& b) { return a.calories < b.calories; });
+    size_t maxItems = std::min(std::max<size_t>(request.maxItems, 1), MAX_PLAN_ITEMS);
+    if (!problem.hasTargets) {
+        // A serving variant with the calories of planCount whole servings of
+        // foods the rest of its plan does not use is beaten by each of them,
+        // so it can never make the cut
+        size_t covering = maxItems - 1 + problem.planCount;
+        auto kept = problem.items.begin();
+        for (auto run = problem.items.begin(); run != problem.items.end();) {
+            auto runEnd = std::find_if(run, problem.items.end(),
+                [&run](const Item& item) { return item.calories != run->calories; });
+            size_t whole = std::count_if(run, runEnd, [](const Item& item) { return item.servings == 1.0f; });
+            for (; run != runEnd; ++run) {
+                if (whole < covering || run->servings == 1.0f) *kept++ = *run;
+            }
+        }
+        problem.items.erase(kept, problem.items.end());
+    }
+    problem.prefixCalories.resize(problem.items.size() + 1, 0.0);
+    for (auto& sized : problem.byServings) {
+        sized.reserve(foods.size());
+    }
+    for (size_t i = 0; i < problem.items.size(); ++i) {
+        problem.prefixCalories[i + 1] = problem.prefixCalories[i] + problem.items[i].calories;
+        size_t option = std::find(std::begin(SERVING_OPTIONS), std::end(SERVING_OPTIONS),
+                                  problem.items[i].servings) - std::begin(SERVING_OPTIONS);
+        problem.byServings[option].push_back(static_cast<uint32_t>(i));
+    }
+
+    SharedBound shared;
+    size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<Search> searches(threadCount, Search(problem, shared));
+    searches[0].runSingles();
+
+    // Smaller plans go first so their scores prune the larger ones
+    for (size_t size = 2; size <= maxItems && !shared.timedOut; ++size) {
+        // First items up to fits leave room for the smallest completion
+        size_t fits = 0;
+        while (fits + size - 1 < problem.items.size() &&
+               problem.items[fits].calories + problem.prefixCalories[fits + size] -
+               problem.prefixCalories[fits + 1] <= problem.calories + problem.tolerance) {
+            ++fits;
+        }
+        std::vector<std::future<void>> tasks;
+        for (size_t t = 0; t < threadCount; ++t) {
+            tasks.push_back(std::async(std::launch::async, [&, t, size, fits] {
+                // The first item is the smallest, so the best plans tend to
+                // start just under calories / size: going down from the
+                // largest that fits finds them early and tightens the bound.
+                // Interleaved so every thread gets large and small first items.
+                for (size_t skipped = t; skipped < fits; skipped += threadCount) {
+                    if (shared.timedOut.load(std::memory_order_relaxed)) break;
+                    if (!searches[t].runFrom(size, fits - 1 - skipped)) break;
+                }
+            }));
+        }
+        for (auto& task : tasks) {
+            task.get();
+        }
+    }
+    truncated = shared.timedOut;
+
+    std::vector<Candidate> candidates;
+    for (auto& search : searches) {
+        auto& best = search.getBest();
+        while (!best.empty()) {
+            candidates.push_back(best.top());
+            best.pop();
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+        [](const Candidate& a, const Candidate& b) { return a.score < b.score; });
+    candidates.resize(std::min(candidates.size(), request.planCount));
+
+    for (const auto& candidate : candidates) {
+        MealPlan plan;
+        plan.score = candidate.score;
+        for (size_t i = 0; i < candidate.count; ++i) {
+            const Item& item = problem.items[candidate.items[i]];
+            const auto& food = foods[item.food];
+            plan.items.emplace_back(food, item.servings);
+            food->accumulateNutrients(plan.totals, item.servings);
+        }
+        plans.push_back(std::move(plan));
+    }
+    return plans;
+}
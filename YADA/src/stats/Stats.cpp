@@ -0,0 +1,171 @@
+#include "stats/Stats.h"
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+// LatencyHistogram implementation
+LatencyHistogram::LatencyHistogram() : count(0), totalNanos(0), maxNanos(0) {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::record(uint64_t nanos) {
+    buckets[bucketIndex(nanos)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    totalNanos.fetch_add(nanos, std::memory_order_relaxed);
+    uint64_t currentMax = maxNanos.load(std::memory_order_relaxed);
+    while (nanos > currentMax &&
+           !maxNanos.compare_exchange_weak(currentMax, nanos, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t LatencyHistogram::getCount() const {
+    return count.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::getTotalNanos() const {
+    return totalNanos.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::getMaxNanos() const {
+    return maxNanos.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::getPercentileNanos(double fraction) const {
+    uint64_t total = getCount();
+    if (total == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(fraction * total);
+    if (rank >= total) rank = total - 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen > rank) {
+            // Never report more than the largest value actually observed
+            uint64_t bound = bucketUpperBound(i);
+            uint64_t observedMax = getMaxNanos();
+            return bound < observedMax ? bound : observedMax;
+        }
+    }
+    return getMaxNanos();
+}
+
+int LatencyHistogram::bucketIndex(uint64_t nanos) {
+    if (nanos < 4) {
+        return static_cast<int>(nanos);
+    }
+    int msb = 63;
+    while (!(nanos >> msb)) {
+        --msb;
+    }
+    int subBucket = static_cast<int>((nanos >> (msb - 2)) & 3);
+    return (msb - 1) * 4 + subBucket;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int index) {
+    if (index < 4) {
+        return static_cast<uint64_t>(index);
+    }
+    int msb = index / 4 + 1;
+    uint64_t subBucket = static_cast<uint64_t>(index % 4);
+    uint64_t width = uint64_t(1) << (msb - 2);
+    return ((4 + subBucket) << (msb - 2)) + width - 1;
+}
+
+// Stats implementation
+Stats& Stats::instance() {
+    static Stats stats;
+    return stats;
+}
+
+bool Stats::isEnabled() {
+#ifdef YADA_ENABLE_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+LatencyHistogram& Stats::operation(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& histogram = operations[name];
+    if (!histogram) {
+        histogram = std::make_unique<LatencyHistogram>();
+    }
+    return *histogram;
+}
+
+std::atomic<uint64_t>& Stats::counter(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& value = counters[name];
+    if (!value) {
+        value = std::make_unique<std::atomic<uint64_t>>(0);
+    }
+    return *value;
+}
+
+void Stats::writeText(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(1);
+    text << std::left << std::setw(32) << "Operation" << std::right
+         << std::setw(10) << "Count" << std::setw(12) << "Total ms"
+         << std::setw(12) << "p50 us" << std::setw(12) << "p99 us" << std::setw(12) << "Max us" << "\n";
+    for (const auto& pair : operations) {
+        const auto& histogram = *pair.second;
+        text << std::left << std::setw(32) << pair.first << std::right
+             << std::setw(10) << histogram.getCount()
+             << std::setw(12) << histogram.getTotalNanos() / 1e6
+             << std::setw(12) << histogram.getPercentileNanos(0.50) / 1e3
+             << std::setw(12) << histogram.getPercentileNanos(0.99) / 1e3
+             << std::setw(12) << histogram.getMaxNanos() / 1e3 << "\n";
+    }
+    if (!counters.empty()) {
+        text << "\n" << std::left << std::setw(32) << "Counter" << std::right << std::setw(10) << "Value" << "\n";
+        for (const auto& pair : counters) {
+            text << std::left << std::setw(32) << pair.first << std::right
+                 << std::setw(10) << pair.second->load(std::memory_order_relaxed) << "\n";
+        }
+    }
+    out << text.str();
+}
+
+void Stats::writeJson(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(3);
+    json << "{\"operations\":{";
+    bool first = true;
+    for (const auto& pair : operations) {
+        const auto& histogram = *pair.second;
+        json << (first ? "" : ",") << "\"" << pair.first << "\":{"
+             << "\"count\":" << histogram.getCount()
+             << ",\"total_ms\":" << histogram.getTotalNanos() / 1e6
+             << ",\"p50_us\":" << histogram.getPercentileNanos(0.50) / 1e3
+             << ",\"p99_us\":" << histogram.getPercentileNanos(0.99) / 1e3
+             << ",\"max_us\":" << histogram.getMaxNanos() / 1e3 << "}";
+        first = false;
+    }
+    json << "},\"counters\":{";
+    first = true;
+    for (const auto& pair : counters) {
+        json << (first ? "" : ",") << "\"" << pair.first << "\":" << pair.second->load(std::memory_order_relaxed);
+        first = false;
+    }
+    json << "}}\n";
+    out << json.str();
+}
+
+void Stats::writeToFile(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file) {
+        throw std::runtime_error("Could not open file for writing: " + filename);
+    }
+    bool json = filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".json") == 0;
+    if (json) {
+        writeJson(file);
+    } else {
+        writeText(file);
+    }
+}
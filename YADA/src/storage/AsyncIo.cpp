@@ -0,0 +1,515 @@
+#include "storage/AsyncIo.h"
+#include "storage/AtomicFile.h"
+#include "stats/Stats.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define YADA_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace {
+
+#ifndef _WIN32
+std::string errorText(const std::string& what, const std::string& filename, int error) {
+    return what + " " + filename + ": " + std::strerror(error);
+}
+
+std::string parentDirectory(const std::string& filename) {
+    size_t slash = filename.find_last_of('/');
+    if (slash == std::string::npos) return ".";
+    if (slash == 0) return "/";
+    return filename.substr(0, slash);
+}
+#endif
+
+bool threadsRequested() {
+    const char* setting = std::getenv("YADA_ASYNC_IO");
+    return setting && std::string(setting) == "threads";
+}
+
+} // namespace
+
+struct AsyncIo::Request {
+    enum Type { READ, WRITE, FSYNC, WAKE } type;
+    int fd;
+    char* buffer;
+    size_t length;
+    uint64_t offset;
+#ifndef _WIN32
+    iovec vector;  // Must stay put until the kernel has read it
+#endif
+    std::function<void(int)> done;
+};
+
+#ifdef YADA_HAVE_IO_URING
+
+// The submission and completion rings shared with the kernel
+struct AsyncIo::Ring {
+    int fd = -1;
+    void* sqMemory = MAP_FAILED;
+    size_t sqSize = 0;
+    void* cqMemory = MAP_FAILED;
+    size_t cqSize = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqesSize = 0;
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    bool open(unsigned entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) return false;
+
+        sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMap) {
+            sqSize = cqSize = std::max(sqSize, cqSize);
+        }
+        sqMemory = mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqMemory == MAP_FAILED) return false;
+        if (singleMap) {
+            cqMemory = sqMemory;
+        } else {
+            cqMemory = mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (cqMemory == MAP_FAILED) return false;
+        }
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE,
+                                               MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) return false;
+
+        char* sq = static_cast<char*>(sqMemory);
+        sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        char* cq = static_cast<char*>(cqMemory);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+    ~Ring() {
+        if (sqes != MAP_FAILED) munmap(sqes, sqesSize);
+        if (cqMemory != MAP_FAILED && cqMemory != sqMemory) munmap(cqMemory, cqSize);
+        if (sqMemory != MAP_FAILED) munmap(sqMemory, sqSize);
+        if (fd >= 0) ::close(fd);
+    }
+};
+
+#else
+
+struct AsyncIo::Ring {};
+
+#endif
+
+struct AsyncIo::ReadState {
+    std::string filename;
+    int fd;
+    std::string data;
+    std::mutex mutex;
+    size_t chunksLeft;
+    size_t end;  // Lowered if the file turns out shorter than it was
+    int error = 0;
+    std::promise<std::string> promise;
+};
+
+struct AsyncIo::WriteState {
+    std::string filename;
+    std::string tempName;
+    int fd;
+    std::string contents;
+    std::mutex mutex;
+    size_t chunksLeft;
+    int error = 0;
+    std::promise<void> promise;
+};
+
+AsyncIo& AsyncIo::instance() {
+    static AsyncIo io(threadsRequested() ? Backend::THREAD_POOL : Backend::IO_URING);
+    return io;
+}
+
+AsyncIo::AsyncIo(Backend preferred, size_t threadCount)
+    : backend(Backend::THREAD_POOL), inFlight(0), stopping(false) {
+#ifdef YADA_HAVE_IO_URING
+    if (preferred == Backend::IO_URING) {
+        auto candidate = std::make_unique<Ring>();
+        if (candidate->open(QUEUE_DEPTH)) {
+            ring = std::move(candidate);
+            backend = Backend::IO_URING;
+            threads.emplace_back(&AsyncIo::reapLoop, this);
+            return;
+        }
+    }
+#else
+    (void)preferred;
+#endif
+    for (size_t i = 0; i < std::max<size_t>(1, threadCount); ++i) {
+        threads.emplace_back(&AsyncIo::poolLoop, this);
+    }
+}
+
+AsyncIo::~AsyncIo() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+#ifdef YADA_HAVE_IO_URING
+        if (ring) {
+            // A no-op completion wakes the reaper to notice it should stop
+            submitToRing(new Request{Request::WAKE, -1, nullptr, 0, 0, {}, nullptr});
+        }
+#endif
+    }
+    workAvailable.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+AsyncIo::Backend AsyncIo::getBackend() const {
+    return backend;
+}
+
+const char* AsyncIo::getBackendName() const {
+    return backend == Backend::IO_URING ? "io_uring" : "thread pool";
+}
+
+void AsyncIo::submit(Request* request) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ring && inFlight < QUEUE_DEPTH) {
+            submitToRing(request);
+            return;
+        }
+        backlog.push_back(request);
+    }
+    workAvailable.notify_one();
+}
+
+#ifdef YADA_HAVE_IO_URING
+
+void AsyncIo::submitToRing(Request* request) {
+    unsigned tail = *ring->sqTail;
+    unsigned index = tail & *ring->sqMask;
+    io_uring_sqe* sqe = &ring->sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    switch (request->type) {
+        case Request::READ:
+        case Request::WRITE:
+            request->vector.iov_base = request->buffer;
+            request->vector.iov_len = request->length;
+            sqe->opcode = request->type == Request::READ ? IORING_OP_READV : IORING_OP_WRITEV;
+            sqe->addr = reinterpret_cast<uint64_t>(&request->vector);
+            sqe->len = 1;
+            sqe->off = request->offset;
+            break;
+        case Request::FSYNC:
+            sqe->opcode = IORING_OP_FSYNC;
+            break;
+        case Request::WAKE:
+            sqe->opcode = IORING_OP_NOP;
+            break;
+    }
+    sqe->fd = request->fd;
+    sqe->user_data = reinterpret_cast<uint64_t>(request);
+    ring->sqArray[index] = index;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+    ++inFlight;
+    // A failed enter (EAGAIN, ENOMEM) leaves the entry queued; the reaper
+    // submits it, so it is not left waiting for another request
+    while (ring->enter(1, 0, 0) < 0 && errno == EINTR) {
+    }
+}
+
+void AsyncIo::reapLoop() {
+    while (true) {
+        unsigned head = *ring->cqHead;
+        if (head == __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE)) {
+            // Entries the submitter could not hand over go in with the wait
+            unsigned pending = __atomic_load_n(ring->sqTail, __ATOMIC_ACQUIRE) -
+                               __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+            if (ring->enter(pending, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+                // Out of kernel memory for now; try again shortly rather than spin
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            continue;
+        }
+        io_uring_cqe cqe = ring->cqes[head & *ring->cqMask];
+        __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+
+        Request* request = reinterpret_cast<Request*>(cqe.user_data);
+        {
+            // Also orders this thread after the submitter, which held the lock
+            std::lock_guard<std::mutex> lock(mutex);
+            --inFlight;
+            while (!backlog.empty() && inFlight < QUEUE_DEPTH) {
+                submitToRing(backlog.front());
+                backlog.pop_front();
+            }
+        }
+        if (request->done) {
+            request->done(cqe.res);  // May submit follow-up requests
+        }
+        delete request;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping && inFlight == 0 && backlog.empty()) {
+            return;
+        }
+    }
+}
+
+#else
+
+void AsyncIo::submitToRing(Request*) {}
+
+void AsyncIo::reapLoop() {}
+
+#endif
+
+void AsyncIo::poolLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        workAvailable.wait(lock, [this] { return stopping || !backlog.empty(); });
+        if (backlog.empty()) {
+            return;  // Stopping with nothing left to do
+        }
+        Request* request = backlog.front();
+        backlog.pop_front();
+        lock.unlock();
+        int result = perform(*request);
+        if (request->done) {
+            request->done(result);
+        }
+        delete request;
+        lock.lock();
+    }
+}
+
+#ifdef _WIN32
+
+int AsyncIo::perform(const Request&) {
+    return -ENOSYS;
+}
+
+// Without POSIX descriptors each file is handled whole on its own thread
+std::future<std::string> AsyncIo::readFile(const std::string& filename) {
+    return std::async(std::launch::async, [filename] {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Could not open file for reading: " + filename);
+        }
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    });
+}
+
+std::future<void> AsyncIo::writeFileAtomically(const std::string& filename, std::string contents) {
+    return std::async(std::launch::async, [filename, contents = std::move(contents)] {
+        ::writeFileAtomically(filename, contents);
+    });
+}
+
+void AsyncIo::readChunk(const std::shared_ptr<ReadState>&, size_t, size_t) {}
+void AsyncIo::writeChunk(const std::shared_ptr<WriteState>&, size_t, size_t) {}
+void AsyncIo::finishWrite(const std::shared_ptr<WriteState>&) {}
+
+#else
+
+int AsyncIo::perform(const Request& request) {
+    ssize_t result;
+    do {
+        switch (request.type) {
+            case Request::READ:
+                result = ::pread(request.fd, request.buffer, request.length, static_cast<off_t>(request.offset));
+                break;
+            case Request::WRITE:
+                result = ::pwrite(request.fd, request.buffer, request.length, static_cast<off_t>(request.offset));
+                break;
+            case Request::FSYNC:
+                result = ::fsync(request.fd);
+                break;
+            default:
+                result = 0;
+                break;
+        }
+    } while (result < 0 && errno == EINTR);
+    return result < 0 ? -errno : static_cast<int>(result);
+}
+
+std::future<std::string> AsyncIo::readFile(const std::string& filename) {
+    auto state = std::make_shared<ReadState>();
+    state->filename = filename;
+    auto future = state->promise.get_future();
+    state->fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat info;
+    if (state->fd < 0 || ::fstat(state->fd, &info) != 0) {
+        if (state->fd >= 0) ::close(state->fd);
+        state->promise.set_exception(std::make_exception_ptr(
+            std::runtime_error("Could not open file for reading: " + filename)));
+        return future;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    if (size == 0) {
+        ::close(state->fd);
+        state->promise.set_value(std::string());
+        return future;
+    }
+    state->data.resize(size);
+    state->end = size;
+    state->chunksLeft = (size + CHUNK_BYTES - 1) / CHUNK_BYTES;
+    // Every chunk is queued at once so the kernel can keep the device busy
+    for (size_t offset = 0; offset < size; offset += CHUNK_BYTES) {
+        readChunk(state, offset, std::min(CHUNK_BYTES, size - offset));
+    }
+    return future;
+}
+
+void AsyncIo::readChunk(const std::shared_ptr<ReadState>& state, size_t offset, size_t length) {
+    Request* request = new Request{Request::READ, state->fd, &state->data[offset], length, offset, {}, nullptr};
+    request->done = [this, state, offset, length](int result) {
+        if (result > 0 && static_cast<size_t>(result) < length) {
+            readChunk(state, offset + result, length - result);  // Short read: ask for the rest
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (result < 0) {
+                state->error = -result;
+            } else if (result == 0) {
+                state->end = std::min(state->end, offset);
+            }
+            if (--state->chunksLeft > 0) return;
+        }
+        ::close(state->fd);
+        if (state->error) {
+            state->promise.set_exception(std::make_exception_ptr(
+                std::runtime_error(errorText("Could not read file", state->filename, state->error))));
+        } else {
+            state->data.resize(state->end);
+            state->promise.set_value(std::move(state->data));
+        }
+    };
+    submit(request);
+}
+
+std::future<void> AsyncIo::writeFileAtomically(const std::string& filename, std::string contents) {
+    YADA_STATS_COUNT("storage.bytes_written", contents.size());
+    auto state = std::make_shared<WriteState>();
+    state->filename = filename;
+    state->tempName = filename + ".tmp";
+    state->contents = std::move(contents);
+    auto future = state->promise.get_future();
+    state->fd = ::open(state->tempName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (state->fd < 0) {
+        state->promise.set_exception(std::make_exception_ptr(
+            std::runtime_error(errorText("Could not open file for writing:", state->tempName, errno))));
+        return future;
+    }
+    size_t size = state->contents.size();
+    if (size == 0) {
+        finishWrite(state);
+        return future;
+    }
+    state->chunksLeft = (size + CHUNK_BYTES - 1) / CHUNK_BYTES;
+    for (size_t offset = 0; offset < size; offset += CHUNK_BYTES) {
+        writeChunk(state, offset, std::min(CHUNK_BYTES, size - offset));
+    }
+    return future;
+}
+
+void AsyncIo::writeChunk(const std::shared_ptr<WriteState>& state, size_t offset, size_t length) {
+    Request* request = new Request{Request::WRITE, state->fd, &state->contents[offset], length, offset, {}, nullptr};
+    request->done = [this, state, offset, length](int result) {
+        if (result > 0 && static_cast<size_t>(result) < length) {
+            writeChunk(state, offset + result, length - result);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (result <= 0) {
+                state->error = result < 0 ? -result : EIO;
+            }
+            if (--state->chunksLeft > 0) return;
+        }
+        if (state->error) {
+            ::close(state->fd);
+            ::unlink(state->tempName.c_str());
+            state->promise.set_exception(std::make_exception_ptr(
+                std::runtime_error(errorText("Could not write file", state->tempName, state->error))));
+            return;
+        }
+        finishWrite(state);
+    };
+    submit(request);
+}
+
+// Syncs the temporary file, renames it into place and syncs the directory
+// so the rename itself survives a crash
+void AsyncIo::finishWrite(const std::shared_ptr<WriteState>& state) {
+    Request* sync = new Request{Request::FSYNC, state->fd, nullptr, 0, 0, {}, nullptr};
+    sync->done = [this, state](int result) {
+        ::close(state->fd);
+        if (result < 0) {
+            ::unlink(state->tempName.c_str());
+            state->promise.set_exception(std::make_exception_ptr(
+                std::runtime_error(errorText("Could not sync file", state->tempName, -result))));
+            return;
+        }
+        if (::rename(state->tempName.c_str(), state->filename.c_str()) != 0) {
+            int error = errno;
+            ::unlink(state->tempName.c_str());
+            state->promise.set_exception(std::make_exception_ptr(
+                std::runtime_error(errorText("Could not replace file", state->filename, error))));
+            return;
+        }
+        int dirFd = ::open(parentDirectory(state->filename).c_str(), O_RDONLY | O_CLOEXEC);
+        if (dirFd < 0) {
+            state->promise.set_value();
+            return;
+        }
+        Request* syncDirectory = new Request{Request::FSYNC, dirFd, nullptr, 0, 0, {}, nullptr};
+        syncDirectory->done = [state, dirFd](int) {
+            ::close(dirFd);
+            state->promise.set_value();
+        };
+        submit(syncDirectory);
+    };
+    submit(sync);
+}
+
+#endif
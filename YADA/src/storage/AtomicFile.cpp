@@ -0,0 +1,103 @@
+#include "storage/AtomicFile.h"
+#include "stats/Stats.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fstream>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+void writeFileAtomically(const std::string& filename, const std::string& contents) {
+    YADA_STATS_TIMER("storage.write_file");
+    YADA_STATS_COUNT("storage.bytes_written", contents.size());
+    std::string tempName = filename + ".tmp";
+    {
+        std::ofstream file(tempName, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("Could not open file for writing: " + tempName);
+        }
+        file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        file.flush();
+        if (!file) {
+            throw std::runtime_error("Could not write file: " + tempName);
+        }
+    }
+    if (!MoveFileExA(tempName.c_str(), filename.c_str(),
+                     MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        std::remove(tempName.c_str());
+        throw std::runtime_error("Could not replace file: " + filename);
+    }
+}
+
+#else
+
+namespace {
+
+std::string errorText(const std::string& what, const std::string& filename) {
+    return what + " " + filename + ": " + std::strerror(errno);
+}
+
+std::string parentDirectory(const std::string& filename) {
+    size_t slash = filename.find_last_of('/');
+    if (slash == std::string::npos) return ".";
+    if (slash == 0) return "/";
+    return filename.substr(0, slash);
+}
+
+} // namespace
+
+void writeFileAtomically(const std::string& filename, const std::string& contents) {
+    YADA_STATS_TIMER("storage.write_file");
+    YADA_STATS_COUNT("storage.bytes_written", contents.size());
+    std::string tempName = filename + ".tmp";
+    int fd = ::open(tempName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error(errorText("Could not open file for writing:", tempName));
+    }
+
+    const char* data = contents.data();
+    size_t remaining = contents.size();
+    while (remaining > 0) {
+        ssize_t written = ::write(fd, data, remaining);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            std::string message = errorText("Could not write file", tempName);
+            ::close(fd);
+            ::unlink(tempName.c_str());
+            throw std::runtime_error(message);
+        }
+        data += written;
+        remaining -= static_cast<size_t>(written);
+    }
+
+    if (::fsync(fd) != 0) {
+        std::string message = errorText("Could not sync file", tempName);
+        ::close(fd);
+        ::unlink(tempName.c_str());
+        throw std::runtime_error(message);
+    }
+    ::close(fd);
+
+    if (::rename(tempName.c_str(), filename.c_str()) != 0) {
+        std::string message = errorText("Could not replace file", filename);
+        ::unlink(tempName.c_str());
+        throw std::runtime_error(message);
+    }
+
+    // Persist the directory entry so the rename itself survives a crash
+    int dirFd = ::open(parentDirectory(filename).c_str(), O_RDONLY);
+    if (dirFd >= 0) {
+        ::fsync(dirFd);
+        ::close(dirFd);
+    }
+}
+
+#endif
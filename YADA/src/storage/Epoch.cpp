@@ -0,0 +1,100 @@
+#include "storage/Epoch.h"
+#include <algorithm>
+#include <limits>
+
+// Gives each thread one slot, handed back when the thread exits
+struct EpochThreadSlot {
+    EpochDomain::Slot* slot = nullptr;
+
+    ~EpochThreadSlot() {
+        if (slot) {
+            EpochDomain::releaseSlot(slot);
+        }
+    }
+};
+
+EpochDomain& EpochDomain::instance() {
+    static EpochDomain* domain = new EpochDomain();
+    return *domain;
+}
+
+EpochDomain::Slot* EpochDomain::claimSlot() {
+    for (Slot* slot = slots.load(); slot; slot = slot->next) {
+        bool expected = false;
+        if (!slot->claimed.load(std::memory_order_relaxed) && slot->claimed.compare_exchange_strong(expected, true)) {
+            return slot;
+        }
+    }
+    Slot* slot = new Slot();
+    slot->claimed.store(true, std::memory_order_relaxed);
+    Slot* head = slots.load();
+    do {
+        slot->next = head;
+    } while (!slots.compare_exchange_weak(head, slot));
+    return slot;
+}
+
+void EpochDomain::releaseSlot(Slot* slot) {
+    slot->epoch.store(0);
+    slot->depth = 0;
+    slot->claimed.store(false, std::memory_order_release);
+}
+
+void EpochDomain::retire(std::function<void()> deleter) {
+    // Readers that could have loaded the object pinned an earlier epoch;
+    // readers pinning this one or later load its replacement
+    uint64_t retiredAt = epoch.fetch_add(1) + 1;
+    {
+        std::lock_guard<std::mutex> lock(retiredMutex);
+        retired.emplace_back(retiredAt, std::move(deleter));
+    }
+    collect();
+}
+
+size_t EpochDomain::collect() {
+    uint64_t oldest = std::numeric_limits<uint64_t>::max();
+    for (Slot* slot = slots.load(); slot; slot = slot->next) {
+        uint64_t pinned = slot->epoch.load();
+        if (pinned != 0 && pinned < oldest) {
+            oldest = pinned;
+        }
+    }
+
+    std::vector<std::function<void()>> ready;
+    size_t waiting;
+    {
+        std::lock_guard<std::mutex> lock(retiredMutex);
+        auto freed = std::partition(retired.begin(), retired.end(),
+            [oldest](const auto& entry) { return entry.first > oldest; });
+        for (auto it = freed; it != retired.end(); ++it) {
+            ready.push_back(std::move(it->second));
+        }
+        retired.erase(freed, retired.end());
+        waiting = retired.size();
+    }
+    // Deleters run unlocked; they may free large structures
+    for (auto& deleter : ready) {
+        deleter();
+    }
+    return waiting;
+}
+
+EpochGuard::EpochGuard() {
+    thread_local EpochThreadSlot threadSlot;
+    EpochDomain& domain = EpochDomain::instance();
+    if (!threadSlot.slot) {
+        threadSlot.slot = domain.claimSlot();
+    }
+    slot = threadSlot.slot;
+    if (slot->depth++ == 0) {
+        // Sequentially consistent, so the pin is seen by writers before the
+        // caller loads any pointer the guard protects
+        slot->epoch.store(domain.epoch.load());
+    }
+}
+
+EpochGuard::~EpochGuard() {
+    if (--slot->depth == 0) {
+        slot->epoch.store(0, std::memory_order_release);
+    }
+}
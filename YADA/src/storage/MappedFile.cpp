@@ -0,0 +1,86 @@
+#include "storage/MappedFile.h"
+#include "stats/Stats.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& filename) : begin(nullptr), length(0) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Could not open file for reading: " + filename);
+    }
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    begin = contents.data();
+    length = contents.size();
+    YADA_STATS_COUNT("storage.bytes_mapped", length);
+}
+
+MappedFile::~MappedFile() = default;
+
+void MappedFile::prefetch(size_t, size_t) const {}
+
+#else
+
+MappedFile::MappedFile(const std::string& filename) : begin(nullptr), length(0) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open file for reading: " + filename + ": " + std::strerror(errno));
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        std::string message = "Could not read file size: " + filename + ": " + std::strerror(errno);
+        ::close(fd);
+        throw std::runtime_error(message);
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length > 0) {
+        void* mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            std::string message = "Could not map file: " + filename + ": " + std::strerror(errno);
+            ::close(fd);
+            throw std::runtime_error(message);
+        }
+        begin = static_cast<const char*>(mapping);
+        ::madvise(mapping, length, MADV_SEQUENTIAL);
+    }
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    YADA_STATS_COUNT("storage.bytes_mapped", length);
+}
+
+MappedFile::~MappedFile() {
+    if (begin) {
+        ::munmap(const_cast<char*>(begin), length);
+    }
+}
+
+void MappedFile::prefetch(size_t offset, size_t count) const {
+    if (!begin || offset >= length) return;
+    // madvise wants a page-aligned start
+    size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    size_t start = offset - offset % page;
+    size_t end = offset + count < length ? offset + count : length;
+    ::madvise(const_cast<char*>(begin) + start, end - start, MADV_WILLNEED);
+}
+
+#endif
+
+const char* MappedFile::data() const {
+    return begin ? begin : "";
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
@@ -0,0 +1,114 @@
+#include "storage/PersistenceWorker.h"
+#include "storage/AsyncIo.h"
+#include <algorithm>
+#include <exception>
+#include <future>
+#include <iterator>
+
+PersistenceWorker::PersistenceWorker()
+    : writing(false), stopping(false), worker(&PersistenceWorker::run, this) {}
+
+PersistenceWorker::~PersistenceWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workAvailable.notify_one();
+    worker.join();
+}
+
+void PersistenceWorker::submit(const std::string& filename, std::string contents) {
+    std::vector<FileWrite> group;
+    group.push_back({filename, std::move(contents)});
+    submit(std::move(group));
+}
+
+void PersistenceWorker::submit(std::vector<FileWrite> group) {
+    auto inGroup = [&group](const FileWrite& write) {
+        return std::any_of(group.begin(), group.end(),
+            [&write](const FileWrite& newer) { return newer.filename == write.filename; });
+    };
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // A pending group sharing a file with this one is joined to it: its
+        // older contents of that file are dropped and this group's writes
+        // follow its other writes, so neither group's order is broken
+        std::vector<FileWrite> joined;
+        for (auto queued = pending.begin(); queued != pending.end();) {
+            if (std::none_of(queued->begin(), queued->end(), inGroup)) {
+                ++queued;
+                continue;
+            }
+            for (auto& write : *queued) {
+                if (!inGroup(write)) joined.push_back(std::move(write));
+            }
+            queued = pending.erase(queued);
+        }
+        joined.insert(joined.end(), std::make_move_iterator(group.begin()), std::make_move_iterator(group.end()));
+        pending.push_back(std::move(joined));
+    }
+    workAvailable.notify_one();
+}
+
+void PersistenceWorker::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    workDone.wait(lock, [this] { return pending.empty() && !writing; });
+}
+
+std::vector<WriteError> PersistenceWorker::takeErrors() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<WriteError> result;
+    result.swap(errors);
+    return result;
+}
+
+void PersistenceWorker::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        workAvailable.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (pending.empty()) {
+            break;  // Stopping with nothing left to write
+        }
+
+        std::vector<std::vector<FileWrite>> batch;
+        batch.swap(pending);
+        writing = true;
+        lock.unlock();
+
+        // The groups are in flight side by side, one file of each at a time
+        std::vector<WriteError> batchErrors;
+        std::vector<std::future<void>> writes(batch.size());
+        for (size_t step = 0;; ++step) {
+            bool started = false;
+            for (size_t i = 0; i < batch.size(); ++i) {
+                if (step < batch[i].size()) {
+                    FileWrite& write = batch[i][step];
+                    writes[i] = AsyncIo::instance().writeFileAtomically(write.filename, std::move(write.contents));
+                    started = true;
+                }
+            }
+            if (!started) break;
+            for (size_t i = 0; i < batch.size(); ++i) {
+                if (step >= batch[i].size()) continue;
+                try {
+                    writes[i].get();
+                } catch (const std::exception& e) {
+                    batchErrors.push_back({batch[i][step].filename, e.what()});
+                    for (size_t later = step + 1; later < batch[i].size(); ++later) {
+                        batchErrors.push_back({batch[i][later].filename,
+                                               "not written, as " + batch[i][step].filename + " failed"});
+                    }
+                    batch[i].resize(step + 1);
+                }
+            }
+        }
+
+        lock.lock();
+        writing = false;
+        errors.insert(errors.end(), batchErrors.begin(), batchErrors.end());
+        if (pending.empty()) {
+            workDone.notify_all();
+        }
+    }
+    workDone.notify_all();
+}
@@ -1,13 +1,59 @@
 #include "ui/UserInterface.h"
+#include "food/FoodImporter.h"
+#include "log/LogExporter.h"
+#include "planner/MealSuggester.h"
+#include "stats/Stats.h"
+#include "storage/AsyncIo.h"
 #include <iostream>
 #include <limits>
 #include <algorithm>
+#include <charconv>
 #include <sstream>
 #include <fstream>
-
-UserInterface::UserInterface() {
+#include <chrono>
+#include <future>
+#include <iomanip>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+const char* const FOOD_DATABASE_FILE = "food_database.txt";
+const char* const USER_PROFILE_FILE = "user_profile.txt";
+const char* const FOOD_LOG_FILE = "food_log.txt";
+const char* const FOOD_FREQUENCY_FILE = "food_frequency.txt";
+const char* const FOOD_LOG_ARCHIVE_FILE = "food_log_archive.bin";
+// Catalog layers, highest precedence first. Overrides stand in for the
+// database's basic food of the same name; shared foods only fill in foods it
+// lacks. Neither is copied into the database.
+const char* const FOOD_OVERRIDES_FILE = "food_overrides.txt";
+const char* const SHARED_FOOD_CATALOG_FILE = "food_catalog.txt";
+const size_t OVERRIDES_LAYER = 0;
+const char* const WEB_FOOD_CACHE_FILE = "web_food_cache.txt";
+// Longest a food selection waits for the online catalog
+const int WEB_LOOKUP_WAIT_MS = 1500;
+
+} // namespace
+
+UserInterface::UserInterface(int archiveAfterDays, const std::string& foodApiUrl)
+    : foodDatabaseDirty(false), userProfileDirty(false), foodLogDirty(false), savedArchiveVersion(0),
+      archiveAfterDays(archiveAfterDays) {
+    foodDatabase = std::make_unique<FoodDatabase>();
+    foodCatalog = std::make_unique<FederatedCatalog>();
+    foodCatalog->addLayer("overrides", std::make_shared<FileFoodSource>(FOOD_OVERRIDES_FILE));
+    foodCatalog->addLayer("shared", std::make_shared<FileFoodSource>(SHARED_FOOD_CATALOG_FILE));
+    if (!foodApiUrl.empty()) {
+        WebFoodSourceOptions webOptions;
+        webOptions.cacheFile = WEB_FOOD_CACHE_FILE;
+        webFoods = std::make_unique<WebFoodSource>(foodApiUrl, webOptions);
+    }
     foodLog = std::make_unique<FoodLog>();
+    trendEngine = std::make_unique<TrendEngine>(*foodLog,
+        [this](const std::string& name) { return findFood(name); });
+    foodLog->setListener(trendEngine.get());
     commandManager = std::make_unique<CommandManager>();
+    persistenceWorker = std::make_unique<PersistenceWorker>();
     loadData();
 }
 
@@ -23,13 +69,19 @@ void UserInterface::run() {
         
         if (choice == "1") {
             handleFoodManagement();
+            scheduleSave();  // Auto-save in the background
         } else if (choice == "2") {
             handleLogManagement();
+            scheduleSave();
         } else if (choice == "3") {
             handleProfileManagement();
+            scheduleSave();
         } else if (choice == "4") {
-            saveData();
+            scheduleSave();
+            std::cout << "Changes are being saved in the background.\n";
         } else if (choice == "5") {
+            viewStatistics();
+        } else if (choice == "6") {
             saveData();  // Auto-save before exit
             break;
         } else {
@@ -44,7 +96,8 @@ void UserInterface::showMainMenu() {
     std::cout << "2. Log Management\n";
     std::cout << "3. Profile Management\n";
     std::cout << "4. Save All Data\n";
-    std::cout << "5. Exit\n";
+    std::cout << "5. View Statistics\n";
+    std::cout << "6. Exit\n";
 }
 
 void UserInterface::handleFoodManagement() {
@@ -54,7 +107,12 @@ void UserInterface::handleFoodManagement() {
         std::cout << "2. Add Composite Food\n";
         std::cout << "3. Search Food\n";
         std::cout << "4. List All Foods\n";
-        std::cout << "5. Back to Main Menu\n";
+        std::cout << "5. Show Recipes Using a Food\n";
+        std::cout << "6. Change Basic Food Calories\n";
+        std::cout << "7. Remove Food\n";
+        std::cout << "8. Import Foods from CSV\n";
+        std::cout << "9. Find Near-Duplicate Foods\n";
+        std::cout << "10. Back to Main Menu\n";
 
         std::string choice = getInput("Enter your choice: ");
         
@@ -67,6 +125,16 @@ void UserInterface::handleFoodManagement() {
         } else if (choice == "4") {
             listAllFoods();
         } else if (choice == "5") {
+            showWhereUsed();
+        } else if (choice == "6") {
+            changeFoodCalories();
+        } else if (choice == "7") {
+            removeFood();
+        } else if (choice == "8") {
+            importFoods();
+        } else if (choice == "9") {
+            findNearDuplicates();
+        } else if (choice == "10") {
             break;
         } else {
             std::cout << "Invalid choice. Please try again.\n";
@@ -81,7 +149,11 @@ void UserInterface::handleLogManagement() {
         std::cout << "2. Remove Food from Log\n";
         std::cout << "3. View Log for Date\n";
         std::cout << "4. Undo Last Action\n";
-        std::cout << "5. Back to Main Menu\n";
+        std::cout << "5. Suggest Meals for Remaining Calories\n";
+        std::cout << "6. View Food History\n";
+        std::cout << "7. View Trends\n";
+        std::cout << "8. Export Log\n";
+        std::cout << "9. Back to Main Menu\n";
 
         std::string choice = getInput("Enter your choice: ");
         
@@ -94,6 +166,14 @@ void UserInterface::handleLogManagement() {
         } else if (choice == "4") {
             undoLastAction();
         } else if (choice == "5") {
+            suggestMeals();
+        } else if (choice == "6") {
+            viewFoodHistory();
+        } else if (choice == "7") {
+            viewTrends();
+        } else if (choice == "8") {
+            exportLog();
+        } else if (choice == "9") {
             break;
         } else {
             std::cout << "Invalid choice. Please try again.\n";
@@ -130,6 +210,20 @@ void UserInterface::addBasicFood() {
     double calories = getNumericInput("Enter calories per serving: ");
     
     auto food = std::make_shared<BasicFood>(name, calories);
+
+    // Macros are optional; calorie-only foods work as before
+    std::string macros = getInput("Enter protein, fat, carbohydrates, fiber (g) and sodium (mg) "
+                                  "separated by spaces, or press Enter to skip: ");
+    if (!macros.empty()) {
+        Nutrients nutrients = food->getNutrients();
+        std::stringstream macroStream(macros);
+        for (size_t i = PROTEIN; i < NUTRIENT_COUNT; ++i) {
+            double value;
+            if (!(macroStream >> value)) break;
+            nutrients.values[i] = value;
+        }
+        food->setNutrients(nutrients);
+    }
     
     std::string keywords;
     std::cout << "Enter search keywords (comma-separated): ";
@@ -146,12 +240,14 @@ void UserInterface::addBasicFood() {
         }
     }
     
-    foodDatabase.push_back(food);
+    foodDatabase->addFood(food);
+    foodDatabaseDirty = true;
+    trendEngine->invalidate();
     std::cout << "Food added successfully!\n";
 }
 
 void UserInterface::addCompositeFood() {
-    if (foodDatabase.empty()) {
+    if (foodDatabase->empty() && foodCatalog->size() == 0) {
         std::cout << "No basic foods available. Please add some basic foods first.\n";
         return;
     }
@@ -160,20 +256,17 @@ void UserInterface::addCompositeFood() {
     auto compositeFood = std::make_shared<CompositeFood>(name);
 
     while (true) {
-        listAllFoods();
-        std::cout << "\nEnter food number to add (0 to finish): ";
-        size_t index;
-        std::cin >> index;
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-
-        if (index == 0) break;
-        if (index > foodDatabase.size()) {
-            std::cout << "Invalid food number.\n";
-            continue;
-        }
+        auto component = selectFood("Component food name (Enter to finish): ");
+        if (!component) break;
 
         double servings = getNumericInput("Enter number of servings: ");
-        compositeFood->addComponent(foodDatabase[index - 1], servings);
+        compositeFood->addComponent(component, servings);
+        // Recipes are saved with their components, so a catalog food used
+        // in one joins the database
+        auto basicComponent = std::dynamic_pointer_cast<BasicFood>(component);
+        if (basicComponent && !foodDatabase->findFoodByName(component->getName())) {
+            foodDatabase->addBasicFoods({basicComponent});
+        }
     }
 
     std::string keywords;
@@ -190,17 +283,38 @@ void UserInterface::addCompositeFood() {
         }
     }
 
-    foodDatabase.push_back(compositeFood);
+    foodDatabase->addFood(compositeFood);
+    foodDatabaseDirty = true;
+    trendEngine->invalidate();
     std::cout << "Composite food added successfully!\n";
 }
 
 void UserInterface::searchFood() {
-    std::string keywords = getInput("Enter search keywords: ");
-    std::cout << "Match (1) ANY or (2) ALL keywords? ";
-    std::string matchChoice = getInput("");
-    bool matchAll = (matchChoice == "2");
-    
-    auto results = searchFoodByKeywords(keywords, matchAll);
+    std::cout << "Search (1) keywords, (2) names and keywords by text or (3) best matches? ";
+    std::string modeChoice = getInput("");
+
+    std::vector<std::shared_ptr<Food>> results;
+    if (modeChoice == "3") {
+        std::string query = getInput("Enter search words (typos are tolerated): ");
+        for (const auto& ranked : foodDatabase->searchRanked(query, 10)) {
+            results.push_back(ranked.food);
+        }
+    } else if (modeChoice == "2") {
+        std::string text = getInput("Enter text to find: ");
+        std::vector<uint32_t> ids;
+        foodDatabase->searchText(text, ids);
+        for (uint32_t id : ids) {
+            if (auto food = foodDatabase->getFood(id)) {
+                results.push_back(food);
+            }
+        }
+    } else {
+        std::string keywords = getInput("Enter search keywords: ");
+        std::cout << "Match (1) ANY or (2) ALL keywords? ";
+        std::string matchChoice = getInput("");
+        bool matchAll = (matchChoice == "2");
+        results = foodDatabase->searchFoodByKeywords(keywords, matchAll);
+    }
     
     if (results.empty()) {
         std::cout << "No foods found matching your search.\n";
@@ -217,22 +331,339 @@ void UserInterface::searchFood() {
 }
 
 void UserInterface::listAllFoods() {
-    if (foodDatabase.empty()) {
-        std::cout << "No foods in database.\n";
+    // The foods findFood() resolves: the database's, as overridden, then the
+    // catalog foods it lacks
+    std::vector<std::shared_ptr<Food>> shown;
+    shown.reserve(foodDatabase->size() + foodCatalog->size());
+    for (const auto& food : foodDatabase->getFoods()) {
+        shown.push_back(findFood(food->getName()));
+    }
+    size_t databaseCount = shown.size();
+    for (const auto& entry : foodCatalog->getFoods()) {
+        if (!foodDatabase->findFoodByName(entry.food->getName())) {
+            shown.push_back(entry.food);
+        }
+    }
+    if (shown.empty()) {
+        std::cout << "No foods in database or food catalog.\n";
         return;
     }
 
     std::cout << "\nAll Foods:\n";
-    for (size_t i = 0; i < foodDatabase.size(); ++i) {
-        const auto& food = foodDatabase[i];
+    for (size_t i = 0; i < shown.size(); ++i) {
+        const auto& food = shown[i];
         std::cout << i + 1 << ". " << food->getName() 
-                 << " (" << food->getType() << ") - "
+                 << " (" << food->getType() << (i < databaseCount ? "" : ", food catalog") << ") - "
                  << food->getCaloriesPerServing() << " calories\n";
     }
 }
 
+void UserInterface::showWhereUsed() {
+    auto food = selectFood("Food name (Enter to cancel): ");
+    if (!food) return;
+
+    auto direct = foodDatabase->findUsedBy(*food, false);
+    auto all = foodDatabase->findUsedBy(*food);
+    if (all.empty()) {
+        std::cout << food->getName() << " is not used in any composite food.\n";
+        return;
+    }
+    std::cout << "\nComposite foods using " << food->getName() << ":\n";
+    for (size_t i = 0; i < all.size(); ++i) {
+        bool isDirect = i < direct.size();  // Nearest recipes come first
+        std::cout << i + 1 << ". " << all[i]->getName()
+                 << (isDirect ? "" : " (through another recipe)") << "\n";
+    }
+}
+
+void UserInterface::changeFoodCalories() {
+    auto food = selectFood("Basic food name (Enter to cancel): ");
+    if (!food) return;
+    bool inDatabase = false;
+    if (auto stored = foodDatabase->findFoodByName(food->getName())) {
+        food = stored;
+        inDatabase = true;
+    }
+    auto basicFood = std::dynamic_pointer_cast<BasicFood>(food);
+    if (!basicFood) {
+        std::cout << "Only basic foods have their own calories; composite foods follow their components.\n";
+        return;
+    }
+    // Catalog layers are read-only, and an override stands in for the
+    // database's food, so changing the database's would change nothing
+    if (foodCatalog->findLayer(food->getName()) == OVERRIDES_LAYER) {
+        std::cout << food->getName() << " is set in " << FOOD_OVERRIDES_FILE << "; change it there.\n";
+        return;
+    }
+
+    double calories = getNumericInput("Enter new calories per serving: ");
+    auto impacts = foodDatabase->previewCalorieChange(*basicFood, calories);
+    if (!impacts.empty()) {
+        const size_t maxShown = 10;
+        std::cout << "\nThis changes " << impacts.size() << " composite food(s):\n";
+        for (size_t i = 0; i < impacts.size() && i < maxShown; ++i) {
+            std::cout << impacts[i].food->getName() << ": " << impacts[i].oldCalories
+                     << " -> " << impacts[i].newCalories << " calories\n";
+        }
+        if (impacts.size() > maxShown) {
+            std::cout << "... and " << impacts.size() - maxShown << " more.\n";
+        }
+        if (getInput("Apply the change? (y/n): ") != "y") {
+            std::cout << "Calories unchanged.\n";
+            return;
+        }
+    }
+
+    if (inDatabase) {
+        foodDatabase->changeCalories(*basicFood, calories);
+    } else {
+        // A shared catalog food is copied into the database, which then
+        // takes precedence over it
+        auto copy = std::make_shared<BasicFood>(*basicFood);
+        copy->setCaloriesPerServing(calories);
+        foodDatabase->addBasicFoods({copy});
+    }
+    foodDatabaseDirty = true;
+    trendEngine->invalidate();
+    std::cout << (inDatabase ? "Calories updated.\n" : "Calories updated; the food now belongs to the food database.\n");
+}
+
+void UserInterface::removeFood() {
+    auto selected = selectFood("Food name to remove (Enter to cancel): ");
+    if (!selected) return;
+    auto food = foodDatabase->findFoodByName(selected->getName());
+    if (!food) {
+        std::cout << selected->getName() << " comes from the food catalog, which is read-only; "
+                  << "only database foods can be removed.\n";
+        return;
+    }
+
+    auto dependents = foodDatabase->findUsedBy(*food);
+    if (!dependents.empty()) {
+        std::cout << food->getName() << " is used by " << dependents.size()
+                  << " composite food(s), e.g. " << dependents.front()->getName() << ".\n";
+        if (getInput("Remove them as well? (y/n): ") != "y") {
+            std::cout << "Nothing removed.\n";
+            return;
+        }
+    }
+
+    std::vector<std::shared_ptr<Food>> removed;
+    try {
+        removed = foodDatabase->removeFood(*food, true);
+    } catch (const std::exception& e) {
+        std::cout << "Could not remove " << food->getName() << ": " << e.what() << "\n";
+        return;
+    }
+    foodDatabaseDirty = true;
+    trendEngine->invalidate();
+    std::cout << "Removed " << removed.size() << " food(s). Log entries for them are kept "
+              << "but no longer counted.\n";
+    if (foodCatalog->findLayer(food->getName()) != FederatedCatalog::NO_LAYER) {
+        std::cout << "The food catalog still has a food named " << food->getName() << ".\n";
+    }
+}
+
+// Asks the online catalog for a food the database lacks without holding up
+// the user for long; a slow answer is cached for when the name is typed again
+std::shared_ptr<Food> UserInterface::findFoodOnline(const std::string& name) {
+    if (!webFoods) {
+        return nullptr;
+    }
+    auto lookup = webFoods->lookupAsync(name);
+    if (lookup.wait_for(std::chrono::milliseconds(WEB_LOOKUP_WAIT_MS)) != std::future_status::ready) {
+        std::cout << "Still looking \"" << name << "\" up in the online food catalog; try again shortly.\n";
+        return nullptr;
+    }
+    std::shared_ptr<BasicFood> food;
+    try {
+        food = lookup.get();
+    } catch (const std::exception& e) {
+        std::cout << "Online food catalog unavailable: " << e.what() << "\n";
+        return nullptr;
+    }
+    if (!food) {
+        return nullptr;
+    }
+    foodDatabase->addBasicFoods({food});
+    foodDatabaseDirty = true;
+    trendEngine->invalidate();
+    std::cout << "Added " << food->getName() << " (" << food->getCaloriesPerServing()
+              << " calories) from the online food catalog.\n";
+    return food;
+}
+
+// Narrows the catalog by typed name prefix instead of listing every food
+std::shared_ptr<Food> UserInterface::selectFood(const std::string& prompt,
+                                                const std::vector<std::shared_ptr<Food>>& quickPicks) {
+    const size_t maxSuggestions = 10;
+    if (!quickPicks.empty()) {
+        std::cout << "\nRecent and Favourite Foods:\n";
+        for (size_t i = 0; i < quickPicks.size(); ++i) {
+            std::cout << i + 1 << ". " << quickPicks[i]->getName() << "\n";
+        }
+        std::cout << "Enter a number to pick one of these, or type a food name.\n";
+    }
+    while (true) {
+        std::string prefix = getInput(prompt);
+        if (prefix.empty()) {
+            return nullptr;
+        }
+        if (!quickPicks.empty()) {
+            // Anything but a whole number in range is taken as a name
+            size_t pick = 0;
+            auto parsed = std::from_chars(prefix.data(), prefix.data() + prefix.size(), pick);
+            if (parsed.ec == std::errc() && parsed.ptr == prefix.data() + prefix.size() &&
+                pick >= 1 && pick <= quickPicks.size()) {
+                return quickPicks[pick - 1];
+            }
+        }
+        auto matches = foodDatabase->completeName(prefix, maxSuggestions + 1);
+        if (matches.empty()) {
+            if (auto food = findFood(prefix)) {
+                std::cout << "Selected " << food->getName() << " from the food catalog.\n";
+                return food;
+            }
+            if (auto food = findFoodOnline(prefix)) {
+                return food;
+            }
+            std::cout << "No foods start with \"" << prefix << "\".\n";
+            continue;
+        }
+        if (matches.size() == 1) {
+            std::cout << "Selected " << matches[0]->getName() << ".\n";
+            return matches[0];
+        }
+
+        size_t shown = std::min(matches.size(), maxSuggestions);
+        std::cout << "\nMatching Foods:\n";
+        for (size_t i = 0; i < shown; ++i) {
+            std::cout << i + 1 << ". " << matches[i]->getName()
+                     << " (" << matches[i]->getType() << ") - "
+                     << matches[i]->getCaloriesPerServing() << " calories\n";
+        }
+        if (matches.size() > shown) {
+            std::cout << "... more foods match; type more of the name to narrow the list.\n";
+        }
+        std::string choice = getInput("Enter food number (Enter to search again): ");
+        size_t index = 0;
+        std::stringstream(choice) >> index;
+        if (index >= 1 && index <= shown) {
+            return matches[index - 1];
+        }
+        if (!choice.empty()) {
+            std::cout << "Invalid food number.\n";
+        }
+    }
+}
+
+void UserInterface::importFoods() {
+    std::string filename = getInput("CSV file to import (Enter to cancel): ");
+    if (filename.empty()) {
+        return;
+    }
+    ImportOptions options;
+    options.threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string policy = getInput("Foods near-identical to existing ones: (1) import, (2) import and list, "
+                                  "or (3) skip? [2]: ");
+    options.nearDuplicates = policy == "1" ? NearDuplicatePolicy::KEEP
+                           : policy == "3" ? NearDuplicatePolicy::MERGE : NearDuplicatePolicy::FLAG;
+    int lastPercent = -1;
+    auto showProgress = [&lastPercent](const ImportProgress& progress) {
+        int percent = progress.totalBytes ? static_cast<int>(progress.bytesDone * 100 / progress.totalBytes) : 100;
+        if (percent == lastPercent) return;
+        lastPercent = percent;
+        std::cout << "\rImporting... " << percent << "% (" << progress.imported << " added, "
+                  << progress.rejected << " rejected)" << std::flush;
+    };
+
+    ImportReport report;
+    try {
+        FoodImporter importer(*foodDatabase);
+        report = importer.importFile(filename, options, showProgress);
+    } catch (const std::exception& e) {
+        if (lastPercent >= 0) std::cout << "\n";
+        std::cout << "Import failed: " << e.what() << "\n";
+        return;
+    }
+    if (lastPercent >= 0) std::cout << "\n";
+    std::cout << "Imported " << report.imported << " food(s); " << report.rejected << " row(s) rejected.\n";
+    for (const auto& row : report.rejectedRows) {
+        std::cout << "  Line " << row.line << ": " << row.reason << "\n";
+    }
+    if (report.rejected > report.rejectedRows.size()) {
+        std::cout << "  ... and " << report.rejected - report.rejectedRows.size() << " more\n";
+    }
+    if (report.nearDuplicates > 0) {
+        std::cout << report.nearDuplicates << " row(s) resemble an existing food"
+                  << (options.nearDuplicates == NearDuplicatePolicy::MERGE ? " and were skipped" : "") << ":\n";
+        for (const auto& row : report.nearDuplicateRows) {
+            std::cout << "  Line " << row.line << ": " << row.name << " ~ " << row.similarTo << "\n";
+        }
+        if (report.nearDuplicates > report.nearDuplicateRows.size()) {
+            std::cout << "  ... and " << report.nearDuplicates - report.nearDuplicateRows.size() << " more\n";
+        }
+    }
+    if (report.imported > 0) {
+        foodDatabaseDirty = true;
+        trendEngine->invalidate();
+    }
+}
+
+void UserInterface::findNearDuplicates() {
+    const size_t MAX_LISTED_GROUPS = 20;
+    auto groups = foodDatabase->findNearDuplicates();
+    if (groups.empty()) {
+        std::cout << "No near-duplicate foods found.\n";
+        return;
+    }
+    std::cout << "\n" << groups.size() << " group(s) of near-identical foods:\n";
+    for (size_t i = 0; i < groups.size() && i < MAX_LISTED_GROUPS; ++i) {
+        std::cout << i + 1 << ". ";
+        for (size_t j = 0; j < groups[i].size(); ++j) {
+            std::cout << (j ? " ~ " : "") << groups[i][j]->getName() << " ("
+                      << groups[i][j]->getCaloriesPerServing() << " cal)";
+        }
+        std::cout << "\n";
+    }
+    if (groups.size() > MAX_LISTED_GROUPS) {
+        std::cout << "... and " << groups.size() - MAX_LISTED_GROUPS << " more\n";
+    }
+
+    // The first food of a group stands in for the rest; history that names
+    // a duplicate is left alone, so only unused duplicates can go
+    std::vector<std::shared_ptr<Food>> removable;
+    for (const auto& group : groups) {
+        for (size_t j = 1; j < group.size(); ++j) {
+            if (foodDatabase->findUsedBy(*group[j], false).empty() &&
+                foodLog->getDatesWithFood(group[j]->getName()).empty()) {
+                removable.push_back(group[j]);
+            }
+        }
+    }
+    if (removable.empty()) {
+        std::cout << "Every duplicate is used by a recipe or the log, so none were removed.\n";
+        return;
+    }
+    std::string confirm = getInput("Remove " + std::to_string(removable.size()) +
+                                   " duplicate(s) never logged or used in a recipe, keeping the first of each group? (y/n): ");
+    if (confirm != "y" && confirm != "Y") {
+        std::cout << "Nothing removed.\n";
+        return;
+    }
+    try {
+        foodDatabase->removeFoods(removable);
+    } catch (const std::exception& e) {
+        std::cout << "Could not remove the duplicates: " << e.what() << "\n";
+        return;
+    }
+    foodDatabaseDirty = true;
+    trendEngine->invalidate();
+    std::cout << "Removed " << removable.size() << " duplicate(s).\n";
+}
+
 void UserInterface::addFoodToLog() {
-    if (foodDatabase.empty()) {
+    if (foodDatabase->empty() && foodCatalog->size() == 0) {
         std::cout << "No foods available. Please add some foods first.\n";
         return;
     }
@@ -242,14 +673,15 @@ void UserInterface::addFoodToLog() {
         date = FoodLog::getCurrentDate();
     }
 
-    listAllFoods();
-    std::cout << "\nEnter food number to add to log: ";
-    size_t index;
-    std::cin >> index;
-    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-
-    if (index < 1 || index > foodDatabase.size()) {
-        std::cout << "Invalid food number.\n";
+    // Foods logged often or lately, skipping any no longer in the database
+    std::vector<std::shared_ptr<Food>> quickPicks;
+    for (const auto& name : foodLog->getFrequency().getQuickPicks(8)) {
+        if (auto food = findFood(name)) {
+            quickPicks.push_back(food);
+        }
+    }
+    auto food = selectFood("Food name (Enter to cancel): ", quickPicks);
+    if (!food) {
         return;
     }
 
@@ -261,7 +693,7 @@ void UserInterface::addFoodToLog() {
         std::cout << "\nCurrent entries for " << date << ":\n";
         for (size_t i = 0; i < entries.size(); ++i) {
             const auto& entry = entries[i];
-            auto food = findFoodByName(entry.foodId);
+            auto food = findFood(entry.foodId);
             if (food) {
                 std::cout << i + 1 << ". " << food->getName() 
                          << " - " << entry.servings << " serving(s)\n";
@@ -270,13 +702,14 @@ void UserInterface::addFoodToLog() {
     }
 
     // Create a command that includes the date
-    auto command = std::make_unique<AddFoodCommand>(*foodLog, foodDatabase[index - 1], servings, date);
+    auto command = std::make_unique<AddFoodCommand>(*foodLog, food, servings, date);
     commandManager->executeCommand(std::move(command));
+    foodLogDirty = true;
     std::cout << "Food added to log for " << date << " successfully!\n";
 
     // Show updated total calories
     auto foodLookup = [this](const std::string& name) -> std::shared_ptr<Food> {
-        return findFoodByName(name);
+        return findFood(name);
     };
     double totalCalories = foodLog->getTotalCaloriesForDate(date, foodLookup);
     std::cout << "Total calories for " << date << ": " << totalCalories;
@@ -303,7 +736,7 @@ void UserInterface::removeFoodFromLog() {
     std::cout << "\nEntries for " << date << ":\n";
     for (size_t i = 0; i < entries.size(); ++i) {
         const auto& entry = entries[i];
-        auto food = findFoodByName(entry.foodId);
+        auto food = findFood(entry.foodId);
         if (food) {
             std::cout << i + 1 << ". " << food->getName() 
                      << " - " << entry.servings << " serving(s)\n";
@@ -321,7 +754,7 @@ void UserInterface::removeFoodFromLog() {
     }
 
     // Get the original food object for the entry being removed
-    auto originalFood = findFoodByName(entries[index - 1].foodId);
+    auto originalFood = findFood(entries[index - 1].foodId);
     if (!originalFood) {
         std::cout << "Error: Could not find the food in database.\n";
         return;
@@ -329,6 +762,7 @@ void UserInterface::removeFoodFromLog() {
 
     auto command = std::make_unique<RemoveFoodCommand>(*foodLog, index - 1, originalFood, date);
     commandManager->executeCommand(std::move(command));
+    foodLogDirty = true;
     std::cout << "Entry removed successfully!\n";
 }
 
@@ -347,7 +781,7 @@ void UserInterface::viewLogForDate() {
     std::cout << "\nFood Log for " << date << ":\n";
     for (size_t i = 0; i < entries.size(); ++i) {
         const auto& entry = entries[i];
-        auto food = findFoodByName(entry.foodId);
+        auto food = findFood(entry.foodId);
         if (food) {
             std::cout << i + 1 << ". " << food->getName() 
                      << " - " << entry.servings << " serving(s) - "
@@ -356,7 +790,7 @@ void UserInterface::viewLogForDate() {
     }
 
     auto foodLookup = [this](const std::string& name) -> std::shared_ptr<Food> {
-        return findFoodByName(name);
+        return findFood(name);
     };
 
     double totalCalories = foodLog->getTotalCaloriesForDate(date, foodLookup);
@@ -366,17 +800,214 @@ void UserInterface::viewLogForDate() {
         std::cout << "Target calories: " << targetCalories << "\n";
         std::cout << "Difference: " << (totalCalories - targetCalories) << "\n";
     }
+
+    Nutrients totals = foodLog->getTotalNutrientsForDate(date, foodLookup);
+    if (totals.hasMacros()) {
+        std::cout << "Nutrients:";
+        for (size_t i = PROTEIN; i < NUTRIENT_COUNT; ++i) {
+            Nutrient nutrient = static_cast<Nutrient>(i);
+            std::cout << (i == PROTEIN ? " " : ", ") << Nutrients::getName(nutrient) << " "
+                     << totals[nutrient] << " " << Nutrients::getUnit(nutrient);
+        }
+        std::cout << "\n";
+    }
 }
 
 void UserInterface::undoLastAction() {
     if (commandManager->canUndo()) {
         commandManager->undo();
+        foodLogDirty = true;
         std::cout << "Last action undone.\n";
     } else {
         std::cout << "No actions to undo.\n";
     }
 }
 
+void UserInterface::viewFoodHistory() {
+    auto food = selectFood("Food name (Enter to cancel): ");
+    if (!food) return;
+
+    auto dates = foodLog->getDatesWithFood(food->getName());
+    if (dates.empty()) {
+        std::cout << food->getName() << " has not been logged yet.\n";
+        return;
+    }
+    std::cout << "\n" << food->getName() << " was logged on " << dates.size()
+              << " day(s), most recently " << dates.back() << ".\n";
+
+    // Month by month over the past year
+    std::string today = FoodLog::getCurrentDate();
+    DayNumber todayNumber;
+    if (FoodDayIndex::parseDay(today, todayNumber)) {
+        std::string yearAgo = FoodDayIndex::formatDay(todayNumber - 364);
+        std::cout << "Days per month since " << yearAgo << ":\n";
+        for (const auto& bin : foodLog->getFoodHistogram(food->getName(), yearAgo, today, HistogramBucket::MONTH)) {
+            std::cout << bin.first.substr(0, 7) << ": " << bin.second << "\n";
+        }
+    }
+
+    auto other = selectFood("Compare with another food (Enter to skip): ");
+    if (!other) return;
+    auto together = foodLog->getDatesWithAllFoods({food->getName(), other->getName()});
+    std::cout << food->getName() << " and " << other->getName() << " were logged together on "
+              << together.size() << " day(s)";
+    if (!together.empty()) {
+        const size_t maxShown = 5;
+        size_t first = together.size() > maxShown ? together.size() - maxShown : 0;
+        std::cout << ", most recently";
+        for (size_t i = together.size(); i-- > first;) {
+            std::cout << (i + 1 == together.size() ? " " : ", ") << together[i];
+        }
+    }
+    std::cout << ".\n";
+}
+
+void UserInterface::viewTrends() {
+    if (!userProfile) {
+        std::cout << "Please create a profile first so there is a calorie target.\n";
+        return;
+    }
+    double target = userProfile->getTargetCalories();
+    std::string today = FoodLog::getCurrentDate();
+    auto summary = trendEngine->getSummary(today, target);
+    if (summary.loggedDays == 0) {
+        std::cout << "Nothing has been logged yet.\n";
+        return;
+    }
+
+    std::cout << "\nTrends (target " << target << " calories per day):\n";
+    for (size_t w = 0; w < TrendEngine::WINDOW_DAYS.size(); ++w) {
+        std::cout << TrendEngine::WINDOW_DAYS[w] << "-day average: " << summary.averages[w] << " calories\n";
+    }
+    std::cout << "Cumulative deficit over " << summary.loggedDays << " logged day(s): "
+              << summary.cumulativeDeficit << " calories\n";
+    std::cout << "Days on target in a row: " << summary.streak << "\n";
+
+    DayNumber todayNumber;
+    if (!FoodDayIndex::parseDay(today, todayNumber)) return;
+    std::cout << "\nLast 14 days (calories, 7-day average):\n";
+    for (const auto& point : trendEngine->getSeries(FoodDayIndex::formatDay(todayNumber - 13), today, target)) {
+        std::cout << point.date << ": ";
+        if (point.logged) {
+            std::cout << point.calories;
+        } else {
+            std::cout << "-";
+        }
+        std::cout << ", " << point.averages[0] << "\n";
+    }
+
+    // Whole years come mostly from archived rollups
+    std::string firstDate = foodLog->getFirstDate();
+    DayNumber firstDay;
+    if (!FoodDayIndex::parseDay(firstDate, firstDay)) return;
+    auto foodLookup = [this](const std::string& name) { return findFood(name); };
+    std::cout << "\nCalories per logged day by year:\n";
+    for (int year = std::stoi(firstDate.substr(0, 4)); year <= std::stoi(today.substr(0, 4)); ++year) {
+        std::string yearText = std::to_string(year);
+        auto totals = foodLog->getLoggedTotals(yearText + "-01-01", yearText + "-12-31", foodLookup);
+        std::cout << year << ": ";
+        if (totals.days > 0) {
+            std::cout << totals.calories / totals.days << " over " << totals.days << " day(s)\n";
+        } else {
+            std::cout << "-\n";
+        }
+    }
+}
+
+void UserInterface::exportLog() {
+    std::string fromDate = getInput("Export from date (YYYY-MM-DD) or press Enter for the first logged day: ");
+    if (fromDate.empty()) {
+        fromDate = foodLog->getFirstDate();
+        if (fromDate.empty()) {
+            std::cout << "Nothing has been logged yet.\n";
+            return;
+        }
+    }
+    std::string toDate = getInput("Export to date (YYYY-MM-DD) or press Enter for today: ");
+    if (toDate.empty()) {
+        toDate = FoodLog::getCurrentDate();
+    }
+    ExportOptions options;
+    std::string format = getInput("Export as (1) CSV or (2) JSON Lines? ");
+    options.format = format == "2" ? ExportFormat::JSON_LINES : ExportFormat::CSV;
+    std::string defaultName = options.format == ExportFormat::CSV ? "food_log_export.csv" : "food_log_export.jsonl";
+    std::string filename = getInput("File name (Enter for " + defaultName + "): ");
+    if (filename.empty()) {
+        filename = defaultName;
+    }
+    options.threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cout << "Could not open " << filename << " for writing.\n";
+        return;
+    }
+    try {
+        LogExporter exporter(*foodLog,
+            [this](const std::string& name) { return findFood(name); });
+        size_t rows = exporter.exportRange(fromDate, toDate, file, options);
+        std::cout << "Exported " << rows << " entries to " << filename << ".\n";
+    } catch (const std::exception& e) {
+        std::cout << "Export failed: " << e.what() << "\n";
+    }
+}
+
+void UserInterface::suggestMeals() {
+    if (!userProfile) {
+        std::cout << "Please create a profile first.\n";
+        return;
+    }
+    std::string date = getInput("Enter date (YYYY-MM-DD) or press Enter for today: ");
+    if (date.empty()) {
+        date = FoodLog::getCurrentDate();
+    }
+
+    auto foodLookup = [this](const std::string& name) -> std::shared_ptr<Food> {
+        return findFood(name);
+    };
+    Nutrients eaten = foodLog->getTotalNutrientsForDate(date, foodLookup);
+    double remaining = userProfile->getTargetCalories() - eaten[CALORIES];
+    if (remaining <= 0.0) {
+        std::cout << "The calorie target for " << date << " is already reached.\n";
+        return;
+    }
+
+    MealRequest request;
+    request.calories = remaining;
+    std::string protein = getInput("Protein still wanted (g), or press Enter to skip: ");
+    if (!protein.empty()) {
+        try {
+            request.nutrientTargets[PROTEIN] = std::stod(protein);
+        } catch (...) {
+            std::cout << "Invalid number; ignoring protein.\n";
+        }
+    }
+
+    MealSuggester suggester(*foodDatabase);
+    auto plans = suggester.suggest(request);
+    if (plans.empty()) {
+        std::cout << "No combination of foods fits the remaining " << remaining << " calories.\n";
+        return;
+    }
+
+    std::cout << "\nSuggestions for the remaining " << remaining << " calories:\n";
+    for (size_t i = 0; i < plans.size(); ++i) {
+        const auto& plan = plans[i];
+        std::cout << i + 1 << ". ";
+        for (size_t j = 0; j < plan.items.size(); ++j) {
+            std::cout << (j ? " + " : "") << plan.items[j].second << " x " << plan.items[j].first->getName();
+        }
+        std::cout << " = " << plan.totals[CALORIES] << " calories";
+        if (plan.totals[PROTEIN] > 0.0) {
+            std::cout << ", " << plan.totals[PROTEIN] << " g protein";
+        }
+        std::cout << "\n";
+    }
+    if (suggester.wasTruncated()) {
+        std::cout << "(Search stopped at its time limit; these are the best found.)\n";
+    }
+}
+
 void UserInterface::createProfile() {
     std::cout << "\nCreate User Profile\n";
     
@@ -427,6 +1058,7 @@ void UserInterface::createProfile() {
         default: method = CalorieCalculationMethod::AVERAGE_OF_BOTH;
     }
     userProfile->setCalculationMethod(method);
+    userProfileDirty = true;
 
     std::cout << "Profile created successfully!\n";
 }
@@ -469,8 +1101,12 @@ void UserInterface::updateProfile() {
             default: level = ActivityLevel::SEDENTARY;
         }
         userProfile->setActivityLevel(level);
+    } else {
+        std::cout << "Invalid choice. Profile unchanged.\n";
+        return;
     }
 
+    userProfileDirty = true;
     std::cout << "Profile updated successfully!\n";
 }
 
@@ -528,9 +1164,20 @@ void UserInterface::changeCalculationMethod() {
     }
 
     userProfile->setCalculationMethod(method);
+    userProfileDirty = true;
     std::cout << "Calculation method updated successfully!\n";
 }
 
+void UserInterface::viewStatistics() {
+    if (!Stats::isEnabled()) {
+        std::cout << "Statistics are not available in this build. "
+                  << "Rebuild with -DYADA_ENABLE_STATS to enable them.\n";
+        return;
+    }
+    std::cout << "\nSession Statistics\n";
+    Stats::instance().writeText(std::cout);
+}
+
 std::string UserInterface::getInput(const std::string& prompt) {
     std::cout << prompt;
     std::string input;
@@ -551,190 +1198,244 @@ double UserInterface::getNumericInput(const std::string& prompt) {
     }
 }
 
-std::vector<std::shared_ptr<Food>> UserInterface::searchFoodByKeywords(const std::string& keywords, bool matchAll) {
-    std::vector<std::shared_ptr<Food>> results;
-    std::stringstream ss(keywords);
-    std::string keyword;
-    std::vector<std::string> searchTerms;
-    
-    while (std::getline(ss, keyword, ' ')) {
-        if (!keyword.empty()) {
-            // Convert to lowercase for case-insensitive search
-            std::transform(keyword.begin(), keyword.end(), keyword.begin(), ::tolower);
-            searchTerms.push_back(keyword);
-        }
-    }
-
-    for (const auto& food : foodDatabase) {
-        const auto& foodKeywords = food->getKeywords();
-        bool isMatch = matchAll;  // For matchAll=true, start true and AND results
-                                 // For matchAll=false, start false and OR results
-        
-        for (const auto& term : searchTerms) {
-            bool termFound = false;
-            for (auto foodKeyword : foodKeywords) {
-                // Convert to lowercase for comparison
-                std::transform(foodKeyword.begin(), foodKeyword.end(), foodKeyword.begin(), ::tolower);
-                if (foodKeyword.find(term) != std::string::npos) {
-                    termFound = true;
-                    break;
-                }
-            }
-            
-            if (matchAll) {
-                isMatch = isMatch && termFound;  // ALL keywords must match
-                if (!isMatch) break;  // Early exit if any keyword doesn't match
-            } else {
-                isMatch = isMatch || termFound;  // ANY keyword can match
-                if (isMatch) break;  // Early exit if any keyword matches
-            }
-        }
-        
-        if (isMatch) {
-            results.push_back(food);
-        }
-    }
-
-    return results;
-}
-
 void UserInterface::saveData() {
-    try {
-        saveFoodDatabase("food_database.txt");
-        saveUserProfile("user_profile.txt");
-        foodLog->saveToFile("food_log.txt");
+    scheduleSave();
+    persistenceWorker->flush();
+    if (!reportSaveErrors()) {
         std::cout << "Data saved successfully!\n";
-    } catch (const std::exception& e) {
-        std::cerr << "Error saving data: " << e.what() << "\n";
     }
 }
 
-void UserInterface::loadData() {
+void UserInterface::scheduleSave() {
+    YADA_STATS_TIMER("ui.save_point");
+    // Serialize only the stores that changed; the worker does the disk I/O
+    reportSaveErrors();
     try {
-        loadFoodDatabase("food_database.txt");
-        loadUserProfile("user_profile.txt");
-        foodLog->loadFromFile("food_log.txt");
-        std::cout << "Data loaded successfully!\n";
+        if (foodDatabaseDirty) {
+            std::ostringstream out;
+            foodDatabase->writeTo(out);
+            persistenceWorker->submit(FOOD_DATABASE_FILE, out.str());
+            foodDatabaseDirty = false;
+        }
+        if (userProfileDirty && userProfile) {
+            std::ostringstream out;
+            writeUserProfile(out);
+            persistenceWorker->submit(USER_PROFILE_FILE, out.str());
+            userProfileDirty = false;
+        }
+        if (foodLogDirty) {
+            // The log no longer holds archived days, so a changed archive
+            // must be on disk before the log is replaced
+            std::vector<FileWrite> logWrites;
+            if (foodLog->getArchiveVersion() != savedArchiveVersion) {
+                std::ostringstream archiveOut;
+                foodLog->writeArchiveTo(archiveOut);
+                logWrites.push_back({FOOD_LOG_ARCHIVE_FILE, archiveOut.str()});
+                savedArchiveVersion = foodLog->getArchiveVersion();
+            }
+            std::ostringstream out;
+            foodLog->writeTo(out);
+            logWrites.push_back({FOOD_LOG_FILE, out.str()});
+            persistenceWorker->submit(std::move(logWrites));
+            std::ostringstream frequencyOut;
+            foodLog->writeFrequencyTo(frequencyOut);
+            persistenceWorker->submit(FOOD_FREQUENCY_FILE, frequencyOut.str());
+            foodLogDirty = false;
+        }
     } catch (const std::exception& e) {
-        std::cout << "No previous data found. Starting fresh.\n";
+        std::cerr << "Error saving data: " << e.what() << "\n";
     }
 }
 
-void UserInterface::saveFoodDatabase(const std::string& filename) const {
-    std::ofstream file(filename);
-    if (!file) {
-        throw std::runtime_error("Could not open file for writing: " + filename);
-    }
-
-    for (const auto& food : foodDatabase) {
-        file << food->getType() << "|" << food->getName() << "|" << food->getCaloriesPerServing();
-        
-        // Save keywords
-        const auto& keywords = food->getKeywords();
-        file << "|" << keywords.size();
-        for (const auto& keyword : keywords) {
-            file << "|" << keyword;
-        }
-
-        // Save components for composite foods
-        if (food->getType() == "Composite") {
-            auto compositeFood = std::dynamic_pointer_cast<CompositeFood>(food);
-            const auto& components = compositeFood->getComponents();
-            file << "|" << components.size();
-            for (const auto& comp : components) {
-                const auto& component = comp.first;
-                const auto& servings = comp.second;
-                file << "|" << component->getName() << "|" << servings;
-            }
+bool UserInterface::reportSaveErrors() {
+    auto errors = persistenceWorker->takeErrors();
+    for (const auto& error : errors) {
+        std::cerr << "Error saving data: " << error.message << "\n";
+        // Mark the store dirty again so the next save point retries it
+        if (error.filename == FOOD_DATABASE_FILE) {
+            foodDatabaseDirty = true;
+        } else if (error.filename == USER_PROFILE_FILE) {
+            userProfileDirty = true;
+        } else if (error.filename == FOOD_LOG_FILE || error.filename == FOOD_FREQUENCY_FILE) {
+            foodLogDirty = true;
+        } else if (error.filename == FOOD_LOG_ARCHIVE_FILE) {
+            foodLogDirty = true;
+            savedArchiveVersion = std::numeric_limits<size_t>::max();  // Matches no version, so it is rewritten
         }
-        file << "\n";
     }
+    return !errors.empty();
 }
 
-void UserInterface::loadFoodDatabase(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file) {
-        throw std::runtime_error("Could not open file for reading: " + filename);
-    }
+void UserInterface::loadData() {
+    YADA_STATS_TIMER("ui.load_data");
+    using Clock = std::chrono::steady_clock;
+    auto startTime = Clock::now();
+
+    // The three stores are independent on disk, so read them concurrently.
+    // Each task touches only its own member and reports its own outcome.
+    auto foodTask = std::async(std::launch::async, [this] {
+        return loadStore("food database", FOOD_DATABASE_FILE,
+                         [this] { foodDatabase->loadFromFile(FOOD_DATABASE_FILE); });
+    });
+    auto profileTask = std::async(std::launch::async, [this] {
+        return loadStore("user profile", USER_PROFILE_FILE,
+                         [this] { loadUserProfile(USER_PROFILE_FILE); });
+    });
+    auto logTask = std::async(std::launch::async, [this] {
+        return loadStore("food log", FOOD_LOG_FILE,
+                         [this] {
+            if (std::ifstream(FOOD_LOG_ARCHIVE_FILE)) {
+                foodLog->loadArchiveFromFile(FOOD_LOG_ARCHIVE_FILE);
+            }
+            foodLog->loadFromFile(FOOD_LOG_FILE);
+            // Quick-pick counts are derived; if unreadable the log rebuilds them
+            try {
+                foodLog->loadFrequencyFromFile(FOOD_FREQUENCY_FILE);
+            } catch (const std::exception&) {
+            }
+        });
+    });
 
-    foodDatabase.clear();
-    std::string line;
-    std::map<std::string, std::vector<std::pair<std::string, double>>> pendingComposites;
+    auto catalogTask = std::async(std::launch::async, [this]() -> std::string {
+        try {
+            foodCatalog->load();
+        } catch (const std::exception& e) {
+            return e.what();
+        }
+        return "";
+    });
 
-    while (std::getline(file, line)) {
-        std::stringstream ss(line);
-        std::string type, name;
-        double calories;
-        size_t keywordCount;
+    std::vector<LoadResult> results = {foodTask.get(), profileTask.get(), logTask.get()};
+    std::string catalogError = catalogTask.get();
 
-        std::getline(ss, type, '|');
-        std::getline(ss, name, '|');
-        ss >> calories;
-        ss.ignore();
-        ss >> keywordCount;
-        ss.ignore();
+    std::pair<size_t, size_t> catalogCounts(0, 0);
+    if (catalogError.empty() && foodCatalog->size() > 0) {
+        catalogCounts = countCatalogFoods();
+    }
 
-        std::shared_ptr<Food> food;
-        if (type == "Basic") {
-            food = std::make_shared<BasicFood>(name, calories);
+    // Log entries refer to foods by name; bind them once the database is ready
+    auto bindStart = Clock::now();
+    std::vector<std::string> unknownFoods;
+    if (results[0].status == LoadStatus::LOADED && results[2].status == LoadStatus::LOADED) {
+        std::unordered_set<std::string> knownNames;
+        for (const auto& food : foodDatabase->getFoods()) {
+            knownNames.insert(food->getName());
+        }
+        unknownFoods = foodLog->findUnknownFoods([this, &knownNames](const std::string& name) {
+            return knownNames.count(name) > 0 || foodCatalog->findFood(name) != nullptr;
+        });
+    }
+    savedArchiveVersion = foodLog->getArchiveVersion();
+
+    // Retention: archived days need the foods to fix their calories
+    size_t archivedDays = 0;
+    std::string archiveCutoff;
+    DayNumber today;
+    if (archiveAfterDays > 0 && results[0].status == LoadStatus::LOADED &&
+        results[2].status == LoadStatus::LOADED && FoodDayIndex::parseDay(FoodLog::getCurrentDate(), today)) {
+        archiveCutoff = FoodDayIndex::formatDay(today - archiveAfterDays);
+        archivedDays = foodLog->archiveBefore(archiveCutoff,
+            [this](const std::string& name) { return findFood(name); });
+        if (archivedDays > 0) {
+            foodLogDirty = true;
+        }
+    }
+    auto endTime = Clock::now();
+
+    bool anyLoaded = false;
+    for (const auto& result : results) {
+        if (result.status == LoadStatus::LOADED) {
+            anyLoaded = true;
+        } else if (result.status == LoadStatus::MISSING) {
+            std::cout << "No saved " << result.store << " found. Starting fresh.\n";
         } else {
-            food = std::make_shared<CompositeFood>(name);
+            std::cout << "Could not load " << result.store << ": " << result.error << "\n";
         }
+    }
+    if (!catalogError.empty()) {
+        std::cout << "Could not load food catalog sources: " << catalogError << "\n";
+    }
+    if (catalogCounts.first > 0 || catalogCounts.second > 0) {
+        std::cout << "Food catalog sources: " << catalogCounts.first << " food(s) beyond the database, "
+                  << catalogCounts.second << " overriding it.\n";
+    }
+    const auto& dangling = foodDatabase->getDanglingComponents();
+    if (!dangling.empty()) {
+        std::cout << "Warning: " << dangling.size() << " composite food component(s) refer to foods "
+                  << "missing from the database and were left out (e.g. \"" << dangling.front().componentName
+                  << "\" in \"" << dangling.front().compositeName << "\").\n";
+    }
+    if (!unknownFoods.empty()) {
+        std::cout << "Warning: food log refers to " << unknownFoods.size()
+                  << " food(s) missing from the database (e.g. \"" << unknownFoods.front() << "\").\n";
+    }
+    if (archivedDays > 0) {
+        std::cout << "Archived " << archivedDays << " day(s) of food log before " << archiveCutoff << ".\n";
+    }
+    if (anyLoaded) {
+        std::cout << "Data loaded successfully!\n";
+    }
 
-        // Load keywords
-        for (size_t i = 0; i < keywordCount; ++i) {
-            std::string keyword;
-            std::getline(ss, keyword, '|');
-            food->addKeyword(keyword);
-        }
+    std::ostringstream timings;
+    timings << std::fixed << std::setprecision(1)
+            << "Startup: food database " << results[0].milliseconds << " ms, "
+            << "profile " << results[1].milliseconds << " ms, "
+            << "log " << results[2].milliseconds << " ms, "
+            << "binding " << std::chrono::duration<double, std::milli>(endTime - bindStart).count() << " ms, "
+            << "total " << std::chrono::duration<double, std::milli>(endTime - startTime).count() << " ms"
+            << " (" << AsyncIo::instance().getBackendName() << " I/O)\n";
+    std::cout << timings.str();
+}
 
-        // Handle composite food components
-        if (type == "Composite") {
-            size_t componentCount;
-            ss >> componentCount;
-            ss.ignore();
-
-            std::vector<std::pair<std::string, double>> components;
-            for (size_t i = 0; i < componentCount; ++i) {
-                std::string componentName;
-                double servings;
-                std::getline(ss, componentName, '|');
-                ss >> servings;
-                ss.ignore();
-                components.emplace_back(componentName, servings);
-            }
-            pendingComposites[name] = components;
-        }
+std::shared_ptr<Food> UserInterface::findFood(const std::string& name) const {
+    auto food = foodDatabase->findFoodByName(name);
+    if (food && food->getType() == "Composite") {
+        return food;  // Composite foods follow their components
+    }
+    size_t layer = foodCatalog->findLayer(name);
+    if (layer == OVERRIDES_LAYER || (!food && layer != FederatedCatalog::NO_LAYER)) {
+        return foodCatalog->findFood(name);
+    }
+    return food;
+}
 
-        foodDatabase.push_back(food);
+std::pair<size_t, size_t> UserInterface::countCatalogFoods() const {
+    YADA_STATS_TIMER("ui.count_catalog_foods");
+    size_t extra = 0;
+    size_t overriding = 0;
+    for (const auto& entry : foodCatalog->getFoods()) {
+        auto food = foodDatabase->findFoodByName(entry.food->getName());
+        if (!food) {
+            ++extra;
+        } else if (entry.layer == OVERRIDES_LAYER && food->getType() != "Composite") {
+            ++overriding;
+        }
     }
+    return {extra, overriding};
+}
 
-    // Resolve composite food components
-    for (const auto& pending : pendingComposites) {
-        const auto& compositeName = pending.first;
-        const auto& components = pending.second;
-        auto compositeFood = std::dynamic_pointer_cast<CompositeFood>(findFoodByName(compositeName));
-        if (compositeFood) {
-            for (const auto& comp : components) {
-                const auto& componentName = comp.first;
-                const auto& servings = comp.second;
-                auto componentFood = findFoodByName(componentName);
-                if (componentFood) {
-                    compositeFood->addComponent(componentFood, servings);
-                }
-            }
+UserInterface::LoadResult UserInterface::loadStore(const std::string& store, const std::string& filename,
+    const std::function<void()>& load) {
+    auto startTime = std::chrono::steady_clock::now();
+    LoadResult result{store, LoadStatus::LOADED, "", 0.0};
+    if (!std::ifstream(filename)) {
+        result.status = LoadStatus::MISSING;
+    } else {
+        try {
+            load();
+        } catch (const std::exception& e) {
+            result.status = LoadStatus::FAILED;
+            result.error = e.what();
         }
     }
+    result.milliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - startTime).count();
+    return result;
 }
 
-void UserInterface::saveUserProfile(const std::string& filename) const {
+void UserInterface::writeUserProfile(std::ostream& file) const {
     if (!userProfile) return;
 
-    std::ofstream file(filename);
-    if (!file) {
-        throw std::runtime_error("Could not open file for writing: " + filename);
-    }
-
     file << (userProfile->getGender() == Gender::MALE ? "M" : "F") << "|"
          << userProfile->getHeight() << "|"
          << userProfile->getAge() << "|"
@@ -751,6 +1452,7 @@ void UserInterface::loadUserProfile(const std::string& filename) {
 
     std::string line;
     if (std::getline(file, line)) {
+        YADA_STATS_COUNT("user_profile.bytes_read", line.size() + 1);
         std::stringstream ss(line);
         std::string genderStr;
         double height, weight;
@@ -766,6 +1468,9 @@ void UserInterface::loadUserProfile(const std::string& filename) {
         ss >> activityLevel;
         ss.ignore();
         ss >> methodLevel;
+        if (ss.fail()) {
+            throw std::runtime_error("Malformed profile in " + filename);
+        }
 
         Gender gender = (genderStr == "M") ? Gender::MALE : Gender::FEMALE;
         userProfile = std::make_unique<UserProfile>(gender, height, age);
@@ -773,10 +1478,4 @@ void UserInterface::loadUserProfile(const std::string& filename) {
         userProfile->setActivityLevel(static_cast<ActivityLevel>(activityLevel));
         userProfile->setCalculationMethod(static_cast<CalorieCalculationMethod>(methodLevel));
     }
-}
-
-std::shared_ptr<Food> UserInterface::findFoodByName(const std::string& name) const {
-    auto it = std::find_if(foodDatabase.begin(), foodDatabase.end(),
-        [&name](const auto& food) { return food->getName() == name; });
-    return (it != foodDatabase.end()) ? *it : nullptr;
 } 
\ No newline at end of file
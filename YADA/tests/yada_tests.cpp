@@ -0,0 +1,494 @@
+// Tests for yada's lock-free catalog, the log archive and day index, the
+// search kernels and the binary and export encodings.
+//
+// Each check that fails prints its file, line and expression to stderr; the
+// exit status is the number of failed checks (capped at 255), so zero means
+// every check passed.
+
+#include "food/BasicFood.h"
+#include "food/CompositeFood.h"
+#include "food/FoodDatabase.h"
+#include "food/FuzzySearchIndex.h"
+#include "food/SubstringSearch.h"
+#include "log/FoodDayIndex.h"
+#include "log/FoodLog.h"
+#include "log/LogArchive.h"
+#include "log/LogExporter.h"
+#include "log/Varint.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<int> checkCount{0};
+std::atomic<int> failureCount{0};
+
+void check(bool passed, const char* expression, const char* file, int line) {
+    checkCount.fetch_add(1, std::memory_order_relaxed);
+    if (!passed) {
+        failureCount.fetch_add(1, std::memory_order_relaxed);
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+    }
+}
+
+// Safe to use from several threads at once
+#define CHECK(condition) check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
+
+std::string tempPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / ("yada_tests_" + name)).string();
+}
+
+void writeFile(const std::string& path, const std::string& contents) {
+    std::ofstream out(path, std::ios::binary);
+    out << contents;
+}
+
+std::string randomText(std::mt19937& rng, size_t length, const std::string& alphabet) {
+    std::uniform_int_distribution<size_t> letter(0, alphabet.size() - 1);
+    std::string text;
+    for (size_t i = 0; i < length; ++i) {
+        text += alphabet[letter(rng)];
+    }
+    return text;
+}
+
+// Catalog ------------------------------------------------------------------
+
+void testReadersDuringWrites() {
+    // Readers look up foods that are never removed, and hold on to foods the
+    // writer removes, while the writer adds, removes and changes calories
+    const size_t STABLE = 2000;
+    const size_t CHANGED = 10;  // Stable foods whose calories flip between 100 and 200
+    FoodDatabase database;
+    std::vector<std::shared_ptr<BasicFood>> stable;
+    for (size_t i = 0; i < STABLE; ++i) {
+        stable.push_back(std::make_shared<BasicFood>("Stable " + std::to_string(i), 100.0));
+    }
+    database.addBasicFoods(stable);
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> readers;
+    for (unsigned t = 0; t < 3; ++t) {
+        readers.emplace_back([&database, &stop, t] {
+            std::mt19937 rng(t);
+            std::uniform_int_distribution<size_t> pick(0, STABLE - 1);
+            std::vector<std::shared_ptr<Food>> held;
+            while (!stop.load()) {
+                size_t i = pick(rng);
+                std::string name = "Stable " + std::to_string(i);
+                auto food = database.findFoodByName(name);
+                CHECK(food && food->getName() == name);
+                if (food) {
+                    double calories = food->getCaloriesPerServing();
+                    CHECK(calories == 100.0 || (i < CHANGED && calories == 200.0));
+                }
+                auto churn = database.completeName("churn", 4);
+                held.insert(held.end(), churn.begin(), churn.end());
+                if (held.size() > 64) {
+                    held.erase(held.begin(), held.begin() + 32);
+                }
+                for (const auto& kept : held) {
+                    CHECK(kept->getName().compare(0, 6, "Churn ") == 0 && kept->getCaloriesPerServing() == 5.0);
+                }
+            }
+        });
+    }
+
+    std::vector<std::shared_ptr<Food>> churned;
+    std::vector<bool> removed;
+    for (size_t round = 0; round < 400; ++round) {
+        auto food = std::make_shared<BasicFood>("Churn " + std::to_string(round), 5.0);
+        database.addFood(food);
+        churned.push_back(food);
+        removed.push_back(false);
+        if (round % 3 == 2 && !removed[round - 2]) {
+            database.removeFood(*churned[round - 2]);
+            removed[round - 2] = true;
+        }
+        if (round % 50 == 49) {
+            // Most of the last fifty at once, so their segments are purged
+            std::vector<std::shared_ptr<Food>> batch;
+            for (size_t i = round - 48; i <= round; ++i) {
+                if (!removed[i] && i % 5 != 0) {
+                    batch.push_back(churned[i]);
+                    removed[i] = true;
+                }
+            }
+            database.removeFoods(batch);
+        }
+        if (round % 20 == 0) {
+            auto changed = std::static_pointer_cast<BasicFood>(
+                database.findFoodByName("Stable " + std::to_string(round / 20 % CHANGED)));
+            database.changeCalories(*changed, changed->getCaloriesPerServing() == 100.0 ? 200.0 : 100.0);
+        }
+    }
+    stop = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    size_t remaining = 0;
+    for (size_t round = 0; round < churned.size(); ++round) {
+        auto food = database.findFoodByName(churned[round]->getName());
+        CHECK(removed[round] ? food == nullptr : food == churned[round]);
+        remaining += removed[round] ? 0 : 1;
+    }
+    for (size_t i = 0; i < STABLE; ++i) {
+        CHECK(database.findFoodByName("Stable " + std::to_string(i)) != nullptr);
+    }
+    CHECK(remaining > 0 && database.size() == STABLE + remaining);
+}
+
+void testFindAfterRemoval() {
+    FoodDatabase database;
+    std::vector<std::shared_ptr<BasicFood>> batch;
+    for (int i = 0; i < 100; ++i) {
+        batch.push_back(std::make_shared<BasicFood>("Food " + std::to_string(i), 10.0 + i));
+    }
+    database.addBasicFoods(batch);
+    auto recipe = std::make_shared<CompositeFood>("Recipe");
+    recipe->addComponent(database.findFoodByName("Food 1"), 2.0);
+    database.addFood(recipe);
+
+    // One removal only marks the food in its segment
+    database.removeFood(*database.findFoodByName("Food 0"));
+    CHECK(database.findFoodByName("Food 0") == nullptr);
+    CHECK(database.findFoodByName("Food 2") == batch[2]);
+    CHECK(database.removeFood(*database.findFoodByName("Food 1"), true).size() == 2);
+    CHECK(database.findFoodByName("Recipe") == nullptr);
+
+    // Past a quarter of the segment it is copied without the removed foods
+    std::vector<std::shared_ptr<Food>> removed;
+    for (int i = 2; i < 60; i += 2) {
+        removed.push_back(batch[i]);
+    }
+    database.removeFoods(removed);
+    for (int i = 0; i < 100; ++i) {
+        auto food = database.findFoodByName("Food " + std::to_string(i));
+        bool gone = i < 2 || (i < 60 && i % 2 == 0);
+        CHECK(gone ? food == nullptr : food == batch[i]);
+    }
+    CHECK(database.size() == 100 - 2 - 29);
+    for (const auto& food : database.completeName("food 4", 20)) {
+        CHECK(food->getName() != "Food 4" && food->getName() != "Food 40");
+    }
+    std::vector<uint32_t> ids;
+    database.searchText("food 5", ids);
+    for (uint32_t id : ids) {
+        auto food = database.getFood(id);
+        CHECK(food && food->getName() != "Food 50" && food->getName() != "Food 52");
+    }
+
+    // A removed name can be used again
+    auto again = std::make_shared<BasicFood>("Food 4", 44.0);
+    database.addFood(again);
+    CHECK(database.findFoodByName("Food 4") == again);
+}
+
+// Log ----------------------------------------------------------------------
+
+void testArchiveRoundTrip() {
+    LogArchive archive;
+    std::mt19937 rng(7);
+    const std::vector<std::string> names = {"Oats", "Milk | whole", "Line\nbreak", "Caf\xc3\xa9 au lait", ""};
+    std::vector<std::vector<LogEntry>> written;
+    for (DayNumber day = 19000; day < 19040; day += 1 + static_cast<DayNumber>(rng() % 3)) {
+        std::vector<LogEntry> entries;
+        std::time_t timestamp = 1700000000;
+        for (size_t i = 0, count = rng() % 6; i < count; ++i) {
+            // Timestamps move both ways, so deltas take both signs
+            timestamp += static_cast<std::time_t>(rng() % 20000) - 10000;
+            entries.push_back({names[rng() % names.size()], (1 + rng() % 400) / 100.0, timestamp});
+        }
+        archive.putDay(day, entries, 123.45 * day);
+        written.resize(day - 19000 + 1);
+        written[day - 19000] = entries;
+    }
+    archive.putDay(19001, {{"Replaced", 1.5, -5}}, 7.0);
+    written[1] = {{"Replaced", 1.5, -5}};
+
+    std::ostringstream out;
+    archive.writeTo(out);
+    std::string path = tempPath("archive.bin");
+    writeFile(path, out.str());
+    LogArchive loaded;
+    loaded.loadFromFile(path);
+    std::remove(path.c_str());
+
+    CHECK(loaded.getDayCount() == archive.getDayCount());
+    for (DayNumber day = 19000; day < 19000 + static_cast<DayNumber>(written.size()); ++day) {
+        CHECK(loaded.contains(day) == archive.contains(day));
+        auto entries = loaded.getEntries(day);
+        const auto& expected = written[day - 19000];
+        CHECK(!archive.contains(day) || entries.size() == expected.size());
+        for (size_t i = 0; i < std::min(entries.size(), expected.size()); ++i) {
+            CHECK(entries[i].foodId == expected[i].foodId);
+            CHECK(entries[i].servings == expected[i].servings);
+            CHECK(entries[i].timestamp == expected[i].timestamp);
+        }
+    }
+    std::vector<DayRollup> before;
+    std::vector<DayRollup> after;
+    archive.forEachDay([&before](const DayRollup& rollup) { before.push_back(rollup); });
+    loaded.forEachDay([&after](const DayRollup& rollup) { after.push_back(rollup); });
+    CHECK(before.size() == after.size());
+    for (size_t i = 0; i < std::min(before.size(), after.size()); ++i) {
+        CHECK(before[i].day == after[i].day && before[i].entries == after[i].entries);
+        CHECK(std::abs(before[i].servings - after[i].servings) < 1e-9);
+        CHECK(std::abs(before[i].calories - after[i].calories) < 0.01);
+    }
+}
+
+void testFoodLogArchiveRoundTrip() {
+    // Old days move to the archive; saving and loading the archive and the
+    // log must give back every entry and the same totals
+    FoodDatabase database;
+    database.addFood(std::make_shared<BasicFood>("Apple", 95.0));
+    database.addFood(std::make_shared<BasicFood>("Bread slice", 80.0));
+    auto lookup = [&database](const std::string& name) { return database.findFoodByName(name); };
+    FoodLog log;
+    const std::vector<std::string> dates = {"2023-12-30", "2024-01-02", "2024-01-15", "2024-02-01", "2024-03-10"};
+    for (size_t d = 0; d < dates.size(); ++d) {
+        log.addEntry(database.findFoodByName("Apple"), 1.0 + 0.25 * d, dates[d]);
+        log.addEntry(database.findFoodByName("Bread slice"), 2.0, dates[d]);
+    }
+    CHECK(log.archiveBefore("2024-02-01", lookup) == 3);
+    LogTotals totals = log.getLoggedTotals("2023-01-01", "2024-12-31", lookup);
+
+    std::ostringstream archiveOut;
+    log.writeArchiveTo(archiveOut);
+    std::ostringstream logOut;
+    log.writeTo(logOut);
+    std::string archivePath = tempPath("food_log_archive.txt");
+    std::string logPath = tempPath("food_log.txt");
+    writeFile(archivePath, archiveOut.str());
+    writeFile(logPath, logOut.str());
+    FoodLog loaded;
+    loaded.loadArchiveFromFile(archivePath);
+    loaded.loadFromFile(logPath);
+    std::remove(archivePath.c_str());
+    std::remove(logPath.c_str());
+
+    CHECK(loaded.getArchivedDayCount() == 3);
+    LogTotals reloaded = loaded.getLoggedTotals("2023-01-01", "2024-12-31", lookup);
+    CHECK(reloaded.days == totals.days && reloaded.entries == totals.entries);
+    CHECK(std::abs(reloaded.servings - totals.servings) < 1e-9);
+    CHECK(std::abs(reloaded.calories - totals.calories) < 0.01);
+    std::vector<std::string> before;
+    std::vector<std::string> after;
+    auto collect = [](std::vector<std::string>& rows) {
+        return [&rows](DayNumber day, const LogEntry& entry) {
+            rows.push_back(FoodDayIndex::formatDay(day) + "|" + entry.foodId + "|" + std::to_string(entry.servings));
+        };
+    };
+    log.forEachEntryBetween("2023-01-01", "2024-12-31", collect(before));
+    loaded.forEachEntryBetween("2023-01-01", "2024-12-31", collect(after));
+    CHECK(before.size() == 10);
+    CHECK(before == after);
+    CHECK(loaded.getDatesWithFood("Apple").size() == dates.size());
+}
+
+void testFoodDayIndex() {
+    FoodDayIndex index;
+    std::set<DayNumber> apples;
+    std::set<DayNumber> pears;
+    std::mt19937 rng(11);
+    // Appends in order cross several blocks, then back-dated days land in them
+    for (DayNumber day = 20000; day < 20400; day += 1 + static_cast<DayNumber>(rng() % 2)) {
+        index.add("Apple", day);
+        apples.insert(day);
+    }
+    for (int i = 0; i < 300; ++i) {
+        DayNumber day = 19900 + static_cast<DayNumber>(rng() % 600);
+        if (rng() % 3 == 0) {
+            index.remove("Apple", day);
+            apples.erase(day);
+        } else {
+            index.add("Apple", day);
+            apples.insert(day);
+        }
+        DayNumber pearDay = 19950 + static_cast<DayNumber>(rng() % 500);
+        index.add("Pear", pearDay);
+        pears.insert(pearDay);
+    }
+    index.add("Apple", *apples.begin());  // Already present
+    index.remove("Apple", 10);            // Never added
+    index.remove("Plum", 20000);          // Unknown food
+
+    std::vector<DayNumber> expected(apples.begin(), apples.end());
+    CHECK(index.getDays("Apple") == expected);
+    CHECK(index.getDays("Plum").empty());
+    for (DayNumber from : {19800, 20000, 20063, 20300}) {
+        for (DayNumber to : {19900, 20064, 20128, 20600}) {
+            size_t count = from > to ? 0 : std::distance(apples.lower_bound(from), apples.upper_bound(to));
+            CHECK(index.countDays("Apple", from, to) == count);
+        }
+    }
+    std::vector<DayNumber> both;
+    std::set_intersection(apples.begin(), apples.end(), pears.begin(), pears.end(), std::back_inserter(both));
+    CHECK(index.intersect({"Apple", "Pear"}) == both);
+    CHECK(index.intersect({"Pear", "Plum"}).empty());
+
+    DayNumber day;
+    CHECK(FoodDayIndex::parseDay("2024-02-29", day) && FoodDayIndex::formatDay(day) == "2024-02-29");
+    CHECK(!FoodDayIndex::parseDay("2023-02-29", day));
+    CHECK(FoodDayIndex::parseDay("1970-01-01", day) && day == 0);
+}
+
+// Search kernels -----------------------------------------------------------
+
+int referenceEditDistance(const std::string& pattern, const std::string& text) {
+    std::vector<int> row(text.size() + 1);
+    for (size_t j = 0; j <= text.size(); ++j) {
+        row[j] = static_cast<int>(j);
+    }
+    for (size_t i = 1; i <= pattern.size(); ++i) {
+        int diagonal = row[0];
+        row[0] = static_cast<int>(i);
+        for (size_t j = 1; j <= text.size(); ++j) {
+            int above = row[j];
+            row[j] = std::min({row[j] + 1, row[j - 1] + 1, diagonal + (pattern[i - 1] == text[j - 1] ? 0 : 1)});
+            diagonal = above;
+        }
+    }
+    return row[text.size()];
+}
+
+void testEditDistance() {
+    std::mt19937 rng(3);
+    for (int i = 0; i < 3000; ++i) {
+        const std::string alphabet = i % 2 ? "ab" : "abcdefgh";
+        std::string pattern = randomText(rng, rng() % 70, alphabet);
+        std::string text = randomText(rng, rng() % 80, alphabet);
+        CHECK(FuzzySearchIndex::editDistance(pattern, text) == referenceEditDistance(pattern.substr(0, 64), text));
+    }
+    CHECK(FuzzySearchIndex::editDistance("", "") == 0);
+    CHECK(FuzzySearchIndex::editDistance("kitten", "sitting") == 3);
+    CHECK(FuzzySearchIndex::editDistance("chiken", "chicken") == 1);
+}
+
+void testFindSubstring() {
+    std::mt19937 rng(5);
+    for (int i = 0; i < 20000; ++i) {
+        const std::string alphabet = i % 3 ? "ab" : "abc xyz";
+        std::string haystack = randomText(rng, rng() % 300, alphabet);
+        std::string needle;
+        if (i % 4 == 0 && !haystack.empty()) {
+            // A piece of the haystack, so it is found, often near the end
+            size_t start = haystack.size() - 1 - rng() % std::min<size_t>(haystack.size(), 40);
+            needle = haystack.substr(start, 1 + rng() % 40);
+        } else {
+            needle = randomText(rng, rng() % 40, alphabet);
+        }
+        size_t expected = haystack.find(needle);
+        size_t found = findSubstring(haystack.data(), haystack.size(), needle.data(), needle.size());
+        CHECK(found == (expected == std::string::npos ? SUBSTRING_NOT_FOUND : expected));
+    }
+}
+
+// Encodings ----------------------------------------------------------------
+
+void testVarint() {
+    const uint64_t values[] = {0, 1, 127, 128, 16383, 16384, uint64_t(1) << 35, uint64_t(1) << 63,
+                               std::numeric_limits<uint64_t>::max()};
+    std::vector<uint8_t> bytes;
+    for (uint64_t value : values) {
+        writeVarint(bytes, value);
+    }
+    size_t offset = 0;
+    for (uint64_t value : values) {
+        CHECK(readVarint(bytes, offset) == value);
+    }
+    CHECK(offset == bytes.size());
+    CHECK(bytes.size() == 1 + 1 + 1 + 2 + 2 + 3 + 6 + 10 + 10);
+
+    const int64_t signedValues[] = {0, -1, 1, -2, 63, -64, 64, std::numeric_limits<int64_t>::min(),
+                                    std::numeric_limits<int64_t>::max()};
+    for (int64_t value : signedValues) {
+        CHECK(zigzagDecode(zigzagEncode(value)) == value);
+    }
+    CHECK(zigzagEncode(0) == 0 && zigzagEncode(-1) == 1 && zigzagEncode(1) == 2 && zigzagEncode(-64) == 127);
+    CHECK(zigzagEncode(std::numeric_limits<int64_t>::min()) == std::numeric_limits<uint64_t>::max());
+}
+
+void testExportEscaping() {
+    FoodDatabase database;
+    const std::vector<std::string> names = {"Plain", "Comma, cheese", "Say \"hi\"", "Line\nbreak",
+                                            "Back\\slash", "Tab\tbed"};
+    FoodLog log;
+    for (const auto& name : names) {
+        auto food = std::make_shared<BasicFood>(name, 100.0);
+        database.addFood(food);
+        log.addEntry(food, 1.5, "2024-03-15");
+    }
+    LogExporter exporter(log, [&database](const std::string& name) { return database.findFoodByName(name); });
+
+    std::ostringstream csv;
+    CHECK(exporter.exportRange("2024-03-01", "2024-03-31", csv) == names.size());
+    std::string text = csv.str();
+    CHECK(text.find("2024-03-15,Plain,1.5,150,") != std::string::npos);
+    CHECK(text.find(",\"Comma, cheese\",") != std::string::npos);
+    CHECK(text.find(",\"Say \"\"hi\"\"\",") != std::string::npos);
+    CHECK(text.find(",\"Line\nbreak\",") != std::string::npos);
+    CHECK(text.find(",Back\\slash,") != std::string::npos);
+    CHECK(text.find(",Tab\tbed,") != std::string::npos);
+
+    std::ostringstream jsonLines;
+    ExportOptions options;
+    options.format = ExportFormat::JSON_LINES;
+    CHECK(exporter.exportRange("2024-03-01", "2024-03-31", jsonLines, options) == names.size());
+    text = jsonLines.str();
+    CHECK(std::count(text.begin(), text.end(), '\n') == static_cast<long>(names.size()));
+    CHECK(text.find("{\"date\":\"2024-03-15\",\"food\":\"Plain\",\"servings\":1.5,\"calories\":150,") !=
+          std::string::npos);
+    CHECK(text.find("\"food\":\"Say \\\"hi\\\"\"") != std::string::npos);
+    CHECK(text.find("\"food\":\"Line\\u000abreak\"") != std::string::npos);
+    CHECK(text.find("\"food\":\"Back\\\\slash\"") != std::string::npos);
+    CHECK(text.find("\"food\":\"Tab\\u0009bed\"") != std::string::npos);
+}
+
+struct Test {
+    const char* name;
+    void (*run)();
+};
+
+const Test TESTS[] = {
+    {"readers_during_writes", testReadersDuringWrites},
+    {"find_after_removal", testFindAfterRemoval},
+    {"archive_round_trip", testArchiveRoundTrip},
+    {"food_log_archive_round_trip", testFoodLogArchiveRoundTrip},
+    {"food_day_index", testFoodDayIndex},
+    {"edit_distance", testEditDistance},
+    {"find_substring", testFindSubstring},
+    {"varint", testVarint},
+    {"export_escaping", testExportEscaping},
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string filter = argc > 1 ? argv[1] : "";
+    for (const auto& test : TESTS) {
+        if (!filter.empty() && std::string(test.name).find(filter) == std::string::npos) {
+            continue;
+        }
+        int failuresBefore = failureCount.load();
+        test.run();
+        std::fprintf(stderr, "%-32s %s\n", test.name, failureCount.load() == failuresBefore ? "ok" : "FAILED");
+    }
+    std::fprintf(stderr, "%d checks, %d failed\n", checkCount.load(), failureCount.load());
+    return std::min(failureCount.load(), 255);
+}
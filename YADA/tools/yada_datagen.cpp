@@ -0,0 +1,297 @@
+// Synthetic dataset generator for yada.
+//
+// Writes food_database.txt, food_log.txt and user_profile.txt in the same
+// formats the application reads, at whatever scale is requested. Keywords are
+// drawn from a vocabulary with a Zipf distribution so that a few words are very
+// common and most are rare, as in real catalogs; foods are logged with the same
+// skew. Composite foods are layered so every nesting level up to --max-depth
+// occurs.
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::string outputDir = ".";
+    size_t foods = 10000;
+    size_t vocabulary = 5000;
+    double zipfExponent = 1.1;
+    size_t minKeywords = 2;
+    size_t maxKeywords = 6;
+    double compositeRatio = 0.1;
+    size_t maxDepth = 3;
+    size_t fanOut = 4;
+    double years = 2.0;
+    double entriesPerDay = 6.0;
+    unsigned seed = 42;
+};
+
+void printUsage() {
+    std::cerr <<
+        "Usage: yada_datagen [options]\n"
+        "  --out DIR               output directory (default .)\n"
+        "  --foods N               total foods, basic and composite (default 10000)\n"
+        "  --vocabulary N          distinct keywords (default 5000)\n"
+        "  --zipf S                Zipf exponent for keyword and food popularity (default 1.1)\n"
+        "  --keywords MIN-MAX      keywords per food (default 2-6)\n"
+        "  --composite-ratio R     fraction of foods that are composite (default 0.1)\n"
+        "  --max-depth N           composite nesting depth (default 3)\n"
+        "  --fan-out N             components per composite (default 4)\n"
+        "  --years Y               years of log history ending today (default 2)\n"
+        "  --entries-per-day N     mean log entries per day (default 6)\n"
+        "  --seed N                random seed (default 42)\n";
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--out") {
+            options.outputDir = value;
+        } else if (arg == "--foods") {
+            options.foods = std::stoul(value);
+        } else if (arg == "--vocabulary") {
+            options.vocabulary = std::max<size_t>(1, std::stoul(value));
+        } else if (arg == "--zipf") {
+            options.zipfExponent = std::stod(value);
+        } else if (arg == "--keywords") {
+            size_t dash = value.find('-');
+            options.minKeywords = std::stoul(value.substr(0, dash));
+            options.maxKeywords = dash == std::string::npos ? options.minKeywords : std::stoul(value.substr(dash + 1));
+            if (options.maxKeywords < options.minKeywords) return false;
+        } else if (arg == "--composite-ratio") {
+            options.compositeRatio = std::min(1.0, std::max(0.0, std::stod(value)));
+        } else if (arg == "--max-depth") {
+            options.maxDepth = std::stoul(value);
+        } else if (arg == "--fan-out") {
+            options.fanOut = std::max<size_t>(1, std::stoul(value));
+        } else if (arg == "--years") {
+            options.years = std::stod(value);
+        } else if (arg == "--entries-per-day") {
+            options.entriesPerDay = std::stod(value);
+        } else if (arg == "--seed") {
+            options.seed = static_cast<unsigned>(std::stoul(value));
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::discrete_distribution<size_t> zipfDistribution(size_t n, double exponent) {
+    std::vector<double> weights(n);
+    for (size_t rank = 0; rank < n; ++rank) {
+        weights[rank] = 1.0 / std::pow(static_cast<double>(rank + 1), exponent);
+    }
+    return std::discrete_distribution<size_t>(weights.begin(), weights.end());
+}
+
+// Pronounceable, unique word for each vocabulary rank
+std::string makeWord(size_t rank) {
+    static const char* const syllables[] = {
+        "ba", "ce", "di", "fo", "gu", "ha", "ke", "li", "mo", "nu",
+        "pa", "re", "si", "to", "vu", "za", "lan", "mer", "sor", "tin"
+    };
+    const size_t count = sizeof(syllables) / sizeof(syllables[0]);
+    std::string word;
+    size_t value = rank;
+    do {
+        word += syllables[value % count];
+        value /= count;
+    } while (value > 0);
+    return word;
+}
+
+std::string formatDate(std::time_t time) {
+    std::tm* tm = std::localtime(&time);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d", tm);
+    return buffer;
+}
+
+struct GeneratedFood {
+    std::string name;
+    bool composite;
+    double calories;
+    std::vector<std::string> keywords;
+    std::vector<std::pair<size_t, double>> components;  // index into foods, servings
+};
+
+std::vector<GeneratedFood> generateFoods(const Options& options, std::mt19937& rng) {
+    auto keywordDist = zipfDistribution(options.vocabulary, options.zipfExponent);
+    std::uniform_int_distribution<size_t> keywordCountDist(options.minKeywords, options.maxKeywords);
+    std::uniform_real_distribution<double> calorieDist(5.0, 900.0);
+    std::uniform_int_distribution<int> servingsDist(1, 8);
+
+    size_t compositeCount = options.maxDepth == 0 ? 0
+        : static_cast<size_t>(options.foods * options.compositeRatio);
+    size_t basicCount = options.foods - compositeCount;
+    if (basicCount == 0 && options.foods > 0) {
+        basicCount = 1;
+        compositeCount = options.foods - 1;
+    }
+
+    std::vector<GeneratedFood> foods;
+    foods.reserve(options.foods);
+    auto addKeywords = [&](GeneratedFood& food) {
+        std::set<size_t> chosen;
+        size_t wanted = std::min(keywordCountDist(rng), options.vocabulary);
+        while (chosen.size() < wanted) {
+            chosen.insert(keywordDist(rng));
+        }
+        for (size_t rank : chosen) {
+            food.keywords.push_back(makeWord(rank));
+        }
+    };
+
+    for (size_t i = 0; i < basicCount; ++i) {
+        GeneratedFood food{"Food " + std::to_string(i), false, std::round(calorieDist(rng)), {}, {}};
+        addKeywords(food);
+        foods.push_back(std::move(food));
+    }
+
+    // Composites at level L take one component from level L-1 and the rest
+    // from any lower level, so each level really reaches depth L
+    std::vector<size_t> levelStart = {0, basicCount};
+    for (size_t level = 1; level <= options.maxDepth && compositeCount > 0; ++level) {
+        size_t remainingLevels = options.maxDepth - level + 1;
+        size_t levelCount = (compositeCount + remainingLevels - 1) / remainingLevels;
+        compositeCount -= levelCount;
+        size_t previousBegin = levelStart[level - 1];
+        size_t previousEnd = levelStart[level];
+        std::uniform_int_distribution<size_t> previousDist(previousBegin, previousEnd - 1);
+        std::uniform_int_distribution<size_t> anyLowerDist(0, previousEnd - 1);
+
+        for (size_t i = 0; i < levelCount; ++i) {
+            GeneratedFood food{"Recipe " + std::to_string(level) + "-" + std::to_string(i), true, 0.0, {}, {}};
+            std::set<size_t> used;
+            used.insert(previousDist(rng));
+            size_t wanted = std::min(options.fanOut, previousEnd);
+            while (used.size() < wanted) {
+                used.insert(anyLowerDist(rng));
+            }
+            for (size_t component : used) {
+                double servings = servingsDist(rng) * 0.5;
+                food.components.emplace_back(component, servings);
+                food.calories += foods[component].calories * servings;
+            }
+            addKeywords(food);
+            foods.push_back(std::move(food));
+        }
+        levelStart.push_back(foods.size());
+    }
+    return foods;
+}
+
+void writeFoodDatabase(const std::string& path, const std::vector<GeneratedFood>& foods) {
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("Could not open file for writing: " + path);
+    }
+    for (const auto& food : foods) {
+        file << (food.composite ? "Composite" : "Basic") << "|" << food.name << "|" << food.calories
+             << "|" << food.keywords.size();
+        for (const auto& keyword : food.keywords) {
+            file << "|" << keyword;
+        }
+        if (food.composite) {
+            file << "|" << food.components.size();
+            for (const auto& component : food.components) {
+                file << "|" << foods[component.first].name << "|" << component.second;
+            }
+        }
+        file << "\n";
+    }
+}
+
+size_t writeFoodLog(const std::string& path, const std::vector<GeneratedFood>& foods,
+    const Options& options, std::mt19937& rng) {
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("Could not open file for writing: " + path);
+    }
+    if (foods.empty()) return 0;
+
+    auto foodDist = zipfDistribution(foods.size(), options.zipfExponent);
+    // Popularity ranks are shuffled so popular foods are not all basic foods
+    std::vector<size_t> popularity(foods.size());
+    for (size_t i = 0; i < popularity.size(); ++i) popularity[i] = i;
+    std::shuffle(popularity.begin(), popularity.end(), rng);
+
+    std::poisson_distribution<size_t> entriesDist(options.entriesPerDay);
+    std::uniform_int_distribution<int> servingsDist(1, 6);
+    std::uniform_int_distribution<int> secondOfDayDist(6 * 3600, 22 * 3600);
+
+    const std::time_t secondsPerDay = 24 * 60 * 60;
+    std::time_t now = std::time(nullptr);
+    size_t days = static_cast<size_t>(options.years * 365.25);
+    size_t entries = 0;
+    for (size_t d = days; d-- > 0;) {
+        std::time_t dayTime = now - static_cast<std::time_t>(d) * secondsPerDay;
+        std::string date = formatDate(dayTime);
+        std::time_t midnight = dayTime - dayTime % secondsPerDay;
+
+        // The application merges repeated foods within a day, so keep them unique
+        size_t wanted = std::min(entriesDist(rng), foods.size());
+        std::set<size_t> eaten;
+        while (eaten.size() < wanted) {
+            eaten.insert(popularity[foodDist(rng)]);
+        }
+        for (size_t index : eaten) {
+            file << date << "|" << foods[index].name << "|" << servingsDist(rng) * 0.5 << "|"
+                 << midnight + secondOfDayDist(rng) << "\n";
+            ++entries;
+        }
+    }
+    return entries;
+}
+
+void writeUserProfile(const std::string& path) {
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("Could not open file for writing: " + path);
+    }
+    file << "M|178|34|76.5|2|2\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    try {
+        std::filesystem::create_directories(options.outputDir);
+        std::filesystem::path dir(options.outputDir);
+        std::mt19937 rng(options.seed);
+
+        auto foods = generateFoods(options, rng);
+        writeFoodDatabase((dir / "food_database.txt").string(), foods);
+        size_t entries = writeFoodLog((dir / "food_log.txt").string(), foods, options, rng);
+        writeUserProfile((dir / "user_profile.txt").string());
+
+        size_t composites = std::count_if(foods.begin(), foods.end(),
+            [](const GeneratedFood& food) { return food.composite; });
+        std::cout << "Wrote " << foods.size() << " foods (" << composites << " composite) and "
+                  << entries << " log entries to " << options.outputDir << "\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,400 @@
+// Stand-in food catalog server for WebFoodSource.
+//
+// Serves the foods of a foods file ("name|calories|keyword count|keywords..."
+// lines, as FileFoodSource reads them) over the protocol WebFoodSource
+// speaks: batched lookups with per-food ETags and a Cache-Control max-age,
+// filtered paging, counts and additions. Connections are kept alive, one
+// thread each. An optional delay per request makes batching and request
+// coalescing visible; GET /stats reports what the server has seen. POSIX only.
+
+#include "food/FoodDataSource.h"
+#include "food/WebFoodSource.h"
+#include "net/Json.h"
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+struct Options {
+    std::string foodsFile;
+    int port = 8080;
+    int maxAgeSeconds = 300;
+    int latencyMs = 0;
+};
+
+void printUsage() {
+    std::cerr <<
+        "Usage: yada_food_server --foods FILE [options]\n"
+        "  --foods FILE            foods to serve, one \"name|calories|keywords...\" line each\n"
+        "  --port N                port to listen on at 127.0.0.1 (default 8080)\n"
+        "  --max-age S             max-age sent with lookups, in seconds (default 300)\n"
+        "  --latency-ms N          delay before answering each request (default 0)\n";
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--foods") {
+            options.foodsFile = value;
+        } else if (arg == "--port") {
+            options.port = std::stoi(value);
+        } else if (arg == "--max-age") {
+            options.maxAgeSeconds = std::stoi(value);
+        } else if (arg == "--latency-ms") {
+            options.latencyMs = std::stoi(value);
+        } else {
+            return false;
+        }
+    }
+    return !options.foodsFile.empty();
+}
+
+struct Request {
+    std::string method;
+    std::string path;
+    std::unordered_map<std::string, std::string> query;
+    std::string body;
+};
+
+struct Response {
+    int status = 200;
+    std::string body;
+    std::string cacheControl;
+};
+
+// The ETag changes whenever anything about the food does
+std::string etagOf(const BasicFood& food) {
+    std::ostringstream record;
+    writeFoodRecord(record, food);
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : record.str()) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+    }
+    std::ostringstream etag;
+    etag << '"' << std::hex << hash << '"';
+    return etag.str();
+}
+
+class Catalog {
+public:
+    explicit Catalog(const std::string& foodsFile) {
+        FileFoodSource source(foodsFile);
+        for (const auto& food : source.getFoods()) {
+            add(food);
+        }
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return foods.size();
+    }
+
+    Response lookup(const JsonValue& body, int maxAgeSeconds) {
+        JsonValue items = JsonValue::array();
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& item : body.find("items")->asArray()) {
+            const std::string& name = item.find("name")->asString();
+            JsonValue answer = JsonValue::object();
+            answer.set("name", name);
+            auto found = byName.find(name);
+            if (found == byName.end()) {
+                answer.set("status", "missing");
+            } else {
+                const std::string& etag = etags[found->second];
+                const JsonValue* known = item.find("etag");
+                answer.set("etag", etag);
+                if (known && known->asString() == etag) {
+                    answer.set("status", "not_modified");
+                } else {
+                    answer.set("status", "ok");
+                    answer.set("food", foodToJson(*foods[found->second]));
+                }
+            }
+            items.push(std::move(answer));
+        }
+        lookedUp += body.find("items")->asArray().size();
+        JsonValue reply = JsonValue::object();
+        reply.set("items", std::move(items));
+        return {200, reply.toString(), "max-age=" + std::to_string(maxAgeSeconds)};
+    }
+
+    Response list(const Request& request) {
+        FoodFilter filter = filterOf(request);
+        size_t offset = numberOf(request, "offset", 0);
+        size_t limit = numberOf(request, "limit", 256);
+        JsonValue page = JsonValue::array();
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t index = offset;
+        for (; index < foods.size() && page.asArray().size() < limit; ++index) {
+            if (filter.matches(*foods[index])) {
+                page.push(foodToJson(*foods[index]));
+            }
+        }
+        JsonValue reply = JsonValue::object();
+        reply.set("foods", std::move(page));
+        reply.set("next", index < foods.size() ? JsonValue(static_cast<double>(index)) : JsonValue());
+        return {200, reply.toString(), ""};
+    }
+
+    Response count(const Request& request) {
+        FoodFilter filter = filterOf(request);
+        size_t matches = 0;
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& food : foods) {
+            matches += filter.matches(*food) ? 1 : 0;
+        }
+        JsonValue reply = JsonValue::object();
+        reply.set("count", static_cast<double>(matches));
+        return {200, reply.toString(), ""};
+    }
+
+    Response addFoods(const JsonValue& body) {
+        size_t added = 0;
+        std::vector<std::shared_ptr<BasicFood>> incoming;
+        for (const auto& food : body.find("foods")->asArray()) {
+            incoming.push_back(foodFromJson(food));
+        }
+        for (const auto& food : incoming) {
+            std::lock_guard<std::mutex> lock(mutex);
+            added += add(food) ? 1 : 0;
+        }
+        JsonValue reply = JsonValue::object();
+        reply.set("added", static_cast<double>(added));
+        return {200, reply.toString(), ""};
+    }
+
+    size_t getLookedUp() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return lookedUp;
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::vector<std::shared_ptr<BasicFood>> foods;
+    std::vector<std::string> etags;
+    std::unordered_map<std::string, size_t> byName;
+    size_t lookedUp = 0;
+
+    bool add(const std::shared_ptr<BasicFood>& food) {
+        if (!byName.emplace(food->getName(), foods.size()).second) {
+            return false;
+        }
+        foods.push_back(food);
+        etags.push_back(etagOf(*food));
+        return true;
+    }
+
+    static size_t numberOf(const Request& request, const std::string& key, size_t otherwise) {
+        auto it = request.query.find(key);
+        return it == request.query.end() ? otherwise : std::stoul(it->second);
+    }
+
+    static FoodFilter filterOf(const Request& request) {
+        FoodFilter filter;
+        auto get = [&request](const char* key) -> const std::string* {
+            auto it = request.query.find(key);
+            return it == request.query.end() ? nullptr : &it->second;
+        };
+        if (auto value = get("prefix")) filter.namePrefix = *value;
+        if (auto value = get("keyword")) filter.keyword = *value;
+        if (auto value = get("min_calories")) filter.minCalories = std::stod(*value);
+        if (auto value = get("max_calories")) filter.maxCalories = std::stod(*value);
+        return filter;
+    }
+};
+
+std::string decodeQuery(const std::string& text) {
+    std::string out;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '%' && i + 2 < text.size()) {
+            out += static_cast<char>(std::stoi(text.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            out += text[i] == '+' ? ' ' : text[i];
+        }
+    }
+    return out;
+}
+
+// Reads one request from the connection; false once the client has gone
+bool readRequest(int fd, std::string& buffer, Request& request) {
+    size_t headerEnd;
+    char chunk[16384];
+    while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+        ssize_t count = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (count <= 0) return false;
+        buffer.append(chunk, static_cast<size_t>(count));
+    }
+    std::istringstream head(buffer.substr(0, headerEnd));
+    std::string target;
+    head >> request.method >> target;
+    size_t contentLength = 0;
+    std::string line;
+    std::getline(head, line);
+    while (std::getline(head, line)) {
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        std::string name = line.substr(0, colon);
+        for (auto& c : name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        if (name == "content-length") {
+            contentLength = std::stoul(line.substr(colon + 1));
+        }
+    }
+    buffer.erase(0, headerEnd + 4);
+    while (buffer.size() < contentLength) {
+        ssize_t count = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (count <= 0) return false;
+        buffer.append(chunk, static_cast<size_t>(count));
+    }
+    request.body = buffer.substr(0, contentLength);
+    buffer.erase(0, contentLength);
+
+    size_t question = target.find('?');
+    request.path = target.substr(0, question);
+    request.query.clear();
+    if (question != std::string::npos) {
+        std::istringstream parameters(target.substr(question + 1));
+        std::string parameter;
+        while (std::getline(parameters, parameter, '&')) {
+            size_t equals = parameter.find('=');
+            if (equals != std::string::npos) {
+                request.query[decodeQuery(parameter.substr(0, equals))] = decodeQuery(parameter.substr(equals + 1));
+            }
+        }
+    }
+    return true;
+}
+
+void sendResponse(int fd, const Response& response) {
+    std::string message = "HTTP/1.1 " + std::to_string(response.status) +
+                          (response.status == 200 ? " OK" : response.status == 404 ? " Not Found" : " Bad Request") +
+                          "\r\nContent-Type: application/json\r\nContent-Length: " +
+                          std::to_string(response.body.size()) + "\r\n";
+    if (!response.cacheControl.empty()) {
+        message += "Cache-Control: " + response.cacheControl + "\r\n";
+    }
+    message += "\r\n" + response.body;
+    size_t sent = 0;
+    while (sent < message.size()) {
+        ssize_t count = ::send(fd, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+        if (count <= 0) return;
+        sent += static_cast<size_t>(count);
+    }
+}
+
+std::atomic<size_t> requestCount(0);
+std::atomic<size_t> connectionCount(0);
+
+Response handle(Catalog& catalog, const Options& options, const Request& request) {
+    if (request.method == "POST" && request.path == "/foods/lookup") {
+        return catalog.lookup(JsonValue::parse(request.body), options.maxAgeSeconds);
+    }
+    if (request.method == "GET" && request.path == "/foods") {
+        return catalog.list(request);
+    }
+    if (request.method == "GET" && request.path == "/foods/count") {
+        return catalog.count(request);
+    }
+    if (request.method == "POST" && request.path == "/foods") {
+        return catalog.addFoods(JsonValue::parse(request.body));
+    }
+    if (request.method == "GET" && request.path == "/stats") {
+        JsonValue reply = JsonValue::object();
+        reply.set("requests", static_cast<double>(requestCount.load()));
+        reply.set("connections", static_cast<double>(connectionCount.load()));
+        reply.set("looked_up", static_cast<double>(catalog.getLookedUp()));
+        return {200, reply.toString(), ""};
+    }
+    return {404, "{\"error\":\"no such endpoint\"}", ""};
+}
+
+void serveConnection(int fd, Catalog& catalog, const Options& options) {
+    std::string buffer;
+    Request request;
+    while (readRequest(fd, buffer, request)) {
+        if (request.path != "/stats") {
+            ++requestCount;
+            if (options.latencyMs > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(options.latencyMs));
+            }
+        }
+        Response response;
+        try {
+            response = handle(catalog, options, request);
+        } catch (const std::exception& e) {
+            std::string error;
+            appendJsonString(error, e.what());
+            response = {400, "{\"error\":" + error + "}", ""};
+        }
+        sendResponse(fd, response);
+    }
+    ::close(fd);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        if (!parseOptions(argc, argv, options)) {
+            printUsage();
+            return 1;
+        }
+    } catch (const std::exception&) {
+        printUsage();
+        return 1;
+    }
+
+    std::unique_ptr<Catalog> catalog;
+    try {
+        catalog = std::make_unique<Catalog>(options.foodsFile);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<uint16_t>(options.port));
+    if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listener, 64) != 0) {
+        std::cerr << "Error: cannot listen on port " << options.port << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    std::cerr << "Serving " << catalog->size() << " foods on http://127.0.0.1:" << options.port << std::endl;
+
+    while (true) {
+        int fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0) continue;
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        ++connectionCount;
+        std::thread(serveConnection, fd, std::ref(*catalog), std::cref(options)).detach();
+    }
+}
@@ -0,0 +1,274 @@
+// Load-test driver for yada.
+//
+// Loads a dataset (for example one written by yada_datagen) through the same
+// classes UserInterface uses, then replays a randomized mix of log additions,
+// removals, undos, keyword searches and day views. Reports overall throughput
+// and per-operation latency percentiles.
+
+#include "command/Command.h"
+#include "food/FoodDatabase.h"
+#include "log/FoodLog.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum Operation { ADD, REMOVE, UNDO, SEARCH, VIEW, OPERATION_COUNT };
+const char* const OPERATION_NAMES[OPERATION_COUNT] = {"add", "remove", "undo", "search", "view"};
+
+struct Options {
+    std::string dataDir = ".";
+    size_t operations = 10000;
+    double weights[OPERATION_COUNT] = {30, 10, 10, 30, 20};
+    size_t historyDays = 730;
+    double zipfExponent = 1.1;
+    unsigned seed = 7;
+    bool json = false;
+};
+
+void printUsage() {
+    std::cerr <<
+        "Usage: yada_loadtest [options]\n"
+        "  --data DIR          directory with food_database.txt and food_log.txt (default .)\n"
+        "  --ops N             operations to replay (default 10000)\n"
+        "  --mix SPEC          relative weights, e.g. add=30,remove=10,undo=10,search=30,view=20\n"
+        "  --history-days N    days back from today that operations touch (default 730)\n"
+        "  --zipf S            popularity skew of foods and search terms (default 1.1)\n"
+        "  --seed N            random seed (default 7)\n"
+        "  --json              print the report as JSON\n";
+}
+
+// Operations not named in the spec get weight zero
+bool parseMix(const std::string& spec, Options& options) {
+    std::fill(std::begin(options.weights), std::end(options.weights), 0.0);
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t equals = item.find('=');
+        if (equals == std::string::npos) return false;
+        std::string name = item.substr(0, equals);
+        auto it = std::find_if(std::begin(OPERATION_NAMES), std::end(OPERATION_NAMES),
+            [&name](const char* candidate) { return name == candidate; });
+        if (it == std::end(OPERATION_NAMES)) return false;
+        options.weights[it - std::begin(OPERATION_NAMES)] = std::stod(item.substr(equals + 1));
+    }
+    return true;
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--json") {
+            options.json = true;
+            continue;
+        }
+        if (arg == "--help" || i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--data") {
+            options.dataDir = value;
+        } else if (arg == "--ops") {
+            options.operations = std::stoul(value);
+        } else if (arg == "--mix") {
+            if (!parseMix(value, options)) return false;
+        } else if (arg == "--history-days") {
+            options.historyDays = std::max<size_t>(1, std::stoul(value));
+        } else if (arg == "--zipf") {
+            options.zipfExponent = std::stod(value);
+        } else if (arg == "--seed") {
+            options.seed = static_cast<unsigned>(std::stoul(value));
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::discrete_distribution<size_t> zipfDistribution(size_t n, double exponent) {
+    std::vector<double> weights(n);
+    for (size_t rank = 0; rank < n; ++rank) {
+        weights[rank] = 1.0 / std::pow(static_cast<double>(rank + 1), exponent);
+    }
+    return std::discrete_distribution<size_t>(weights.begin(), weights.end());
+}
+
+std::string formatDate(std::time_t time) {
+    std::tm* tm = std::localtime(&time);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d", tm);
+    return buffer;
+}
+
+double percentile(std::vector<double>& sorted, double fraction) {
+    if (sorted.empty()) return 0.0;
+    size_t index = static_cast<size_t>(std::ceil(fraction * sorted.size())) - 1;
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+struct Report {
+    std::string name;
+    size_t count;
+    double p50, p95, p99, p999, max;  // microseconds
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    std::filesystem::path dir(options.dataDir);
+    FoodDatabase database;
+    FoodLog log;
+    CommandManager commands;
+
+    auto loadStart = Clock::now();
+    try {
+        database.loadFromFile((dir / "food_database.txt").string());
+        if (std::filesystem::exists(dir / "food_log.txt")) {
+            log.loadFromFile((dir / "food_log.txt").string());
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    double loadMs = std::chrono::duration<double, std::milli>(Clock::now() - loadStart).count();
+    if (database.empty()) {
+        std::cerr << "Error: the food database is empty\n";
+        return 1;
+    }
+
+    std::mt19937 rng(options.seed);
+    const auto& foods = database.getFoods();
+
+    // Popular foods and search terms follow the same skew as the generator
+    std::vector<size_t> foodOrder(foods.size());
+    for (size_t i = 0; i < foodOrder.size(); ++i) foodOrder[i] = i;
+    std::shuffle(foodOrder.begin(), foodOrder.end(), rng);
+    auto foodDist = zipfDistribution(foods.size(), options.zipfExponent);
+
+    std::map<std::string, size_t> keywordCounts;
+    for (const auto& food : foods) {
+        for (const auto& keyword : food->getKeywords()) {
+            ++keywordCounts[keyword];
+        }
+    }
+    std::vector<std::pair<size_t, std::string>> terms;
+    for (const auto& pair : keywordCounts) {
+        terms.emplace_back(pair.second, pair.first);
+    }
+    std::sort(terms.rbegin(), terms.rend());
+    if (terms.empty()) {
+        terms.emplace_back(0, "food");
+    }
+    auto termDist = zipfDistribution(terms.size(), options.zipfExponent);
+
+    std::vector<std::string> dates;
+    std::time_t now = std::time(nullptr);
+    for (size_t d = 0; d < options.historyDays; ++d) {
+        dates.push_back(formatDate(now - static_cast<std::time_t>(d) * 24 * 60 * 60));
+    }
+    // Most activity is about the last few days
+    auto dateDist = zipfDistribution(dates.size(), 1.0);
+
+    std::discrete_distribution<int> operationDist(std::begin(options.weights), std::end(options.weights));
+    std::uniform_int_distribution<int> servingsDist(1, 6);
+    std::bernoulli_distribution coin(0.5);
+    auto lookup = [&database](const std::string& name) { return database.findFoodByName(name); };
+
+    std::vector<double> latencies[OPERATION_COUNT];
+    double checksum = 0.0;
+    auto runStart = Clock::now();
+    for (size_t i = 0; i < options.operations; ++i) {
+        int operation = operationDist(rng);
+        const std::string& date = dates[dateDist(rng)];
+        auto start = Clock::now();
+        switch (operation) {
+            case ADD: {
+                const auto& food = foods[foodOrder[foodDist(rng)]];
+                commands.executeCommand(std::make_unique<AddFoodCommand>(log, food, servingsDist(rng) * 0.5, date));
+                break;
+            }
+            case REMOVE: {
+                auto entries = log.getEntriesForDate(date);
+                if (!entries.empty()) {
+                    size_t index = rng() % entries.size();
+                    auto food = database.findFoodByName(entries[index].foodId);
+                    if (food) {
+                        commands.executeCommand(std::make_unique<RemoveFoodCommand>(log, index, food, date));
+                    }
+                }
+                break;
+            }
+            case UNDO:
+                commands.undo();
+                break;
+            case SEARCH: {
+                std::string query = terms[termDist(rng)].second;
+                bool matchAll = coin(rng);
+                if (coin(rng)) {
+                    query += " " + terms[termDist(rng)].second;
+                }
+                checksum += database.searchFoodByKeywords(query, matchAll).size();
+                break;
+            }
+            case VIEW: {
+                auto entries = log.getEntriesForDate(date);
+                checksum += entries.size() + log.getTotalCaloriesForDate(date, lookup);
+                break;
+            }
+        }
+        latencies[operation].push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+    double runSeconds = std::chrono::duration<double>(Clock::now() - runStart).count();
+
+    std::vector<Report> reports;
+    for (int op = 0; op < OPERATION_COUNT; ++op) {
+        auto& samples = latencies[op];
+        std::sort(samples.begin(), samples.end());
+        reports.push_back({OPERATION_NAMES[op], samples.size(),
+                           percentile(samples, 0.50), percentile(samples, 0.95),
+                           percentile(samples, 0.99), percentile(samples, 0.999),
+                           samples.empty() ? 0.0 : samples.back()});
+    }
+    double throughput = runSeconds > 0 ? options.operations / runSeconds : 0.0;
+
+    if (options.json) {
+        std::printf("{\"foods\":%zu,\"load_ms\":%.1f,\"operations\":%zu,\"seconds\":%.3f,"
+                    "\"ops_per_second\":%.1f,\"latency_us\":{",
+                    foods.size(), loadMs, options.operations, runSeconds, throughput);
+        for (size_t i = 0; i < reports.size(); ++i) {
+            const auto& r = reports[i];
+            std::printf("%s\"%s\":{\"count\":%zu,\"p50\":%.1f,\"p95\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f}",
+                        i ? "," : "", r.name.c_str(), r.count, r.p50, r.p95, r.p99, r.p999, r.max);
+        }
+        std::printf("},\"checksum\":%.1f}\n", checksum);
+    } else {
+        std::printf("Loaded %zu foods in %.1f ms\n", foods.size(), loadMs);
+        std::printf("Replayed %zu operations in %.3f s (%.1f ops/s)\n\n",
+                    options.operations, runSeconds, throughput);
+        std::printf("%-8s %8s %10s %10s %10s %10s %10s   (microseconds)\n",
+                    "op", "count", "p50", "p95", "p99", "p99.9", "max");
+        for (const auto& r : reports) {
+            std::printf("%-8s %8zu %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                        r.name.c_str(), r.count, r.p50, r.p95, r.p99, r.p999, r.max);
+        }
+    }
+    return 0;
+}